@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+ * \file ideclcache.h
+ * Interface to the persistent cache of tokenised declaration files.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "imodule.h"
+
+namespace decl
+{
+
+/// A named definition block, as returned by the parser::DefBlockTokeniser
+struct DeclBlock
+{
+	std::string name;
+
+	// Block contents, excluding the braces
+	std::string contents;
+};
+
+/// The tokenised contents of a declaration file
+struct DeclFile
+{
+	// The folder of the archive the file is located in, to be resolved to
+	// the mod name with game::current::getModPath()
+	std::string modRoot;
+
+	// The blocks of the file, if requested as DeclFileContents::Blocks
+	std::vector<DeclBlock> blocks;
+
+	// All tokens of the file, if requested as DeclFileContents::Tokens
+	std::vector<std::string> tokens;
+};
+typedef std::shared_ptr<const DeclFile> DeclFilePtr;
+
+/// The form a declaration file is needed in
+enum class DeclFileContents
+{
+	Blocks, // split into named blocks with the DefBlockTokeniser
+	Tokens, // split into tokens with the DefTokeniser (default delimiters)
+};
+
+/**
+ * The declaration cache keeps the tokenised contents of the .mtr, .def, .sndshd,
+ * .skin, .prt etc. files across sessions, such that only the files which have
+ * changed since the previous session need to be tokenised again. The files are
+ * identified by their VFS path and the stamp of the physical file.
+ *
+ * The cache is loaded on startup and written back on shutdown.
+ */
+class IDeclCache :
+	public RegisterableModule
+{
+public:
+	/// Number of files served from the cache and number of files tokenised
+	struct Statistics
+	{
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+	};
+
+	/**
+	 * Returns the tokenised contents of the given VFS file, or an empty
+	 * pointer if the file doesn't exist. Throws parser::ParseException if
+	 * the file cannot be tokenised. Can be called from any thread.
+	 */
+	virtual DeclFilePtr getFile(const std::string& path, DeclFileContents contents) = 0;
+
+	/// Discards all cached files, on disk as well
+	virtual void invalidate() = 0;
+
+	/// The hits and misses since startup or the last invalidation
+	virtual Statistics getStatistics() = 0;
+};
+
+}
+
+const char* const MODULE_DECLCACHE("DeclCache");
+
+inline decl::IDeclCache& GlobalDeclCache()
+{
+	// Cache the reference locally
+	static decl::IDeclCache& _declCache(
+		*std::static_pointer_cast<decl::IDeclCache>(
+			module::GlobalModuleRegistry().getModule(MODULE_DECLCACHE)
+		)
+	);
+	return _declCache;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * \file ideclloadscheduler.h
+ * Interface to the scheduler running the background loaders of the
+ * declaration managers (materials, entityDefs, skins, etc.).
+ */
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "imodule.h"
+
+namespace decl
+{
+
+/// Scheduling priority of a loader job, higher priority jobs are started first
+enum class LoadPriority
+{
+	Low,
+	Normal,
+	High,
+};
+
+/**
+ * The load scheduler runs the declaration loaders on a fixed pool of worker
+ * threads (one per core), instead of each manager spawning its own thread.
+ *
+ * Jobs are identified by name and can declare the names of other jobs they
+ * depend on. A job is not started before all of its dependencies which have
+ * been scheduled so far are finished. Ready jobs are started in order of
+ * their priority. Jobs can split their work into sub-tasks (e.g. one per
+ * file), which are processed by the same workers.
+ *
+ * The start and finish times of every job are written to the log.
+ */
+class ILoadScheduler :
+	public RegisterableModule
+{
+public:
+	typedef std::function<void()> Task;
+
+	/// Handle to a scheduled job
+	class Job
+	{
+	public:
+		virtual ~Job() {}
+
+		/// Name the job has been scheduled with
+		virtual const std::string& getName() const = 0;
+
+		/// Returns true if the job has run to completion
+		virtual bool isFinished() const = 0;
+
+		/**
+		 * Blocks until the job has finished. A job which has not been picked
+		 * up by a worker yet (including its dependencies) is run on the
+		 * calling thread instead of waiting for a free worker.
+		 */
+		virtual void wait() = 0;
+	};
+	typedef std::shared_ptr<Job> JobPtr;
+
+	/**
+	 * Queue the given task as job with the given name. Any exception thrown
+	 * by the task is swallowed, callers interested in the outcome need to
+	 * take care of that themselves (e.g. by scheduling a packaged_task).
+	 */
+	virtual JobPtr schedule(const std::string& name, const Task& task,
+		const std::vector<std::string>& dependencies = {},
+		LoadPriority priority = LoadPriority::Normal) = 0;
+
+	/**
+	 * Runs the given independent sub-tasks on the worker pool and returns
+	 * once all of them are done. The calling thread is processing sub-tasks
+	 * too, this is safe to call from within a job. The first exception
+	 * thrown by any of the sub-tasks is rethrown after all tasks are done.
+	 */
+	virtual void runSubTasks(const std::vector<Task>& tasks) = 0;
+
+	/// The number of worker threads
+	virtual std::size_t getNumWorkers() const = 0;
+};
+
+}
+
+const char* const MODULE_DECLLOADSCHEDULER("DeclLoadScheduler");
+
+inline decl::ILoadScheduler& GlobalDeclLoadScheduler()
+{
+	// Cache the reference locally
+	static decl::ILoadScheduler& _scheduler(
+		*std::static_pointer_cast<decl::ILoadScheduler>(
+			module::GlobalModuleRegistry().getModule(MODULE_DECLLOADSCHEDULER)
+		)
+	);
+	return _scheduler;
+}
@@ -177,6 +177,22 @@ public:
       inherited(false)
     {}
 
+    /**
+     * Construct a non-inherited EntityClassAttribute from already allocated
+     * strings, which might be shared with other attributes (e.g. interned
+     * key names).
+     */
+    EntityClassAttribute(const StringPtr& typeRef,
+                         const StringPtr& nameRef,
+                         const StringPtr& valueRef,
+                         const StringPtr& descRef)
+    : _typeRef(typeRef),
+      _nameRef(nameRef),
+      _valueRef(valueRef),
+      _descRef(descRef),
+      inherited(false)
+    {}
+
     /**
      * Construct a inherited EntityClassAttribute with a true inherited flag.
      * The strings are taken from the inherited attribute.
@@ -271,9 +287,9 @@ public:
      *
      * @return
      * A reference to the named EntityClassAttribute. If the named attribute is
-     * not found, an empty EntityClassAttribute is returned.
+     * not found, an empty EntityClassAttribute is returned. Inherited attributes
+     * are shared with the parent classes, hence read-only.
      */
-    virtual EntityClassAttribute& getAttribute(const std::string& name) = 0;
     virtual const EntityClassAttribute& getAttribute(const std::string& name) const = 0;
 
     /**
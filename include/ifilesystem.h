@@ -7,9 +7,13 @@
  */
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <list>
+#include <map>
 #include <set>
+#include <vector>
+#include <future>
 #include <functional>
 #include <algorithm>
 
@@ -89,6 +93,60 @@ struct FileInfo
     }
 };
 
+/// Identifies the physical state of a file, to detect changes between sessions
+struct FileStamp
+{
+    /// The archive (PK4 file or directory) the file is located in
+    std::string archive;
+
+    /// Size and modification time of the physical file. For files in PK4s
+    /// these refer to the PK4 itself.
+    std::uint64_t size = 0;
+    std::int64_t modificationTime = 0;
+
+    bool operator==(const FileStamp& other) const
+    {
+        return size == other.size && modificationTime == other.modificationTime &&
+            archive == other.archive;
+    }
+
+    bool operator!=(const FileStamp& other) const
+    {
+        return !operator==(other);
+    }
+};
+
+/// Accumulated I/O statistics of a group of files in the virtual filesystem
+struct IOStatistics
+{
+    /// Number of times a file has been opened
+    std::size_t opens = 0;
+
+    /// Number of bytes passed to the readers
+    std::size_t bytesRead = 0;
+
+    /// Portion of bytesRead which had to be decompressed from a PK4
+    std::size_t bytesInflated = 0;
+
+    /// Time spent opening and reading the files, in microseconds
+    std::size_t latencyMicroseconds = 0;
+};
+
+/// Snapshot of the I/O statistics collected by the virtual filesystem
+struct IOStatisticsReport
+{
+    typedef std::map<std::string, IOStatistics> StatisticsMap;
+
+    /// Statistics per archive (PK4 file or directory)
+    StatisticsMap archives;
+
+    /// Statistics per lowercase file extension (without dot)
+    StatisticsMap extensions;
+
+    /// Highest number of files which have been open at the same time
+    std::size_t peakConcurrentReaders = 0;
+};
+
 /**
  * Main interface for the virtual filesystem.
  *
@@ -136,6 +194,18 @@ public:
 		 * down. An empty default implementation is provided.
 		 */
 		virtual void onFileSystemShutdown() {}
+
+		/**
+		 * Notification of files having been modified, added or removed on
+		 * disk, carrying the VFS paths of these files (e.g. "materials/foo.mtr").
+		 *
+		 * This is only sent while file watching is enabled and only covers
+		 * files located in physical directories, changes to files which are
+		 * overridden by higher-priority paths are not reported. Invoked from
+		 * within dispatchFileChanges(). An empty default implementation is
+		 * provided.
+		 */
+		virtual void onFilesChanged(const std::set<std::string>& changedFiles) {}
 	};
 
 	typedef std::set<std::string> ExtensionSet;
@@ -168,6 +238,21 @@ public:
 	/// This is a variant of openTextFile taking an absolute path as argument.
 	virtual ArchiveTextFilePtr openTextFileInAbsolutePath(const std::string& filename) = 0;
 
+	/**
+	 * \brief Opens the given files in text mode on a pool of worker threads.
+	 *
+	 * Each file is read (and decompressed) completely into memory, such that
+	 * parsing the returned ArchiveTextFile doesn't touch the disk anymore.
+	 * The files are scheduled in the given order, the workers are reading
+	 * ahead while the caller is still busy with earlier files. All of them are
+	 * held in memory until the caller releases them, callers working through
+	 * many files should request a few at a time.
+	 *
+	 * Returns one future per requested filename, in the same order. A future
+	 * yields an empty pointer if the corresponding file could not be found.
+	 */
+	virtual std::vector<std::future<ArchiveTextFilePtr>> openTextFilesAsync(const std::vector<std::string>& filenames) = 0;
+
 	/// \brief Calls the visitor function for each file under \p basedir matching \p extension.
 	/// Use "*" as \p extension to match all file extensions.
 	virtual void forEachFile(const std::string& basedir,
@@ -192,6 +277,42 @@ public:
 
 	// Returns the list of registered VFS paths, ordered by search priority
 	virtual const SearchPaths& getVfsSearchPaths() = 0;
+
+	/**
+	 * \brief Determines the stamp of the given file (the one with the highest
+	 * priority), returns false if the file doesn't exist.
+	 */
+	virtual bool getFileStamp(const std::string& filename, FileStamp& stamp) = 0;
+
+	/**
+	 * \brief Enables or disables monitoring the physical directories of the
+	 * VFS for changed files. This is only supported on Linux.
+	 */
+	virtual void setFileWatchingEnabled(bool enabled) = 0;
+
+	/**
+	 * \brief Collects the changes detected since the last call and notifies
+	 * the observers about them. Does nothing if file watching is disabled.
+	 * The observers are invoked on the calling thread.
+	 */
+	virtual void dispatchFileChanges() = 0;
+
+	/**
+	 * \brief Returns the I/O statistics collected since startup or since the
+	 * last call to resetIOStatistics(). Files are counted as soon as they're
+	 * opened, the bytes and time spent reading are added once they're closed.
+	 */
+	virtual IOStatisticsReport getIOStatistics() = 0;
+
+	/// Clears the I/O statistics collected so far
+	virtual void resetIOStatistics() = 0;
+
+	/**
+	 * \brief Starts writing a trace of all open and read events to the given
+	 * file (in CSV format), replacing any previously active trace. Passing an
+	 * empty path stops tracing. Returns false if the file cannot be opened.
+	 */
+	virtual bool setIOTraceFile(const std::string& path) = 0;
 };
 
 }
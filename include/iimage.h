@@ -56,6 +56,9 @@ public:
 
 typedef std::shared_ptr<BindableTexture> BindableTexturePtr;
 
+class Image;
+typedef std::shared_ptr<Image> ImagePtr;
+
 class Image
 : public BindableTexture
 {
@@ -76,10 +79,43 @@ public:
 	virtual bool isPrecompressed() const {
 		return false;
 	}
+
+	/**
+	 * Returns the number of mipmaps stored in this image, which can be
+	 * passed to getMipMapPixels() and friends.
+	 */
+	virtual std::size_t getMipMapCount() const {
+		return 1;
+	}
+
+	/**
+	 * \brief
+	 * Decompress the given mipmap of a precompressed image into an RGBA
+	 * image. Consumers needing a coarse version of the image only can
+	 * decompress one of the smaller mipmaps instead of the full image.
+	 *
+	 * \return
+	 * An empty pointer if this image isn't precompressed or its format is
+	 * not supported.
+	 */
+	virtual ImagePtr getDecompressedMipMap(std::size_t mipMapIndex) const {
+		return ImagePtr();
+	}
+
+	/**
+	 * \brief
+	 * Upload the pixel data into the given, already allocated GL texture,
+	 * replacing its previous contents. This allows a texture number to be
+	 * handed out before its image is available.
+	 *
+	 * \return
+	 * false if the image couldn't be uploaded.
+	 */
+	virtual bool uploadTexture(GLuint textureNum) const = 0;
 };
-typedef std::shared_ptr<Image> ImagePtr;
 
 class ArchiveFile;
+namespace vfs { struct FileStamp; }
 
 /// Module responsible for loading images from VFS or disk filesystem
 class ImageLoader :
@@ -105,6 +141,13 @@ public:
      * Load an image from a filesystem path.
      */
 	virtual ImagePtr imageFromFile(const std::string& filename) const = 0;
+
+    /**
+     * \brief
+     * Determine the stamp of the file imageFromVFS() would load for the given
+     * VFS path, without loading it. Returns false if there is no such file.
+     */
+    virtual bool getImageStamp(const std::string& vfsPath, vfs::FileStamp& stamp) const = 0;
 };
 
 typedef std::shared_ptr<ImageLoader> ImageLoaderPtr;
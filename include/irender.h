@@ -184,6 +184,16 @@ public:
     /// Return true if this light intersects the given AABB
 	virtual bool intersectsAABB(const AABB& aabb) const = 0;
 
+    /**
+     * \brief
+     * Return the world-space bounds of the light volume.
+     *
+     * The renderer uses these bounds to find the objects which may be lit by
+     * this light, so they must overlap every AABB intersectsAABB() returns
+     * true for. An invalid AABB stands for an unbounded light volume.
+     */
+    virtual AABB lightVolumeAABB() const = 0;
+
     /**
      * \brief
      * Return the light origin in world space.
@@ -230,6 +240,13 @@ public:
     /// Test if the given light intersects the LitObject
     virtual bool intersectsLight(const RendererLight& light) const = 0;
 
+    /**
+     * Return the world-space bounds of this object, lights not overlapping
+     * them are not tested with intersectsLight(). Objects with invalid bounds
+     * are tested against every light.
+     */
+    virtual AABB litObjectAABB() const = 0;
+
     /// Add a light to the set of lights which do intersect this object
     virtual void insertLight(const RendererLight& light) {}
 
@@ -270,14 +287,16 @@ typedef std::function<void(const RendererLight&)> RendererLightCallback;
  * it invokes LightList::calculateIntersectingLights() on the stored LightList
  * reference.
  * 4. calculateIntersectingLights() first checks to see if the lights need
- * updating, which is true if EITHER this LightList's setDirty() method OR the
- * RenderSystem's lightChanged() has been called since the last calculation. If
- * no update is needed, it returns.
- * 5. If an update IS needed, the LightList iterates over all lights in the
- * scene, and tests if each one intersects its associated lit object (which is
- * the one that just invoked calculateIntersectingLights(), although nothing
- * enforces this). This intersection test is performed by passing the light to
- * the LitObject::intersectsLight() method.
+ * updating, which is true if EITHER this LightList's setDirty() method has been
+ * called OR the RenderSystem's lightChanged() has been called for a light whose
+ * old or new volume overlaps the bounds of the lit object since the last
+ * calculation. If no update is needed, it returns.
+ * 5. If an update IS needed, the LightList looks up the lights whose volumes
+ * overlap the bounds of its associated lit object (which is the one that just
+ * invoked calculateIntersectingLights(), although nothing enforces this) in
+ * the spatial index of the RenderSystem, and tests if each one intersects the
+ * object. This intersection test is performed by passing the light to the
+ * LitObject::intersectsLight() method.
  * 6. For each light which passes the intersection test, the LightList both adds
  * it to its internal list of "active" (i.e. intersecting) lights for its
  * object, and passes it to the object's insertLight() method. Some object
@@ -298,10 +317,9 @@ typedef std::function<void(const RendererLight&)> RendererLightCallback;
  * its internal OpenGLShaderPasses: once only if RENDER_BUMP is not active, not
  * at all if RENDER_BUMP is active but the LightList is NULL, or once for each
  * light in the LightList otherwise.
- * 12. The OpenGLShaderPass now contains a list of TransformedRenderable
- * structures, each associating a single renderable with a single light.
- * Multiple TransformedRenderable will exist for the same renderable if there
- * were multiple lights illuminating it.
+ * 12. The render system's RenderQueue now contains an entry for each pass,
+ * associating a single renderable with a single light. Multiple entries will
+ * exist for the same renderable if there were multiple lights illuminating it.
  */
 class LightList
 {
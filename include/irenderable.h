@@ -150,5 +150,26 @@ public:
 	 * Returns information about whether the renderer should highlight this node and how.
 	 */
 	virtual std::size_t getHighlightFlags() = 0;
+
+	/**
+	 * Retained rendering support: returns a number which changes whenever the
+	 * renderables submitted by renderSolid() change. The renderer may store the
+	 * submitted renderables and submit them again in subsequent frames without
+	 * calling renderSolid(), until this number changes.
+	 *
+	 * Returns 0 if the submitted renderables depend on the view (apart from
+	 * culling), such objects are asked to submit their renderables each frame.
+	 */
+	virtual std::size_t getRenderGeneration() const
+	{
+		return 0;
+	}
+
+	/**
+	 * Called instead of renderSolid() in the frames the stored renderables of
+	 * this object are submitted again, e.g. to update the lights falling on it.
+	 */
+	virtual void updateRetainedRenderables() const
+	{}
 };
 typedef std::shared_ptr<Renderable> RenderablePtr;
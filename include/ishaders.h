@@ -8,6 +8,7 @@
 #include "math/Vector4.h"
 
 #include <ostream>
+#include <set>
 #include <vector>
 
 #include "Texture.h"
@@ -165,6 +166,9 @@ public:
 		MC_TRANSLUCENT		// blended with background
 	};
 
+	// The maximum width and height of the editor thumbnails
+	static constexpr std::size_t THUMBNAIL_SIZE = 128;
+
 	virtual ~Material() {}
 
     /**
@@ -173,6 +177,14 @@ public:
      */
     virtual TexturePtr getEditorImage() = 0;
 
+    /**
+     * \brief
+     * Return a downscaled version of the editor image, which is at most
+     * THUMBNAIL_SIZE wide and high. Thumbnails are kept in a cache on disk,
+     * such that browsers can show them without loading the full image.
+     */
+    virtual TexturePtr getEditorThumbnail() = 0;
+
     /**
      * \brief
      * Return true if the editor image is no tex for this shader.
@@ -380,6 +392,23 @@ public:
 	// to a filesystem or other configuration change
 	virtual sigc::signal<void>& signal_DefsUnloaded() = 0;
 
+	// Signal invoked when a single material has been redefined (or removed)
+	// after its declaring file changed on disk. The Material object returned
+	// by getMaterialForName() stays the same, only its contents change.
+	virtual sigc::signal<void, const std::string&>& signal_MaterialChanged() = 0;
+
+	// Signal invoked after textures which have been loaded in the background
+	// have been uploaded to GL. Views showing them should be redrawn.
+	virtual sigc::signal<void>& signal_TexturesUploaded() = 0;
+
+	/**
+	 * Tells the material manager that the given GL texture is drawn in the
+	 * current frame. Textures which haven't been drawn for a while might be
+	 * evicted to stay within the texture memory budget, they are loaded
+	 * again once they're used. Must be called on the main thread.
+	 */
+	virtual void markTextureUsed(GLuint textureNum) = 0;
+
 	/** Activate the shader for a given name and return it. The default shader
 	 * will be returned if name is not found.
 	 *
@@ -399,6 +428,14 @@ public:
 
 	virtual void foreachShaderName(const ShaderNameCallback& callback) = 0;
 
+	/**
+	 * Requests the named materials to be parsed in the background ahead of
+	 * the others, since they are about to be used (e.g. by the map being
+	 * loaded). Doesn't wait for the materials to be parsed, does nothing if
+	 * background parsing is disabled.
+	 */
+	virtual void prioritiseMaterials(const std::set<std::string>& names) = 0;
+
     /**
      * Visit each material with the given function object. Replaces the legacy foreachShader().
      */
@@ -63,10 +63,23 @@ public:
     {
 		GLuint textureNum;
 
-        debug::assertNoGlErrors();
-
 		// Allocate a new texture number and store it into the Texture structure
 		glGenTextures(1, &textureNum);
+
+		uploadTexture(textureNum);
+
+        // Construct texture object
+        BasicTexture2DPtr tex2DObject(new BasicTexture2D(textureNum, name));
+        tex2DObject->setWidth(getWidth(0));
+        tex2DObject->setHeight(getHeight(0));
+
+		return tex2DObject;
+	}
+
+	bool uploadTexture(GLuint textureNum) const
+	{
+        debug::assertNoGlErrors();
+
 		glBindTexture(GL_TEXTURE_2D, textureNum);
 
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
@@ -83,14 +96,9 @@ public:
 		// Un-bind the texture
 		glBindTexture(GL_TEXTURE_2D, 0);
 
-        // Construct texture object
-        BasicTexture2DPtr tex2DObject(new BasicTexture2D(textureNum, name));
-        tex2DObject->setWidth(getWidth(0));
-        tex2DObject->setHeight(getHeight(0));
-
         debug::assertNoGlErrors();
 
-		return tex2DObject;
+		return true;
 	}
 
 	bool isPrecompressed() const
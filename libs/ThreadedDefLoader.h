@@ -2,36 +2,53 @@
 
 #include <future>
 #include <functional>
+#include <memory>
+#include <mutex>
+
+#include "ideclloadscheduler.h"
 
 namespace util
 {
 
 /**
- * Helper class used to asynchronically parse/load def files in a separate thread.
+ * Helper class used to asynchronically parse/load def files in the background.
+ * The loader function is run as job of the global DeclLoadScheduler, under
+ * the given name and after the given dependency jobs.
  *
- * The worker thread itself is ensured to be called in a thread-safe 
+ * The worker itself is ensured to be called in a thread-safe 
  * way (to prevent the worker from being invoked twice). Subsequent calls to 
  * get() or start() will not start the loader again, unless the reset() method
  * is called.
  *
  * Client code (even from multiple threads) can retrieve (and wait for) the result 
- * by calling the get() method.
+ * by calling the get() method. If the job has not been picked up by the
+ * scheduler yet, the waiting thread runs it itself.
  */
 template <typename ReturnType>
 class ThreadedDefLoader
 {
     typedef std::function<ReturnType()> LoadFunction;
 
+    std::string _name;
     LoadFunction _loadFunc;
+    std::vector<std::string> _dependencies;
+    decl::LoadPriority _priority;
 
     std::shared_future<ReturnType> _result;
+    decl::ILoadScheduler::JobPtr _job;
     std::mutex _mutex;
 
     bool _loadingStarted;
 
 public:
-    ThreadedDefLoader(const LoadFunction& loadFunc) :
+    // The name identifies the job, other loaders can refer to it in their dependencies
+    ThreadedDefLoader(const std::string& name, const LoadFunction& loadFunc,
+                      const std::vector<std::string>& dependencies = {},
+                      decl::LoadPriority priority = decl::LoadPriority::Normal) :
+        _name(name),
         _loadFunc(loadFunc),
+        _dependencies(dependencies),
+        _priority(priority),
         _loadingStarted(false)
     {}
 
@@ -46,6 +63,7 @@ public:
     // cannot be started a second time unless reset() is called.
     void start()
     {
+        std::lock_guard<std::mutex> lock(_mutex);
         ensureLoaderStarted();
     }
 
@@ -61,11 +79,22 @@ public:
     // run yet or in case it's still running
     ReturnType get()
     {
-        // Make sure we already started the loader
-        ensureLoaderStarted();
+        decl::ILoadScheduler::JobPtr job;
+        std::shared_future<ReturnType> result;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            // Make sure we already started the loader
+            ensureLoaderStarted();
+
+            job = _job;
+            result = _result;
+        }
 
         // Wait for the result or return if it's already done.
-        return _result.get();
+        job->wait();
+        return result.get();
     }
 
     // Resets the state of the loader to the state it had after construction.
@@ -81,22 +110,29 @@ public:
 
             if (_result.valid())
             {
+                _job->wait();
                 _result.get();
             }
 
             _result = std::shared_future<ReturnType>();
+            _job.reset();
         }
     }
 
 private:
+    // Requires _mutex to be held
     void ensureLoaderStarted()
     {
-        std::lock_guard<std::mutex> lock(_mutex);
-
         if (!_loadingStarted)
         {
             _loadingStarted = true;
-            _result = std::async(std::launch::async, _loadFunc);
+
+            // The job itself is not throwing, exceptions are passed on to _result
+            auto task = std::make_shared<std::packaged_task<ReturnType()>>(_loadFunc);
+            _result = task->get_future().share();
+
+            _job = GlobalDeclLoadScheduler().schedule(_name, [task]() { (*task)(); },
+                _dependencies, _priority);
         }
     }
 };
@@ -2,6 +2,8 @@
 
 #include "AABB.h"
 
+#include <cmath>
+
 // Normalise all planes in frustum
 void Frustum::normalisePlanes()
 {
@@ -140,6 +142,35 @@ VolumeIntersectionValue Frustum::testIntersection(const AABB& aabb) const
     return result;
 }
 
+AABB Frustum::getBounds() const
+{
+    const Plane3* sides[2] = { &left, &right };
+    const Plane3* caps[2] = { &top, &bottom };
+    const Plane3* ends[2] = { &front, &back };
+
+    AABB bounds;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const Plane3& side = *sides[i & 1];
+        const Plane3& cap = *caps[(i >> 1) & 1];
+        const Plane3& end = *ends[i >> 2];
+
+        // Plane3::intersect() returns the origin for planes without a common
+        // point, which can't be told apart from an actual corner there
+        double denom = side.normal().dot(cap.normal().crossProduct(end.normal()));
+
+        if (std::abs(denom) < 1e-9 * side.normal().getLength() * cap.normal().getLength() * end.normal().getLength())
+        {
+            return AABB();
+        }
+
+        bounds.includePoint(Plane3::intersect(side, cap, end));
+    }
+
+    return bounds;
+}
+
 VolumeIntersectionValue Frustum::testIntersection(const AABB& aabb, const Matrix4& localToWorld) const
 {
 	AABB aabb_world(aabb);
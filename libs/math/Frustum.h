@@ -63,6 +63,16 @@ public:
      */
     VolumeIntersectionValue testIntersection(const AABB& aabb) const;
 
+	/**
+	 * \brief
+	 * Return the bounds of the eight corners of this frustum.
+	 *
+	 * Returns an invalid AABB if some of the corners don't exist, since two
+	 * of the planes meeting there are parallel (i.e. the frustum is degenerate
+	 * or unbounded).
+	 */
+	AABB getBounds() const;
+
 	/**
 	 * Test the intersection of this frustum with a transformed AABB.
 	 */
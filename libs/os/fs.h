@@ -44,6 +44,7 @@ namespace fs = boost::filesystem;
 #endif
 
 #include "string/predicate.h"
+#include <cstdint>
 
 namespace os
 {
@@ -84,6 +85,17 @@ namespace os
 #endif
 	}
 
+	// Returns the last write time of the given file as integer, only to be
+	// used for comparisons. Throws fs::filesystem_error on failure.
+	inline std::int64_t getLastWriteTime(const fs::path& path)
+	{
+#ifdef DR_USE_STD_FILESYSTEM
+		return static_cast<std::int64_t>(fs::last_write_time(path).time_since_epoch().count());
+#else
+		return static_cast<std::int64_t>(fs::last_write_time(path));
+#endif
+	}
+
 	// Replaces the extension of the given filename with newExt
 	inline std::string replaceExtension(const std::string& input, const std::string& newExt)
 	{
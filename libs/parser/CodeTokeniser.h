@@ -6,6 +6,10 @@
 
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
 #include <algorithm>
 #include <fmt/format.h>
 
@@ -571,36 +575,309 @@ public:
 	}
 };
 
+/**
+ * A code file split into tokens by the CodeTokeniserFunc. The #define
+ * statements are parsed into macros right away, such that the tokens
+ * can be replayed any number of times without touching the file again.
+ */
+struct CodeFileTokens
+{
+	// The VFS path of the tokenised file
+	std::string name;
+
+	std::vector<std::string> tokens;
+
+	// The macros of the valid #define tokens, keyed by token index
+	std::map<std::size_t, Macro> macros;
+
+	// Parses the macro name, arguments and body of the given #define token,
+	// returns false if the statement is invalid
+	static bool parseMacro(const std::string& token, Macro& macro)
+	{
+		if (token.length() <= 7)
+		{
+			return false;
+		}
+
+		std::string defineToken = token;
+
+		// Replace tabs with spaces
+		std::replace(defineToken.begin(), defineToken.end(), '\t', ' ');
+
+		// Cut off the "#define " (including space)
+		defineToken = defineToken.substr(8);
+
+		// Parse the entire macro
+		std::istringstream macroStream(defineToken);
+		SingleCodeFileTokeniser macroParser(macroStream);
+
+		if (!macroParser.hasMoreTokens())
+		{
+			return false;
+		}
+
+		std::string name = macroParser.nextToken();
+
+		bool paramsStarted = false;
+
+		if (string::ends_with(name, "("))
+		{
+			string::trim_right(name, "(");
+			paramsStarted = true;
+		}
+
+		macro = Macro(name);
+
+		while (macroParser.hasMoreTokens())
+		{
+			std::string macroToken = macroParser.nextToken();
+
+			// An opening parenthesis might be an argument list, but
+			// only if we're still at the beginning of the macro
+			if (macroToken == "(" && !paramsStarted && macro.tokens.empty())
+			{
+				paramsStarted = true;
+			}
+			else if (macroToken == ")" && paramsStarted)
+			{
+				paramsStarted = false;
+			}
+			else if (macroToken == ",")
+			{
+				if (paramsStarted)
+				{
+					continue;
+				}
+
+				// Treat the comma as part of the macro value
+				macro.tokens.push_back(macroToken);
+			}
+			else
+			{
+				if (paramsStarted)
+				{
+					// Token is an argument
+					macro.arguments.push_back(macroToken);
+				}
+				else
+				{
+					// Ordinary macro value
+					macro.tokens.push_back(macroToken);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Tokenises the whole stream, throws a ParseException on failure
+	static std::shared_ptr<CodeFileTokens> Parse(std::istream& stream, const std::string& name,
+		const char* delims, const char* keptDelims)
+	{
+		auto file = std::make_shared<CodeFileTokens>();
+		file->name = name;
+
+		SingleCodeFileTokeniser tokeniser(stream, delims, keptDelims);
+
+		while (tokeniser.hasMoreTokens())
+		{
+			file->tokens.emplace_back(tokeniser.nextToken());
+
+			const std::string& token = file->tokens.back();
+
+			if (string::starts_with(token, "#define"))
+			{
+				Macro macro;
+
+				if (parseMacro(token, macro))
+				{
+					file->macros.emplace(file->tokens.size() - 1, std::move(macro));
+				}
+			}
+		}
+
+		return file;
+	}
+};
+typedef std::shared_ptr<const CodeFileTokens> CodeFileTokensPtr;
+
+/**
+ * Keeps the tokens of VFS files which are included over and over by
+ * different code files (e.g. the common .guicode files of readables).
+ * The files are re-tokenised only if their FileStamp changed since.
+ *
+ * The cache can be shared by several CodeTokenisers, also across threads.
+ */
+class CodeFileCache
+{
+private:
+	struct Entry
+	{
+		vfs::FileStamp stamp;
+		CodeFileTokensPtr file;
+
+		// The delimiters the file has been tokenised with
+		std::string delims;
+		std::string keptDelims;
+	};
+
+	// The VFS the files are read from, GlobalFileSystem() if not set
+	vfs::VirtualFileSystem* _vfs;
+
+	std::mutex _mutex;
+	std::map<std::string, Entry> _entries;
+
+	std::size_t _hits;
+	std::size_t _misses;
+
+public:
+	CodeFileCache() :
+		_vfs(nullptr),
+		_hits(0),
+		_misses(0)
+	{}
+
+	// Construct a cache reading the files from the given VFS
+	CodeFileCache(vfs::VirtualFileSystem& vfs) :
+		_vfs(&vfs),
+		_hits(0),
+		_misses(0)
+	{}
+
+	// Returns the tokens of the given VFS file, or an empty pointer if the
+	// file cannot be found. Throws a ParseException if tokenising fails.
+	CodeFileTokensPtr getFile(const std::string& path, const char* delims, const char* keptDelims)
+	{
+		vfs::FileStamp stamp;
+
+		if (!getFileSystem().getFileStamp(path, stamp))
+		{
+			return CodeFileTokensPtr();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			auto found = _entries.find(path);
+
+			if (found != _entries.end() && found->second.stamp == stamp &&
+				found->second.delims == delims && found->second.keptDelims == keptDelims)
+			{
+				++_hits;
+				return found->second.file;
+			}
+		}
+
+		ArchiveTextFilePtr archive = getFileSystem().openTextFile(path);
+
+		if (!archive)
+		{
+			return CodeFileTokensPtr();
+		}
+
+		// Tokenise the file without blocking other threads
+		std::istream stream(&archive->getInputStream());
+		CodeFileTokensPtr file = CodeFileTokens::Parse(stream, archive->getName(), delims, keptDelims);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		Entry& entry = _entries[path];
+		entry.stamp = stamp;
+		entry.file = file;
+		entry.delims = delims;
+		entry.keptDelims = keptDelims;
+
+		++_misses;
+
+		return file;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_entries.clear();
+		_hits = 0;
+		_misses = 0;
+	}
+
+	std::size_t getNumHits()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _hits;
+	}
+
+	std::size_t getNumMisses()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _misses;
+	}
+
+private:
+	vfs::VirtualFileSystem& getFileSystem()
+	{
+		return _vfs != nullptr ? *_vfs : GlobalFileSystem();
+	}
+};
+
 /**
  * High-level tokeniser taking a specific VFS file as input.
  * It is able to handle preprocessor statements like #include
  * by maintaining several child tokenisers. This can be used
  * to parse code-like files as Doom 3 Scripts or GUIs.
  *
- * Note: Don't expect this tokeniser to be particularly fast.
+ * Included files are taken from the optional CodeFileCache, such
+ * that files included by many others are tokenised only once.
  */
 class CodeTokeniser :
 	public DefTokeniser
 {
 private:
 
+	// The read position within a tokenised file
 	struct ParseNode
 	{
-		ArchiveTextFilePtr archive;
-		std::istream inputStream;
-		SingleCodeFileTokeniser tokeniser;
-
-		ParseNode(const ArchiveTextFilePtr& archive_,
-				const char* delims, const char* keptDelims) :
-			archive(archive_),
-			inputStream(&archive->getInputStream()),
-			tokeniser(inputStream, delims, keptDelims)
+		CodeFileTokensPtr file;
+		std::size_t position;
+
+		ParseNode(const CodeFileTokensPtr& file_) :
+			file(file_),
+			position(0)
 		{}
+
+		bool hasMoreTokens() const
+		{
+			return position < file->tokens.size();
+		}
+
+		const std::string& nextToken()
+		{
+			if (!hasMoreTokens())
+			{
+				throw ParseException("CodeTokeniser: no more tokens in " + file->name);
+			}
+
+			return file->tokens[position++];
+		}
+
+		void skipTokens(std::size_t numTokens)
+		{
+			for (std::size_t i = 0; i < numTokens; ++i)
+			{
+				nextToken();
+			}
+		}
+
+		// Returns the pre-parsed macro of the token returned last, if any
+		const Macro* getLastMacro() const
+		{
+			auto found = file->macros.find(position - 1);
+			return found != file->macros.end() ? &found->second : nullptr;
+		}
 	};
-	typedef std::shared_ptr<ParseNode> ParseNodePtr;
 
 	// The stack of child tokenisers
-	typedef std::list<ParseNodePtr> NodeList;
+	typedef std::list<ParseNode> NodeList;
 	NodeList _nodes;
 
 	NodeList::iterator _curNode;
@@ -622,18 +899,26 @@ private:
 	const char* _delims;
 	const char* _keptDelims;
 
+	// Source of the included files, can be NULL
+	CodeFileCache* _includeCache;
+
 public:
 
     /**
      * Construct a CodeTokeniser with the given text file from the VFS.
+     * Included files are looked up in the given cache, if not NULL.
      */
 	CodeTokeniser(const ArchiveTextFilePtr& file,
 				  const char* delims = " \t\n\v\r",
-				  const char* keptDelims = "{}(),;") :
+				  const char* keptDelims = "{}(),;",
+				  CodeFileCache* includeCache = nullptr) :
 		_delims(delims),
-		_keptDelims(keptDelims)
+		_keptDelims(keptDelims),
+		_includeCache(includeCache)
     {
-		_nodes.push_back(ParseNodePtr(new ParseNode(file, _delims, _keptDelims)));
+		std::istream stream(&file->getInputStream());
+
+		_nodes.emplace_back(CodeFileTokens::Parse(stream, file->getName(), _delims, _keptDelims));
 		_curNode = _nodes.begin();
 
 		_fileStack.push_back(file->getName());
@@ -680,14 +965,14 @@ private:
 	{
 		while (_curNode != _nodes.end())
 		{
-			if (!(*_curNode)->tokeniser.hasMoreTokens())
+			if (!_curNode->hasMoreTokens())
 			{
 				_fileStack.pop_back();
 				++_curNode;
 				continue;
 			}
 
-			std::string token = (*_curNode)->tokeniser.nextToken();
+			const std::string& token = _curNode->nextToken();
 
 			// Don't treat #strNNNN as preprocessor tokens
 			if (!token.empty() &&
@@ -708,7 +993,7 @@ private:
 			if (found != _macros.end())
 			{
 				// Expand this macro, new tokens are acquired from the currently active tokeniser
-				StringList expanded = expandMacro(found->second, [this]() { return (*_curNode)->tokeniser.nextToken(); });
+				StringList expanded = expandMacro(found->second, [this]() { return _curNode->nextToken(); });
 
 				if (!expanded.empty())
 				{
@@ -793,7 +1078,7 @@ private:
 			else
 			{
 				rWarning() << "Macro expansion yields empty token list: " << *t <<
-					" in " << (*_curNode)->archive->getName() << std::endl;
+					" in " << _curNode->file->name << std::endl;
 			}
 		}
 
@@ -819,49 +1104,46 @@ private:
 	{
 		if (token == "#include")
 		{
-			std::string includeFile = (*_curNode)->tokeniser.nextToken();
+			std::string includeFile = _curNode->nextToken();
 
-			ArchiveTextFilePtr file = GlobalFileSystem().openTextFile(includeFile);
+			CodeFileTokensPtr file = openIncludeFile(includeFile);
 
-			if (file != NULL)
+			if (file)
 			{
 				// Catch infinite recursions
-				FileNameStack::const_iterator found = std::find(_fileStack.begin(), _fileStack.end(), file->getName());
+				FileNameStack::const_iterator found = std::find(_fileStack.begin(), _fileStack.end(), file->name);
 
 				if (found == _fileStack.end())
 				{
 					// Push a new parse node and switch
-					_fileStack.push_back(file->getName());
+					_fileStack.push_back(file->name);
 
-					_curNode = _nodes.insert(
-						_curNode,
-						ParseNodePtr(new ParseNode(file, _delims, _keptDelims))
-					);
+					_curNode = _nodes.emplace(_curNode, file);
 				}
 				else
 				{
 					rError() << "Caught infinite loop on parsing #include token: "
-						<< includeFile << " in " << (*_curNode)->archive->getName() << std::endl;
+						<< includeFile << " in " << _curNode->file->name << std::endl;
 				}
 			}
 			else
 			{
 				rWarning() << "Couldn't find include file: "
-					<< includeFile << " in " << (*_curNode)->archive->getName() << std::endl;
+					<< includeFile << " in " << _curNode->file->name << std::endl;
 			}
 		}
 		else if (string::starts_with(token, "#define"))
 		{
-			parseMacro(token);
+			defineMacro();
 		}
 		else if (token == "#undef")
 		{
-			std::string key = (*_curNode)->tokeniser.nextToken();
+			std::string key = _curNode->nextToken();
 			_macros.erase(key);
 		}
 		else if (token == "#ifdef")
 		{
-			std::string key = (*_curNode)->tokeniser.nextToken();
+			std::string key = _curNode->nextToken();
 			Macros::const_iterator found = _macros.find(key);
 
 			if (found == _macros.end())
@@ -871,8 +1153,7 @@ private:
 		}
 		else if (token == "#ifndef")
 		{
-			Macros::const_iterator found = _macros.find(
-				(*_curNode)->tokeniser.nextToken());
+			Macros::const_iterator found = _macros.find(_curNode->nextToken());
 
 			if (found != _macros.end())
 			{
@@ -886,89 +1167,47 @@ private:
 		}
 		else if (token == "#if")
 		{
-			(*_curNode)->tokeniser.skipTokens(1);
+			_curNode->skipTokens(1);
 		}
 	}
 
-	void parseMacro(const std::string& token)
+	CodeFileTokensPtr openIncludeFile(const std::string& path)
 	{
-		std::string defineToken = token;
-
-		if (defineToken.length() <= 7)
+		if (_includeCache != nullptr)
 		{
-			rWarning() << "Invalid #define statement in " << (*_curNode)->archive->getName() << std::endl;
-			return;
+			return _includeCache->getFile(path, _delims, _keptDelims);
 		}
 
-		// Replace tabs with spaces
-		std::replace(defineToken.begin(), defineToken.end(), '\t', ' ');
-
-		// Cut off the "#define " (including space)
-		defineToken = defineToken.substr(8);
+		ArchiveTextFilePtr file = GlobalFileSystem().openTextFile(path);
 
-		// Parse the entire macro
-		std::istringstream macroStream(defineToken);
-		SingleCodeFileTokeniser macroParser(macroStream);
+		if (!file)
+		{
+			return CodeFileTokensPtr();
+		}
 
-		std::string name = macroParser.nextToken();
+		std::istream stream(&file->getInputStream());
+		return CodeFileTokens::Parse(stream, file->getName(), _delims, _keptDelims);
+	}
 
-		bool paramsStarted = false;
+	// Registers the macro of the #define token returned last
+	void defineMacro()
+	{
+		const Macro* macro = _curNode->getLastMacro();
 
-		if (string::ends_with(name, "("))
+		if (macro == nullptr)
 		{
-			string::trim_right(name, "(");
-			paramsStarted = true;
+			rWarning() << "Invalid #define statement in " << _curNode->file->name << std::endl;
+			return;
 		}
 
 		std::pair<Macros::iterator, bool> result = _macros.insert(
-			Macros::value_type(name, Macro(name))
+			Macros::value_type(macro->name, *macro)
 		);
 
 		if (!result.second)
 		{
-			rWarning() << "Redefinition of " << name << " in " << (*_curNode)->archive->getName() << std::endl;
-			result.first->second = Macro(name);
-		}
-
-		Macro& macro = result.first->second;
-
-		while (macroParser.hasMoreTokens())
-		{
-			std::string macroToken = macroParser.nextToken();
-
-			// An opening parenthesis might be an argument list, but
-			// only if we're still at the beginning of the macro
-			if (macroToken == "(" && !paramsStarted && macro.tokens.empty())
-			{	
-				paramsStarted = true;
-			}
-			else if (macroToken == ")" && paramsStarted)
-			{
-				paramsStarted = false;
-			}
-			else if (macroToken == ",")
-			{
-				if (paramsStarted)
-				{
-					continue;
-				}
-
-				// Treat the comma as part of the macro value
-				macro.tokens.push_back(macroToken);
-			}
-			else 
-			{
-				if (paramsStarted)
-				{
-					// Token is an argument
-					macro.arguments.push_back(macroToken);
-				}
-				else
-				{
-					// Ordinary macro value
-					macro.tokens.push_back(macroToken);
-				}
-			}
+			rWarning() << "Redefinition of " << macro->name << " in " << _curNode->file->name << std::endl;
+			result.first->second = *macro;
 		}
 	}
 
@@ -977,13 +1216,13 @@ private:
 		// Not defined, skip everything until matching #endif
 		for (std::size_t level = 1; level > 0;)
 		{
-			if (!(*_curNode)->tokeniser.hasMoreTokens())
+			if (!_curNode->hasMoreTokens())
 			{
 				rWarning() << "No matching #endif for #if(n)def in "
-					<< (*_curNode)->archive->getName() << std::endl;
+					<< _curNode->file->name << std::endl;
 			}
 
-			std::string token = (*_curNode)->tokeniser.nextToken();
+			std::string token = _curNode->nextToken();
 
 			if (token == "#endif")
 			{
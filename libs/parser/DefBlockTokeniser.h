@@ -2,8 +2,10 @@
 
 #include "ParseException.h"
 
+#include <cstring>
 #include <ios>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <ctype.h>
 #include "string/tokeniser.h"
@@ -97,6 +99,81 @@ class DefBlockTokeniserFunc
         return false;
     }
 
+	// Adds the characters to the block contents until the block is closed, returns
+	// true when the closing brace has been consumed.
+	template<typename InputIterator>
+	bool scanBlockContents(InputIterator& next, const InputIterator& end,
+						   std::string& contents, std::size_t& blockLevel)
+	{
+		for (; next != end; ++next)
+		{
+			char ch = *next;
+
+			if (ch == _blockEndChar)
+			{
+				if (--blockLevel == 0)
+				{
+					// End of block content, don't add this last character
+					++next;
+					return true;
+				}
+			}
+			else if (ch == _blockStartChar)
+			{
+				// another block within this block, ignore this
+				blockLevel++;
+			}
+
+			contents += ch;
+		}
+
+		return false;
+	}
+
+	// Fast path for contiguous input: only the braces are significant within a
+	// block, so jump from brace to brace with memchr and copy the contents in one go
+	bool scanBlockContents(std::string::const_iterator& next, const std::string::const_iterator& end,
+						   std::string& contents, std::size_t& blockLevel)
+	{
+		const char* begin = &(*next);
+		const char* last = begin + (end - next);
+
+		const char* nextStart = findChar(begin, last, _blockStartChar);
+		const char* nextEnd = findChar(begin, last, _blockEndChar);
+
+		while (nextEnd != last)
+		{
+			if (nextStart < nextEnd)
+			{
+				blockLevel++;
+				nextStart = findChar(nextStart + 1, last, _blockStartChar);
+				continue;
+			}
+
+			if (--blockLevel == 0)
+			{
+				contents.append(begin, nextEnd);
+				next += (nextEnd + 1) - begin;
+				return true;
+			}
+
+			nextEnd = findChar(nextEnd + 1, last, _blockEndChar);
+		}
+
+		// Unterminated block, the contents run up to the end of the input
+		contents.append(begin, last);
+		next = end;
+
+		return false;
+	}
+
+	// Returns the position of the first ch in [begin, last), or last if not found
+	static const char* findChar(const char* begin, const char* last, char ch)
+	{
+		const void* found = std::memchr(begin, ch, last - begin);
+		return found != nullptr ? static_cast<const char*>(found) : last;
+	}
+
 public:
 
     // Constructor
@@ -196,35 +273,12 @@ public:
 				}
 
 			case BLOCK_CONTENT:
-				// Check for another opening brace
-				if (ch == _blockEndChar) {
-					blockLevel--;
-
-					if (blockLevel == 0) {
-						// End of block content, we're done here,
-						// don't add this last character either
-						++next;
-						return true;
-					}
-					else {
-						// Still within a block, add to contents
-						tok.contents += ch;
-						++next;
-						continue;
-					}
-				}
-				else if (ch == _blockStartChar) {
-					// another block within this block, ignore this
-					blockLevel++;
-					tok.contents += ch;
-					++next;
-					continue;
-				}
-				else {
-					tok.contents += ch;
-					++next;
-					continue;
+				// Consume the block contents up to and including the matching brace
+				if (scanBlockContents(next, end, tok.contents, blockLevel))
+				{
+					return true;
 				}
+				continue;
 
 			case FORWARDSLASH:
 
@@ -367,7 +421,10 @@ public:
 	{
 		if (hasMoreBlocks())
 		{
-			return *(_tokIter++);
+			// Avoid the postfix increment, it copies the current block
+			Block block = *_tokIter;
+			++_tokIter;
+			return block;
 		}
 
         throw ParseException("BlockTokeniser: no more blocks");
@@ -375,32 +432,29 @@ public:
 };
 
 /**
- * Specialisation of DefTokeniser to work with std::istream objects. This is
- * needed because an std::istream does not provide begin() and end() methods
- * to get an iterator, but needs a separate istream_iterator<> to be constructed
- * for it.
+ * Specialisation of DefTokeniser to work with std::istream objects. The stream
+ * contents are read into a buffer up front, which allows the tokeniser function
+ * to scan the (large) block contents in bulk instead of char by char.
  */
 template<>
 class BasicDefBlockTokeniser<std::istream> :
 	public BlockTokeniser
 {
 private:
-    // Istream iterator type
-    typedef std::istream_iterator<char> CharStreamIterator;
+    // The stream contents, referenced by the tokeniser
+    std::string _buffer;
 
     // Internal tokeniser and its iterator
     typedef string::Tokeniser<DefBlockTokeniserFunc, 
-							  CharStreamIterator,
+							  std::string::const_iterator,
 							  BlockTokeniser::Block> Tokeniser;
 
     Tokeniser _tok;
     Tokeniser::Iterator _tokIter;
 
-	// Helper function to set noskipws on the input stream.
-	static std::istream& setNoskipws(std::istream& is)
+	static std::string readStream(std::istream& is)
 	{
-		is >> std::noskipws;
-		return is;
+		return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
 	}
 
 public:
@@ -416,12 +470,15 @@ public:
 						   const char* delims = " \t\n\v\r",
 						   const char blockStartChar = '{',
 						   const char blockEndChar = '}') :
-		_tok(CharStreamIterator(setNoskipws(str)), // start iterator
-			 CharStreamIterator(), // end (null) iterator
-			 DefBlockTokeniserFunc(delims, blockStartChar, blockEndChar)),
+		_buffer(readStream(str)),
+		_tok(_buffer, DefBlockTokeniserFunc(delims, blockStartChar, blockEndChar)),
 		_tokIter(_tok.getIterator())
 	{}
 
+	// The tokeniser refers to our own buffer, copies would share it
+	BasicDefBlockTokeniser(const BasicDefBlockTokeniser&) = delete;
+	BasicDefBlockTokeniser& operator=(const BasicDefBlockTokeniser&) = delete;
+
     /**
      * Test if this BlockTokeniser has more blocks to return.
      *
@@ -448,7 +505,10 @@ public:
 	{
 		if (hasMoreBlocks())
 		{
-			return *(_tokIter++);
+			// Avoid the postfix increment, it copies the current block
+			Block block = *_tokIter;
+			++_tokIter;
+			return block;
 		}
 
         throw ParseException("BlockTokeniser: no more tokens");
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "DefTokeniser.h"
+
+#include <vector>
+
+namespace parser
+{
+
+/**
+ * DefTokeniser returning the tokens of an already tokenised file, e.g.
+ * the token list kept by the declaration cache. The list is not copied,
+ * it must outlive the tokeniser.
+ */
+class TokenListTokeniser :
+	public DefTokeniser
+{
+private:
+	const std::vector<std::string>& _tokens;
+	std::vector<std::string>::const_iterator _current;
+
+public:
+	TokenListTokeniser(const std::vector<std::string>& tokens) :
+		_tokens(tokens),
+		_current(_tokens.begin())
+	{}
+
+	bool hasMoreTokens() const override
+	{
+		return _current != _tokens.end();
+	}
+
+	std::string nextToken() override
+	{
+		if (hasMoreTokens())
+		{
+			return *(_current++);
+		}
+
+		throw ParseException("DefTokeniser: no more tokens");
+	}
+
+	std::string peek() const override
+	{
+		if (hasMoreTokens())
+		{
+			return *_current;
+		}
+
+		throw ParseException("DefTokeniser: no more tokens");
+	}
+};
+
+}
@@ -50,6 +50,7 @@ Node::Node() :
 	_local2world(Matrix4::getIdentity()),
 	_instantiated(false),
 	_forceVisible(false),
+	_renderablesGeneration(1),
     _renderEntity(nullptr)
 {
 	// Each node is part of layer 0 by default
@@ -70,6 +71,7 @@ Node::Node(const Node& other) :
 	_instantiated(false),
 	_forceVisible(false),
 	_layers(other._layers),
+	_renderablesGeneration(1),
     _renderEntity(other._renderEntity)
 {}
 
@@ -415,6 +417,8 @@ void Node::boundsChanged() {
 	_boundsChanged = true;
 	_childBoundsChanged = true;
 
+	renderablesChanged();
+
 	INodePtr parent = _parent.lock();
 	if (parent != NULL) {
 		parent->boundsChanged();
@@ -468,6 +472,8 @@ void Node::transformChangedLocal()
 	_boundsChanged = true;
 	_childBoundsChanged = true;
 
+	renderablesChanged();
+
 	if (_transformChangedCallback)
 	{
 		_transformChangedCallback();
@@ -502,6 +508,9 @@ void Node::setRenderSystem(const RenderSystemPtr& renderSystem)
 {
 	_renderSystem = renderSystem;
 
+	// The shaders are captured from the new render system
+	renderablesChanged();
+
 	if (_children.empty()) return;
 
 	// Propagate this call to all children
@@ -512,6 +521,8 @@ void Node::setForcedVisibility(bool forceVisible, bool includeChildren)
 {
 	_forceVisible = forceVisible;
 
+	renderablesChanged();
+
 	if (includeChildren)
 	{
 		_children.foreachNode([&](const INodePtr& node)
@@ -527,6 +538,16 @@ bool Node::isForcedVisible() const
 	return _forceVisible;
 }
 
+void Node::renderablesChanged()
+{
+	++_renderablesGeneration;
+}
+
+std::size_t Node::getRenderablesGeneration() const
+{
+	return _renderablesGeneration;
+}
+
 unsigned long Node::_maxNodeId = 0;
 
 } // namespace scene
@@ -64,6 +64,9 @@ private:
 	// The list of layers this object is associated to
 	LayerList _layers;
 
+	// Incremented whenever the renderables of this node might have changed
+	std::size_t _renderablesGeneration;
+
 protected:
 	// If this node is attached to a parent entity, this is the reference to it
     IRenderEntity* _renderEntity;
@@ -191,6 +194,7 @@ public:
 	void setRenderEntity(IRenderEntity* entity) override
 	{
 		_renderEntity = entity;
+		renderablesChanged();
 	}
 
 	// Base renderable implementation
@@ -201,6 +205,14 @@ protected:
 	// Method for subclasses to check whether this node is forcedly visible
 	bool isForcedVisible() const;
 
+	// Marks the renderables of this node as changed. Bounds, transform, render
+	// entity and visibility changes do this automatically.
+	void renderablesChanged();
+
+	// Subclasses supporting retained rendering return this (non-zero) value
+	// from getRenderGeneration(), it changes along with their renderables
+	std::size_t getRenderablesGeneration() const;
+
 	// Fills in the ancestors and self (in this order) into the given targetPath.
 	void getPathRecursively(scene::Path& targetPath);
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "itextstream.h"
+#include <algorithm>
+#include <vector>
 
 namespace stream
 {
@@ -54,12 +56,15 @@ public:
 
 /// \brief A binary-to-text wrapper around an InputStream.
 /// Converts CRLF or LFCR line-endings to LF line-endings.
+/// Reads straight into the target buffer and strips the CRs in place.
 template<typename BinaryInputStreamType>
 class BinaryToTextInputStream : 
 	public TextInputStream
 {
 private:
-	SingleByteInputStream<BinaryInputStreamType> _inputStream;
+	typedef typename BinaryInputStreamType::byte_type byte_type;
+
+	BinaryInputStreamType& _inputStream;
 
 public:
 	BinaryToTextInputStream(BinaryInputStreamType& inputStream) : 
@@ -69,23 +74,105 @@ public:
 	std::size_t read(char* buffer, std::size_t length) override
 	{
 		char* p = buffer;
-		for (;;)
+
+		while (length != 0)
+		{
+			std::size_t bytesRead = _inputStream.read(reinterpret_cast<byte_type*>(p), length);
+
+			if (bytesRead == 0)
+			{
+				break;
+			}
+
+			char* end = std::remove(p, p + bytesRead, '\r');
+
+			length -= end - p;
+			p = end;
+		}
+
+		return p - buffer;
+	}
+};
+
+/// \brief A binary-to-text wrapper around an InputStream of known size.
+/// The whole stream is pulled on first access, asking for all of it at once
+/// which allows the wrapped stream to use a whole-file fast path. Streams
+/// returning less than asked for or more than the given size are read until
+/// they are exhausted.
+/// Line endings are converted like in BinaryToTextInputStream.
+template<typename BinaryInputStreamType>
+class WholeFileBinaryToTextInputStream :
+	public TextInputStream
+{
+private:
+	typedef typename BinaryInputStreamType::byte_type byte_type;
+
+	BinaryInputStreamType& _inputStream;
+	std::size_t _size;
+
+	std::vector<char> _contents;
+	std::size_t _position;
+	bool _loaded;
+
+public:
+	WholeFileBinaryToTextInputStream(BinaryInputStreamType& inputStream, std::size_t size) :
+		_inputStream(inputStream),
+		_size(size),
+		_position(0),
+		_loaded(false)
+	{}
+
+	std::size_t read(char* buffer, std::size_t length) override
+	{
+		if (!_loaded)
+		{
+			load();
+		}
+
+		std::size_t count = std::min(_contents.size() - _position, length);
+
+		std::copy(_contents.begin() + _position, _contents.begin() + _position + count, buffer);
+		_position += count;
+
+		return count;
+	}
+
+private:
+	void load()
+	{
+		_loaded = true;
+		_contents.resize(_size);
+
+		std::size_t bytesRead = 0;
+
+		while (true)
 		{
-			if (length != 0 && _inputStream.readByte(*reinterpret_cast<typename BinaryInputStreamType::byte_type*>(p)))
+			std::size_t count;
+
+			if (bytesRead < _contents.size())
 			{
-				if (*p != '\r')
-				{
-					++p;
-					--length;
-				}
+				count = _inputStream.read(reinterpret_cast<byte_type*>(_contents.data() + bytesRead),
+					_contents.size() - bytesRead);
 			}
 			else
 			{
-				return p - buffer;
+				// The size might be wrong, check for more data before growing
+				byte_type chunk[4096];
+				count = _inputStream.read(chunk, sizeof(chunk));
+
+				_contents.insert(_contents.end(), chunk, chunk + count);
 			}
+
+			if (count == 0)
+			{
+				break;
+			}
+
+			bytesRead += count;
 		}
+
+		_contents.resize(std::remove(_contents.begin(), _contents.begin() + bytesRead, '\r') - _contents.begin());
 	}
 };
 
 }
-
@@ -25,12 +25,8 @@ public:
 	{
 		std::size_t count = std::min(std::size_t(_end - _read), length);
 		
-		const char* end = _read + count;
-
-		while (_read != end)
-		{
-			*buffer++ = *_read++;
-		}
+		std::copy(_read, _read + count, buffer);
+		_read += count;
 
 		return count;
 	}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util
+{
+
+/**
+ * A fixed-size pool of worker threads processing queued tasks in FIFO order.
+ *
+ * Worker threads are spawned on the first call to enqueue(). Calling stop()
+ * (or destroying the pool) lets the workers finish all queued tasks before
+ * joining them; the pool can be used again afterwards.
+ */
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+private:
+	std::size_t _numThreads;
+	std::vector<std::thread> _threads;
+
+	std::deque<Task> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _taskAvailable;
+
+	bool _stopping;
+
+public:
+	// Construct a pool with the given number of threads, pass 0 to
+	// use one thread per hardware core
+	ThreadPool(std::size_t numThreads = 0) :
+		_numThreads(numThreads > 0 ? numThreads : getDefaultNumThreads()),
+		_stopping(false)
+	{}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool()
+	{
+		stop();
+	}
+
+	std::size_t getNumThreads() const
+	{
+		return _numThreads;
+	}
+
+	// Queue the given task for execution on one of the worker threads
+	void enqueue(const Task& task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			ensureThreadsStarted();
+			_tasks.push_back(task);
+		}
+
+		_taskAvailable.notify_one();
+	}
+
+	// Queue the given function, returning a future for its result.
+	// Exceptions thrown by the function are passed on to the future.
+	template<typename Func>
+	auto submit(Func func) -> std::future<decltype(func())>
+	{
+		typedef decltype(func()) ReturnType;
+
+		// std::function requires a copyable target, so hold the packaged_task by pointer
+		auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::move(func));
+
+		enqueue([task]() { (*task)(); });
+
+		return task->get_future();
+	}
+
+	// Finishes all queued tasks and joins the worker threads.
+	// Must not be called from a worker thread.
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stopping = true;
+		}
+
+		_taskAvailable.notify_all();
+
+		for (std::thread& thread : _threads)
+		{
+			thread.join();
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_threads.clear();
+		_stopping = false;
+	}
+
+	// One thread per core, but at least one
+	static std::size_t getDefaultNumThreads()
+	{
+		return std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+private:
+	// Requires _mutex to be held
+	void ensureThreadsStarted()
+	{
+		while (_threads.size() < _numThreads)
+		{
+			_threads.emplace_back(&ThreadPool::processTasks, this);
+		}
+	}
+
+	void processTasks()
+	{
+		while (true)
+		{
+			Task task;
+
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+
+				_taskAvailable.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+
+				if (_tasks.empty())
+				{
+					return; // stopping and nothing left to do
+				}
+
+				task = std::move(_tasks.front());
+				_tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+};
+
+}
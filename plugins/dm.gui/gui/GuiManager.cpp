@@ -3,7 +3,6 @@
 #include "iarchive.h"
 #include "ifilesystem.h"
 #include "itextstream.h"
-#include "parser/CodeTokeniser.h"
 
 #include "Gui.h"
 
@@ -11,7 +10,8 @@ namespace gui
 {
 
 GuiManager::GuiManager() :
-    _guiLoader(std::bind(&GuiManager::findGuis, this))
+    _guiLoader("Guis", std::bind(&GuiManager::findGuis, this),
+        { "Materials", "Fonts" }, decl::LoadPriority::Low)
 {}
 
 void GuiManager::registerGui(const std::string& guiPath)
@@ -117,6 +117,7 @@ void GuiManager::clear()
     _guiLoader.reset();
 	_guis.clear();
 	_errorList.clear();
+	_includeCache.clear();
 }
 
 IGuiPtr GuiManager::getGui(const std::string& guiPath)
@@ -174,7 +175,7 @@ GuiPtr GuiManager::loadGui(const std::string& guiPath)
 	// Construct a Code Tokeniser, which is able to handle #includes
 	try
 	{
-		parser::CodeTokeniser tokeniser(file, parser::WHITESPACE, "{}(),;");
+		parser::CodeTokeniser tokeniser(file, parser::WHITESPACE, "{}(),;", &_includeCache);
 
 		info.gui = Gui::createFromTokens(tokeniser);
 		info.type = UNDETERMINED;
@@ -205,6 +206,7 @@ const StringSet& GuiManager::getDependencies() const
 	if (_dependencies.empty())
 	{
 		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
+		_dependencies.insert(MODULE_DECLLOADSCHEDULER);
 	}
 
 	return _dependencies;
@@ -220,6 +222,9 @@ void GuiManager::initialiseModule(const ApplicationContext& ctx)
 
 void GuiManager::shutdownModule()
 {
+	rMessage() << "[GuiManager] Include cache hits: " << _includeCache.getNumHits()
+		<< ", misses: " << _includeCache.getNumMisses() << std::endl;
+
 	clear();
 }
 
@@ -6,6 +6,7 @@
 #include "ifilesystem.h"
 #include "string/string.h"
 #include "ThreadedDefLoader.h"
+#include "parser/CodeTokeniser.h"
 
 namespace gui
 {
@@ -55,6 +56,9 @@ private:
 	// A List of all the errors occuring lastly.
 	StringList _errorList;
 
+	// Tokens of the files #included by the GUIs, most readables share them
+	parser::CodeFileCache _includeCache;
+
 public:
 	GuiManager();
 
@@ -1,5 +1,7 @@
 #include "FileSystemInterface.h"
 
+#include <pybind11/stl_bind.h>
+
 #include "generic/callback.h"
 #include "iarchive.h"
 #include "itextstream.h"
@@ -60,6 +62,21 @@ std::string FileSystemInterface::findRoot(const std::string& name)
 	return GlobalFileSystem().findRoot(name);
 }
 
+vfs::IOStatisticsReport FileSystemInterface::getIOStatistics()
+{
+	return GlobalFileSystem().getIOStatistics();
+}
+
+void FileSystemInterface::resetIOStatistics()
+{
+	GlobalFileSystem().resetIOStatistics();
+}
+
+bool FileSystemInterface::setIOTraceFile(const std::string& path)
+{
+	return GlobalFileSystem().setIOTraceFile(path);
+}
+
 void FileSystemInterface::registerInterface(py::module& scope, py::dict& globals) 
 {
 	// Expose the FileVisitor interface
@@ -67,6 +84,20 @@ void FileSystemInterface::registerInterface(py::module& scope, py::dict& globals
 	visitor.def(py::init<>());
 	visitor.def("visit", &VirtualFileSystemVisitor::visit);
 
+	// Declare the I/O statistics types
+	py::class_<vfs::IOStatistics> ioStatistics(scope, "IOStatistics");
+	ioStatistics.def_readonly("opens", &vfs::IOStatistics::opens);
+	ioStatistics.def_readonly("bytesRead", &vfs::IOStatistics::bytesRead);
+	ioStatistics.def_readonly("bytesInflated", &vfs::IOStatistics::bytesInflated);
+	ioStatistics.def_readonly("latencyMicroseconds", &vfs::IOStatistics::latencyMicroseconds);
+
+	py::bind_map<vfs::IOStatisticsReport::StatisticsMap>(scope, "IOStatisticsMap");
+
+	py::class_<vfs::IOStatisticsReport> ioReport(scope, "IOStatisticsReport");
+	ioReport.def_readonly("archives", &vfs::IOStatisticsReport::archives);
+	ioReport.def_readonly("extensions", &vfs::IOStatisticsReport::extensions);
+	ioReport.def_readonly("peakConcurrentReaders", &vfs::IOStatisticsReport::peakConcurrentReaders);
+
 	// Add the VFS module declaration to the given python namespace
 	py::class_<FileSystemInterface> filesystem(scope, "FileSystem");
 	filesystem.def("forEachFile", &FileSystemInterface::forEachFile);
@@ -74,6 +105,9 @@ void FileSystemInterface::registerInterface(py::module& scope, py::dict& globals
 	filesystem.def("findRoot", &FileSystemInterface::findRoot);
 	filesystem.def("readTextFile", &FileSystemInterface::readTextFile);
 	filesystem.def("getFileCount", &FileSystemInterface::getFileCount);
+	filesystem.def("getIOStatistics", &FileSystemInterface::getIOStatistics);
+	filesystem.def("resetIOStatistics", &FileSystemInterface::resetIOStatistics);
+	filesystem.def("setIOTraceFile", &FileSystemInterface::setIOTraceFile);
 
 	// Now point the Python variable "GlobalFileSystem" to this instance
 	globals["GlobalFileSystem"] = this;
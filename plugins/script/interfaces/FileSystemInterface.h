@@ -61,6 +61,10 @@ public:
 	std::string findFile(const std::string& name);
 	std::string findRoot(const std::string& name);
 
+	vfs::IOStatisticsReport getIOStatistics();
+	void resetIOStatistics();
+	bool setIOTraceFile(const std::string& path);
+
 	// IScriptInterface implementation
 	void registerInterface(py::module& scope, py::dict& globals) override;
 };
@@ -2,10 +2,10 @@
 
 #include "SoundManager.h"
 
-#include "parser/DefBlockTokeniser.h"
-#include "parser/DefTokeniser.h"
+#include "parser/ParseException.h"
 #include "ifilesystem.h"
-#include "iarchive.h"
+#include "ideclcache.h"
+#include "gamelib.h"
 #include "imainframe.h"
 
 #include <iostream>
@@ -40,19 +40,13 @@ private:
 		return input;
 	}
 
-    // Accept a stream of shaders to parse
-    void parseShadersFromStream(std::istream& contents,
-                                const std::string& modName)
+    // Add the shaders of the given file to the map
+    void addShaders(const decl::DeclFile& file)
     {
-        // Construct a DefTokeniser to tokenise the string into sound shader
-        // decls
-        parser::BasicDefBlockTokeniser<std::istream> tok(contents);
+        std::string modName = game::current::getModPath(file.modRoot);
 
-        while (tok.hasMoreBlocks())
+        for (const decl::DeclBlock& block : file.blocks)
         {
-            // Retrieve a named definition block from the parser
-            parser::BlockTokeniser::Block block = tok.nextBlock();
-
             // Create a new shader with this name
             std::pair<SoundManager::ShaderMap::iterator, bool> result;
             result = _shaders.insert(
@@ -83,29 +77,26 @@ public:
 	 */
 	void operator()(const std::string& filename)
 	{
-		// Open the .sndshd file and get its contents as a std::string
-		ArchiveTextFilePtr file =
-			GlobalFileSystem().openTextFile(SOUND_FOLDER + filename);
-
-		// Parse contents of file if it was opened successfully
-		if (file)
-        {
-			std::istream is(&(file->getInputStream()));
+		try
+		{
+			// Get the blocks of the .sndshd file, unchanged files come from the cache
+			decl::DeclFilePtr file = GlobalDeclCache().getFile(SOUND_FOLDER + filename,
+				decl::DeclFileContents::Blocks);
 
-			try
-            {
-				parseShadersFromStream(is, file->getModName());
+			if (file)
+			{
+				addShaders(*file);
 			}
-			catch (parser::ParseException& ex) 
-            {
-				rError() << "[sound]: Error while parsing " << filename <<
-					": " << ex.what() << std::endl;
+			else
+			{
+				rWarning() << "[sound] Warning: unable to open \""
+					<< filename << "\"" << std::endl;
 			}
 		}
-		else 
-        {
-			rWarning() << "[sound] Warning: unable to open \""
-					  << filename << "\"" << std::endl;
+		catch (parser::ParseException& ex)
+		{
+			rError() << "[sound]: Error while parsing " << filename <<
+				": " << ex.what() << std::endl;
 		}
 	}
 };
@@ -13,7 +13,8 @@ namespace sound
 
 // Constructor
 SoundManager::SoundManager() :
-    _defLoader(std::bind(&SoundManager::loadShadersFromFilesystem, this)),
+    _defLoader("SoundShaders", std::bind(&SoundManager::loadShadersFromFilesystem, this),
+        {}, decl::LoadPriority::Low),
 	_emptyShader(new SoundShader("", ""))
 {}
 
@@ -116,6 +117,8 @@ const StringSet& SoundManager::getDependencies() const
 
 	if (_dependencies.empty()) {
 		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
+		_dependencies.insert(MODULE_DECLLOADSCHEDULER);
+		_dependencies.insert(MODULE_DECLCACHE);
 	}
 
 	return _dependencies;
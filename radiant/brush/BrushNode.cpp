@@ -7,6 +7,8 @@
 #include "iclipper.h"
 #include "ientity.h"
 #include "math/Frustum.h"
+#include "entitylib.h"
+#include "MergedFaceBuffers.h"
 #include <functional>
 
 // Constructor
@@ -309,6 +311,10 @@ bool BrushNode::intersectsLight(const RendererLight& light) const {
 	return light.intersectsAABB(worldAABB());
 }
 
+AABB BrushNode::litObjectAABB() const {
+	return worldAABB();
+}
+
 void BrushNode::insertLight(const RendererLight& light) {
 	const Matrix4& l2w = localToWorld();
 	for (FaceInstances::iterator i = m_faceInstances.begin(); i != m_faceInstances.end(); ++i) {
@@ -393,6 +399,43 @@ std::size_t BrushNode::getHighlightFlags()
 	return isGroupMember() ? (Highlight::Selected | Highlight::GroupMember) : Highlight::Selected;
 }
 
+std::size_t BrushNode::getRenderGeneration() const
+{
+	// Selected components and the clip plane are highlighted, submit them each frame
+	if (isSelectedComponents() || (GlobalClipper().clipMode() && isSelected()))
+	{
+		return 0;
+	}
+
+	return getRenderablesGeneration();
+}
+
+void BrushNode::updateRetainedRenderables() const
+{
+	// The faces keep their lists of lights, which are filled in here
+	m_lightList->calculateIntersectingLights();
+
+	// Merged faces are not part of the retained renderables, draw them again
+	if (MergedFaceBuffers::Instance().isActive() && facesCanBeMerged())
+	{
+		bool forceVisible = isForcedVisible();
+
+		for (const FaceInstance& face : m_faceInstances)
+		{
+			if ((forceVisible || face.faceIsVisible()) && face.getFace().contributes())
+			{
+				face.getFace().renderMerged(*_renderEntity);
+			}
+		}
+	}
+}
+
+bool BrushNode::facesCanBeMerged() const
+{
+	// Selected brushes are highlighted or transformed, entity brushes might be transformed
+	return !isSelected() && !isSelectedComponents() && Node_isWorldspawn(getParent());
+}
+
 void BrushNode::evaluateViewDependent(const VolumeTest& volume, const Matrix4& localToWorld) const
 {
 	if (!m_viewChanged) return;
@@ -448,12 +491,25 @@ void BrushNode::renderSolid(RenderableCollector& collector,
 	// Check for the override status of this brush
 	bool forceVisible = isForcedVisible();
 
+	// The camera might draw the faces from the merged buffers of their materials
+	bool merged = MergedFaceBuffers::Instance().isActive() && facesCanBeMerged();
+
     // Submit the lights and renderable geometry for each face
 	for (const FaceInstance& face : m_faceInstances)
     {
 		// Skip invisible faces before traversing further
 		if (!forceVisible && !face.faceIsVisible()) continue;
 
+		if (merged)
+		{
+			if (face.getFace().intersectVolume(volume))
+			{
+				face.getFace().renderMerged(*_renderEntity);
+			}
+
+			continue;
+		}
+
 		// greebo: BrushNodes have always an identity l2w, don't do any transforms
 		face.renderSolid(collector, volume, *_renderEntity);
     }
@@ -544,6 +600,8 @@ void BrushNode::updateFaceVisibility()
 	{
 		i->updateFaceVisibility();
 	}
+
+	renderablesChanged();
 }
 
 void BrushNode::transformComponents(const Matrix4& matrix) {
@@ -138,6 +138,7 @@ public:
 
 	// LitObject implementation
 	bool intersectsLight(const RendererLight& light) const override;
+	AABB litObjectAABB() const override;
 	void insertLight(const RendererLight& light) override;
 	void clearLights() override;
 
@@ -149,6 +150,8 @@ public:
 
 	void viewChanged() const override;
 	std::size_t getHighlightFlags() override;
+	std::size_t getRenderGeneration() const override;
+	void updateRetainedRenderables() const override;
 
 	void evaluateTransform();
 
@@ -186,6 +189,10 @@ private:
                               const Matrix4& localToWorld) const;
 
 	void renderClipPlane(RenderableCollector& collector, const VolumeTest& volume) const;
+
+	// True if the faces can be drawn from the merged buffers of the camera
+	bool facesCanBeMerged() const;
+
 	void evaluateViewDependent(const VolumeTest& volume, const Matrix4& localToWorld) const;
 
 }; // class BrushNode
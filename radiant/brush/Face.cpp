@@ -41,7 +41,8 @@ Face::Face(Brush& owner) :
     _owner(owner),
     _shader(texdef_name_default(), _owner.getBrushNode().getRenderSystem()),
     _undoStateSaver(nullptr),
-    _faceIsVisible(true)
+    _faceIsVisible(true),
+    _windingGeneration(1)
 {
 	setupSurfaceShader();
 
@@ -64,7 +65,8 @@ Face::Face(
     _shader(shader, _owner.getBrushNode().getRenderSystem()),
     _texdef(projection),
     _undoStateSaver(nullptr),
-    _faceIsVisible(true)
+    _faceIsVisible(true),
+    _windingGeneration(1)
 {
 	setupSurfaceShader();
     m_plane.initialiseFromPoints(p0, p1, p2);
@@ -76,7 +78,8 @@ Face::Face(Brush& owner, const Plane3& plane) :
     _owner(owner),
     _shader("", _owner.getBrushNode().getRenderSystem()),
     _undoStateSaver(nullptr),
-    _faceIsVisible(true)
+    _faceIsVisible(true),
+    _windingGeneration(1)
 {
 	setupSurfaceShader();
     m_plane.setPlane(plane);
@@ -89,7 +92,8 @@ Face::Face(Brush& owner, const Plane3& plane, const Matrix4& texdef,
     _owner(owner),
     _shader(shader, _owner.getBrushNode().getRenderSystem()),
     _undoStateSaver(nullptr),
-    _faceIsVisible(true)
+    _faceIsVisible(true),
+    _windingGeneration(1)
 {
 	setupSurfaceShader();
     m_plane.setPlane(plane);
@@ -108,7 +112,8 @@ Face::Face(Brush& owner, const Face& other) :
     _shader(other._shader.getMaterialName(), _owner.getBrushNode().getRenderSystem()),
     _texdef(other.getProjection()),
     _undoStateSaver(nullptr),
-    _faceIsVisible(other._faceIsVisible)
+    _faceIsVisible(other._faceIsVisible),
+    _windingGeneration(1)
 {
 	setupSurfaceShader();
     planepts_assign(m_move_planepts, other.m_move_planepts);
@@ -118,6 +123,8 @@ Face::Face(Brush& owner, const Face& other) :
 Face::~Face()
 {
 	_surfaceShaderRealised.disconnect();
+
+	MergedFaceBuffers::Instance().removeFace(_mergedSlot);
 }
 
 void Face::setupSurfaceShader()
@@ -230,6 +237,12 @@ void Face::renderSolid(RenderableCollector& collector, const Matrix4& localToWor
 	collector.addRenderable(_shader.getGLShader(), m_winding, localToWorld, entity, lights);
 }
 
+void Face::renderMerged(const IRenderEntity& entity) const
+{
+	MergedFaceBuffers::Instance().renderMerged(_mergedSlot, _shader.getGLShader(), m_winding,
+		_windingGeneration, entity);
+}
+
 void Face::renderWireframe(RenderableCollector& collector, const Matrix4& localToWorld,
 	const IRenderEntity& entity) const
 {
@@ -307,6 +320,7 @@ void Face::freezeTransform() {
 
 void Face::updateWinding() {
     m_winding.updateNormals(m_plane.getPlane().normal());
+    ++_windingGeneration;
 }
 
 void Face::update_move_planepts_vertex(std::size_t index, PlanePoints planePoints) {
@@ -518,6 +532,7 @@ void Face::alignTexture(EAlignType align)
 
 void Face::EmitTextureCoordinates() {
     m_texdefTransformed.emitTextureCoordinates(m_winding, plane3().normal(), Matrix4::getIdentity());
+    ++_windingGeneration;
 }
 
 void Face::applyDefaultTextureScale()
@@ -12,6 +12,7 @@
 #include "SurfaceShader.h"
 #include "PlanePoints.h"
 #include "FacePlane.h"
+#include "MergedFaceBuffers.h"
 #include <memory>
 #include "util/Noncopyable.h"
 #include <sigc++/signal.h>
@@ -61,6 +62,12 @@ private:
 	// Cached visibility flag, queried during front end rendering
 	bool _faceIsVisible;
 
+	// Incremented each time the winding vertices or texture coordinates change
+	std::size_t _windingGeneration;
+
+	// The location of this face in the merged buffers, if it has been drawn from them
+	mutable MergedFaceBuffers::Slot _mergedSlot;
+
 public:
 
 	// Constructors
@@ -109,6 +116,9 @@ public:
 	void renderWireframe(RenderableCollector& collector, const Matrix4& localToWorld,
 		const IRenderEntity& entity) const;
 
+	// Draws the face winding from the merged buffers of the current frame, see MergedFaceBuffers
+	void renderMerged(const IRenderEntity& entity) const;
+
 	void setRenderSystem(const RenderSystemPtr& renderSystem);
 
 	void transform(const Matrix4& matrix);
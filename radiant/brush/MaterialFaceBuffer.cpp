@@ -0,0 +1,250 @@
+#include "MaterialFaceBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+	// Below this many unused vertices, compact() leaves the arrays alone
+	const std::size_t MIN_UNUSED_VERTICES_TO_COMPACT = 1024;
+
+	// The number of indices of a triangle fan covering the given vertices
+	inline std::size_t getNumFanIndices(std::size_t numVertices)
+	{
+		return numVertices < 3 ? 0 : (numVertices - 2) * 3;
+	}
+}
+
+MaterialFaceBuffer::MaterialFaceBuffer() :
+	_unusedVertices(0),
+	_changedVertices{ 0, 0 },
+	_changedIndices{ 0, 0 },
+	_sizeChanged(false)
+{}
+
+MaterialFaceBuffer::FaceId MaterialFaceBuffer::addFace(const IWinding& winding)
+{
+	FaceId face;
+
+	if (!_freeSlots.empty())
+	{
+		face = _freeSlots.back();
+		_freeSlots.pop_back();
+	}
+	else
+	{
+		face = _slots.size();
+		_slots.emplace_back();
+	}
+
+	Slot& slot = _slots[face];
+
+	slot.used = true;
+	allocate(slot, winding.size());
+	fill(slot, winding);
+
+	return face;
+}
+
+void MaterialFaceBuffer::updateFace(FaceId face, const IWinding& winding)
+{
+	assert(face < _slots.size() && _slots[face].used);
+
+	Slot& slot = _slots[face];
+
+	// Grown windings are moved to the end, their old space stays unused
+	if (winding.size() > slot.vertexCapacity)
+	{
+		_unusedVertices += slot.vertexCapacity;
+		allocate(slot, winding.size());
+	}
+
+	fill(slot, winding);
+}
+
+void MaterialFaceBuffer::removeFace(FaceId face)
+{
+	assert(face < _slots.size() && _slots[face].used);
+
+	Slot& slot = _slots[face];
+
+	_unusedVertices += slot.vertexCapacity;
+
+	slot.used = false;
+	slot.vertexCount = 0;
+
+	_freeSlots.push_back(face);
+}
+
+std::size_t MaterialFaceBuffer::getNumFaces() const
+{
+	return _slots.size() - _freeSlots.size();
+}
+
+MaterialFaceBuffer::Range MaterialFaceBuffer::getFaceIndices(FaceId face) const
+{
+	assert(face < _slots.size());
+
+	const Slot& slot = _slots[face];
+
+	return Range{ slot.indexStart, getNumFanIndices(slot.vertexCount) };
+}
+
+MaterialFaceBuffer::Range MaterialFaceBuffer::getFaceVertices(FaceId face) const
+{
+	assert(face < _slots.size());
+
+	const Slot& slot = _slots[face];
+
+	return Range{ slot.vertexStart, slot.vertexCount };
+}
+
+const MaterialFaceBuffer::Vertices& MaterialFaceBuffer::getVertices() const
+{
+	return _vertices;
+}
+
+const MaterialFaceBuffer::Indices& MaterialFaceBuffer::getIndices() const
+{
+	return _indices;
+}
+
+bool MaterialFaceBuffer::compact()
+{
+	if (_unusedVertices < MIN_UNUSED_VERTICES_TO_COMPACT ||
+		_unusedVertices < _vertices.size() - _unusedVertices)
+	{
+		return false;
+	}
+
+	Vertices vertices;
+	Indices indices;
+
+	vertices.reserve(_vertices.size() - _unusedVertices);
+
+	for (Slot& slot : _slots)
+	{
+		if (!slot.used)
+		{
+			slot.vertexStart = vertices.size();
+			slot.vertexCapacity = 0;
+			slot.indexStart = indices.size();
+			continue;
+		}
+
+		std::size_t vertexStart = vertices.size();
+		std::size_t numIndices = getNumFanIndices(slot.vertexCapacity);
+
+		vertices.insert(vertices.end(), _vertices.begin() + slot.vertexStart,
+			_vertices.begin() + slot.vertexStart + slot.vertexCapacity);
+
+		// The indices are relative to the first vertex of the face
+		for (std::size_t i = 0; i < numIndices; ++i)
+		{
+			indices.push_back(static_cast<unsigned int>(
+				_indices[slot.indexStart + i] - slot.vertexStart + vertexStart));
+		}
+
+		slot.vertexStart = vertexStart;
+		slot.indexStart = indices.size() - numIndices;
+	}
+
+	_vertices.swap(vertices);
+	_indices.swap(indices);
+
+	_unusedVertices = 0;
+	_sizeChanged = true;
+
+	return true;
+}
+
+bool MaterialFaceBuffer::sizeChanged() const
+{
+	return _sizeChanged;
+}
+
+const MaterialFaceBuffer::Range& MaterialFaceBuffer::getChangedVertices() const
+{
+	return _changedVertices;
+}
+
+const MaterialFaceBuffer::Range& MaterialFaceBuffer::getChangedIndices() const
+{
+	return _changedIndices;
+}
+
+void MaterialFaceBuffer::clearChanges()
+{
+	_changedVertices = Range{ 0, 0 };
+	_changedIndices = Range{ 0, 0 };
+	_sizeChanged = false;
+}
+
+void MaterialFaceBuffer::allocate(Slot& slot, std::size_t numVertices)
+{
+	slot.vertexStart = _vertices.size();
+	slot.vertexCapacity = numVertices;
+	slot.vertexCount = 0;
+	slot.indexStart = _indices.size();
+
+	_vertices.resize(_vertices.size() + numVertices);
+	_indices.resize(_indices.size() + getNumFanIndices(numVertices));
+
+	_sizeChanged = true;
+}
+
+void MaterialFaceBuffer::fill(Slot& slot, const IWinding& winding)
+{
+	assert(winding.size() <= slot.vertexCapacity);
+
+	slot.vertexCount = winding.size();
+
+	for (std::size_t i = 0; i < winding.size(); ++i)
+	{
+		VertexNT& vertex = _vertices[slot.vertexStart + i];
+
+		vertex.vertex = winding[i].vertex;
+		vertex.texcoord = winding[i].texcoord;
+		vertex.normal = winding[i].normal;
+	}
+
+	// Windings are convex, triangulate them as a fan around the first vertex
+	unsigned int first = static_cast<unsigned int>(slot.vertexStart);
+	std::size_t numIndices = getNumFanIndices(slot.vertexCapacity);
+	std::size_t numUsedIndices = getNumFanIndices(slot.vertexCount);
+
+	for (std::size_t i = 0; i < numUsedIndices / 3; ++i)
+	{
+		std::size_t index = slot.indexStart + i * 3;
+
+		_indices[index] = first;
+		_indices[index + 1] = first + static_cast<unsigned int>(i) + 1;
+		_indices[index + 2] = first + static_cast<unsigned int>(i) + 2;
+	}
+
+	// Indices left over from a larger winding form degenerate triangles
+	std::fill(_indices.begin() + slot.indexStart + numUsedIndices,
+		_indices.begin() + slot.indexStart + numIndices, first);
+
+	markChanged(_changedVertices, slot.vertexStart, slot.vertexCapacity);
+	markChanged(_changedIndices, slot.indexStart, numIndices);
+}
+
+void MaterialFaceBuffer::markChanged(Range& changed, std::size_t start, std::size_t count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (changed.empty())
+	{
+		changed = Range{ start, count };
+		return;
+	}
+
+	std::size_t end = std::max(changed.start + changed.count, start + count);
+
+	changed.start = std::min(changed.start, start);
+	changed.count = end - changed.start;
+}
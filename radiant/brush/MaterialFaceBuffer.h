@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ibrush.h"
+#include "render/VertexNT.h"
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/**
+ * Vertices and triangle indices of the faces using a single material, merged
+ * into shared arrays such that the faces can be drawn from a single buffer
+ * object. This class only manages the CPU side of the buffers, uploading and
+ * drawing is up to the caller.
+ *
+ * Each face owns a range of vertices and indices in the arrays, which is kept
+ * when the face changes unless its winding has grown. Changed ranges are
+ * recorded, such that only these need to be uploaded again.
+ */
+class MaterialFaceBuffer
+{
+public:
+	typedef std::vector<VertexNT> Vertices;
+
+	// Same type as RenderIndex
+	typedef std::vector<unsigned int> Indices;
+
+	// Identifies a face in this buffer, stays valid until the face is removed
+	typedef std::size_t FaceId;
+
+	static const FaceId InvalidFace = std::numeric_limits<FaceId>::max();
+
+	// A range of elements in the vertex or index array
+	struct Range
+	{
+		std::size_t start;
+		std::size_t count;
+
+		bool empty() const
+		{
+			return count == 0;
+		}
+	};
+
+private:
+	struct Slot
+	{
+		// The reserved vertices, the first vertexCount ones are in use
+		std::size_t vertexStart;
+		std::size_t vertexCapacity;
+		std::size_t vertexCount;
+
+		// The reserved indices, starting with the ones of the triangle fan
+		std::size_t indexStart;
+
+		bool used;
+	};
+
+	std::vector<Slot> _slots;
+
+	// Ids of unused slots, which are reused by addFace()
+	std::vector<FaceId> _freeSlots;
+
+	Vertices _vertices;
+	Indices _indices;
+
+	// The number of reserved vertices not being used by any face
+	std::size_t _unusedVertices;
+
+	// Changes since the last call to clearChanges()
+	Range _changedVertices;
+	Range _changedIndices;
+	bool _sizeChanged;
+
+public:
+	MaterialFaceBuffer();
+
+	/// Adds the given winding as new face, returns its id
+	FaceId addFace(const IWinding& winding);
+
+	/// Replaces the geometry of the given face
+	void updateFace(FaceId face, const IWinding& winding);
+
+	/// Removes the given face, its id may be reused by addFace()
+	void removeFace(FaceId face);
+
+	/// Returns the number of faces in this buffer
+	std::size_t getNumFaces() const;
+
+	/// Returns the range of indices making up the triangles of the given face
+	Range getFaceIndices(FaceId face) const;
+
+	/// Returns the range of vertices used by the given face
+	Range getFaceVertices(FaceId face) const;
+
+	const Vertices& getVertices() const;
+	const Indices& getIndices() const;
+
+	/**
+	 * Packs the faces to the beginning of the arrays, if the unused space
+	 * exceeds the used one. The face ids stay the same, but their ranges
+	 * change. Returns true if the arrays have been packed.
+	 */
+	bool compact();
+
+	/// Returns true if the arrays have been resized since clearChanges()
+	bool sizeChanged() const;
+
+	/// The elements which have been changed since clearChanges()
+	const Range& getChangedVertices() const;
+	const Range& getChangedIndices() const;
+
+	/// Marks the current contents as uploaded
+	void clearChanges();
+
+private:
+	// Reserves space for the given number of vertices at the end of the arrays
+	void allocate(Slot& slot, std::size_t numVertices);
+
+	// Copies the winding into the reserved space of the given slot
+	void fill(Slot& slot, const IWinding& winding);
+
+	void markChanged(Range& changed, std::size_t start, std::size_t count);
+};
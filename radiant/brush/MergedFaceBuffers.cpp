@@ -0,0 +1,360 @@
+#include "MergedFaceBuffers.h"
+
+#include "igl.h"
+#include "irenderable.h"
+#include "math/Matrix4.h"
+#include "render/VBO.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * The merged buffer of the faces using a single shader, along with the VBOs
+ * holding its uploaded copy.
+ */
+class MergedFaceBuffers::Batch :
+	public OpenGLRenderable
+{
+private:
+	ShaderPtr _shader;
+
+	MaterialFaceBuffer _buffer;
+
+	// The faces to draw in this frame
+	std::vector<MaterialFaceBuffer::FaceId> _visibleFaces;
+
+	// The index ranges to draw, adjacent faces are merged into one range
+	std::vector<GLsizei> _counts;
+	std::vector<const GLvoid*> _offsets;
+
+	GLuint _vertexVBO;
+	GLuint _indexVBO;
+
+	// The VBOs to delete once the GL context is current, see MergedFaceBuffers
+	std::vector<GLuint>& _releasedBuffers;
+
+public:
+	Batch(const ShaderPtr& shader, std::vector<GLuint>& releasedBuffers) :
+		_shader(shader),
+		_vertexVBO(0),
+		_indexVBO(0),
+		_releasedBuffers(releasedBuffers)
+	{}
+
+	// Batches are destroyed along with their last face, not necessarily
+	// while rendering, so the VBOs are only queued for deletion
+	~Batch()
+	{
+		releaseVBOs();
+	}
+
+	const ShaderPtr& getShader() const
+	{
+		return _shader;
+	}
+
+	MaterialFaceBuffer& getBuffer()
+	{
+		return _buffer;
+	}
+
+	void addVisibleFace(MaterialFaceBuffer::FaceId face)
+	{
+		_visibleFaces.push_back(face);
+	}
+
+	bool hasVisibleFaces() const
+	{
+		return !_visibleFaces.empty();
+	}
+
+	void clearVisibleFaces()
+	{
+		_visibleFaces.clear();
+	}
+
+	// Uploads the changes to the VBOs and determines the ranges to draw
+	void prepare()
+	{
+		_buffer.compact();
+
+		upload();
+
+		std::vector<MaterialFaceBuffer::Range> ranges;
+		ranges.reserve(_visibleFaces.size());
+
+		for (MaterialFaceBuffer::FaceId face : _visibleFaces)
+		{
+			MaterialFaceBuffer::Range range = _buffer.getFaceIndices(face);
+
+			if (!range.empty())
+			{
+				ranges.push_back(range);
+			}
+		}
+
+		std::sort(ranges.begin(), ranges.end(), [](const MaterialFaceBuffer::Range& a, const MaterialFaceBuffer::Range& b)
+		{
+			return a.start < b.start;
+		});
+
+		_counts.clear();
+		_offsets.clear();
+
+		std::size_t rangeEnd = 0;
+
+		for (const MaterialFaceBuffer::Range& range : ranges)
+		{
+			if (!_counts.empty() && range.start == rangeEnd)
+			{
+				_counts.back() += static_cast<GLsizei>(range.count);
+			}
+			else
+			{
+				_counts.push_back(static_cast<GLsizei>(range.count));
+				_offsets.push_back(reinterpret_cast<const GLvoid*>(range.start * sizeof(unsigned int)));
+			}
+
+			rangeEnd = range.start + range.count;
+		}
+	}
+
+	void render(const RenderInfo& info) const override
+	{
+		// Tangents are not stored, bump mapped passes are never given merged faces
+		if (_counts.empty() || _vertexVBO == 0 || info.checkFlag(RENDER_BUMP))
+		{
+			return;
+		}
+
+		// Our vertex colours are always white, if requested
+		glDisableClientState(GL_COLOR_ARRAY);
+		if (info.checkFlag(RENDER_VERTEX_COLOUR))
+		{
+			glColor3f(1, 1, 1);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, _vertexVBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexVBO);
+
+		const GLsizei stride = sizeof(VertexNT);
+		const GLvoid* vertexOffset = reinterpret_cast<const GLvoid*>(offsetof(VertexNT, vertex));
+
+		glVertexPointer(3, GL_DOUBLE, stride, vertexOffset);
+
+		// Same texture coordinates as Winding::render()
+		if (info.checkFlag(RENDER_TEXTURE_CUBEMAP))
+		{
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+			glTexCoordPointer(3, GL_DOUBLE, stride, vertexOffset);
+		}
+		else
+		{
+			if (info.checkFlag(RENDER_LIGHTING))
+			{
+				glNormalPointer(GL_DOUBLE, stride, reinterpret_cast<const GLvoid*>(offsetof(VertexNT, normal)));
+			}
+
+			if (info.checkFlag(RENDER_TEXTURE_2D))
+			{
+				glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+				glTexCoordPointer(2, GL_DOUBLE, stride, reinterpret_cast<const GLvoid*>(offsetof(VertexNT, texcoord)));
+			}
+		}
+
+		if (GLEW_VERSION_1_4)
+		{
+			glMultiDrawElements(GL_TRIANGLES, _counts.data(), GL_UNSIGNED_INT, _offsets.data(),
+				static_cast<GLsizei>(_counts.size()));
+		}
+		else
+		{
+			for (std::size_t i = 0; i < _counts.size(); ++i)
+			{
+				glDrawElements(GL_TRIANGLES, _counts[i], GL_UNSIGNED_INT, _offsets[i]);
+			}
+		}
+
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+private:
+	void upload()
+	{
+		const MaterialFaceBuffer::Vertices& vertices = _buffer.getVertices();
+		const MaterialFaceBuffer::Indices& indices = _buffer.getIndices();
+
+		// Resized buffers are uploaded as a whole
+		if (_buffer.sizeChanged())
+		{
+			releaseVBOs();
+		}
+
+		if (vertices.empty() || indices.empty())
+		{
+			_buffer.clearChanges();
+			return;
+		}
+
+		if (_vertexVBO == 0)
+		{
+			_vertexVBO = render::makeVBOFromArray(GL_ARRAY_BUFFER, vertices);
+			_indexVBO = render::makeVBOFromArray(GL_ELEMENT_ARRAY_BUFFER, indices);
+		}
+		else
+		{
+			const MaterialFaceBuffer::Range& changedVertices = _buffer.getChangedVertices();
+			const MaterialFaceBuffer::Range& changedIndices = _buffer.getChangedIndices();
+
+			if (!changedVertices.empty())
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, _vertexVBO);
+				glBufferSubData(GL_ARRAY_BUFFER, changedVertices.start * sizeof(VertexNT),
+					changedVertices.count * sizeof(VertexNT), &vertices[changedVertices.start]);
+			}
+
+			if (!changedIndices.empty())
+			{
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexVBO);
+				glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, changedIndices.start * sizeof(unsigned int),
+					changedIndices.count * sizeof(unsigned int), &indices[changedIndices.start]);
+			}
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		_buffer.clearChanges();
+	}
+
+	void releaseVBOs()
+	{
+		for (GLuint* vbo : { &_vertexVBO, &_indexVBO })
+		{
+			if (*vbo != 0)
+			{
+				_releasedBuffers.push_back(*vbo);
+				*vbo = 0;
+			}
+		}
+	}
+};
+
+MergedFaceBuffers::MergedFaceBuffers() :
+	_entity(nullptr),
+	_active(false)
+{}
+
+// The instance is destroyed at exit, after the GL context. The names of the
+// released buffers are left to go with the context.
+MergedFaceBuffers::~MergedFaceBuffers()
+{}
+
+MergedFaceBuffers& MergedFaceBuffers::Instance()
+{
+	static MergedFaceBuffers _instance;
+	return _instance;
+}
+
+void MergedFaceBuffers::beginFrame()
+{
+	for (const auto& pair : _batches)
+	{
+		pair.second->clearVisibleFaces();
+	}
+
+	_entity = nullptr;
+	_active = true;
+}
+
+bool MergedFaceBuffers::isActive() const
+{
+	return _active;
+}
+
+void MergedFaceBuffers::renderMerged(Slot& slot, const ShaderPtr& shader, const IWinding& winding,
+	std::size_t windingGeneration, const IRenderEntity& entity)
+{
+	// Faces changing their shader move to the buffer of the new one
+	if (slot.batch != nullptr && slot.batch->getShader() != shader)
+	{
+		removeFace(slot);
+	}
+
+	if (slot.batch == nullptr)
+	{
+		auto& batch = _batches[shader.get()];
+
+		if (!batch)
+		{
+			batch.reset(new Batch(shader, _releasedBuffers));
+		}
+
+		slot.batch = batch.get();
+		slot.face = batch->getBuffer().addFace(winding);
+		slot.windingGeneration = windingGeneration;
+	}
+	else if (slot.windingGeneration != windingGeneration)
+	{
+		slot.batch->getBuffer().updateFace(slot.face, winding);
+		slot.windingGeneration = windingGeneration;
+	}
+
+	slot.batch->addVisibleFace(slot.face);
+
+	_entity = &entity;
+}
+
+void MergedFaceBuffers::removeFace(Slot& slot)
+{
+	if (slot.batch == nullptr)
+	{
+		return;
+	}
+
+	MaterialFaceBuffer& buffer = slot.batch->getBuffer();
+
+	buffer.removeFace(slot.face);
+
+	// Buffers of unused shaders are released right away
+	if (buffer.getNumFaces() == 0)
+	{
+		_batches.erase(slot.batch->getShader().get());
+	}
+
+	slot = Slot();
+}
+
+void MergedFaceBuffers::endFrame(RenderableCollector& collector)
+{
+	_active = false;
+
+	if (!_releasedBuffers.empty())
+	{
+		glDeleteBuffers(static_cast<GLsizei>(_releasedBuffers.size()), _releasedBuffers.data());
+		_releasedBuffers.clear();
+	}
+
+	if (_entity == nullptr)
+	{
+		return;
+	}
+
+	for (const auto& pair : _batches)
+	{
+		Batch& batch = *pair.second;
+
+		if (!batch.hasVisibleFaces())
+		{
+			continue;
+		}
+
+		batch.prepare();
+
+		collector.addRenderable(batch.getShader(), batch, Matrix4::getIdentity(), *_entity);
+	}
+}
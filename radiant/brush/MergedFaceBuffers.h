@@ -0,0 +1,81 @@
+#pragma once
+
+#include "igl.h"
+#include "irender.h"
+#include "MaterialFaceBuffer.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+class RenderableCollector;
+
+/**
+ * The merged vertex and index buffers the camera draws worldspawn brush faces
+ * from, one per material, such that all visible faces of a material are drawn
+ * with a single call instead of one call per face.
+ *
+ * While a frame is active (see beginFrame()), brushes hand their visible
+ * faces over to renderMerged() instead of submitting the windings themselves.
+ * The faces stay in the buffers between frames, only changed faces are
+ * uploaded again. Selected or highlighted brushes render their faces
+ * individually as before.
+ */
+class MergedFaceBuffers
+{
+public:
+	// The buffer of a single material, see the .cpp file
+	class Batch;
+
+	// The location of a face in the buffers, stored by the face itself
+	struct Slot
+	{
+		Batch* batch = nullptr;
+		MaterialFaceBuffer::FaceId face = MaterialFaceBuffer::InvalidFace;
+
+		// The winding generation of the face when it has been stored
+		std::size_t windingGeneration = 0;
+	};
+
+private:
+	// The VBOs of released batches, faces are destroyed without the GL context
+	// being current, so these are deleted in the next endFrame(). Declared
+	// before the batches, which add to it when being destroyed.
+	std::vector<GLuint> _releasedBuffers;
+
+	std::map<const Shader*, std::unique_ptr<Batch>> _batches;
+
+	// The entity the faces drawn in this frame belong to
+	const IRenderEntity* _entity;
+
+	bool _active;
+
+public:
+	MergedFaceBuffers();
+	~MergedFaceBuffers();
+
+	static MergedFaceBuffers& Instance();
+
+	/// Starts collecting the faces to draw in the next frame
+	void beginFrame();
+
+	/// Returns true while faces are collected, between beginFrame() and endFrame()
+	bool isActive() const;
+
+	/**
+	 * Stores the given face winding in the buffer of its shader (again, if its
+	 * generation differs from the stored one) and draws it in this frame.
+	 */
+	void renderMerged(Slot& slot, const ShaderPtr& shader, const IWinding& winding,
+		std::size_t windingGeneration, const IRenderEntity& entity);
+
+	/// Removes the face stored in the given slot from its buffer
+	void removeFace(Slot& slot);
+
+	/**
+	 * Deletes the VBOs of released buffers, uploads the changed geometry and
+	 * submits the buffers with faces to draw to the given collector. Must be
+	 * called with the GL context being current.
+	 */
+	void endFrame(RenderableCollector& collector);
+};
@@ -9,6 +9,7 @@
 #include "itextstream.h"
 
 #include <time.h>
+#include <chrono>
 #include <fmt/format.h>
 
 #include "util/ScopedBoolLock.h"
@@ -21,6 +22,7 @@
 #include "GlobalCamera.h"
 #include "render/RenderStatistics.h"
 #include "render/frontend/RenderableCollectionWalker.h"
+#include "brush/MergedFaceBuffers.h"
 #include "wxutil/MouseButton.h"
 #include "registry/adaptors.h"
 #include "selection/OccludeSelector.h"
@@ -144,6 +146,7 @@ CamWnd::CamWnd(wxWindow* parent) :
     _mainWxWidget(loadNamedPanel(parent, "CamWndPanel")),
     _id(++_maxId),
     _view(true),
+    _mergedBrushFaces(false),
     _camera(&_view, Callback(std::bind(&CamWnd::queueDraw, this))),
     _cameraView(_camera, &_view, Callback(std::bind(&CamWnd::update, this))),
     _drawing(false),
@@ -684,7 +687,45 @@ void CamWnd::Cam_Draw()
         CamRenderer renderer(allowedRenderFlags, _primitiveHighlightShader,
                              _faceHighlightShader, _view.getViewer());
 
-        render::RenderableCollectionWalker::CollectRenderablesInScene(renderer, _view);
+        auto collectionStart = std::chrono::steady_clock::now();
+
+        // Merged brush faces don't carry tangents, lighting mode draws them individually
+        CameraDrawMode renderMode = getCameraSettings()->getRenderMode();
+        bool mergedBrushFaces = getCameraSettings()->mergedBrushFaces() &&
+            (renderMode == RENDER_MODE_SOLID || renderMode == RENDER_MODE_TEXTURED);
+
+        if (mergedBrushFaces != _mergedBrushFaces)
+        {
+            _mergedBrushFaces = mergedBrushFaces;
+            _retainedRenderables.clear();
+        }
+
+        if (mergedBrushFaces)
+        {
+            MergedFaceBuffers::Instance().beginFrame();
+        }
+
+        if (getCameraSettings()->retainedRendering())
+        {
+            render::RenderableCollectionWalker::CollectRenderablesInScene(renderer, _view, &_retainedRenderables);
+
+            const auto& retainedStats = _retainedRenderables.getStatistics();
+            render::RenderStatistics::Instance().setRetainedNodes(
+                retainedStats.retainedNodes, retainedStats.recordedNodes);
+        }
+        else
+        {
+            _retainedRenderables.clear();
+
+            render::RenderableCollectionWalker::CollectRenderablesInScene(renderer, _view);
+        }
+
+        if (mergedBrushFaces)
+        {
+            MergedFaceBuffers::Instance().endFrame(renderer);
+        }
+
+        render::RenderStatistics::Instance().addCollectionTime(std::chrono::steady_clock::now() - collectionStart);
 
         // Render any active mousetools
         for (const ActiveMouseTools::value_type& i : _activeMouseTools)
@@ -693,6 +734,8 @@ void CamWnd::Cam_Draw()
         }
 
         renderer.render(_camera.modelview, _camera.projection);
+
+        render::RenderStatistics::Instance().stopCounting();
     }
 
     // greebo: Draw the clipper's points (skipping the depth-test)
@@ -806,20 +849,60 @@ void CamWnd::draw()
 
 void CamWnd::benchmark()
 {
-    double dStart = clock() / 1000.0;
+    const int numFrames = 100;
+
+    bool retainedRendering = getCameraSettings()->retainedRendering();
+    bool mergedBrushFaces = getCameraSettings()->mergedBrushFaces();
+    Vector3 previousAngles = getCameraAngles();
 
-    for (int i=0 ; i < 100 ; i++)
+    struct Mode
     {
-        Vector3 angles;
-        angles[CAMERA_ROLL] = 0;
-        angles[CAMERA_PITCH] = 0;
-        angles[CAMERA_YAW] = static_cast<double>(i * (360.0 / 100.0));
-        setCameraAngles(angles);
-    }
+        const char* name;
+        bool retained;
+        bool merged;
+    };
+
+    // Render the same frames submitting all renderables each frame, then
+    // keeping the renderables of unchanged objects between frames, then
+    // drawing the brush faces from the merged buffers in addition
+    for (const Mode& mode : {
+        Mode{ "Renderables submitted each frame: ", false, false },
+        Mode{ "Retained renderables: ", true, false },
+        Mode{ "Retained renderables, merged brush faces: ", true, true } })
+    {
+        registry::setValue(RKEY_RETAINED_RENDERING, mode.retained);
+        registry::setValue(RKEY_MERGED_BRUSH_FACES, mode.merged);
+        _retainedRenderables.clear();
 
-    double dEnd = clock() / 1000.0;
+        double collectionTime = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < numFrames; i++)
+        {
+            Vector3 angles;
+            angles[CAMERA_ROLL] = 0;
+            angles[CAMERA_PITCH] = 0;
+            angles[CAMERA_YAW] = static_cast<double>(i * (360.0 / numFrames));
+            setCameraAngles(angles);
 
-    rMessage() << fmt::format("{0:5.2lf}", (dEnd - dStart)) << " seconds\n";
+            // Paint right away
+            _wxGLWidget->Refresh(false);
+            _wxGLWidget->Update();
+
+            collectionTime += render::RenderStatistics::Instance().getCollectionTime();
+        }
+
+        double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        rMessage() << mode.name <<
+            fmt::format("{0:.2f} msec per frame, {1:.2f} msec of which collecting renderables",
+                frameTime / numFrames, collectionTime / numFrames) << std::endl;
+    }
+
+    registry::setValue(RKEY_RETAINED_RENDERING, retainedRendering);
+    registry::setValue(RKEY_MERGED_BRUSH_FACES, mergedBrushFaces);
+    setCameraAngles(previousAngles);
+    queueDraw();
 }
 
 void CamWnd::onSceneGraphChange()
@@ -15,6 +15,7 @@
 #include <wx/glcanvas.h>
 #include <wx/timer.h>
 #include "render/View.h"
+#include "render/frontend/RetainedRenderables.h"
 
 #include "RadiantCameraView.h"
 #include "Camera.h"
@@ -53,6 +54,13 @@ private:
 
     render::View _view;
 
+    // The renderables of unchanged objects, kept between frames
+    render::RetainedRenderables _retainedRenderables;
+
+    // Whether the last frame has drawn brush faces from the merged buffers,
+    // the retained renderables depend on it
+    bool _mergedBrushFaces;
+
     // The contained camera
     Camera _camera;
 
@@ -120,7 +128,8 @@ public:
 
     const Frustum& getViewFrustum() const;
 
-    // greebo: This measures the rendering time during a 360° turn of the camera.
+    // greebo: This measures the rendering time during a 360° turn of the camera,
+    // with and without keeping the renderables between frames.
     void benchmark();
 
     // This tries to find brushes above/below the current camera position and moves the view upwards/downwards
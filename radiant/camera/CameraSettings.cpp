@@ -20,7 +20,9 @@ CameraSettings::CameraSettings() :
 	_cubicScale(registry::getValue<int>(RKEY_CUBIC_SCALE)),
 	_farClipEnabled(registry::getValue<bool>(RKEY_ENABLE_FARCLIP)),
 	_solidSelectionBoxes(registry::getValue<bool>(RKEY_SOLID_SELECTION_BOXES)),
-	_toggleFreelook(registry::getValue<bool>(RKEY_TOGGLE_FREE_MOVE))
+	_toggleFreelook(registry::getValue<bool>(RKEY_TOGGLE_FREE_MOVE)),
+	_retainedRendering(registry::getValue<bool>(RKEY_RETAINED_RENDERING)),
+	_mergedBrushFaces(registry::getValue<bool>(RKEY_MERGED_BRUSH_FACES))
 {
 	// Constrain the cubic scale to a fixed value
 	if (_cubicScale > MAX_CUBIC_SCALE) {
@@ -39,6 +41,8 @@ CameraSettings::CameraSettings() :
 	observeKey(RKEY_DRAWMODE);
 	observeKey(RKEY_SOLID_SELECTION_BOXES);
 	observeKey(RKEY_TOGGLE_FREE_MOVE);
+	observeKey(RKEY_RETAINED_RENDERING);
+	observeKey(RKEY_MERGED_BRUSH_FACES);
 
 	// greebo: Add the preference settings
 	constructPreferencePage();
@@ -72,6 +76,12 @@ void CameraSettings::constructPreferencePage()
 
     // Whether to show the toolbar (to please the screenspace addicts)
     page.appendCheckBox(_("Show camera toolbar"), RKEY_SHOW_CAMERA_TOOLBAR);
+
+	// Unchanged objects don't need to submit their geometry each frame
+	page.appendCheckBox(_("Keep the geometry of unchanged objects between frames"), RKEY_RETAINED_RENDERING);
+
+	// Solid and textured mode can draw all faces of a material at once
+	page.appendCheckBox(_("Draw worldspawn brush faces in batches per material"), RKEY_MERGED_BRUSH_FACES);
 }
 
 bool CameraSettings::showCameraToolbar() const
@@ -129,6 +139,8 @@ void CameraSettings::keyChanged()
 		_invertMouseVerticalAxis = registry::getValue<bool>(RKEY_INVERT_MOUSE_VERTICAL_AXIS);
 		_farClipEnabled = registry::getValue<bool>(RKEY_ENABLE_FARCLIP);
 		_solidSelectionBoxes = registry::getValue<bool>(RKEY_SOLID_SELECTION_BOXES);
+		_retainedRendering = registry::getValue<bool>(RKEY_RETAINED_RENDERING);
+		_mergedBrushFaces = registry::getValue<bool>(RKEY_MERGED_BRUSH_FACES);
 
 		GlobalEventManager().setToggled("ToggleCubicClip", _farClipEnabled);
 
@@ -197,6 +209,16 @@ bool CameraSettings::toggleFreelook() const {
 	return _toggleFreelook;
 }
 
+bool CameraSettings::retainedRendering() const
+{
+	return _retainedRendering;
+}
+
+bool CameraSettings::mergedBrushFaces() const
+{
+	return _mergedBrushFaces;
+}
+
 bool CameraSettings::farClipEnabled() const
 {
 	return _farClipEnabled;
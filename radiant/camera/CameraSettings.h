@@ -29,6 +29,8 @@ namespace
 	const std::string RKEY_TOGGLE_FREE_MOVE = RKEY_CAMERA_ROOT + "/toggleFreeMove";
 	const std::string RKEY_CAMERA_WINDOW_STATE = RKEY_CAMERA_ROOT + "/window";
     const std::string RKEY_SHOW_CAMERA_TOOLBAR = RKEY_CAMERA_ROOT + "/showToolbar";
+	const std::string RKEY_RETAINED_RENDERING = RKEY_CAMERA_ROOT + "/retainedRendering";
+	const std::string RKEY_MERGED_BRUSH_FACES = RKEY_CAMERA_ROOT + "/mergedBrushFaces";
 }
 
 enum CameraDrawMode 
@@ -58,6 +60,12 @@ class CameraSettings: public sigc::trackable
 	// instead of enabling it by clicking and clicking again to disable
 	bool _toggleFreelook;
 
+	// Whether the renderables of unchanged objects are kept between frames
+	bool _retainedRendering;
+
+	// Whether worldspawn brush faces are drawn from merged per-material buffers
+	bool _mergedBrushFaces;
+
     // Signals
     sigc::signal<void> _sigRenderModeChanged;
 
@@ -77,6 +85,8 @@ public:
 	bool discreteMovement() const;
 	bool solidSelectionBoxes() const;
 	bool toggleFreelook() const;
+	bool retainedRendering() const;
+	bool mergedBrushFaces() const;
 
     /// Whether to show the camera toolbar
     bool showCameraToolbar() const;
@@ -55,6 +55,8 @@ void GlobalCameraManager::registerCommands()
 
 	GlobalCommandSystem().addCommand("TogglePreview", std::bind(&GlobalCameraManager::toggleLightingMode, this, std::placeholders::_1));
 
+	GlobalCommandSystem().addCommand("BenchmarkCamera", std::bind(&GlobalCameraManager::benchmark, this, std::placeholders::_1));
+
 	// Insert movement commands
 	GlobalCommandSystem().addCommand("CameraForward", std::bind(&GlobalCameraManager::moveForwardDiscrete, this, std::placeholders::_1));
 	GlobalCommandSystem().addCommand("CameraBack", std::bind(&GlobalCameraManager::moveBackDiscrete, this, std::placeholders::_1));
@@ -227,7 +229,7 @@ void GlobalCameraManager::decreaseCameraSpeed(const cmd::ArgumentList& args) {
 	registry::setValue(RKEY_MOVEMENT_SPEED, movementSpeed);
 }
 
-void GlobalCameraManager::benchmark() {
+void GlobalCameraManager::benchmark(const cmd::ArgumentList& args) {
 	CamWndPtr camWnd = getActiveCamWnd();
 
 	if (camWnd != NULL) {
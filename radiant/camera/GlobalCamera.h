@@ -88,8 +88,7 @@ public:
 	void decreaseCameraSpeed(const cmd::ArgumentList& args);
 
 	// greebo: This measures the rendering time for a full 360 degrees turn of the camera
-	// Note: unused at the moment
-	void benchmark();
+	void benchmark(const cmd::ArgumentList& args);
 
 	void update();
     void forceDraw();
@@ -0,0 +1,461 @@
+#include "DeclCache.h"
+
+#include "itextstream.h"
+#include "iarchive.h"
+#include "os/fs.h"
+#include "os/path.h"
+#include "string/predicate.h"
+#include "parser/DefTokeniser.h"
+#include "parser/DefBlockTokeniser.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace decl
+{
+
+namespace
+{
+	const char* const CACHE_FILENAME = "declcache.bin";
+
+	// Bump the version whenever the tokenisers or the file layout change
+	const char CACHE_MAGIC[4] = { 'D', 'R', 'D', 'C' };
+	const std::uint32_t CACHE_VERSION = 1;
+
+	// Plain binary I/O in host byte order, the cache is not meant to be portable
+	template<typename T>
+	void writeValue(std::ostream& stream, T value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void writeString(std::ostream& stream, const std::string& str)
+	{
+		writeValue<std::uint32_t>(stream, static_cast<std::uint32_t>(str.size()));
+		stream.write(str.data(), str.size());
+	}
+
+	template<typename T>
+	T readValue(std::istream& stream)
+	{
+		T value = T();
+		stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+		return value;
+	}
+
+	// Returns the number of bytes between the read position and the given
+	// length of the file, 0 if the stream failed
+	std::uint64_t getBytesLeft(std::istream& stream, std::uint64_t length)
+	{
+		if (!stream)
+		{
+			return 0;
+		}
+
+		std::uint64_t position = static_cast<std::uint64_t>(stream.tellg());
+		return position < length ? length - position : 0;
+	}
+
+	// Returns false if the string doesn't fit into the rest of the file,
+	// before allocating anything for it
+	bool readString(std::istream& stream, std::uint64_t length, std::string& str)
+	{
+		std::uint32_t size = readValue<std::uint32_t>(stream);
+
+		if (!stream || size > getBytesLeft(stream, length))
+		{
+			return false;
+		}
+
+		str.resize(size);
+		stream.read(&str[0], size);
+
+		return static_cast<bool>(stream);
+	}
+
+	// The smallest possible size of an entry and of its items, used to reject
+	// counts the rest of the file cannot hold
+	const std::uint64_t MIN_ENTRY_SIZE = 3 * sizeof(std::uint32_t) + sizeof(std::uint8_t) +
+		3 * sizeof(std::uint64_t);
+	const std::uint64_t MIN_TOKEN_SIZE = sizeof(std::uint32_t);
+	const std::uint64_t MIN_BLOCK_SIZE = 2 * sizeof(std::uint32_t);
+}
+
+DeclCache::DeclCache() :
+	_vfs(nullptr),
+	_dirty(false)
+{}
+
+DeclCache::DeclCache(vfs::VirtualFileSystem& vfs, const std::string& cacheFile) :
+	_vfs(&vfs),
+	_cacheFile(cacheFile),
+	_dirty(false)
+{}
+
+DeclFilePtr DeclCache::getFile(const std::string& path, DeclFileContents contents)
+{
+	vfs::FileStamp stamp;
+
+	if (!_vfs->getFileStamp(path, stamp))
+	{
+		return DeclFilePtr();
+	}
+
+	Key key(path, contents);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto found = _entries.find(key);
+
+		if (found != _entries.end() && found->second.stamp == stamp)
+		{
+			found->second.used = true;
+			++_statistics.hits;
+
+			return found->second.file;
+		}
+	}
+
+	// Tokenise the file without blocking other threads
+	DeclFilePtr file = parseFile(path, stamp, contents);
+
+	if (!file)
+	{
+		return file;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Entry& entry = _entries[key];
+	entry.stamp = stamp;
+	entry.file = file;
+	entry.used = true;
+
+	++_statistics.misses;
+	_dirty = true;
+
+	return file;
+}
+
+void DeclCache::invalidate()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_entries.clear();
+	_statistics = Statistics();
+	_dirty = false;
+
+	if (!_cacheFile.empty() && fs::exists(_cacheFile))
+	{
+		fs::remove(_cacheFile);
+	}
+}
+
+IDeclCache::Statistics DeclCache::getStatistics()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _statistics;
+}
+
+bool DeclCache::load()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_entries.clear();
+	_dirty = false;
+
+	std::ifstream stream(_cacheFile, std::ios::binary | std::ios::ate);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::uint64_t length = static_cast<std::uint64_t>(stream.tellg());
+	stream.seekg(0);
+
+	char magic[sizeof(CACHE_MAGIC)];
+	stream.read(magic, sizeof(magic));
+
+	if (!stream || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 ||
+		readValue<std::uint32_t>(stream) != CACHE_VERSION)
+	{
+		rMessage() << "[decl] Ignoring outdated cache file " << _cacheFile << std::endl;
+		return false;
+	}
+
+	// A truncated or damaged file must not make us allocate anything based on
+	// the lengths and counts read from it
+	bool valid = true;
+
+	std::uint64_t numEntries = readValue<std::uint64_t>(stream);
+
+	if (numEntries > getBytesLeft(stream, length) / MIN_ENTRY_SIZE)
+	{
+		valid = false;
+	}
+
+	for (std::uint64_t i = 0; i < numEntries && valid; ++i)
+	{
+		std::string path;
+		valid = readString(stream, length, path);
+
+		auto contents = static_cast<DeclFileContents>(readValue<std::uint8_t>(stream));
+
+		Entry entry;
+		valid = valid && readString(stream, length, entry.stamp.archive);
+		entry.stamp.size = readValue<std::uint64_t>(stream);
+		entry.stamp.modificationTime = readValue<std::int64_t>(stream);
+
+		auto file = std::make_shared<DeclFile>();
+		valid = valid && readString(stream, length, file->modRoot);
+
+		std::uint64_t numItems = readValue<std::uint64_t>(stream);
+		std::uint64_t minItemSize = contents == DeclFileContents::Blocks ? MIN_BLOCK_SIZE : MIN_TOKEN_SIZE;
+
+		valid = valid && stream && numItems <= getBytesLeft(stream, length) / minItemSize;
+
+		for (std::uint64_t j = 0; j < numItems && valid; ++j)
+		{
+			if (contents == DeclFileContents::Blocks)
+			{
+				DeclBlock block;
+				valid = readString(stream, length, block.name) &&
+					readString(stream, length, block.contents);
+				file->blocks.emplace_back(std::move(block));
+			}
+			else
+			{
+				std::string token;
+				valid = readString(stream, length, token);
+				file->tokens.emplace_back(std::move(token));
+			}
+		}
+
+		entry.file = file;
+		_entries[Key(path, contents)] = entry;
+	}
+
+	if (!valid || !stream)
+	{
+		rWarning() << "[decl] Cache file " << _cacheFile << " is corrupt, ignoring it." << std::endl;
+		_entries.clear();
+		return false;
+	}
+
+	rMessage() << "[decl] Loaded " << _entries.size() << " cached files." << std::endl;
+
+	return true;
+}
+
+void DeclCache::save()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (!_dirty)
+	{
+		return;
+	}
+
+	// Write to a temporary file first, to not leave a broken cache behind
+	std::string tempFile = _cacheFile + ".tmp";
+
+	{
+		std::ofstream stream(tempFile, std::ios::binary | std::ios::trunc);
+
+		if (!stream)
+		{
+			rWarning() << "[decl] Cannot write cache file " << tempFile << std::endl;
+			return;
+		}
+
+		std::vector<Entries::const_iterator> entries;
+
+		for (auto i = _entries.begin(); i != _entries.end(); ++i)
+		{
+			// Keep the files of mods and games not loaded this time
+			if (i->second.used || physicalFileUnchanged(i->first.first, i->second.stamp))
+			{
+				entries.push_back(i);
+			}
+		}
+
+		stream.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		writeValue<std::uint32_t>(stream, CACHE_VERSION);
+		writeValue<std::uint64_t>(stream, entries.size());
+
+		for (const auto& i : entries)
+		{
+			const DeclFile& file = *i->second.file;
+
+			writeString(stream, i->first.first);
+			writeValue<std::uint8_t>(stream, static_cast<std::uint8_t>(i->first.second));
+
+			writeString(stream, i->second.stamp.archive);
+			writeValue<std::uint64_t>(stream, i->second.stamp.size);
+			writeValue<std::int64_t>(stream, i->second.stamp.modificationTime);
+
+			writeString(stream, file.modRoot);
+
+			if (i->first.second == DeclFileContents::Blocks)
+			{
+				writeValue<std::uint64_t>(stream, file.blocks.size());
+
+				for (const DeclBlock& block : file.blocks)
+				{
+					writeString(stream, block.name);
+					writeString(stream, block.contents);
+				}
+			}
+			else
+			{
+				writeValue<std::uint64_t>(stream, file.tokens.size());
+
+				for (const std::string& token : file.tokens)
+				{
+					writeString(stream, token);
+				}
+			}
+		}
+
+		if (!stream)
+		{
+			rWarning() << "[decl] Failed to write cache file " << tempFile << std::endl;
+			return;
+		}
+	}
+
+	try
+	{
+		fs::rename(tempFile, _cacheFile);
+		_dirty = false;
+	}
+	catch (const fs::filesystem_error& ex)
+	{
+		rWarning() << "[decl] Cannot replace cache file " << _cacheFile << ": " << ex.what() << std::endl;
+	}
+}
+
+DeclFilePtr DeclCache::parseFile(const std::string& path, const vfs::FileStamp& stamp,
+	DeclFileContents contents)
+{
+	ArchiveTextFilePtr file = _vfs->openTextFile(path);
+
+	if (!file)
+	{
+		return DeclFilePtr();
+	}
+
+	auto result = std::make_shared<DeclFile>();
+
+	// PK4 contents belong to the mod folder containing the PK4
+	result->modRoot = string::ends_with(stamp.archive, "/") ? stamp.archive :
+		os::standardPathWithSlash(fs::path(stamp.archive).remove_filename().string());
+
+	std::istream stream(&(file->getInputStream()));
+
+	if (contents == DeclFileContents::Blocks)
+	{
+		parser::BasicDefBlockTokeniser<std::istream> tokeniser(stream);
+
+		while (tokeniser.hasMoreBlocks())
+		{
+			parser::BlockTokeniser::Block block = tokeniser.nextBlock();
+			result->blocks.emplace_back(DeclBlock{ std::move(block.name), std::move(block.contents) });
+		}
+	}
+	else
+	{
+		parser::BasicDefTokeniser<std::istream> tokeniser(stream);
+
+		while (tokeniser.hasMoreTokens())
+		{
+			result->tokens.emplace_back(tokeniser.nextToken());
+		}
+	}
+
+	return result;
+}
+
+bool DeclCache::physicalFileUnchanged(const std::string& path, const vfs::FileStamp& stamp)
+{
+	// Directory archives end with a slash, anything else is a PK4
+	fs::path physicalPath = string::ends_with(stamp.archive, "/") ?
+		fs::path(stamp.archive + path) : fs::path(stamp.archive);
+
+	try
+	{
+		return fs::exists(physicalPath) &&
+			static_cast<std::uint64_t>(fs::file_size(physicalPath)) == stamp.size &&
+			os::getLastWriteTime(physicalPath) == stamp.modificationTime;
+	}
+	catch (const fs::filesystem_error&)
+	{
+		return false;
+	}
+}
+
+void DeclCache::invalidateCmd(const cmd::ArgumentList& args)
+{
+	invalidate();
+	rMessage() << "[decl] Cache invalidated, all files will be parsed again on the next load." << std::endl;
+}
+
+void DeclCache::printStatisticsCmd(const cmd::ArgumentList& args)
+{
+	Statistics statistics = getStatistics();
+	std::size_t total = statistics.hits + statistics.misses;
+
+	rMessage() << "[decl] Cache hits: " << statistics.hits << ", misses: " << statistics.misses;
+
+	if (total > 0)
+	{
+		rMessage() << ", hit rate: " << (100 * statistics.hits / total) << "%";
+	}
+
+	rMessage() << std::endl;
+}
+
+// RegisterableModule implementation
+const std::string& DeclCache::getName() const
+{
+	static std::string _name(MODULE_DECLCACHE);
+	return _name;
+}
+
+const StringSet& DeclCache::getDependencies() const
+{
+	static StringSet _dependencies;
+
+	if (_dependencies.empty())
+	{
+		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
+		_dependencies.insert(MODULE_COMMANDSYSTEM);
+	}
+
+	return _dependencies;
+}
+
+void DeclCache::initialiseModule(const ApplicationContext& ctx)
+{
+	rMessage() << getName() << "::initialiseModule called." << std::endl;
+
+	_vfs = &GlobalFileSystem();
+	_cacheFile = ctx.getSettingsPath() + CACHE_FILENAME;
+
+	load();
+
+	GlobalCommandSystem().addCommand("InvalidateDeclCache",
+		std::bind(&DeclCache::invalidateCmd, this, std::placeholders::_1));
+	GlobalCommandSystem().addCommand("PrintDeclCacheStatistics",
+		std::bind(&DeclCache::printStatisticsCmd, this, std::placeholders::_1));
+}
+
+void DeclCache::shutdownModule()
+{
+	printStatisticsCmd(cmd::ArgumentList());
+	save();
+}
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ideclcache.h"
+#include "ifilesystem.h"
+#include "icommandsystem.h"
+
+#include <map>
+#include <mutex>
+
+namespace decl
+{
+
+/**
+ * IDeclCache implementation, storing the cached files in a binary file in
+ * the user settings folder.
+ */
+class DeclCache :
+	public IDeclCache
+{
+private:
+	struct Entry
+	{
+		vfs::FileStamp stamp;
+		DeclFilePtr file;
+
+		// Whether the entry has been requested in this session
+		bool used = false;
+	};
+
+	// Entries are keyed by VFS path and the requested form
+	typedef std::pair<std::string, DeclFileContents> Key;
+	typedef std::map<Key, Entry> Entries;
+
+	vfs::VirtualFileSystem* _vfs;
+	std::string _cacheFile;
+
+	std::mutex _mutex;
+	Entries _entries;
+	Statistics _statistics;
+
+	// Whether the entries changed since loading
+	bool _dirty;
+
+public:
+	// Constructs an empty cache, the module is set up in initialiseModule()
+	DeclCache();
+
+	// Constructs an empty cache using the given VFS and cache file
+	DeclCache(vfs::VirtualFileSystem& vfs, const std::string& cacheFile);
+
+	DeclFilePtr getFile(const std::string& path, DeclFileContents contents) override;
+	void invalidate() override;
+	Statistics getStatistics() override;
+
+	// Replaces the entries with the ones stored in the cache file. Returns
+	// false if there is no (valid) cache file, leaving the cache empty.
+	bool load();
+
+	// Writes the entries to the cache file, if anything changed. Unused entries
+	// are only kept if their physical file didn't change in the meantime.
+	void save();
+
+	// RegisterableModule implementation
+	const std::string& getName() const override;
+	const StringSet& getDependencies() const override;
+	void initialiseModule(const ApplicationContext& ctx) override;
+	void shutdownModule() override;
+
+private:
+	DeclFilePtr parseFile(const std::string& path, const vfs::FileStamp& stamp, DeclFileContents contents);
+
+	// Checks the stamp of a cached file without going through the VFS
+	static bool physicalFileUnchanged(const std::string& path, const vfs::FileStamp& stamp);
+
+	void invalidateCmd(const cmd::ArgumentList& args);
+	void printStatisticsCmd(const cmd::ArgumentList& args);
+};
+
+}
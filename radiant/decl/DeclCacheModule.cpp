@@ -0,0 +1,10 @@
+#include "DeclCache.h"
+#include "modulesystem/StaticModule.h"
+
+namespace decl
+{
+
+// Static module instance
+module::StaticModule<DeclCache> declCacheModule;
+
+}
@@ -0,0 +1,158 @@
+#include "DeclFileIndex.h"
+
+#include "iarchive.h"
+#include "idatastream.h"
+
+namespace decl
+{
+
+DeclFileIndex::DeclFileIndex() :
+	_depth(0)
+{}
+
+void DeclFileIndex::reset(vfs::VirtualFileSystem& vfs, const std::string& folder,
+	const std::string& extension, std::size_t depth)
+{
+	_folder = folder;
+	_extension = extension;
+	_depth = depth;
+	_files.clear();
+
+	for (const std::string& path : findFiles(vfs))
+	{
+		FileState& state = _files[path];
+
+		if (!vfs.getFileStamp(path, state.stamp))
+		{
+			_files.erase(path);
+		}
+	}
+}
+
+std::set<std::string> DeclFileIndex::findChangedFiles(vfs::VirtualFileSystem& vfs)
+{
+	std::set<std::string> changedFiles;
+	std::set<std::string> currentFiles = findFiles(vfs);
+
+	// Removed files
+	for (auto i = _files.begin(); i != _files.end();)
+	{
+		if (currentFiles.count(i->first) == 0)
+		{
+			changedFiles.insert(i->first);
+			_files.erase(i++);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	for (const std::string& path : currentFiles)
+	{
+		vfs::FileStamp stamp;
+
+		if (!vfs.getFileStamp(path, stamp))
+		{
+			continue;
+		}
+
+		auto existing = _files.find(path);
+
+		if (existing == _files.end())
+		{
+			// Added file
+			_files[path].stamp = stamp;
+			changedFiles.insert(path);
+			continue;
+		}
+
+		FileState& state = existing->second;
+
+		if (state.stamp == stamp)
+		{
+			continue;
+		}
+
+		state.stamp = stamp;
+
+		// The stamp changed, but the contents might still be the same
+		std::uint64_t hash = 0;
+		bool hashed = hashContents(vfs, path, hash);
+
+		if (!hashed || !state.hasContentHash || state.contentHash != hash)
+		{
+			changedFiles.insert(path);
+		}
+
+		state.hasContentHash = hashed;
+		state.contentHash = hash;
+	}
+
+	return changedFiles;
+}
+
+void DeclFileIndex::update(vfs::VirtualFileSystem& vfs, const std::set<std::string>& paths)
+{
+	for (const std::string& path : paths)
+	{
+		FileState state;
+
+		if (!vfs.getFileStamp(path, state.stamp))
+		{
+			_files.erase(path);
+			continue;
+		}
+
+		state.hasContentHash = hashContents(vfs, path, state.contentHash);
+		_files[path] = state;
+	}
+}
+
+void DeclFileIndex::clear()
+{
+	_files.clear();
+}
+
+std::set<std::string> DeclFileIndex::findFiles(vfs::VirtualFileSystem& vfs)
+{
+	std::set<std::string> files;
+
+	vfs.forEachFile(_folder, _extension, [&](const vfs::FileInfo& fileInfo)
+	{
+		files.insert(fileInfo.fullPath());
+	}, _depth);
+
+	return files;
+}
+
+bool DeclFileIndex::hashContents(vfs::VirtualFileSystem& vfs, const std::string& path, std::uint64_t& hash)
+{
+	ArchiveFilePtr file = vfs.openFile(path);
+
+	if (!file)
+	{
+		return false;
+	}
+
+	InputStream& stream = file->getInputStream();
+
+	// FNV-1a over the raw file contents
+	hash = 14695981039346656037ull;
+
+	InputStream::byte_type buffer[16384];
+
+	for (std::size_t length = stream.read(buffer, sizeof(buffer)); length > 0;
+		 length = stream.read(buffer, sizeof(buffer)))
+	{
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			hash ^= buffer[i];
+			hash *= 1099511628211ull;
+		}
+	}
+
+	return true;
+}
+
+}
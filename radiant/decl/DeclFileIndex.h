@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ifilesystem.h"
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+namespace decl
+{
+
+/**
+ * Remembers the state of the decl files found in a VFS folder, to tell
+ * which of them have been added, removed or modified between two scans.
+ *
+ * Files are compared by their FileStamp first. The contents of files with
+ * a different stamp are hashed, such that files which have been touched
+ * without actually changing (or are located in a PK4 which has been
+ * replaced) are not reported once their hash is known.
+ */
+class DeclFileIndex
+{
+private:
+	struct FileState
+	{
+		vfs::FileStamp stamp;
+
+		// The hash is computed the first time the stamp of a file changes
+		bool hasContentHash = false;
+		std::uint64_t contentHash = 0;
+	};
+
+	// The scanned folder, as passed to VirtualFileSystem::forEachFile()
+	std::string _folder;
+	std::string _extension;
+	std::size_t _depth;
+
+	// File states by VFS path
+	std::map<std::string, FileState> _files;
+
+public:
+	DeclFileIndex();
+
+	// Records the stamps of all files with the given extension in the folder,
+	// forgetting about the previous state. Doesn't read any file contents.
+	void reset(vfs::VirtualFileSystem& vfs, const std::string& folder,
+		const std::string& extension, std::size_t depth = 0);
+
+	// Scans the folder again and returns the VFS paths of the files which have
+	// been added, removed or modified since the last scan. The index is
+	// updated to the current state.
+	std::set<std::string> findChangedFiles(vfs::VirtualFileSystem& vfs);
+
+	// Records the current state of the given files (VFS paths), after they
+	// have been reloaded by other means
+	void update(vfs::VirtualFileSystem& vfs, const std::set<std::string>& paths);
+
+	void clear();
+
+private:
+	std::set<std::string> findFiles(vfs::VirtualFileSystem& vfs);
+
+	// Hashes the contents of the given file, returns false if it can't be read
+	static bool hashContents(vfs::VirtualFileSystem& vfs, const std::string& path, std::uint64_t& hash);
+};
+
+}
@@ -0,0 +1,372 @@
+#include "DeclLoadScheduler.h"
+
+#include "itextstream.h"
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace decl
+{
+
+namespace
+{
+	inline double toSeconds(DeclLoadScheduler::Clock::duration duration)
+	{
+		return std::chrono::duration<double>(duration).count();
+	}
+}
+
+class DeclLoadScheduler::LoadJob :
+	public ILoadScheduler::Job,
+	public std::enable_shared_from_this<LoadJob>
+{
+public:
+	DeclLoadScheduler& scheduler;
+
+	std::string name;
+	Task task;
+	std::vector<std::string> dependencies;
+	LoadPriority priority;
+
+	// Protected by the scheduler mutex
+	JobState state;
+
+	// Mirrors state == Finished, to be checked without locking
+	std::atomic<bool> finished;
+
+	Clock::time_point queueTime;
+
+	LoadJob(DeclLoadScheduler& owner, const std::string& name_, const Task& task_,
+		const std::vector<std::string>& dependencies_, LoadPriority priority_) :
+		scheduler(owner),
+		name(name_),
+		task(task_),
+		dependencies(dependencies_),
+		priority(priority_),
+		state(JobState::Queued),
+		finished(false),
+		queueTime(Clock::now())
+	{}
+
+	const std::string& getName() const override
+	{
+		return name;
+	}
+
+	bool isFinished() const override
+	{
+		return finished;
+	}
+
+	void wait() override
+	{
+		if (finished)
+		{
+			return; // no need to touch the scheduler
+		}
+
+		std::unique_lock<std::mutex> lock(scheduler._mutex);
+		scheduler.waitForJob(shared_from_this(), lock);
+	}
+};
+
+DeclLoadScheduler::DeclLoadScheduler(std::size_t numWorkers) :
+	_numWorkers(numWorkers > 0 ? numWorkers : util::ThreadPool::getDefaultNumThreads()),
+	_stopping(false),
+	_startTime(Clock::now())
+{}
+
+DeclLoadScheduler::~DeclLoadScheduler()
+{
+	stop();
+}
+
+ILoadScheduler::JobPtr DeclLoadScheduler::schedule(const std::string& name, const Task& task,
+	const std::vector<std::string>& dependencies, LoadPriority priority)
+{
+	auto job = std::make_shared<LoadJob>(*this, name, task, dependencies, priority);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		ensureWorkersStarted();
+
+		_queue.push_back(job);
+		_jobsByName[name] = job;
+	}
+
+	_stateChanged.notify_all();
+
+	return job;
+}
+
+void DeclLoadScheduler::runSubTasks(const std::vector<Task>& tasks)
+{
+	if (tasks.empty())
+	{
+		return;
+	}
+
+	auto batch = std::make_shared<SubTaskBatch>();
+	batch->tasks = &tasks;
+	batch->nextTask = 0;
+	batch->remaining = tasks.size();
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	ensureWorkersStarted();
+
+	_batches.push_back(batch);
+	_stateChanged.notify_all();
+
+	// Lend a hand, then wait for the sub-tasks picked up by the workers
+	while (runNextSubTask(batch, lock)) {}
+
+	_stateChanged.wait(lock, [&]() { return batch->remaining == 0; });
+
+	if (batch->exception)
+	{
+		std::rethrow_exception(batch->exception);
+	}
+}
+
+std::size_t DeclLoadScheduler::getNumWorkers() const
+{
+	return _numWorkers;
+}
+
+void DeclLoadScheduler::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_stateChanged.notify_all();
+
+	for (std::thread& worker : _workers)
+	{
+		worker.join();
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_workers.clear();
+	_stopping = false;
+}
+
+void DeclLoadScheduler::ensureWorkersStarted()
+{
+	while (_workers.size() < _numWorkers)
+	{
+		_workers.emplace_back(&DeclLoadScheduler::processTasks, this);
+	}
+}
+
+bool DeclLoadScheduler::dependenciesFinished(const LoadJob& job) const
+{
+	for (const std::string& dependency : job.dependencies)
+	{
+		auto found = _jobsByName.find(dependency);
+
+		// Dependencies which have not been scheduled are not waited for
+		if (found != _jobsByName.end() && found->second->state != JobState::Finished)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+DeclLoadScheduler::LoadJobPtr DeclLoadScheduler::takeNextReadyJob()
+{
+	auto best = _queue.end();
+
+	for (auto i = _queue.begin(); i != _queue.end(); ++i)
+	{
+		if ((best == _queue.end() || (*i)->priority > (*best)->priority) && dependenciesFinished(**i))
+		{
+			best = i;
+		}
+	}
+
+	if (best == _queue.end())
+	{
+		return LoadJobPtr();
+	}
+
+	LoadJobPtr job = *best;
+	_queue.erase(best);
+
+	return job;
+}
+
+void DeclLoadScheduler::runJob(const LoadJobPtr& job, std::unique_lock<std::mutex>& lock)
+{
+	auto queued = std::find(_queue.begin(), _queue.end(), job);
+
+	if (queued != _queue.end())
+	{
+		_queue.erase(queued);
+	}
+
+	job->state = JobState::Running;
+
+	// Dependencies still pending are handled right here, this happens
+	// when a job is run by a thread waiting for it
+	for (const std::string& dependency : job->dependencies)
+	{
+		auto found = _jobsByName.find(dependency);
+
+		if (found != _jobsByName.end() && found->second != job)
+		{
+			LoadJobPtr dependencyJob = found->second;
+			waitForJob(dependencyJob, lock);
+		}
+	}
+
+	lock.unlock();
+
+	Clock::time_point startTime = Clock::now();
+
+	try
+	{
+		job->task();
+	}
+	catch (const std::exception& ex)
+	{
+		rError() << "[decl] " << job->name << " failed: " << ex.what() << std::endl;
+	}
+	catch (...)
+	{
+		rError() << "[decl] " << job->name << " failed." << std::endl;
+	}
+
+	Clock::time_point finishTime = Clock::now();
+
+	rMessage() << "[decl] " << job->name << " finished: queued at "
+		<< toSeconds(job->queueTime - _startTime) << "s, started at "
+		<< toSeconds(startTime - _startTime) << "s, took "
+		<< toSeconds(finishTime - startTime) << "s" << std::endl;
+
+	lock.lock();
+
+	job->state = JobState::Finished;
+	job->finished = true;
+
+	_stateChanged.notify_all();
+}
+
+void DeclLoadScheduler::waitForJob(const LoadJobPtr& job, std::unique_lock<std::mutex>& lock)
+{
+	if (job->state == JobState::Queued)
+	{
+		// No worker got to it yet, don't wait for one
+		runJob(job, lock);
+		return;
+	}
+
+	_stateChanged.wait(lock, [&]() { return job->state == JobState::Finished; });
+}
+
+bool DeclLoadScheduler::runNextSubTask(const SubTaskBatchPtr& batch, std::unique_lock<std::mutex>& lock)
+{
+	if (batch->nextTask >= batch->tasks->size())
+	{
+		return false;
+	}
+
+	std::size_t index = batch->nextTask++;
+
+	if (batch->nextTask == batch->tasks->size())
+	{
+		// All claimed, remove the batch from the list
+		_batches.erase(std::find(_batches.begin(), _batches.end(), batch));
+	}
+
+	lock.unlock();
+
+	std::exception_ptr exception;
+
+	try
+	{
+		(*batch->tasks)[index]();
+	}
+	catch (...)
+	{
+		exception = std::current_exception();
+	}
+
+	lock.lock();
+
+	if (exception && !batch->exception)
+	{
+		batch->exception = exception;
+	}
+
+	if (--batch->remaining == 0)
+	{
+		_stateChanged.notify_all();
+	}
+
+	return true;
+}
+
+void DeclLoadScheduler::processTasks()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		// Sub-tasks come first, they're part of jobs already running
+		if (!_batches.empty())
+		{
+			SubTaskBatchPtr batch = _batches.front();
+			runNextSubTask(batch, lock);
+			continue;
+		}
+
+		LoadJobPtr job = takeNextReadyJob();
+
+		if (job)
+		{
+			runJob(job, lock);
+			continue;
+		}
+
+		if (_stopping && _queue.empty())
+		{
+			return;
+		}
+
+		_stateChanged.wait(lock);
+	}
+}
+
+// RegisterableModule implementation
+const std::string& DeclLoadScheduler::getName() const
+{
+	static std::string _name(MODULE_DECLLOADSCHEDULER);
+	return _name;
+}
+
+const StringSet& DeclLoadScheduler::getDependencies() const
+{
+	static StringSet _dependencies;
+	return _dependencies;
+}
+
+void DeclLoadScheduler::initialiseModule(const ApplicationContext& ctx)
+{
+	rMessage() << getName() << "::initialiseModule called, using "
+		<< _numWorkers << " worker threads." << std::endl;
+}
+
+void DeclLoadScheduler::shutdownModule()
+{
+	stop();
+}
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "ideclloadscheduler.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace decl
+{
+
+/**
+ * ILoadScheduler implementation, running the jobs and their sub-tasks on
+ * a fixed number of worker threads which are spawned on demand.
+ */
+class DeclLoadScheduler :
+	public ILoadScheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+private:
+	enum class JobState
+	{
+		Queued,
+		Running,
+		Finished,
+	};
+
+	class LoadJob;
+	typedef std::shared_ptr<LoadJob> LoadJobPtr;
+
+	// A set of sub-tasks passed to runSubTasks()
+	struct SubTaskBatch
+	{
+		const std::vector<Task>* tasks;
+
+		// Index of the next task to be claimed and number of unfinished tasks
+		std::size_t nextTask;
+		std::size_t remaining;
+
+		std::exception_ptr exception;
+	};
+	typedef std::shared_ptr<SubTaskBatch> SubTaskBatchPtr;
+
+	std::size_t _numWorkers;
+	std::vector<std::thread> _workers;
+
+	// Protects all of the members below and the job states
+	mutable std::mutex _mutex;
+
+	// Signalled whenever a job or sub-task is queued or finished
+	std::condition_variable _stateChanged;
+
+	// Jobs waiting to be started, in scheduling order
+	std::deque<LoadJobPtr> _queue;
+
+	// The most recently scheduled job of each name
+	std::map<std::string, LoadJobPtr> _jobsByName;
+
+	// Batches having unclaimed sub-tasks
+	std::deque<SubTaskBatchPtr> _batches;
+
+	bool _stopping;
+
+	Clock::time_point _startTime;
+
+public:
+	// Pass 0 to use one worker per hardware core
+	DeclLoadScheduler(std::size_t numWorkers = 0);
+	~DeclLoadScheduler();
+
+	JobPtr schedule(const std::string& name, const Task& task,
+		const std::vector<std::string>& dependencies, LoadPriority priority) override;
+
+	void runSubTasks(const std::vector<Task>& tasks) override;
+
+	std::size_t getNumWorkers() const override;
+
+	// Runs all queued jobs and joins the workers. The scheduler can
+	// be used again afterwards. Must not be called from within a job.
+	void stop();
+
+	// RegisterableModule implementation
+	const std::string& getName() const override;
+	const StringSet& getDependencies() const override;
+	void initialiseModule(const ApplicationContext& ctx) override;
+	void shutdownModule() override;
+
+private:
+	// All of these require _mutex to be held
+
+	void ensureWorkersStarted();
+
+	// Returns true if none of the job's dependencies is queued or running
+	bool dependenciesFinished(const LoadJob& job) const;
+
+	// Takes the ready job with the highest priority off the queue
+	LoadJobPtr takeNextReadyJob();
+
+	// Runs the given job on the calling thread, after its dependencies.
+	// The job must be queued, the lock is released while running it.
+	void runJob(const LoadJobPtr& job, std::unique_lock<std::mutex>& lock);
+
+	// Blocks until the given job is finished, running it if it's still queued
+	void waitForJob(const LoadJobPtr& job, std::unique_lock<std::mutex>& lock);
+
+	// Claims and runs the next sub-task of the given batch, releasing the
+	// lock while running it. Returns false if all sub-tasks were claimed.
+	bool runNextSubTask(const SubTaskBatchPtr& batch, std::unique_lock<std::mutex>& lock);
+
+	void processTasks();
+};
+
+}
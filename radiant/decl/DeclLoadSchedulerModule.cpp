@@ -0,0 +1,10 @@
+#include "DeclLoadScheduler.h"
+#include "modulesystem/StaticModule.h"
+
+namespace decl
+{
+
+// Static module instance
+module::StaticModule<DeclLoadScheduler> declLoadSchedulerModule;
+
+}
@@ -0,0 +1,162 @@
+#include "DeclName.h"
+
+#include <mutex>
+
+namespace decl
+{
+
+namespace
+{
+	inline char foldCase(char c)
+	{
+		return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+	}
+}
+
+DeclName::DeclName(std::string_view name) :
+	_entry(DeclNameTable::Instance().intern(name))
+{}
+
+DeclName DeclName::Find(std::string_view name)
+{
+	return DeclName(DeclNameTable::Instance().find(name));
+}
+
+const std::string& DeclName::str() const
+{
+	static const std::string _emptyName;
+	return _entry != nullptr ? _entry->folded : _emptyName;
+}
+
+std::size_t DeclNameTable::FoldedHash::operator()(std::string_view name) const
+{
+	// FNV-1a over the lowercase characters
+	std::uint64_t hash = 14695981039346656037ull;
+
+	for (char c : name)
+	{
+		hash ^= static_cast<unsigned char>(foldCase(c));
+		hash *= 1099511628211ull;
+	}
+
+	return static_cast<std::size_t>(hash);
+}
+
+bool DeclNameTable::FoldedEqual::operator()(std::string_view a, std::string_view b) const
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+
+	for (std::size_t i = 0; i < a.size(); ++i)
+	{
+		if (foldCase(a[i]) != foldCase(b[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const DeclName::Entry* DeclNameTable::intern(std::string_view name)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(_mutex);
+
+		auto found = _index.find(name);
+
+		if (found != _index.end())
+		{
+			return found->second;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+
+	return &insert(name);
+}
+
+std::shared_ptr<std::string> DeclNameTable::internString(std::string_view str)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(_stringMutex);
+
+		auto found = _strings.find(str);
+
+		if (found != _strings.end())
+		{
+			return found->second;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(_stringMutex);
+
+	// Another thread might have been faster
+	auto found = _strings.find(str);
+
+	if (found != _strings.end())
+	{
+		return found->second;
+	}
+
+	auto interned = std::make_shared<std::string>(str);
+
+	// The key refers to the shared string, which stays in place
+	_strings.emplace(std::string_view(*interned), interned);
+
+	return interned;
+}
+
+DeclName::Entry& DeclNameTable::insert(std::string_view name)
+{
+	// Another thread might have been faster
+	auto found = _index.find(name);
+
+	if (found != _index.end())
+	{
+		return *found->second;
+	}
+
+	_entries.emplace_back();
+
+	DeclName::Entry& entry = _entries.back();
+	entry.folded.reserve(name.size());
+
+	for (char c : name)
+	{
+		entry.folded += foldCase(c);
+	}
+
+	entry.hash = FoldedHash()(name);
+	entry.id = static_cast<std::uint32_t>(_entries.size());
+
+	// The key refers to the entry's own string, which stays in place
+	_index.emplace(std::string_view(entry.folded), &entry);
+
+	return entry;
+}
+
+const DeclName::Entry* DeclNameTable::find(std::string_view name) const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+
+	auto found = _index.find(name);
+
+	return found != _index.end() ? found->second : nullptr;
+}
+
+std::size_t DeclNameTable::size() const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return _entries.size();
+}
+
+DeclNameTable& DeclNameTable::Instance()
+{
+	static DeclNameTable _instance;
+	return _instance;
+}
+
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace decl
+{
+
+/**
+ * Handle of a declaration name interned in the DeclNameTable. The names are
+ * case-insensitive, all spellings of a name share the same handle.
+ *
+ * Handles are as cheap to copy, compare and hash as a pointer, which makes
+ * them suitable as keys of the decl maps. They stay valid for the lifetime
+ * of the application.
+ */
+class DeclName
+{
+public:
+	struct Entry
+	{
+		// The lowercase form of the name
+		std::string folded;
+
+		std::size_t hash;
+
+		// Sequential number, in order of interning
+		std::uint32_t id;
+	};
+
+private:
+	const Entry* _entry;
+
+public:
+	// Constructs an empty handle, not referring to any name
+	DeclName() :
+		_entry(nullptr)
+	{}
+
+	// Interns the given name
+	explicit DeclName(std::string_view name);
+
+	// Returns the handle of the given name, or an empty handle if the name
+	// hasn't been interned yet. Use this for lookups, to not grow the table
+	// with names which are not declared anywhere.
+	static DeclName Find(std::string_view name);
+
+	bool empty() const
+	{
+		return _entry == nullptr;
+	}
+
+	// The lowercase name, empty for empty handles
+	const std::string& str() const;
+
+	std::uint32_t getId() const
+	{
+		return _entry != nullptr ? _entry->id : 0;
+	}
+
+	std::size_t getHash() const
+	{
+		return _entry != nullptr ? _entry->hash : 0;
+	}
+
+	bool operator==(const DeclName& other) const
+	{
+		return _entry == other._entry;
+	}
+
+	bool operator!=(const DeclName& other) const
+	{
+		return _entry != other._entry;
+	}
+
+	// Orders the handles by id, i.e. in order of interning
+	bool operator<(const DeclName& other) const
+	{
+		return getId() < other.getId();
+	}
+
+private:
+	DeclName(const Entry* entry) :
+		_entry(entry)
+	{}
+};
+
+/**
+ * The application-wide table of interned declaration names. Interning is
+ * thread-safe, the decl files are parsed by several threads at once.
+ *
+ * Names are never removed, the table only grows by the names which are
+ * actually declared (or explicitly interned).
+ */
+class DeclNameTable
+{
+private:
+	// Hashes and compares the names ignoring their case, such that lookups
+	// don't need to fold the name into a temporary string first
+	struct FoldedHash
+	{
+		std::size_t operator()(std::string_view name) const;
+	};
+
+	struct FoldedEqual
+	{
+		bool operator()(std::string_view a, std::string_view b) const;
+	};
+
+	mutable std::shared_mutex _mutex;
+
+	// Entries are not moved by the deque when growing at its end
+	std::deque<DeclName::Entry> _entries;
+
+	// Indexes the entries by their folded name
+	std::unordered_map<std::string_view, DeclName::Entry*, FoldedHash, FoldedEqual> _index;
+
+	// The strings handed out by internString(), case-sensitive. They are
+	// kept apart from the names, the index only holds declared names.
+	mutable std::shared_mutex _stringMutex;
+	std::unordered_map<std::string_view, std::shared_ptr<std::string>> _strings;
+
+public:
+	const DeclName::Entry* intern(std::string_view name);
+
+	/**
+	 * Returns the shared instance of the given string, keeping its case.
+	 * Used for the strings repeated over and over in the decls, like the
+	 * attribute names and types of the entity classes. The strings are not
+	 * interned as names, find() doesn't know about them.
+	 */
+	std::shared_ptr<std::string> internString(std::string_view str);
+
+	// Returns NULL if the name hasn't been interned yet
+	const DeclName::Entry* find(std::string_view name) const;
+
+	// The number of interned names
+	std::size_t size() const;
+
+	static DeclNameTable& Instance();
+
+private:
+	// Returns the entry of the given name, adding it if necessary. The
+	// table must be locked exclusively.
+	DeclName::Entry& insert(std::string_view name);
+};
+
+}
+
+namespace std
+{
+
+template<>
+struct hash<decl::DeclName>
+{
+	std::size_t operator()(const decl::DeclName& name) const
+	{
+		return name.getHash();
+	}
+};
+
+}
@@ -8,6 +8,7 @@
 #include "string/predicate.h"
 #include <fmt/format.h>
 #include <functional>
+#include <algorithm>
 
 namespace eclass
 {
@@ -40,6 +41,83 @@ bool tryGetSuffixedKey(const std::string& key, const std::string& prefix, std::s
 	return false;
 }
 
+typedef std::shared_ptr<std::string> StringPtr;
+
+// Returns the shared instance of the given string. Attribute names and types
+// are repeated over and over in the entity classes, they share the string
+// pool of the decl name table.
+inline StringPtr internString(const std::string& str)
+{
+    return decl::DeclNameTable::Instance().internString(str);
+}
+
+// Constructs an attribute with interned name and type strings. Empty values
+// and descriptions are shared too, setters replace the string anyway.
+EntityClassAttribute createAttribute(const std::string& type, const std::string& name,
+                                     const std::string& value, const std::string& description)
+{
+    return EntityClassAttribute(
+        internString(type),
+        internString(name),
+        value.empty() ? internString(value) : std::make_shared<std::string>(value),
+        description.empty() ? internString(description) : std::make_shared<std::string>(description)
+    );
+}
+
+// Attribute order for the sorted attribute lists, ignoring case
+inline bool attributeNameLess(const EntityClassAttribute& attribute, const std::string& name)
+{
+    return string_compare_nocase(attribute.getName().c_str(), name.c_str()) < 0;
+}
+
+inline bool attributeNameEqual(const EntityClassAttribute& attribute, const std::string& name)
+{
+    return string_compare_nocase(attribute.getName().c_str(), name.c_str()) == 0;
+}
+
+typedef std::vector<const EntityClassAttribute*> AttributeList;
+
+// Merges the sorted inherited attributes into the sorted list of visible
+// attributes, the ones already in the list take precedence
+void mergeInheritedAttributes(AttributeList& visible,
+                              const std::vector<EntityClassAttribute>& inherited)
+{
+    AttributeList merged;
+    merged.reserve(visible.size() + inherited.size());
+
+    AttributeList::const_iterator i = visible.cbegin();
+    std::vector<EntityClassAttribute>::const_iterator j = inherited.begin();
+
+    while (i != visible.cend() && j != inherited.end())
+    {
+        int result = string_compare_nocase((*i)->getName().c_str(), j->getName().c_str());
+
+        if (result < 0)
+        {
+            merged.push_back(*i++);
+        }
+        else if (result > 0)
+        {
+            merged.push_back(&(*j++));
+        }
+        else
+        {
+            // Overridden by the class itself or a nearer ancestor
+            merged.push_back(*i++);
+            ++j;
+        }
+    }
+
+    merged.insert(merged.end(), i, visible.cend());
+
+    for (; j != inherited.end(); ++j)
+    {
+        merged.push_back(&(*j));
+    }
+
+    visible.swap(merged);
+}
+
 } // namespace
 
 // Attachment helper object
@@ -320,29 +398,32 @@ const std::string& Doom3EntityClass::getFillShader() const
  */
 void Doom3EntityClass::addAttribute(const EntityClassAttribute& attribute)
 {
-    // Try to insert the class attribute
-    std::pair<EntityAttributeMap::iterator, bool> result = _attributes.insert(
-        EntityAttributeMap::value_type(attribute.getNameRef(), attribute)
+    // Find the insert position in the sorted list
+    Attributes::iterator i = std::lower_bound(
+        _attributes.begin(), _attributes.end(), attribute.getName(), attributeNameLess
     );
 
-    if (!result.second)
+    if (i == _attributes.end() || !attributeNameEqual(*i, attribute.getName()))
     {
-        EntityClassAttribute& existing = result.first->second;
+        _attributes.insert(i, attribute);
+        return;
+    }
 
-        // greebo: Attribute already existed, check if we have some
-        // descriptive properties to be added to the existing one.
-        if (!attribute.getDescription().empty() && existing.getDescription().empty())
-        {
-            // Use the shared string reference to save memory
-            existing.setDescription(attribute.getDescriptionRef());
-        }
+    EntityClassAttribute& existing = *i;
 
-        // Check if we have a more descriptive type than "text"
-        if (attribute.getType() != "text" && existing.getType() == "text")
-        {
-            // Use the shared string reference to save memory
-            existing.setType(attribute.getTypeRef());
-        }
+    // greebo: Attribute already existed, check if we have some
+    // descriptive properties to be added to the existing one.
+    if (!attribute.getDescription().empty() && existing.getDescription().empty())
+    {
+        // Use the shared string reference to save memory
+        existing.setDescription(attribute.getDescriptionRef());
+    }
+
+    // Check if we have a more descriptive type than "text"
+    if (attribute.getType() != "text" && existing.getType() == "text")
+    {
+        // Use the shared string reference to save memory
+        existing.setType(attribute.getTypeRef());
     }
 }
 
@@ -356,25 +437,35 @@ void Doom3EntityClass::forEachClassAttribute(
     std::function<void(const EntityClassAttribute&)> visitor,
     bool editorKeys) const
 {
-    for (EntityAttributeMap::const_iterator i = _attributes.begin();
-         i != _attributes.end();
-         ++i)
+    AttributeList visible;
+    visible.reserve(_attributes.size());
+
+    for (const EntityClassAttribute& attribute : _attributes)
+    {
+        visible.push_back(&attribute);
+    }
+
+    // Add the inherited ones, including editor keys
+    for (const Doom3EntityClass* parent = _parent; parent != nullptr; parent = parent->_parent)
+    {
+        mergeInheritedAttributes(visible, parent->_inheritedAttributes);
+    }
+
+    for (const EntityClassAttribute* attribute : visible)
     {
         // Visit if it is a non-editor key or we are visiting all keys
-        if (editorKeys || !string::istarts_with(*i->first, "editor_"))
+        if (editorKeys || !string::istarts_with(attribute->getName(), "editor_"))
         {
-            visitor(i->second);
+            visitor(*attribute);
         }
     }
 }
 
-namespace
+const std::string& Doom3EntityClass::getParentName() const
 {
-    void copyInheritedAttribute(Doom3EntityClass* target,
-                                const EntityClassAttribute& attr)
-    {
-        target->addAttribute(EntityClassAttribute(attr, true));
-    }
+    const EntityClassAttribute* inherit = findAttribute(_attributes, "inherit");
+
+    return inherit != nullptr ? inherit->getValue() : _emptyAttribute.getValue();
 }
 
 // Resolve inheritance for this class
@@ -384,37 +475,83 @@ void Doom3EntityClass::resolveInheritance(EntityClasses& classmap)
     if (_inheritanceResolved)
         return;
 
-    // Lookup the parent name and return if it is not set. Also return if the
-    // parent name is the same as our own classname, to avoid infinite
-    // recursion.
-    std::string parName = getAttribute("inherit").getValue();
-    if (parName.empty() || parName == _name)
-        return;
+    // Set the resolved flag right away, such that circular inheritance
+    // doesn't lead to infinite recursion
+    _inheritanceResolved = true;
+
+    // Lookup the parent name, classes without parent are done. The parent
+    // name might be the same as our own classname, ignore it in this case.
+    std::string parName = getParentName();
 
-    // Find the parent entity class
-    EntityClasses::iterator pIter = classmap.find(parName);
-    if (pIter != classmap.end())
+    if (!parName.empty() && parName != _name)
     {
-        // Recursively resolve inheritance of parent
-        pIter->second->resolveInheritance(classmap);
+        // Find the parent entity class
+        EntityClasses::iterator pIter = classmap.find(decl::DeclName::Find(parName));
+        if (pIter != classmap.end())
+        {
+            // Recursively resolve inheritance of parent
+            pIter->second->resolveInheritance(classmap);
 
-        // Copy attributes from the parent to the child, including editor keys
-        pIter->second->forEachClassAttribute(
-            std::bind(&copyInheritedAttribute, this, std::placeholders::_1), true
-        );
+            Doom3EntityClass* parent = pIter->second.get();
+
+            // Don't link a parent which is inheriting from us
+            bool circular = false;
 
-        // Set our parent pointer
-        _parent = pIter->second.get();
+            for (const Doom3EntityClass* p = parent; p != nullptr && !circular; p = p->_parent)
+            {
+                circular = p == this;
+            }
+
+            if (circular)
+            {
+                rWarning() << "[eclassmgr] Entity class " << _name
+                    << " has circular inheritance via " << parName << std::endl;
+            }
+            else
+            {
+                // Set our parent pointer, the parent's attributes are visible
+                // to us from now on
+                _parent = parent;
+
+                // Pick up the descriptive properties of overridden attributes
+                for (EntityClassAttribute& attribute : _attributes)
+                {
+                    const EntityClassAttribute* inherited =
+                        _parent->findInheritedAttribute(attribute.getName());
+
+                    if (inherited == nullptr) continue;
+
+                    if (!inherited->getDescription().empty() && attribute.getDescription().empty())
+                    {
+                        attribute.setDescription(inherited->getDescriptionRef());
+                    }
+
+                    if (inherited->getType() != "text" && attribute.getType() == "text")
+                    {
+                        attribute.setType(inherited->getTypeRef());
+                    }
+                }
+            }
+        }
+        else
+        {
+            rWarning() << "[eclassmgr] Entity class "
+                                  << _name << " specifies unknown parent class "
+                                  << parName << std::endl;
+        }
     }
-    else
+
+    // Build the attribute view of our descendants
+    _inheritedAttributes.clear();
+    _inheritedAttributes.reserve(_attributes.size());
+
+    for (const EntityClassAttribute& attribute : _attributes)
     {
-        rWarning() << "[eclassmgr] Entity class "
-                              << _name << " specifies unknown parent class "
-                              << parName << std::endl;
+        _inheritedAttributes.emplace_back(attribute, true);
     }
 
-    // Set the resolved flag
-    _inheritanceResolved = true;
+    if (parName.empty() || parName == _name)
+        return;
 
     if (!getAttribute("model").getValue().empty())
     {
@@ -463,24 +600,51 @@ bool Doom3EntityClass::isOfType(const std::string& className)
 	return false;
 }
 
-// Find a single attribute
-EntityClassAttribute& Doom3EntityClass::getAttribute(const std::string& name)
+const EntityClassAttribute* Doom3EntityClass::findAttribute(const Attributes& attributes,
+                                                             const std::string& name)
 {
-    StringPtr ref(new std::string(name));
+    Attributes::const_iterator i = std::lower_bound(
+        attributes.begin(), attributes.end(), name, attributeNameLess
+    );
+
+    return i != attributes.end() && attributeNameEqual(*i, name) ? &(*i) : nullptr;
+}
 
-    EntityAttributeMap::iterator f = _attributes.find(ref);
+const EntityClassAttribute* Doom3EntityClass::findInheritedAttribute(const std::string& name) const
+{
+    for (const Doom3EntityClass* eclass = this; eclass != nullptr; eclass = eclass->_parent)
+    {
+        const EntityClassAttribute* found = findAttribute(eclass->_inheritedAttributes, name);
+
+        if (found != nullptr)
+        {
+            return found;
+        }
+    }
+
+    return nullptr;
+}
+
+EntityClassAttribute* Doom3EntityClass::findOwnAttribute(const std::string& name)
+{
+    Attributes::iterator i = std::lower_bound(
+        _attributes.begin(), _attributes.end(), name, attributeNameLess
+    );
 
-    return (f != _attributes.end()) ? f->second : _emptyAttribute;
+    return i != _attributes.end() && attributeNameEqual(*i, name) ? &(*i) : nullptr;
 }
 
 // Find a single attribute
 const EntityClassAttribute& Doom3EntityClass::getAttribute(const std::string& name) const
 {
-    StringPtr ref(new std::string(name));
+    const EntityClassAttribute* found = findAttribute(_attributes, name);
 
-    EntityAttributeMap::const_iterator f = _attributes.find(ref);
+    if (found == nullptr && _parent != nullptr)
+    {
+        found = _parent->findInheritedAttribute(name);
+    }
 
-    return (f != _attributes.end()) ? f->second : _emptyAttribute;
+    return found != nullptr ? *found : _emptyAttribute;
 }
 
 void Doom3EntityClass::clear()
@@ -493,7 +657,9 @@ void Doom3EntityClass::clear()
 
     _fixedSize = false;
 
+    _parent = nullptr;
     _attributes.clear();
+    _inheritedAttributes.clear();
     _model.clear();
     _skin.clear();
     _inheritanceResolved = false;
@@ -533,7 +699,7 @@ void Doom3EntityClass::parseEditorSpawnarg(const std::string& key,
 
             // Construct an attribute with empty value, but with valid
             // description
-            addAttribute(EntityClassAttribute(type, attName, "", value));
+            addAttribute(createAttribute(type, attName, "", value));
         }
     }
 }
@@ -577,19 +743,20 @@ void Doom3EntityClass::parseFromTokens(parser::DefTokeniser& tokeniser)
         // Try parsing this key/value with the Attachments manager
         _attachments->parseDefAttachKeys(key, value);
 
-        // Add the EntityClassAttribute for this key/val
-        if (getAttribute(key).getType().empty())
+        // Add the EntityClassAttribute for this key/val. The parent is not
+        // known yet, only our own attributes are considered.
+        EntityClassAttribute* existing = findOwnAttribute(key);
+
+        if (existing == nullptr || existing->getType().empty())
         {
             // Following key-specific processing, add the keyvalue to the eclass
-            EntityClassAttribute attribute("text", key, value, "");
-
             // Type is empty, attribute does not exist, add it.
-            addAttribute(attribute);
+            addAttribute(createAttribute("text", key, value, ""));
         }
-        else if (getAttribute(key).getValue().empty())
+        else if (existing->getValue().empty())
         {
             // Attribute type is set, but value is empty, set the value.
-            getAttribute(key).setValue(value);
+            existing->setValue(value);
         }
         else
         {
@@ -605,4 +772,25 @@ void Doom3EntityClass::parseFromTokens(parser::DefTokeniser& tokeniser)
     _changedSignal.emit();
 }
 
+void Doom3EntityClass::replaceContents(Doom3EntityClass& parsed)
+{
+    clear();
+
+    _isLight = parsed._isLight;
+    _colour = parsed._colour;
+    _colourTransparent = parsed._colourTransparent;
+    _fillShader = std::move(parsed._fillShader);
+    _wireShader = std::move(parsed._wireShader);
+    _fixedSize = parsed._fixedSize;
+    _attributes.swap(parsed._attributes);
+    _model = std::move(parsed._model);
+    _skin = std::move(parsed._skin);
+    _modName = std::move(parsed._modName);
+    _attachments.swap(parsed._attachments);
+    _defFileName = std::move(parsed._defFileName);
+
+    // Notify the observers
+    _changedSignal.emit();
+}
+
 } // namespace eclass
@@ -8,10 +8,12 @@
 #include "string/string.h"
 
 #include "parser/DefTokeniser.h"
+#include "decl/DeclName.h"
 
 #include <vector>
 #include <map>
 #include <memory>
+#include <unordered_map>
 
 /* FORWARD DECLS */
 
@@ -30,23 +32,11 @@ typedef std::shared_ptr<Doom3EntityClass> Doom3EntityClassPtr;
 class Doom3EntityClass
 : public IEntityClass
 {
-    typedef std::shared_ptr<std::string> StringPtr;
-
-    class StringCompareFunctor
-    {
-    public:
-        bool operator()(const StringPtr& lhs, const StringPtr& rhs) const
-        {
-            //return boost::algorithm::ilexicographical_compare(lhs, rhs); // this is slow!
-            return string_compare_nocase(lhs->c_str(), rhs->c_str()) < 0;
-        }
-    };
-
     // The name of this entity class
     std::string _name;
 
     // Parent class pointer (or NULL)
-    IEntityClass* _parent;
+    Doom3EntityClass* _parent;
 
     // Should this entity type be treated as a light?
     bool _isLight;
@@ -66,28 +56,28 @@ class Doom3EntityClass
     // Does this entity have a fixed size?
     bool _fixedSize;
 
-    // Map of named EntityAttribute structures. EntityAttributes are picked
-    // up from the DEF file during parsing. Ignores key case.
+    // The attributes defined by this class, sorted by name (ignoring case).
+    // EntityAttributes are picked up from the DEF file during parsing.
 
-    // greebo: I've changed the EntityAttributeMap key type to StringPtr, to save
-    // more than 130 MB of string data used for just the keys. A default TDM installation
-    // has about 780k entity class attributes after resolving inheritance.
-    // However, the memory saving comes with a performance cost since we need 
-    // to convert the incoming std::string queries to StringRefs before passing
-    // them to std::map::find(). During a regular DarkRadiant startup 
-    // there are about 64k find() operations, a single idLight
-    // creation costs about 30-40 find() operations, which is ok I guess.
+    // Inherited attributes are not copied into the child classes (a default TDM
+    // installation has about 780k entity class attributes after resolving
+    // inheritance), lookups walk up the parent chain instead. Key names and
+    // types are interned, all classes share the same string instances.
+    typedef std::vector<EntityClassAttribute> Attributes;
+    Attributes _attributes;
 
-    typedef std::map<StringPtr, EntityClassAttribute, StringCompareFunctor> EntityAttributeMap;
-    EntityAttributeMap _attributes;
+    // The attributes of this class as seen by the inheriting classes: same
+    // order and strings as _attributes, but flagged as inherited. Built when
+    // resolving inheritance and shared by all descendants.
+    Attributes _inheritedAttributes;
 
     // The model and skin for this entity class (if it has one)
     std::string _model;
     std::string _skin;
 
     // Flag to indicate inheritance resolved. An EntityClass resolves its
-    // inheritance by copying all values from the parent onto the child,
-    // after recursively instructing the parent to resolve its own inheritance.
+    // inheritance by looking up its parent class, after recursively
+    // instructing the parent to resolve its own inheritance.
     bool _inheritanceResolved;
 
     // Name of the mod owning this class
@@ -103,6 +93,9 @@ class Doom3EntityClass
     // The time this def has been parsed
     std::size_t _parseStamp;
 
+    // The DEF file this class has been parsed from
+    std::string _defFileName;
+
     // Emitted when contents are reloaded
     sigc::signal<void> _changedSignal;
 
@@ -112,6 +105,17 @@ private:
     void parseEditorSpawnarg(const std::string& key, const std::string& value);
     void setIsLight(bool val);
 
+    // Binary search for the given name in the sorted attribute list
+    static const EntityClassAttribute* findAttribute(const Attributes& attributes,
+                                                     const std::string& name);
+
+    // Returns the attribute defined by this class itself, NULL if not found
+    EntityClassAttribute* findOwnAttribute(const std::string& name);
+
+    // Looks up the given attribute in the inherited attributes of this class
+    // and its ancestors, returns NULL if not found
+    const EntityClassAttribute* findInheritedAttribute(const std::string& name) const;
+
 public:
 
     /**
@@ -164,7 +168,6 @@ public:
     const Vector3& getColour() const;
     const std::string& getWireShader() const;
     const std::string& getFillShader() const;
-    EntityClassAttribute& getAttribute(const std::string& name);
     const EntityClassAttribute& getAttribute(const std::string& name) const;
     void forEachClassAttribute(std::function<void(const EntityClassAttribute&)>,
                                bool) const;
@@ -184,13 +187,21 @@ public:
     void setSkin(const std::string& skin) { _skin = skin; }
 
     /**
-     * Resolve inheritance for this class.
+     * Returns the parent class name, as specified by the "inherit" key of
+     * this class (ignoring any inherited keys).
+     */
+    const std::string& getParentName() const;
+
+    /**
+     * Resolve inheritance for this class. The parent class is resolved first
+     * if necessary, this is not thread-safe unless the parent has been
+     * resolved already.
      *
      * @param classmap
      * A reference to the global map of entity classes, which should be searched
      * for the parent entity.
      */
-    typedef std::map<std::string, Doom3EntityClassPtr> EntityClasses;
+    typedef std::unordered_map<decl::DeclName, Doom3EntityClassPtr> EntityClasses;
     void resolveInheritance(EntityClasses& classmap);
 
     /**
@@ -210,6 +221,11 @@ public:
     // Initialises this class from the given tokens
     void parseFromTokens(parser::DefTokeniser& tokeniser);
 
+    // Takes over the parsed contents of the given class (of the same name),
+    // leaving this class with unresolved inheritance. Used when reloading
+    // definitions, to keep the existing class instances intact.
+    void replaceContents(Doom3EntityClass& parsed);
+
     void setParseStamp(std::size_t parseStamp)
     {
         _parseStamp = parseStamp;
@@ -219,6 +235,16 @@ public:
     {
         return _parseStamp;
     }
+
+    void setDefFileName(const std::string& fileName)
+    {
+        _defFileName = fileName;
+    }
+
+    const std::string& getDefFileName() const
+    {
+        return _defFileName;
+    }
 };
 
 /**
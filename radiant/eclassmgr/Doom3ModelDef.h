@@ -11,6 +11,9 @@ class Doom3ModelDef :
 {
 	std::size_t _parseStamp;
 
+	// The DEF file this model has been parsed from
+	std::string _defFileName;
+
 public:
 	Doom3ModelDef(const std::string& modelDefName) :
 		_parseStamp(0)
@@ -28,6 +31,16 @@ public:
 		_parseStamp = parseStamp;
 	}
 
+	void setDefFileName(const std::string& fileName)
+	{
+		_defFileName = fileName;
+	}
+
+	const std::string& getDefFileName() const
+	{
+		return _defFileName;
+	}
+
 	void setModName(const std::string& newModName)
 	{
 		modName = newModName;
@@ -10,23 +10,39 @@
 #include "iradiant.h"
 #include "iuimanager.h"
 #include "ifilesystem.h"
-#include "parser/DefTokeniser.h"
+#include "ideclcache.h"
+#include "gamelib.h"
+#include "ideclloadscheduler.h"
+#include "parser/TokenListTokeniser.h"
 
 #include "Doom3EntityClass.h"
 #include "Doom3ModelDef.h"
 
 #include "string/case_conv.h"
+#include "string/predicate.h"
 #include <functional>
+#include <algorithm>
 
 #include "debugging/ScopedDebugTimer.h"
 #include "modulesystem/StaticModule.h"
 
 namespace eclass {
 
+namespace
+{
+	// Inheritance depth markers
+	const int DEPTH_CIRCULAR = -1;
+	const int DEPTH_IN_PROGRESS = -2;
+
+	// The number of entity classes resolved by a single sub-task
+	const std::size_t CLASSES_PER_TASK = 256;
+}
+
 // Constructor
 EClassManager::EClassManager() :
     _realised(false),
-    _defLoader(std::bind(&EClassManager::loadDefAndResolveInheritance, this)),
+    _defLoader("EntityDefs", std::bind(&EClassManager::loadDefAndResolveInheritance, this),
+        {}, decl::LoadPriority::High),
 	_curParseStamp(0)
 {}
 
@@ -46,16 +62,16 @@ IEntityClassPtr EClassManager::findOrInsert(const std::string& name, bool has_br
         return IEntityClassPtr();
     }
 
-	// Convert string to lowercase, for case-insensitive lookup
-	std::string lName = string::to_lower_copy(name);
-
-    // Find and return if exists
-    Doom3EntityClassPtr eclass = findInternal(lName);
+    // Find and return if exists, the lookup is case-insensitive
+    Doom3EntityClassPtr eclass = findInternal(name);
     if (eclass)
     {
         return eclass;
     }
 
+	// Class names are lowercase
+	std::string lName = string::to_lower_copy(name);
+
     // Otherwise insert the new EntityClass
     //IEntityClassPtr eclass = eclass::Doom3EntityClass::create(lName, has_brushes);
     // greebo: Changed fallback behaviour when unknown entites are encountered to TRUE
@@ -69,7 +85,7 @@ IEntityClassPtr EClassManager::findOrInsert(const std::string& name, bool has_br
 Doom3EntityClassPtr EClassManager::findInternal(const std::string& name)
 {
     // Find the EntityClass in the map.
-    EntityClasses::const_iterator i = _entityClasses.find(name);
+    EntityClasses::const_iterator i = _entityClasses.find(decl::DeclName::Find(name));
 
     return i != _entityClasses.end() ? i->second : Doom3EntityClassPtr();
 }
@@ -78,9 +94,14 @@ Doom3EntityClassPtr EClassManager::insertUnique(const Doom3EntityClassPtr& eclas
 {
 	// Try to insert the eclass
     std::pair<EntityClasses::iterator, bool> i = _entityClasses.insert(
-    	EntityClasses::value_type(eclass->getName(), eclass)
+    	EntityClasses::value_type(decl::DeclName(eclass->getName()), eclass)
     );
 
+    if (i.second)
+    {
+        _sortedEntityClasses.reset();
+    }
+
     // Return the pointer to the inserted eclass
     return i.first->second;
 }
@@ -131,11 +152,49 @@ void EClassManager::parseDefFiles()
 
 	{
 		ScopedDebugTimer timer("EntityDefs parsed: ");
+        std::vector<std::string> filenames;
+
         GlobalFileSystem().forEachFile(
             "def/", "def",
-            [&](const vfs::FileInfo& fileInfo) { parseFile(fileInfo.name); }
+            [&](const vfs::FileInfo& fileInfo) { filenames.push_back(fileInfo.name); }
         );
+
+        parseFiles(filenames);
+	}
+
+	// Remember what has been loaded, for the incremental reloads
+	_defFiles.reset(GlobalFileSystem(), "def/", "def", 1);
+}
+
+int EClassManager::getInheritanceDepth(const Doom3EntityClass& eclass, InheritanceDepths& depths)
+{
+	InheritanceDepths::const_iterator found = depths.find(&eclass);
+
+	if (found != depths.end())
+	{
+		// Running into a class still in progress means we're going in circles
+		return found->second == DEPTH_IN_PROGRESS ? DEPTH_CIRCULAR : found->second;
 	}
+
+	depths[&eclass] = DEPTH_IN_PROGRESS;
+
+	int depth = 0;
+	const std::string& parentName = eclass.getParentName();
+
+	if (!parentName.empty() && parentName != eclass.getName())
+	{
+		EntityClasses::const_iterator parent = _entityClasses.find(decl::DeclName::Find(parentName));
+
+		if (parent != _entityClasses.end())
+		{
+			int parentDepth = getInheritanceDepth(*parent->second, depths);
+			depth = parentDepth == DEPTH_CIRCULAR ? DEPTH_CIRCULAR : parentDepth + 1;
+		}
+	}
+
+	depths[&eclass] = depth;
+
+	return depth;
 }
 
 void EClassManager::resolveInheritance()
@@ -148,13 +207,62 @@ void EClassManager::resolveInheritance()
 
     // Resolve inheritance for the entities. At this stage the classes
     // will have the name of their parent, but not an actual pointer to
-    // it
-    for (EntityClasses::value_type& pair : _entityClasses)
-	{
-		// Tell the class to resolve its own inheritance using the given
-		// map as a source for parent lookup
-        pair.second->resolveInheritance(_entityClasses);
+    // it. The classes are resolved level by level, all parents are done
+    // before their children, such that the classes of a single level can
+    // be resolved in parallel.
+    InheritanceDepths depths;
+    std::vector<std::vector<Doom3EntityClass*>> levels;
+    std::vector<Doom3EntityClass*> circular;
+
+    for (const EntityClasses::value_type& pair : _entityClasses)
+    {
+        int depth = getInheritanceDepth(*pair.second, depths);
+
+        if (depth == DEPTH_CIRCULAR)
+        {
+            circular.push_back(pair.second.get());
+            continue;
+        }
+
+        if (levels.size() <= static_cast<std::size_t>(depth))
+        {
+            levels.resize(depth + 1);
+        }
+
+        levels[depth].push_back(pair.second.get());
+    }
+
+    for (const std::vector<Doom3EntityClass*>& level : levels)
+    {
+        std::vector<std::function<void()>> tasks;
+
+        for (std::size_t start = 0; start < level.size(); start += CLASSES_PER_TASK)
+        {
+            std::size_t end = std::min(start + CLASSES_PER_TASK, level.size());
 
+            tasks.emplace_back([&, start, end]()
+            {
+                for (std::size_t i = start; i < end; ++i)
+                {
+                    // Tell the class to resolve its own inheritance using the given
+                    // map as a source for parent lookup
+                    level[i]->resolveInheritance(_entityClasses);
+                }
+            });
+        }
+
+        GlobalDeclLoadScheduler().runSubTasks(tasks);
+    }
+
+    // The classes inheriting from themselves (or depending on such a class)
+    // are resolved sequentially, this breaks up the cycles
+    for (Doom3EntityClass* eclass : circular)
+    {
+        eclass->resolveInheritance(_entityClasses);
+    }
+
+    for (EntityClasses::value_type& pair : _entityClasses)
+    {
         // If the entity has a model path ("model" key), lookup the actual
         // model and apply its mesh and skin to this entity.
         if (!pair.second->getModelPath().empty())
@@ -218,10 +326,8 @@ IEntityClassPtr EClassManager::findClass(const std::string& className)
 {
     ensureDefsLoaded();
 
-	// greebo: Convert the lookup className string to lowercase first
-	std::string classNameLower = string::to_lower_copy(className);
-
-    EntityClasses::const_iterator i = _entityClasses.find(classNameLower);
+	// The interned names are case-insensitive, no need to convert the name
+    EntityClasses::const_iterator i = _entityClasses.find(decl::DeclName::Find(className));
 
     return i != _entityClasses.end() ? i->second : IEntityClassPtr();
 }
@@ -231,9 +337,36 @@ void EClassManager::forEachEntityClass(EntityClassVisitor& visitor)
 {
     ensureDefsLoaded();
 
-	for (EntityClasses::value_type& pair : _entityClasses)
+	// The hashed map has no order, visit the classes sorted by name
+	if (!_sortedEntityClasses)
 	{
-		visitor.visit(pair.second);
+		std::vector<std::pair<std::string, Doom3EntityClassPtr>> named;
+		named.reserve(_entityClasses.size());
+
+		for (const EntityClasses::value_type& pair : _entityClasses)
+		{
+			named.emplace_back(pair.second->getName(), pair.second);
+		}
+
+		std::sort(named.begin(), named.end());
+
+		std::shared_ptr<SortedEntityClasses> sorted = std::make_shared<SortedEntityClasses>();
+		sorted->reserve(named.size());
+
+		for (const auto& pair : named)
+		{
+			sorted->push_back(pair.second);
+		}
+
+		_sortedEntityClasses = sorted;
+	}
+
+	// The visitor might insert classes, which resets the member
+	std::shared_ptr<const SortedEntityClasses> sorted = _sortedEntityClasses;
+
+	for (const Doom3EntityClassPtr& eclass : *sorted)
+	{
+		visitor.visit(eclass);
 	}
 }
 
@@ -297,6 +430,8 @@ const StringSet& EClassManager::getDependencies() const {
 		_dependencies.insert(MODULE_UIMANAGER);
 		_dependencies.insert(MODULE_EVENTMANAGER);
 		_dependencies.insert(MODULE_COMMANDSYSTEM);
+		_dependencies.insert(MODULE_DECLLOADSCHEDULER);
+		_dependencies.insert(MODULE_DECLCACHE);
 	}
 
 	return _dependencies;
@@ -309,7 +444,8 @@ void EClassManager::initialiseModule(const ApplicationContext& ctx)
 	GlobalFileSystem().addObserver(*this);
 	realise();
 
-	GlobalCommandSystem().addCommand("ReloadDefs", std::bind(&EClassManager::reloadDefsCmd, this, std::placeholders::_1));
+	GlobalCommandSystem().addCommand("ReloadDefs", std::bind(&EClassManager::reloadDefsCmd, this, std::placeholders::_1),
+		{ cmd::ARGTYPE_STRING | cmd::ARGTYPE_OPTIONAL });
 	GlobalEventManager().addCommand("ReloadDefs", "ReloadDefs");
 }
 
@@ -327,7 +463,9 @@ void EClassManager::shutdownModule()
 
 	// Clear member structures
 	_entityClasses.clear();
+	_sortedEntityClasses.reset();
 	_models.clear();
+	_defFiles.clear();
 }
 
 // This takes care of relading the entityDefs and refreshing the scenegraph
@@ -335,8 +473,16 @@ void EClassManager::reloadDefsCmd(const cmd::ArgumentList& args)
 {
     IScopedScreenUpdateBlockerPtr blocker = GlobalMainFrame().getScopedScreenUpdateBlocker(_("Reloading Defs"),
         _("Reloading Defs"), true);
-	
-    reloadDefs();
+
+    // Only the changed files are parsed again, unless "full" is requested
+    if (!args.empty() && args[0].getString() == "full")
+    {
+        reloadDefs();
+    }
+    else
+    {
+        reloadChangedDefFiles();
+    }
 }
 
 // Gets called on VFS initialise
@@ -351,119 +497,330 @@ void EClassManager::onFileSystemShutdown()
 	unrealise();
 }
 
-// Parse the provided stream containing the contents of a single .def file.
-// Extract all entitydefs and create objects accordingly.
-void EClassManager::parse(TextInputStream& inStr, const std::string& modDir)
+void EClassManager::onFilesChanged(const std::set<std::string>& changedFiles)
 {
-	// Construct a tokeniser for the stream
-	std::istream is(&inStr);
-    parser::BasicDefTokeniser<std::istream> tokeniser(is);
+	if (!_realised)
+	{
+		return;
+	}
 
-    while (tokeniser.hasMoreTokens())
+	std::set<std::string> defFiles;
+
+	for (const std::string& file : changedFiles)
 	{
-        std::string blockType = tokeniser.nextToken();
-        string::to_lower(blockType);
+		if (string::starts_with(file, "def/") && string::ends_with(file, ".def"))
+		{
+			defFiles.insert(file.substr(4));
+		}
+	}
 
-        if (blockType == "entitydef")
+	if (!defFiles.empty())
+	{
+		ensureDefsLoaded();
+		reloadDefFiles(defFiles);
+
+		std::set<std::string> paths;
+
+		for (const std::string& file : defFiles)
 		{
-			// Get the (lowercase) entity name
-			const std::string sName =
-    			string::to_lower_copy(tokeniser.nextToken());
+			paths.insert("def/" + file);
+		}
 
-			// Ensure that an Entity class with this name already exists
-			// When reloading entityDef declarations, most names will already be registered
-			EntityClasses::iterator i = _entityClasses.find(sName);
+		_defFiles.update(GlobalFileSystem(), paths);
+	}
+}
 
-			if (i == _entityClasses.end())
+void EClassManager::reloadChangedDefFiles()
+{
+	ensureDefsLoaded();
+
+	std::set<std::string> defFiles;
+
+	for (const std::string& path : _defFiles.findChangedFiles(GlobalFileSystem()))
+	{
+		defFiles.insert(path.substr(4)); // strip the def/
+	}
+
+	if (defFiles.empty())
+	{
+		rMessage() << "[eclassmgr] No def files changed." << std::endl;
+		return;
+	}
+
+	reloadDefFiles(defFiles);
+}
+
+void EClassManager::reloadDefFiles(std::set<std::string> filenames)
+{
+	// Inheriting classes are holding copies of the changed values,
+	// they need to be parsed and resolved again
+	addDependentDefFiles(filenames);
+
+	rMessage() << "[eclassmgr] Reloading " << filenames.size() << " def files." << std::endl;
+
+	_curParseStamp++;
+
+	{
+		ScopedDebugTimer timer("Changed EntityDefs parsed: ");
+
+		parseFiles(std::vector<std::string>(filenames.begin(), filenames.end()));
+	}
+
+	resolveInheritance();
+
+	_defsReloadedSignal.emit();
+}
+
+void EClassManager::addDependentDefFiles(std::set<std::string>& filenames)
+{
+	bool filesAdded = true;
+
+	while (filesAdded)
+	{
+		filesAdded = false;
+
+		// Gather the declarations of the current set of files
+		std::set<std::string> classNames;
+		std::set<std::string> modelNames;
+
+		for (const EntityClasses::value_type& pair : _entityClasses)
+		{
+			if (filenames.count(pair.second->getDefFileName()) > 0)
+			{
+				classNames.insert(pair.second->getName());
+			}
+		}
+
+		for (const Models::value_type& pair : _models)
+		{
+			if (filenames.count(pair.second->getDefFileName()) > 0)
+			{
+				modelNames.insert(pair.first);
+			}
+		}
+
+		for (const EntityClasses::value_type& pair : _entityClasses)
+		{
+			const std::string& fileName = pair.second->getDefFileName();
+
+			if (fileName.empty() || filenames.count(fileName) > 0)
 			{
-				// Not existing yet, allocate a new class
-        		Doom3EntityClassPtr entityClass(new eclass::Doom3EntityClass(sName));
+				continue;
+			}
 
-				std::pair<EntityClasses::iterator, bool> result = _entityClasses.insert(
-					EntityClasses::value_type(sName, entityClass)
-				);
+			// Check the model reference and all ancestors
+			bool dependent = modelNames.count(pair.second->getAttribute("model").getValue()) > 0;
 
-				i = result.first;
+			for (const IEntityClass* parent = pair.second->getParent();
+				 parent != nullptr && !dependent; parent = parent->getParent())
+			{
+				dependent = classNames.count(parent->getName()) > 0;
 			}
-			else
+
+			if (dependent)
 			{
-				// EntityDef already exists, compare the parse stamp
-				if (i->second->getParseStamp() == _curParseStamp)
+				filenames.insert(fileName);
+				filesAdded = true;
+			}
+		}
+
+		for (const Models::value_type& pair : _models)
+		{
+			const std::string& fileName = pair.second->getDefFileName();
+
+			if (fileName.empty() || filenames.count(fileName) > 0)
+			{
+				continue;
+			}
+
+			// Walk up the model hierarchy, guarding against circular inheritance
+			std::set<std::string> visited;
+
+			for (std::string parent = pair.second->parent;
+				 !parent.empty() && visited.insert(parent).second; )
+			{
+				if (modelNames.count(parent) > 0)
 				{
-					rWarning() << "[eclassmgr]: EntityDef "
-						<< sName << " redefined" << std::endl;
+					filenames.insert(fileName);
+					filesAdded = true;
+					break;
 				}
+
+				Models::const_iterator found = _models.find(parent);
+				parent = found != _models.end() ? found->second->parent : std::string();
 			}
+		}
+	}
+}
 
-			// At this point, i is pointing to a valid entityclass
+// Parse the provided stream containing the contents of a single .def file.
+// Extract all entitydefs and create objects accordingly.
+void EClassManager::parse(parser::DefTokeniser& tokeniser, const std::string& fileName, ParsedDefFile& parsed)
+{
+    while (tokeniser.hasMoreTokens())
+	{
+        std::string blockType = tokeniser.nextToken();
+        string::to_lower(blockType);
 
-			i->second->setParseStamp(_curParseStamp);
+        if (blockType == "entitydef")
+		{
+			// Get the (lowercase) entity name
+			const std::string sName =
+    			string::to_lower_copy(tokeniser.nextToken());
 
-        	// Parse the contents of the eclass (excluding name)
-			i->second->parseFromTokens(tokeniser);
+			// Allocate a new class, its contents are merged into an existing
+			// class of the same name later on. The class is added before parsing,
+			// to keep what has been parsed if the definition is broken.
+			Doom3EntityClassPtr entityClass(new eclass::Doom3EntityClass(sName));
+			entityClass->setDefFileName(fileName);
+			parsed.entityClasses.push_back(entityClass);
 
-			// Set the mod directory
-        	i->second->setModName(modDir);
+        	// Parse the contents of the eclass (excluding name)
+			entityClass->parseFromTokens(tokeniser);
         }
         else if (blockType == "model")
 		{
 			// Read the name
 			std::string modelDefName = tokeniser.nextToken();
 
-			// Ensure that an Entity class with this name already exists
-			// When reloading entityDef declarations, most names will already be registered
-			Models::iterator i = _models.find(modelDefName);
+			// Allocate an empty ModelDef
+			Doom3ModelDefPtr model(new Doom3ModelDef(modelDefName));
+			model->setDefFileName(fileName);
+			parsed.models.push_back(model);
 
-			if (i == _models.end())
-			{
-				// Does not exist yet, allocate a new one
+            // Invoke the parser routine
+        	model->parseFromTokens(tokeniser);
+        }
+    }
+}
 
-				// Allocate an empty ModelDef
-        		Doom3ModelDefPtr model(new Doom3ModelDef(modelDefName));
+decl::DeclFilePtr EClassManager::getDefFile(const std::string& filename)
+{
+	return GlobalDeclCache().getFile("def/" + filename, decl::DeclFileContents::Tokens);
+}
 
-				std::pair<Models::iterator, bool> result = _models.insert(
-					Models::value_type(modelDefName, model)
-				);
+EClassManager::ParsedDefFile EClassManager::parseFile(const std::string& filename)
+{
+	ParsedDefFile parsed;
 
-				i = result.first;
-			}
-			else
-			{
-				// Model already exists, compare the parse stamp
-				if (i->second->getParseStamp() == _curParseStamp)
-				{
-					rWarning() << "[eclassmgr]: Model "
-						<< modelDefName << " redefined" << std::endl;
-				}
-			}
+	try
+	{
+		decl::DeclFilePtr file = getDefFile(filename);
 
-			// Model structure is allocated and in the map,
-            // invoke the parser routine
-			i->second->setParseStamp(_curParseStamp);
+		if (file)
+		{
+			parsed.modRoot = file->modRoot;
 
-        	i->second->parseFromTokens(tokeniser);
-			i->second->setModName(modDir);
-        }
-    }
+			// Parse entity defs from the file
+			parser::TokenListTokeniser tokeniser(file->tokens);
+			parse(tokeniser, filename, parsed);
+		}
+	}
+	catch (parser::ParseException& e)
+	{
+		parsed.error = e.what();
+	}
+
+	return parsed;
 }
 
-void EClassManager::parseFile(const std::string& filename)
+void EClassManager::parseFiles(const std::vector<std::string>& filenames)
 {
-	const std::string fullname = "def/" + filename;
+	// Parse the files in parallel, unchanged ones come from the decl cache
+	std::vector<ParsedDefFile> parsedFiles(filenames.size());
+	std::vector<std::function<void()>> tasks;
 
-	ArchiveTextFilePtr file = GlobalFileSystem().openTextFile(fullname);
+	for (std::size_t i = 0; i < filenames.size(); ++i)
+	{
+		tasks.emplace_back([&, i]()
+		{
+			parsedFiles[i] = parseFile(filenames[i]);
+		});
+	}
 
-	if (!file) return;
+	GlobalDeclLoadScheduler().runSubTasks(tasks);
 
-	try
-    {
-		// Parse entity defs from the file
-		parse(file->getInputStream(), file->getModName());
+	// Merge the declarations in VFS order, later ones replacing earlier ones
+	std::map<std::string, std::string> modDirs;
+
+	for (std::size_t i = 0; i < parsedFiles.size(); ++i)
+	{
+		ParsedDefFile& parsed = parsedFiles[i];
+
+		if (!parsed.error.empty())
+		{
+			rError() << "[eclassmgr] failed to parse " << filenames[i]
+					 << " (" << parsed.error << ")" << std::endl;
+		}
+
+		if (parsed.entityClasses.empty() && parsed.models.empty())
+		{
+			continue;
+		}
+
+		std::map<std::string, std::string>::const_iterator modDir = modDirs.find(parsed.modRoot);
+
+		if (modDir == modDirs.end())
+		{
+			modDir = modDirs.emplace(parsed.modRoot, game::current::getModPath(parsed.modRoot)).first;
+		}
+
+		mergeParsedFile(parsed, modDir->second);
 	}
-    catch (parser::ParseException& e)
-    {
-		rError() << "[eclassmgr] failed to parse " << filename
-				 << " (" << e.what() << ")" << std::endl;
+}
+
+void EClassManager::mergeParsedFile(ParsedDefFile& parsed, const std::string& modDir)
+{
+	for (const Doom3EntityClassPtr& entityClass : parsed.entityClasses)
+	{
+		// When reloading entityDef declarations, most names will already be registered
+		decl::DeclName name(entityClass->getName());
+		EntityClasses::iterator i = _entityClasses.find(name);
+
+		if (i == _entityClasses.end())
+		{
+			i = _entityClasses.insert(EntityClasses::value_type(name, entityClass)).first;
+			_sortedEntityClasses.reset();
+		}
+		else
+		{
+			// EntityDef already exists, compare the parse stamp
+			if (i->second->getParseStamp() == _curParseStamp)
+			{
+				rWarning() << "[eclassmgr]: EntityDef "
+					<< entityClass->getName() << " redefined" << std::endl;
+			}
+
+			// Keep the existing instance, any IEntityClassPtrs remain intact
+			i->second->replaceContents(*entityClass);
+		}
+
+		i->second->setParseStamp(_curParseStamp);
+		i->second->setModName(modDir);
+	}
+
+	for (const Doom3ModelDefPtr& model : parsed.models)
+	{
+		Models::iterator i = _models.find(model->name);
+
+		if (i == _models.end())
+		{
+			i = _models.insert(Models::value_type(model->name, model)).first;
+		}
+		else
+		{
+			// Model already exists, compare the parse stamp
+			if (i->second->getParseStamp() == _curParseStamp)
+			{
+				rWarning() << "[eclassmgr]: Model "
+					<< model->name << " redefined" << std::endl;
+			}
+
+			*i->second = std::move(*model);
+		}
+
+		i->second->setParseStamp(_curParseStamp);
+		i->second->setModName(modDir);
 	}
 }
 
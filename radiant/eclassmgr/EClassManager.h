@@ -3,12 +3,16 @@
 #include "ieclass.h"
 #include "icommandsystem.h"
 #include "ifilesystem.h"
+#include "ideclcache.h"
 #include "itextstream.h"
 #include "ThreadedDefLoader.h"
+#include "decl/DeclFileIndex.h"
 
 #include "Doom3EntityClass.h"
 #include "Doom3ModelDef.h"
 
+#include <unordered_map>
+
 namespace eclass
 {
 
@@ -34,16 +38,24 @@ class EClassManager :
     // Whether the entity classes have been realised
     bool _realised;
 
-    // Map of named entity classes
-    typedef std::map<std::string, Doom3EntityClassPtr> EntityClasses;
+    // Map of named entity classes, hashed by their interned name
+    typedef Doom3EntityClass::EntityClasses EntityClasses;
     EntityClasses _entityClasses;
 
+    // The classes sorted by name for forEachEntityClass(), reset when classes
+    // are added or removed. The visitor keeps its own reference.
+    typedef std::vector<Doom3EntityClassPtr> SortedEntityClasses;
+    std::shared_ptr<const SortedEntityClasses> _sortedEntityClasses;
+
     typedef std::map<std::string, Doom3ModelDefPtr> Models;
     Models _models;
 
     // The worker thread loading the eclasses will be managed by this
     util::ThreadedDefLoader<void> _defLoader;
 
+    // The state of the DEF files as of the last (re)load
+    decl::DeclFileIndex _defFiles;
+
 	// A unique parse pass identifier, used to check when existing
 	// definitions have been parsed
 	std::size_t _curParseStamp;
@@ -66,6 +78,7 @@ public:
     // VFS::Observer implementation
     virtual void onFileSystemInitialise() override;
     virtual void onFileSystemShutdown() override;
+    virtual void onFilesChanged(const std::set<std::string>& changedFiles) override;
 
     // Find the modeldef with the given name
     virtual IModelDefPtr findModel(const std::string& name) override;
@@ -80,10 +93,24 @@ public:
     virtual void initialiseModule(const ApplicationContext& ctx) override;
     virtual void shutdownModule() override;
 
-	// Method loading the DEF files
-    void parseFile(const std::string& filename);
-
 private:
+    // The declarations parsed from a single DEF file, not merged into the
+    // class and model maps yet
+    struct ParsedDefFile
+    {
+        // The folder of the archive containing the file
+        std::string modRoot;
+
+        std::vector<Doom3EntityClassPtr> entityClasses;
+        std::vector<Doom3ModelDefPtr> models;
+
+        // The parser error message, if the file couldn't be parsed completely
+        std::string error;
+    };
+
+    // The depth of the entity classes in the inheritance tree
+    typedef std::unordered_map<const Doom3EntityClass*, int> InheritanceDepths;
+
     // Since loading is happening in a worker thread, we need to ensure
     // that it's done loading before accessing any defs or models.
     void ensureDefsLoaded();
@@ -96,12 +123,43 @@ private:
 	Doom3EntityClassPtr insertUnique(const Doom3EntityClassPtr& eclass);
     Doom3EntityClassPtr findInternal(const std::string& name);
 
-	// Parses the given inputstream for DEFs.
-	void parse(TextInputStream& inStr, const std::string& modDir);
+	// Returns the tokens of the given DEF file (relative to def/) through the
+	// decl cache. Can be called from any thread.
+	decl::DeclFilePtr getDefFile(const std::string& filename);
+
+	// Parses the given DEF file (relative to def/) into new declarations.
+	// Can be called from any thread.
+	ParsedDefFile parseFile(const std::string& filename);
+
+	// Parses the given tokens for DEFs, fileName is relative to def/
+	static void parse(parser::DefTokeniser& tokeniser, const std::string& fileName, ParsedDefFile& parsed);
+
+	// Parses the given DEF files (relative to def/) in parallel and merges the
+	// declarations in the given order, replacing the contents of existing ones
+	void parseFiles(const std::vector<std::string>& filenames);
+
+	// Adds the parsed declarations to the maps
+	void mergeParsedFile(ParsedDefFile& parsed, const std::string& modDir);
+
+	// Parses the given DEF files (relative to def/) again, along with all
+	// files containing declarations depending on them
+	void reloadDefFiles(std::set<std::string> filenames);
+
+	// Reloads the DEF files which have been added, removed or modified
+	// since they have been loaded
+	void reloadChangedDefFiles();
+
+	// Extends the given set of DEF files by the ones containing declarations
+	// which inherit from or reference a declaration in one of the files
+	void addDependentDefFiles(std::set<std::string>& filenames);
 
 	// Recursively resolves the inheritance of the model defs
 	void resolveModelInheritance(const std::string& name, const Doom3ModelDefPtr& model);
 
+	// Returns the number of ancestors of the given class which are known to
+	// this manager, or -1 if the inheritance chain is circular
+	int getInheritanceDepth(const Doom3EntityClass& eclass, InheritanceDepths& depths);
+
 	void parseDefFiles();
 	void resolveInheritance();
 
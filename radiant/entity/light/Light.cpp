@@ -733,55 +733,91 @@ AABB Light::lightAABB() const
     return AABB(_originTransformed, m_doom3Radius.m_radiusTransformed);
 }
 
+Frustum Light::getWorldFrustum() const
+{
+    // Update the projection, including the Frustum (we don't care about the
+    // projection matrix itself).
+    updateProjection();
+
+    // Construct a transformation with the rotation and translation of the
+    // frustum
+    Matrix4 transRot = Matrix4::getIdentity();
+    transRot.translateBy(worldOrigin());
+    transRot.multiplyBy(rotation());
+
+    // Transform the frustum with the rotate/translate matrix
+    return _frustum.getTransformedBy(transRot);
+}
+
+AABB Light::getRotatedPointLightBounds() const
+{
+    // An AABB which contains the rotated bounds of this light.
+    AABB bounds = localAABB();
+    bounds.origin += worldOrigin();
+
+    return AABB(
+        bounds.origin,
+        Vector3(
+            static_cast<float>(fabs(m_rotation[0] * bounds.extents[0])
+                                + fabs(m_rotation[3] * bounds.extents[1])
+                                + fabs(m_rotation[6] * bounds.extents[2])),
+            static_cast<float>(fabs(m_rotation[1] * bounds.extents[0])
+                                + fabs(m_rotation[4] * bounds.extents[1])
+                                + fabs(m_rotation[7] * bounds.extents[2])),
+            static_cast<float>(fabs(m_rotation[2] * bounds.extents[0])
+                                + fabs(m_rotation[5] * bounds.extents[1])
+                                + fabs(m_rotation[8] * bounds.extents[2]))
+        )
+    );
+}
+
 bool Light::intersectsAABB(const AABB& other) const
 {
     bool returnVal;
 
     if (isProjected())
     {
-        // Update the projection, including the Frustum (we don't care about the
-        // projection matrix itself).
-        updateProjection();
-
-        // Construct a transformation with the rotation and translation of the
-        // frustum
-        Matrix4 transRot = Matrix4::getIdentity();
-        transRot.translateBy(worldOrigin());
-        transRot.multiplyBy(rotation());
+        // Test the intersection of the world space frustum with the AABB
+        Frustum frustum = getWorldFrustum();
+		VolumeIntersectionValue intersects = frustum.testIntersection(other);
 
-        // Transform the frustum with the rotate/translate matrix and test its
-        // intersection with the AABB
-		Frustum frustumTrans = _frustum.getTransformedBy(transRot);
+        // The planes are tested one by one, which accepts boxes next to the
+        // edges of the frustum. The corner bounds reject the ones beyond
+        // lightVolumeAABB(), which the renderer only looks for lit objects in.
+        AABB bounds = getProjectedBounds(frustum);
 
-		VolumeIntersectionValue intersects = frustumTrans.testIntersection(other);
-
-        returnVal = intersects != VOLUME_OUTSIDE;
+        returnVal = intersects != VOLUME_OUTSIDE &&
+                    (!bounds.isValid() || other.intersects(bounds));
     }
     else
     {
         // test against an AABB which contains the rotated bounds of this light.
-        AABB bounds = localAABB();
-        bounds.origin += worldOrigin();
-
-        returnVal = other.intersects(AABB(
-            bounds.origin,
-            Vector3(
-                static_cast<float>(fabs(m_rotation[0] * bounds.extents[0])
-                                    + fabs(m_rotation[3] * bounds.extents[1])
-                                    + fabs(m_rotation[6] * bounds.extents[2])),
-                static_cast<float>(fabs(m_rotation[1] * bounds.extents[0])
-                                    + fabs(m_rotation[4] * bounds.extents[1])
-                                    + fabs(m_rotation[7] * bounds.extents[2])),
-                static_cast<float>(fabs(m_rotation[2] * bounds.extents[0])
-                                    + fabs(m_rotation[5] * bounds.extents[1])
-                                    + fabs(m_rotation[8] * bounds.extents[2]))
-            )
-        ));
+        returnVal = other.intersects(getRotatedPointLightBounds());
     }
 
     return returnVal;
 }
 
+AABB Light::getProjectedBounds(const Frustum& frustum)
+{
+    AABB bounds = frustum.getBounds();
+
+    // A degenerate frustum has no bounds, the renderer treats the invalid AABB
+    // as unbounded
+    if (bounds.isValid())
+    {
+        // Leave some room for the rounding errors of the corner calculation
+        bounds.extendBy(Vector3(1, 1, 1));
+    }
+
+    return bounds;
+}
+
+AABB Light::lightVolumeAABB() const
+{
+    return isProjected() ? getProjectedBounds(getWorldFrustum()) : getRotatedPointLightBounds();
+}
+
 const Matrix4& Light::rotation() const {
     m_doom3Rotation = m_rotation.getMatrix4();
     return m_doom3Rotation;
@@ -152,6 +152,15 @@ private:
     // Update the bounds of the renderable radius box
 	void updateRenderableRadius() const;
 
+    // The frustum of a projected light in world space
+	Frustum getWorldFrustum() const;
+
+    // The world space AABB containing the rotated bounds of a point light
+	AABB getRotatedPointLightBounds() const;
+
+    // The bounds of the given projected light frustum, invalid if it has none
+	static AABB getProjectedBounds(const Frustum& frustum);
+
 public:
 
     const Vector3& getUntransformedOrigin() const;
@@ -257,6 +266,7 @@ public:
 
     Matrix4 getLightTextureTransformation() const;
   	bool intersectsAABB(const AABB& other) const;
+	AABB lightVolumeAABB() const;
 	const Matrix4& rotation() const;
 	Vector3 getLightOrigin() const;
 	const Vector3& colour() const;
@@ -27,7 +27,7 @@ in game descriptor";
 }
 
 FontManager::FontManager() :
-    _loader(std::bind(&FontManager::loadFonts, this)),
+    _loader("Fonts", std::bind(&FontManager::loadFonts, this), {}, decl::LoadPriority::Low),
 	_curLanguage("english")
 {}
 
@@ -47,6 +47,7 @@ const StringSet& FontManager::getDependencies() const
 		_dependencies.insert(MODULE_XMLREGISTRY);
 		_dependencies.insert(MODULE_GAMEMANAGER);
 		_dependencies.insert(MODULE_SHADERSYSTEM);
+		_dependencies.insert(MODULE_DECLLOADSCHEDULER);
 	}
 
 	return _dependencies;
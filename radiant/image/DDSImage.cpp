@@ -3,14 +3,43 @@
 #include "itextstream.h"
 #include "BasicTexture2D.h"
 
+#include <algorithm>
+
+namespace
+{
+	// Large mipmaps are decompressed in portions of about this many blocks
+	const int BLOCKS_PER_TASK = 4096;
+}
+
 TexturePtr DDSImage::bindTexture(const std::string& name) const
 {
     GLuint textureNum;
 
-    debug::assertNoGlErrors();
-
     // Allocate a new texture number and store it into the Texture structure
     glGenTextures(1, &textureNum);
+
+    if (!uploadTexture(textureNum))
+    {
+        rConsoleError() << "[DDSImage] Unable to bind texture '"
+                  << name << "'; unsupported texture format"
+                  << std::endl;
+
+        glDeleteTextures(1, &textureNum);
+        return TexturePtr();
+    }
+
+    // Create and return texture object
+    BasicTexture2DPtr texObj(new BasicTexture2D(textureNum, name));
+    texObj->setWidth(getWidth(0));
+    texObj->setHeight(getHeight(0));
+
+    return texObj;
+}
+
+bool DDSImage::uploadTexture(GLuint textureNum) const
+{
+    debug::assertNoGlErrors();
+
     glBindTexture(GL_TEXTURE_2D, textureNum);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
@@ -18,6 +47,15 @@ TexturePtr DDSImage::bindTexture(const std::string& name) const
 
     glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
 
+    // BC4 and BC5 are uploaded decompressed. As RGTC textures they would be
+    // sampled as red only, or as normals with a zero z component, while the
+    // decompressed images are grey, or have the z component reconstructed.
+    if (_pixelFormat == DDS_PF_ATI1 || _pixelFormat == DDS_PF_ATI2)
+    {
+        uploadDecompressedMipMaps();
+        return true;
+    }
+
     for (std::size_t i = 0; i < _mipMapInfo.size(); ++i)
     {
         const MipMapInfo& mipMap = _mipMapInfo[i];
@@ -36,11 +74,8 @@ TexturePtr DDSImage::bindTexture(const std::string& name) const
         // Handle unsupported format error
         if (glGetError() == GL_INVALID_ENUM)
         {
-            rConsoleError() << "[DDSImage] Unable to bind texture '"
-                      << name << "'; unsupported texture format"
-                      << std::endl;
-
-            return TexturePtr();
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return false;
         }
 
         debug::assertNoGlErrors();
@@ -51,14 +86,37 @@ TexturePtr DDSImage::bindTexture(const std::string& name) const
     // Un-bind the texture
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    // Create and return texture object
-    BasicTexture2DPtr texObj(new BasicTexture2D(textureNum, name));
-    texObj->setWidth(getWidth(0));
-    texObj->setHeight(getHeight(0));
-
     debug::assertNoGlErrors();
 
-    return texObj;
+    return true;
+}
+
+void DDSImage::uploadDecompressedMipMaps() const
+{
+    for (std::size_t i = 0; i < _mipMapInfo.size(); ++i)
+    {
+        ImagePtr mipMap = getDecompressedMipMap(i);
+
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            static_cast<GLint>(i),
+            GL_RGBA8,
+            static_cast<GLsizei>(mipMap->getWidth(0)),
+            static_cast<GLsizei>(mipMap->getHeight(0)),
+            0,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            mipMap->getMipMapPixels(0)
+        );
+
+        debug::assertNoGlErrors();
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(_mipMapInfo.size() - 1));
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    debug::assertNoGlErrors();
 }
 
 void DDSImage::addMipMap(std::size_t mipWidth,
@@ -76,3 +134,46 @@ void DDSImage::addMipMap(std::size_t mipWidth,
     _mipMapInfo.push_back(info);
 }
 
+ImagePtr DDSImage::getDecompressedMipMap(std::size_t mipMapIndex) const
+{
+    assert(mipMapIndex < _mipMapInfo.size());
+
+    if (DDSGetBlockBytes(_pixelFormat) == 0 && _pixelFormat != DDS_PF_ARGB8888)
+    {
+        return ImagePtr();
+    }
+
+    const MipMapInfo& mipMap = _mipMapInfo[mipMapIndex];
+
+    RGBAImagePtr image = std::make_shared<RGBAImage>(mipMap.width, mipMap.height);
+
+    ddsPF_t pixelFormat = _pixelFormat;
+    const byte* blocks = _pixelData + mipMap.offset;
+    byte* pixels = image->getMipMapPixels(0);
+
+    int width = static_cast<int>(mipMap.width);
+    int height = static_cast<int>(mipMap.height);
+    int numRows = (height + 3) / 4;
+    int rowsPerTask = std::max(BLOCKS_PER_TASK / std::max((width + 3) / 4, 1), 1);
+
+    if (!_subTaskRunner || numRows <= rowsPerTask)
+    {
+        DDSDecompressBlockRows(pixelFormat, blocks, width, height, 0, numRows, pixels);
+        return image;
+    }
+
+    // The tasks write to distinct rows of the image
+    std::vector<std::function<void()>> tasks;
+
+    for (int row = 0; row < numRows; row += rowsPerTask)
+    {
+        tasks.push_back([=]()
+        {
+            DDSDecompressBlockRows(pixelFormat, blocks, width, height, row, rowsPerTask, pixels);
+        });
+    }
+
+    _subTaskRunner(tasks);
+
+    return image;
+}
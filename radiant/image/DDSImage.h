@@ -1,8 +1,10 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 #include "igl.h"
 
+#include "ddslib.h"
 #include "RGBAImage.h"
 #include "util/Noncopyable.h"
 
@@ -30,6 +32,9 @@ public:
 	};
 	typedef std::vector<MipMapInfo> MipMapInfoList;
 
+	// Runs the given tasks in parallel, returning once all of them are done
+	typedef std::function<void(const std::vector<std::function<void()>>&)> SubTaskRunner;
+
 private:
 	// The actual pixels
 	byte* _pixelData;
@@ -40,8 +45,13 @@ private:
 	// The compression format ID
 	GLuint _format;
 
+	// The format of the blocks, used to decompress them
+	ddsPF_t _pixelFormat;
+
 	MipMapInfoList _mipMapInfo;
 
+	SubTaskRunner _subTaskRunner;
+
 public:
 	RGBAPixel* pixels;
 	unsigned int width, height;
@@ -49,7 +59,9 @@ public:
 	// Pass the required memory size to the constructor
 	DDSImage(std::size_t size) :
 		_pixelData(NULL),
-		_memSize(size)
+		_memSize(size),
+		_format(0),
+		_pixelFormat(DDS_PF_UNKNOWN)
 	{
 		allocateMemory();
 	}
@@ -63,6 +75,18 @@ public:
 		_format = format;
 	}
 
+	void setPixelFormat(ddsPF_t pixelFormat)
+	{
+		_pixelFormat = pixelFormat;
+	}
+
+	// Set the function decompressing large mipmaps in parallel, which are
+	// split into portions of a few block rows
+	void setSubTaskRunner(const SubTaskRunner& runner)
+	{
+		_subTaskRunner = runner;
+	}
+
 	/**
 	 * greebo: Declares a new mip map to be added to the internal
 	 * structure.
@@ -119,8 +143,20 @@ public:
     /* BindableTexture implementation */
 	TexturePtr bindTexture(const std::string& name) const;
 
+	bool uploadTexture(GLuint textureNum) const;
+
 	bool isPrecompressed() const {
 		return true;
 	}
+
+	std::size_t getMipMapCount() const {
+		return _mipMapInfo.size();
+	}
+
+	ImagePtr getDecompressedMipMap(std::size_t mipMapIndex) const;
+
+private:
+	// Uploads all mipmaps decompressed to the texture bound by uploadTexture()
+	void uploadDecompressedMipMaps() const;
 };
 typedef std::shared_ptr<DDSImage> DDSImagePtr;
@@ -1,14 +1,15 @@
 #include "Doom3ImageLoader.h"
 #include "ImageLoaderWx.h"
 #include "TGALoader.h"
-#include "dds.h"
 
 #include "ifilesystem.h"
 #include "iarchive.h"
 #include "iregistry.h"
 #include "igame.h"
+#include "ideclloadscheduler.h"
 
 #include "string/case_conv.h"
+#include <mutex>
 
 #include "os/path.h"
 #include "DirectoryArchiveFile.h"
@@ -27,6 +28,10 @@ ImageTypeLoader::Extensions getGameFileImageExtensions()
 {
 	static ImageTypeLoader::Extensions _extensions;
 
+	// Images are loaded by the texture decoders too
+	static std::mutex _extensionsMutex;
+	std::lock_guard<std::mutex> lock(_extensionsMutex);
+
 	if (_extensions.empty())
 	{
 		// Load the texture types from the .game file
@@ -66,7 +71,8 @@ Doom3ImageLoader::Doom3ImageLoader()
     addLoaderToMap(std::make_shared<TGALoader>());
 
     // DDS loader
-    addLoaderToMap(std::make_shared<DDSLoader>());
+    _ddsLoader = std::make_shared<DDSLoader>();
+    addLoaderToMap(_ddsLoader);
 }
 
 // Load image from VFS
@@ -106,6 +112,29 @@ ImagePtr Doom3ImageLoader::imageFromVFS(const std::string& name) const
 	return ImagePtr();
 }
 
+bool Doom3ImageLoader::getImageStamp(const std::string& name, vfs::FileStamp& stamp) const
+{
+	// Same search order as imageFromVFS()
+	const ImageTypeLoader::Extensions exts = getGameFileImageExtensions();
+	for (auto i = exts.begin(); i != exts.end(); ++i)
+	{
+        auto loaderIter = _loadersByExtension.find(*i);
+        if (loaderIter == _loadersByExtension.end())
+        {
+            continue;
+        }
+
+		std::string fullName = loaderIter->second->getPrefix() + name + "." + *i;
+
+		if (GlobalFileSystem().getFileStamp(fullName, stamp))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 ImagePtr Doom3ImageLoader::imageFromFile(const std::string& filename) const
 {
     ImagePtr image;
@@ -143,10 +172,23 @@ const std::string& Doom3ImageLoader::getName() const
 
 const StringSet& Doom3ImageLoader::getDependencies() const
 {
-    static StringSet _dependencies; // no dependencies
+    static StringSet _dependencies;
+
+    if (_dependencies.empty())
+    {
+        _dependencies.insert(MODULE_DECLLOADSCHEDULER);
+    }
+
     return _dependencies;
 }
 
+void Doom3ImageLoader::initialiseModule(const ApplicationContext& ctx)
+{
+    // Large DDS mipmaps are decompressed by the worker threads
+    _ddsLoader->setSubTaskRunner(std::bind(&decl::ILoadScheduler::runSubTasks,
+                                           &GlobalDeclLoadScheduler(), std::placeholders::_1));
+}
+
 // Static module instance
 module::StaticModule<Doom3ImageLoader> doom3ImageLoaderModule;
 
@@ -2,6 +2,7 @@
 
 #include "iimage.h"
 #include "ImageTypeLoader.h"
+#include "dds.h"
 
 #include <map>
 
@@ -16,6 +17,9 @@ class Doom3ImageLoader: public ImageLoader
     typedef std::map<std::string, ImageTypeLoader::Ptr> LoadersByExtension;
     LoadersByExtension _loadersByExtension;
 
+    // Receives the sub-task runner once the modules are initialised
+    std::shared_ptr<DDSLoader> _ddsLoader;
+
 private:
     void addLoaderToMap(ImageTypeLoader::Ptr loader);
 
@@ -27,11 +31,12 @@ public:
     // ImageLoader implementation
     ImagePtr imageFromVFS(const std::string& vfsPath) const;
 	ImagePtr imageFromFile(const std::string& filename) const;
+    bool getImageStamp(const std::string& vfsPath, vfs::FileStamp& stamp) const;
 
     // RegisterableModule implementation
     const std::string& getName() const;
     const StringSet& getDependencies() const;
-    void initialiseModule(const ApplicationContext&) { }
+    void initialiseModule(const ApplicationContext& ctx);
 };
 
 }
@@ -34,7 +34,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 namespace image
 {
 
-DDSImagePtr LoadDDSFromStream(InputStream& stream)
+DDSImagePtr LoadDDSFromStream(InputStream& stream, const DDSImage::SubTaskRunner& subTaskRunner)
 {
 	int width(0), height(0);
 	ddsPF_t pixelFormat;
@@ -55,7 +55,7 @@ DDSImagePtr LoadDDSFromStream(InputStream& stream)
 	mipMapInfo.resize(mipMapCount);
 
 	// Calculate the total memory requirements (greebo: DXT1 has 8 bytes per block)
-	std::size_t blockBytes = (pixelFormat == DDS_PF_DXT1) ? 8 : 16;
+	std::size_t blockBytes = DDSGetBlockBytes(pixelFormat);
 
 	std::size_t size = 0;
 	std::size_t offset = 0;
@@ -67,7 +67,12 @@ DDSImagePtr LoadDDSFromStream(InputStream& stream)
 		mipMap.offset = offset;
 		mipMap.width = width;
 		mipMap.height = height;
-		mipMap.size = std::max( width, 4 ) / 4 * std::max( height, 4 ) / 4 * blockBytes;
+
+		// Partial blocks at the right and bottom count as whole ones
+		if (pixelFormat == DDS_PF_ARGB8888)
+			mipMap.size = width * height * 4;
+		else
+			mipMap.size = (width + 3) / 4 * ((height + 3) / 4) * blockBytes;
 
 		// Update the offset for the next mipmap
 		offset += mipMap.size;
@@ -82,6 +87,7 @@ DDSImagePtr LoadDDSFromStream(InputStream& stream)
 
 	// Allocate a new DDS image with that size
 	DDSImagePtr image(new DDSImage(size));
+	image->setSubTaskRunner(subTaskRunner);
 
 	// Set the format of this DDS image
 	switch (pixelFormat)
@@ -95,10 +101,14 @@ DDSImagePtr LoadDDSFromStream(InputStream& stream)
 		case DDS_PF_DXT5:
 			image->setFormat(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
 			break;
+		// ATI1 and ATI2 are uploaded decompressed, see DDSImage::uploadTexture()
 		default:
 			break;
 	};
 
+	// Keep the block format, for decompressing the mipmaps on demand
+	image->setPixelFormat(pixelFormat);
+
 	// Load the mipmaps into the allocated memory
 	for (std::size_t i = 0; i < mipMapInfo.size(); ++i) {
 		const DDSImage::MipMapInfo& mipMap = mipMapInfo[i];
@@ -114,14 +124,19 @@ DDSImagePtr LoadDDSFromStream(InputStream& stream)
 	return image;
 }
 
-ImagePtr LoadDDS(ArchiveFile& file) {
-	return LoadDDSFromStream(file.getInputStream());
+ImagePtr LoadDDS(ArchiveFile& file, const DDSImage::SubTaskRunner& subTaskRunner) {
+	return LoadDDSFromStream(file.getInputStream(), subTaskRunner);
 }
 
 ImagePtr DDSLoader::load(ArchiveFile& file) const
 {
     // Pass the call to the according load function
-    return LoadDDS(file);
+    return LoadDDS(file, _subTaskRunner);
+}
+
+void DDSLoader::setSubTaskRunner(const DDSImage::SubTaskRunner& runner)
+{
+    _subTaskRunner = runner;
 }
 
 ImageTypeLoader::Extensions DDSLoader::getExtensions() const
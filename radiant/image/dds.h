@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ImageTypeLoader.h"
+#include "DDSImage.h"
 
 namespace image
 {
@@ -8,6 +9,8 @@ namespace image
 /// ImageTypeLoader implementation for DDS files
 class DDSLoader : public ImageTypeLoader
 {
+	DDSImage::SubTaskRunner _subTaskRunner;
+
 public:
 
     // ImageTypeLoader implementation
@@ -21,6 +24,10 @@ public:
 	std::string getPrefix() const {
 		return "dds/";
 	}
+
+	// Set the function the loaded images use to decompress large mipmaps
+	// in parallel
+	void setSubTaskRunner(const DDSImage::SubTaskRunner& runner);
 };
 
 }
@@ -45,6 +45,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /* dependencies */
 #include "ddslib.h"
 
+#include <math.h>
+
 #if !defined(_MSC_VER)
 #include <stdint.h> // greebo: This isn't needed in VC++ 2005
 #endif
@@ -170,6 +172,12 @@ static void DDSDecodePixelFormat( const DDSHeader* header, ddsPF_t *pf ) {
 		*pf = DDS_PF_DXT5;
 	else if (fourCC[0] == 'R' && fourCC[1] == 'X' && fourCC[2] == 'G' && fourCC[3] == 'B')
 		*pf = DDS_PF_DXT5_RXGB;
+	else if ((fourCC[0] == 'A' && fourCC[1] == 'T' && fourCC[2] == 'I' && fourCC[3] == '1') ||
+			 (fourCC[0] == 'B' && fourCC[1] == 'C' && fourCC[2] == '4' && fourCC[3] == 'U'))
+		*pf = DDS_PF_ATI1;
+	else if ((fourCC[0] == 'A' && fourCC[1] == 'T' && fourCC[2] == 'I' && fourCC[3] == '2') ||
+			 (fourCC[0] == 'B' && fourCC[1] == 'C' && fourCC[2] == '5' && fourCC[3] == 'U'))
+		*pf = DDS_PF_ATI2;
 	else
 		*pf = DDS_PF_UNKNOWN;
 }
@@ -206,616 +214,404 @@ int DDSGetInfo(const DDSHeader* header, int *width, int *height, ddsPF_t *pf ) {
 }
 
 /*
-DDSGetColorBlockColors()
-extracts colors from a dds color block
+DDSGetBlockBytes()
+returns the number of bytes of a 4x4 block of the given format, 0 if the format isn't block compressed
 */
 
-static void DDSGetColorBlockColors( ddsColorBlock_t *block, ddsColor_t colors[ 4 ] ) {
-	unsigned short		word;
-
-
-	/* color 0 */
-	word = DDSLittleShort( block->colors[ 0 ] );
-	colors[ 0 ].a = 0xff;
-
-	/* extract rgb bits */
-	colors[ 0 ].b = (unsigned char) word;
-	colors[ 0 ].b <<= 3;
-	colors[ 0 ].b |= (colors[ 0 ].b >> 5);
-	word >>= 5;
-	colors[ 0 ].g = (unsigned char) word;
-	colors[ 0 ].g <<= 2;
-	colors[ 0 ].g |= (colors[ 0 ].g >> 6);
-	word >>= 6;
-	colors[ 0 ].r = (unsigned char) word;
-	colors[ 0 ].r <<= 3;
-	colors[ 0 ].r |= (colors[ 0 ].r >> 5);
-
-	/* same for color 1 */
-	word = DDSLittleShort( block->colors[ 1 ] );
-	colors[ 1 ].a = 0xff;
-
-	/* extract rgb bits */
-	colors[ 1 ].b = (unsigned char) word;
-	colors[ 1 ].b <<= 3;
-	colors[ 1 ].b |= (colors[ 1 ].b >> 5);
-	word >>= 5;
-	colors[ 1 ].g = (unsigned char) word;
-	colors[ 1 ].g <<= 2;
-	colors[ 1 ].g |= (colors[ 1 ].g >> 6);
-	word >>= 6;
-	colors[ 1 ].r = (unsigned char) word;
-	colors[ 1 ].r <<= 3;
-	colors[ 1 ].r |= (colors[ 1 ].r >> 5);
-
-	/* use this for all but the super-freak math method */
-	if( block->colors[ 0 ] > block->colors[ 1 ] ) {
-		/* four-color block: derive the other two colors.
-		   00 = color 0, 01 = color 1, 10 = color 2, 11 = color 3
-		   these two bit codes correspond to the 2-bit fields
-		   stored in the 64-bit block. */
-
-		word = ((unsigned short) colors[ 0 ].r * 2 + (unsigned short) colors[ 1 ].r ) / 3;
-		/* no +1 for rounding */
-		/* as bits have been shifted to 888 */
-		colors[ 2 ].r = (unsigned char) word;
-		word = ((unsigned short) colors[ 0 ].g * 2 + (unsigned short) colors[ 1 ].g) / 3;
-		colors[ 2 ].g = (unsigned char) word;
-		word = ((unsigned short) colors[ 0 ].b * 2 + (unsigned short) colors[ 1 ].b) / 3;
-		colors[ 2 ].b = (unsigned char) word;
-		colors[ 2 ].a = 0xff;
-
-		word = ((unsigned short) colors[ 0 ].r + (unsigned short) colors[ 1 ].r * 2) / 3;
-		colors[ 3 ].r = (unsigned char) word;
-		word = ((unsigned short) colors[ 0 ].g + (unsigned short) colors[ 1 ].g * 2) / 3;
-		colors[ 3 ].g = (unsigned char) word;
-		word = ((unsigned short) colors[ 0 ].b + (unsigned short) colors[ 1 ].b * 2) / 3;
-		colors[ 3 ].b = (unsigned char) word;
-		colors[ 3 ].a = 0xff;
-	}
-	else {
-		/* three-color block: derive the other color.
-		   00 = color 0, 01 = color 1, 10 = color 2,
-		   11 = transparent.
-		   These two bit codes correspond to the 2-bit fields
-		   stored in the 64-bit block */
-
-		word = ((unsigned short) colors[ 0 ].r + (unsigned short) colors[ 1 ].r) / 2;
-		colors[ 2 ].r = (unsigned char) word;
-		word = ((unsigned short) colors[ 0 ].g + (unsigned short) colors[ 1 ].g) / 2;
-		colors[ 2 ].g = (unsigned char) word;
-		word = ((unsigned short) colors[ 0 ].b + (unsigned short) colors[ 1 ].b) / 2;
-		colors[ 2 ].b = (unsigned char) word;
-		colors[ 2 ].a = 0xff;
+int DDSGetBlockBytes( ddsPF_t pf ) {
+	switch( pf ) {
+		case DDS_PF_DXT1:
+		case DDS_PF_ATI1:
+			return 8;
 
-		/* random color to indicate alpha */
-		colors[ 3 ].r = 0x00;
-		colors[ 3 ].g = 0xff;
-		colors[ 3 ].b = 0xff;
-		colors[ 3 ].a = 0x00;
+		case DDS_PF_DXT2:
+		case DDS_PF_DXT3:
+		case DDS_PF_DXT4:
+		case DDS_PF_DXT5:
+		case DDS_PF_DXT5_RXGB:
+		case DDS_PF_ATI2:
+			return 16;
+
+		default:
+			return 0;
 	}
 }
 
 
 
 /*
-DDSDecodeColorBlock()
-decodes a dds color block
-fixme: make endian-safe
+DDSPackColor()
+packs a color into an unsigned int, the bytes are r, g, b, a in memory regardless of the endianness
 */
 
-static void DDSDecodeColorBlock( unsigned int *pixel, ddsColorBlock_t *block, int width, unsigned int colors[ 4 ] ) {
-	int				r, n;
-	unsigned int	bits;
-	unsigned int	masks[] = { 3, 12, 3 << 4, 3 << 6 };	/* bit masks = 00000011, 00001100, 00110000, 11000000 */
-	int				shift[] = { 0, 2, 4, 6 };
-
-	/* r steps through lines in y */
-	for( r = 0; r < 4; r++, pixel += (width - 4) )	/* no width * 4 as unsigned int ptr inc will * 4 */
-	{
-		/* width * 4 bytes per pixel per line, each j dxtc row is 4 lines of pixels */
-
-		/* n steps through pixels */
-		for( n = 0; n < 4; n++ ) {
-			bits = block->row[ r ] & masks[ n ];
-			bits >>= shift[ n ];
-			*pixel = colors[bits];
-			pixel++;
-		}
-	}
+static unsigned int DDSPackColor( unsigned char r, unsigned char g, unsigned char b, unsigned char a ) {
+	ddsColor_t		color;
+	unsigned int	packed;
+
+
+	color.r = r;
+	color.g = g;
+	color.b = b;
+	color.a = a;
+	memcpy( &packed, &color, sizeof( packed ) );
+
+	return packed;
 }
 
 
 
 /*
-DDSDecodeAlphaExplicit()
-decodes a dds explicit alpha block
+DDSGetColorBlockColors()
+extracts colors from a dds color block, the block is read byte by byte to stay endian-safe
 */
 
-static void DDSDecodeAlphaExplicit( unsigned int *pixel, ddsAlphaBlockExplicit_t *alphaBlock, int width, unsigned int alphaZero ) {
-	int				row, pix;
-	unsigned short	word;
-	ddsColor_t		color;
+static void DDSGetColorBlockColors( const unsigned char *block, unsigned int colors[ 4 ] ) {
+	unsigned int	word[ 2 ], bits;
+	unsigned char	r[ 2 ], g[ 2 ], b[ 2 ];
+	int				i;
 
 
-	/* clear color */
-	color.r = 0;
-	color.g = 0;
-	color.b = 0;
+	word[ 0 ] = block[ 0 ] | (block[ 1 ] << 8);
+	word[ 1 ] = block[ 2 ] | (block[ 3 ] << 8);
 
-	/* walk rows */
-	for( row = 0; row < 4; row++, pixel += (width - 4) ) {
-		word = DDSLittleShort( alphaBlock->row[ row ] );
+	/* expand the 565 bits to 888 */
+	for( i = 0; i < 2; i++ ) {
+		bits = word[ i ] >> 11;
+		r[ i ] = (unsigned char) ((bits << 3) | (bits >> 2));
+		bits = (word[ i ] >> 5) & 0x3F;
+		g[ i ] = (unsigned char) ((bits << 2) | (bits >> 4));
+		bits = word[ i ] & 0x1F;
+		b[ i ] = (unsigned char) ((bits << 3) | (bits >> 2));
 
-		/* walk pixels */
-		for( pix = 0; pix < 4; pix++ ) {
-			/* zero the alpha bits of image pixel */
-			*pixel &= alphaZero;
-			color.a = word & 0x000F;
-			color.a = color.a | (color.a << 4);
-			*pixel |= *((unsigned int*) &color);
-			word >>= 4;		/* move next bits to lowest 4 */
-			pixel++;		/* move to next pixel in the row */
+		colors[ i ] = DDSPackColor( r[ i ], g[ i ], b[ i ], 0xff );
+	}
 
-		}
+	if( word[ 0 ] > word[ 1 ] ) {
+		/* four-color block: derive the other two colors.
+		   00 = color 0, 01 = color 1, 10 = color 2, 11 = color 3
+		   no +1 for rounding as bits have been shifted to 888 */
+		colors[ 2 ] = DDSPackColor( (r[ 0 ] * 2 + r[ 1 ]) / 3, (g[ 0 ] * 2 + g[ 1 ]) / 3, (b[ 0 ] * 2 + b[ 1 ]) / 3, 0xff );
+		colors[ 3 ] = DDSPackColor( (r[ 0 ] + r[ 1 ] * 2) / 3, (g[ 0 ] + g[ 1 ] * 2) / 3, (b[ 0 ] + b[ 1 ] * 2) / 3, 0xff );
+	}
+	else {
+		/* three-color block: derive the other color.
+		   00 = color 0, 01 = color 1, 10 = color 2, 11 = transparent */
+		colors[ 2 ] = DDSPackColor( (r[ 0 ] + r[ 1 ]) / 2, (g[ 0 ] + g[ 1 ]) / 2, (b[ 0 ] + b[ 1 ]) / 2, 0xff );
+
+		/* random color to indicate alpha */
+		colors[ 3 ] = DDSPackColor( 0x00, 0xff, 0xff, 0x00 );
 	}
 }
 
 
 
 /*
-DDSDecodeAlpha3BitLinear()
-decodes interpolated alpha block
+DDSDecodeColorBlock()
+decodes a dds color block into 4x4 pixels, pitch is the number of pixels per line. the channels
+outside of mask are replaced by the ones of the given 16 pixels (the alpha of dxt3 and dxt5)
 */
 
-static void DDSDecodeAlpha3BitLinear( unsigned int *pixel, ddsAlphaBlock3BitLinear_t *alphaBlock, int width, unsigned int alphaZero ) {
-
-	int					row, pix;
-	unsigned int		stuff;
-	unsigned char		bits[ 4 ][ 4 ];
-	unsigned short		alphas[ 8 ];
-	ddsColor_t			aColors[ 4 ][ 4 ];
+static void DDSDecodeColorBlock( unsigned int *pixel, int pitch, const unsigned char *block,
+								 const unsigned int merge[ 16 ], unsigned int mask ) {
+	unsigned int	colors[ 4 ];
+	unsigned int	bits;
+	int				row, pix;
 
 
-	/* get initial alphas */
-	alphas[ 0 ] = alphaBlock->alpha0;
-	alphas[ 1 ] = alphaBlock->alpha1;
+	DDSGetColorBlockColors( block, colors );
 
-	/* 8-alpha block */
-	if( alphas[ 0 ] > alphas[ 1 ] ) {
-		/* 000 = alpha_0, 001 = alpha_1, others are interpolated */
-		alphas[ 2 ] = ( 6 * alphas[ 0 ] +     alphas[ 1 ]) / 7;	/* bit code 010 */
-		alphas[ 3 ] = ( 5 * alphas[ 0 ] + 2 * alphas[ 1 ]) / 7;	/* bit code 011 */
-		alphas[ 4 ] = ( 4 * alphas[ 0 ] + 3 * alphas[ 1 ]) / 7;	/* bit code 100 */
-		alphas[ 5 ] = ( 3 * alphas[ 0 ] + 4 * alphas[ 1 ]) / 7;	/* bit code 101 */
-		alphas[ 6 ] = ( 2 * alphas[ 0 ] + 5 * alphas[ 1 ]) / 7;	/* bit code 110 */
-		alphas[ 7 ] = (     alphas[ 0 ] + 6 * alphas[ 1 ]) / 7;	/* bit code 111 */
+	if( merge == NULL ) {
+		/* 2 bit color indices of a line in each byte, the first pixel in the lowest bits */
+		for( row = 0; row < 4; row++, pixel += pitch ) {
+			bits = block[ 4 + row ];
+			pixel[ 0 ] = colors[ bits & 3 ];
+			pixel[ 1 ] = colors[ (bits >> 2) & 3 ];
+			pixel[ 2 ] = colors[ (bits >> 4) & 3 ];
+			pixel[ 3 ] = colors[ bits >> 6 ];
+		}
+		return;
 	}
 
-	/* 6-alpha block */
-	else {
-		/* 000 = alpha_0, 001 = alpha_1, others are interpolated */
-		alphas[ 2 ] = (4 * alphas[ 0 ] +     alphas[ 1 ]) / 5;	/* bit code 010 */
-		alphas[ 3 ] = (3 * alphas[ 0 ] + 2 * alphas[ 1 ]) / 5;	/* bit code 011 */
-		alphas[ 4 ] = (2 * alphas[ 0 ] + 3 * alphas[ 1 ]) / 5;	/* bit code 100 */
-		alphas[ 5 ] = (    alphas[ 0 ] + 4 * alphas[ 1 ]) / 5;	/* bit code 101 */
-		alphas[ 6 ] = 0;										/* bit code 110 */
-		alphas[ 7 ] = 255;										/* bit code 111 */
-	}
+	for( pix = 0; pix < 4; pix++ )
+		colors[ pix ] &= mask;
 
-	/* decode 3-bit fields into array of 16 bytes with same value */
-
-	/* first two rows of 4 pixels each */
-	stuff = *((unsigned int*) &(alphaBlock->stuff[ 0 ]));
-
-	bits[ 0 ][ 0 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 0 ][ 1 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 0 ][ 2 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 0 ][ 3 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 1 ][ 0 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 1 ][ 1 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 1 ][ 2 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 1 ][ 3 ] = (unsigned char) (stuff & 0x00000007);
-
-	/* last two rows */
-	stuff = *((unsigned int*) &(alphaBlock->stuff[ 3 ])); /* last 3 bytes */
-
-	bits[ 2 ][ 0 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 2 ][ 1 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 2 ][ 2 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 2 ][ 3 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 3 ][ 0 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 3 ][ 1 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 3 ][ 2 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 3 ][ 3 ] = (unsigned char) (stuff & 0x00000007);
-
-	/* decode the codes into alpha values */
-	for( row = 0; row < 4; row++ ) {
-		for( pix=0; pix < 4; pix++ ) {
-			aColors[ row ][ pix ].r = 0;
-			aColors[ row ][ pix ].g = 0;
-			aColors[ row ][ pix ].b = 0;
-			aColors[ row ][ pix ].a = (unsigned char) alphas[ bits[ row ][ pix ] ];
-		}
+	for( row = 0; row < 4; row++, pixel += pitch, merge += 4 ) {
+		bits = block[ 4 + row ];
+		pixel[ 0 ] = colors[ bits & 3 ] | merge[ 0 ];
+		pixel[ 1 ] = colors[ (bits >> 2) & 3 ] | merge[ 1 ];
+		pixel[ 2 ] = colors[ (bits >> 4) & 3 ] | merge[ 2 ];
+		pixel[ 3 ] = colors[ bits >> 6 ] | merge[ 3 ];
 	}
+}
 
-	/* write out alpha values to the image bits */
-	for( row = 0; row < 4; row++, pixel += width-4 ) {
-		for( pix = 0; pix < 4; pix++ ) {
-			/* zero the alpha bits of image pixel */
-			*pixel &= alphaZero;
 
-			/* or the bits into the prev. nulled alpha */
-			*pixel |= *((unsigned int*) &(aColors[ row ][ pix ]));
-			pixel++;
-		}
+
+/*
+DDSDecodeAlphaExplicit()
+decodes a dds explicit alpha block into 16 pixels holding nothing but the alpha
+*/
+
+static void DDSDecodeAlphaExplicit( unsigned int alphas[ 16 ], const unsigned char *block ) {
+	unsigned char	alpha;
+	int				i;
+
+
+	/* 4 bit alphas, the first pixel in the lower half of the first byte */
+	for( i = 0; i < 16; i++ ) {
+		alpha = (block[ i >> 1 ] >> ((i & 1) << 2)) & 0x0F;
+		alphas[ i ] = DDSPackColor( 0, 0, 0, alpha | (alpha << 4) );
 	}
 }
 
-/** greebo: Decodes the alpha channel into the red channel for RXGB-encoded images
- */
-static void DDSDecodeRXGBAlpha3BitLinear( unsigned int *pixel, ddsAlphaBlock3BitLinear_t *alphaBlock, int width, unsigned int redZero ) {
 
-	int					row, pix;
-	unsigned int		stuff;
-	unsigned char		bits[ 4 ][ 4 ];
-	unsigned short		alphas[ 8 ];
-	ddsColor_t			aColors[ 4 ][ 4 ];
+
+/*
+DDSDecode3BitLinear()
+decodes an interpolated alpha block (dxt5 alpha, bc4 and bc5 channels) into 16 values
+*/
+
+static void DDSDecode3BitLinear( unsigned char values[ 16 ], const unsigned char *block ) {
+	unsigned char	alphas[ 8 ];
+	unsigned int	a0, a1;
+	unsigned int	bits;
+	int				i;
 
 
 	/* get initial alphas */
-	alphas[ 0 ] = alphaBlock->alpha0;
-	alphas[ 1 ] = alphaBlock->alpha1;
+	a0 = alphas[ 0 ] = block[ 0 ];
+	a1 = alphas[ 1 ] = block[ 1 ];
 
 	/* 8-alpha block */
-	if( alphas[ 0 ] > alphas[ 1 ] ) {
+	if( a0 > a1 ) {
 		/* 000 = alpha_0, 001 = alpha_1, others are interpolated */
-		alphas[ 2 ] = ( 6 * alphas[ 0 ] +     alphas[ 1 ]) / 7;	/* bit code 010 */
-		alphas[ 3 ] = ( 5 * alphas[ 0 ] + 2 * alphas[ 1 ]) / 7;	/* bit code 011 */
-		alphas[ 4 ] = ( 4 * alphas[ 0 ] + 3 * alphas[ 1 ]) / 7;	/* bit code 100 */
-		alphas[ 5 ] = ( 3 * alphas[ 0 ] + 4 * alphas[ 1 ]) / 7;	/* bit code 101 */
-		alphas[ 6 ] = ( 2 * alphas[ 0 ] + 5 * alphas[ 1 ]) / 7;	/* bit code 110 */
-		alphas[ 7 ] = (     alphas[ 0 ] + 6 * alphas[ 1 ]) / 7;	/* bit code 111 */
+		alphas[ 2 ] = (unsigned char) (( 6 * a0 +     a1) / 7);	/* bit code 010 */
+		alphas[ 3 ] = (unsigned char) (( 5 * a0 + 2 * a1) / 7);	/* bit code 011 */
+		alphas[ 4 ] = (unsigned char) (( 4 * a0 + 3 * a1) / 7);	/* bit code 100 */
+		alphas[ 5 ] = (unsigned char) (( 3 * a0 + 4 * a1) / 7);	/* bit code 101 */
+		alphas[ 6 ] = (unsigned char) (( 2 * a0 + 5 * a1) / 7);	/* bit code 110 */
+		alphas[ 7 ] = (unsigned char) ((     a0 + 6 * a1) / 7);	/* bit code 111 */
 	}
 
 	/* 6-alpha block */
 	else {
 		/* 000 = alpha_0, 001 = alpha_1, others are interpolated */
-		alphas[ 2 ] = (4 * alphas[ 0 ] +     alphas[ 1 ]) / 5;	/* bit code 010 */
-		alphas[ 3 ] = (3 * alphas[ 0 ] + 2 * alphas[ 1 ]) / 5;	/* bit code 011 */
-		alphas[ 4 ] = (2 * alphas[ 0 ] + 3 * alphas[ 1 ]) / 5;	/* bit code 100 */
-		alphas[ 5 ] = (    alphas[ 0 ] + 4 * alphas[ 1 ]) / 5;	/* bit code 101 */
+		alphas[ 2 ] = (unsigned char) ((4 * a0 +     a1) / 5);	/* bit code 010 */
+		alphas[ 3 ] = (unsigned char) ((3 * a0 + 2 * a1) / 5);	/* bit code 011 */
+		alphas[ 4 ] = (unsigned char) ((2 * a0 + 3 * a1) / 5);	/* bit code 100 */
+		alphas[ 5 ] = (unsigned char) ((    a0 + 4 * a1) / 5);	/* bit code 101 */
 		alphas[ 6 ] = 0;										/* bit code 110 */
 		alphas[ 7 ] = 255;										/* bit code 111 */
 	}
 
-	/* decode 3-bit fields into array of 16 bytes with same value */
-
-	/* first two rows of 4 pixels each */
-	stuff = *((unsigned int*) &(alphaBlock->stuff[ 0 ]));
-
-	bits[ 0 ][ 0 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 0 ][ 1 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 0 ][ 2 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 0 ][ 3 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 1 ][ 0 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 1 ][ 1 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 1 ][ 2 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 1 ][ 3 ] = (unsigned char) (stuff & 0x00000007);
-
-	/* last two rows */
-	stuff = *((unsigned int*) &(alphaBlock->stuff[ 3 ])); /* last 3 bytes */
-
-	bits[ 2 ][ 0 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 2 ][ 1 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 2 ][ 2 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 2 ][ 3 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 3 ][ 0 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 3 ][ 1 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 3 ][ 2 ] = (unsigned char) (stuff & 0x00000007);
-	stuff >>= 3;
-	bits[ 3 ][ 3 ] = (unsigned char) (stuff & 0x00000007);
-
-	/* decode the codes into red values */
-	for( row = 0; row < 4; row++ ) {
-		for( pix=0; pix < 4; pix++ ) {
-			aColors[ row ][ pix ].a = 0;
-			aColors[ row ][ pix ].g = 0;
-			aColors[ row ][ pix ].b = 0;
-			aColors[ row ][ pix ].r = (unsigned char) alphas[ bits[ row ][ pix ] ];
-		}
-	}
+	/* 3 bit codes of two rows in each of the 24 bit halves */
+	bits = block[ 2 ] | (block[ 3 ] << 8) | (block[ 4 ] << 16);
 
-	/* write out alpha values to the image bits */
-	for( row = 0; row < 4; row++, pixel += width-4 ) {
-		for( pix = 0; pix < 4; pix++ ) {
-			/* zero the red bits of image pixel */
-			*pixel &= redZero;
+	for( i = 0; i < 8; i++, bits >>= 3 )
+		values[ i ] = alphas[ bits & 7 ];
 
-			/* or the bits into the prev. nulled red */
-			*pixel |= *((unsigned int*) &(aColors[ row ][ pix ]));
-			pixel++;
-		}
-	}
+	bits = block[ 5 ] | (block[ 6 ] << 8) | (block[ 7 ] << 16);
+
+	for( i = 8; i < 16; i++, bits >>= 3 )
+		values[ i ] = alphas[ bits & 7 ];
 }
 
 
+
 /*
-DDSDecompressDXT1()
-decompresses a dxt1 format texture
+block decoders
+each decodes one block of its format into 4x4 pixels, pitch is the number of pixels per line
 */
 
-static int DDSDecompressDXT1( const unsigned char* buffer, int width, int height, unsigned char *pixels ) {
-	int				x, y, xBlocks, yBlocks;
-	unsigned int	*pixel;
-	ddsColorBlock_t	*block;
-	ddsColor_t		colors[ 4 ];
-
+typedef void (*ddsBlockDecoder_t)( unsigned int *pixel, int pitch, const unsigned char *block );
 
-	/* setup */
-	xBlocks = width / 4;
-	yBlocks = height / 4;
-
-	/* walk y */
-	for( y = 0; y < yBlocks; y++ ) {
-		/* 8 bytes per block */
-		block = (ddsColorBlock_t*) ((uintptr_t) buffer + y * xBlocks * 8);
-
-		/* walk x */
-		for( x = 0; x < xBlocks; x++, block++ ) {
-			DDSGetColorBlockColors( block, colors );
-			pixel = (unsigned int*) (pixels + x * 16 + (y * 4) * width * 4);
-			DDSDecodeColorBlock( pixel, block, width, (unsigned int*) colors );
-		}
-	}
-
-	/* return ok */
-	return 0;
+static void DDSDecodeBlockDXT1( unsigned int *pixel, int pitch, const unsigned char *block ) {
+	DDSDecodeColorBlock( pixel, pitch, block, NULL, 0 );
 }
 
+/* dxt2 is decoded like dxt3 (fixme: un-premultiply alpha) */
+static void DDSDecodeBlockDXT3( unsigned int *pixel, int pitch, const unsigned char *block ) {
+	unsigned int	alphas[ 16 ];
 
 
-/*
-DDSDecompressDXT3()
-decompresses a dxt3 format texture
-*/
+	DDSDecodeAlphaExplicit( alphas, block );
+	DDSDecodeColorBlock( pixel, pitch, block + 8, alphas, DDSPackColor( 0xff, 0xff, 0xff, 0x00 ) );
+}
 
-static int DDSDecompressDXT3( const unsigned char* buffer, int width, int height, unsigned char *pixels ) {
-	int						x, y, xBlocks, yBlocks;
-	unsigned int			*pixel, alphaZero;
-	ddsColorBlock_t			*block;
-	ddsAlphaBlockExplicit_t	*alphaBlock;
-	ddsColor_t				colors[ 4 ];
+/* dxt4 is decoded like dxt5 (fixme: un-premultiply alpha) */
+static void DDSDecodeBlockDXT5( unsigned int *pixel, int pitch, const unsigned char *block ) {
+	unsigned char	values[ 16 ];
+	unsigned int	alphas[ 16 ];
+	int				i;
 
 
-	/* setup */
-	xBlocks = width / 4;
-	yBlocks = height / 4;
+	DDSDecode3BitLinear( values, block );
 
-	/* create zero alpha */
-	colors[ 0 ].a = 0;
-	colors[ 0 ].r = 0xFF;
-	colors[ 0 ].g = 0xFF;
-	colors[ 0 ].b = 0xFF;
-	alphaZero = *((unsigned int*) &colors[ 0 ]);
+	for( i = 0; i < 16; i++ )
+		alphas[ i ] = DDSPackColor( 0, 0, 0, values[ i ] );
 
-	/* walk y */
-	for( y = 0; y < yBlocks; y++ ) {
-		/* 8 bytes per block, 1 block for alpha, 1 block for color */
-		block = (ddsColorBlock_t*) ((uintptr_t) buffer + y * xBlocks * 16);
+	DDSDecodeColorBlock( pixel, pitch, block + 8, alphas, DDSPackColor( 0xff, 0xff, 0xff, 0x00 ) );
+}
 
-		/* walk x */
-		for( x = 0; x < xBlocks; x++, block++ ) {
-			/* get alpha block */
-			alphaBlock = (ddsAlphaBlockExplicit_t*) block;
+/** greebo: Decodes the alpha channel into the red channel for RXGB-encoded images
+ */
+static void DDSDecodeBlockRXGB( unsigned int *pixel, int pitch, const unsigned char *block ) {
+	unsigned char	values[ 16 ];
+	unsigned int	reds[ 16 ];
+	int				i;
 
-			/* get color block */
-			block++;
-			DDSGetColorBlockColors( block, colors );
 
-			/* decode color block */
-			pixel = (unsigned int*) (pixels + x * 16 + (y * 4) * width * 4);
-			DDSDecodeColorBlock( pixel, block, width, (unsigned int*) colors );
+	DDSDecode3BitLinear( values, block );
 
-			/* overwrite alpha bits with alpha block */
-			DDSDecodeAlphaExplicit( pixel, alphaBlock, width, alphaZero );
-		}
-	}
+	for( i = 0; i < 16; i++ )
+		reds[ i ] = DDSPackColor( values[ i ], 0, 0, 0 );
 
-	/* return ok */
-	return 0;
+	DDSDecodeColorBlock( pixel, pitch, block + 8, reds, DDSPackColor( 0x00, 0xff, 0xff, 0xff ) );
 }
 
+/* the single channel is replicated into rgb */
+static void DDSDecodeBlockATI1( unsigned int *pixel, int pitch, const unsigned char *block ) {
+	unsigned char	values[ 16 ];
+	unsigned char	value;
+	int				row, pix;
 
 
-/*
-DDSDecompressDXT5()
-decompresses a dxt5 format texture
-*/
-
-static int DDSDecompressDXT5( const unsigned char* buffer, int width, int height, unsigned char *pixels ) {
-	int							x, y, xBlocks, yBlocks;
-	unsigned int				*pixel, alphaZero;
-	ddsColorBlock_t				*block;
-	ddsAlphaBlock3BitLinear_t	*alphaBlock;
-	ddsColor_t					colors[ 4 ];
-
-
-	/* setup */
-	xBlocks = width / 4;
-	yBlocks = height / 4;
+	DDSDecode3BitLinear( values, block );
 
-	/* create zero alpha */
-	colors[ 0 ].a = 0;
-	colors[ 0 ].r = 0xFF;
-	colors[ 0 ].g = 0xFF;
-	colors[ 0 ].b = 0xFF;
-	alphaZero = *((unsigned int*) &colors[ 0 ]);
+	for( row = 0; row < 4; row++, pixel += pitch ) {
+		for( pix = 0; pix < 4; pix++ ) {
+			value = values[ row * 4 + pix ];
+			pixel[ pix ] = DDSPackColor( value, value, value, 0xff );
+		}
+	}
+}
 
-	/* walk y */
-	for( y = 0; y < yBlocks; y++ ) {
-		/* 8 bytes per block, 1 block for alpha, 1 block for color */
-		block = (ddsColorBlock_t*) ((uintptr_t) buffer + y * xBlocks * 16);
+/* the two channels hold x and y of a normal, z is reconstructed into blue */
+static void DDSDecodeBlockATI2( unsigned int *pixel, int pitch, const unsigned char *block ) {
+	unsigned char	x[ 16 ], y[ 16 ];
+	float			nx, ny, nz;
+	int				row, pix, i;
 
-		/* walk x */
-		for( x = 0; x < xBlocks; x++, block++ ) {
-			/* get alpha block */
-			alphaBlock = (ddsAlphaBlock3BitLinear_t*) block;
 
-			/* get color block */
-			block++;
-			DDSGetColorBlockColors( block, colors );
+	DDSDecode3BitLinear( x, block );
+	DDSDecode3BitLinear( y, block + 8 );
 
-			/* decode color block */
-			pixel = (unsigned int*) (pixels + x * 16 + (y * 4) * width * 4);
-			DDSDecodeColorBlock( pixel, block, width, (unsigned int*) colors );
+	for( row = 0; row < 4; row++, pixel += pitch ) {
+		for( pix = 0; pix < 4; pix++ ) {
+			i = row * 4 + pix;
+			nx = x[ i ] / 127.5f - 1.0f;
+			ny = y[ i ] / 127.5f - 1.0f;
+			nz = 1.0f - nx * nx - ny * ny;
+			nz = nz > 0.0f ? sqrtf( nz ) : 0.0f;
 
-			/* overwrite alpha bits with alpha block */
-			DDSDecodeAlpha3BitLinear( pixel, alphaBlock, width, alphaZero );
+			pixel[ pix ] = DDSPackColor( x[ i ], y[ i ], (unsigned char) ((nz + 1.0f) * 127.5f + 0.5f), 0xff );
 		}
 	}
-
-	/* return ok */
-	return 0;
 }
 
 
 
 /*
-DDSDecompressDXT2()
-decompresses a dxt2 format texture (fixme: un-premultiply alpha)
+DDSDecompressARGB8888()
+decompresses lines of an argb 8888 format texture
 */
 
-static int DDSDecompressDXT2( const unsigned char* buffer, int width, int height, unsigned char *pixels ) {
-	int		r;
+static int DDSDecompressARGB8888( const unsigned char* buffer, int width, int firstLine, int numLines, unsigned char *pixels ) {
+	/* fixme: support other [a]rgb formats */
+	memcpy( pixels + firstLine * width * 4, buffer + firstLine * width * 4, numLines * width * 4 );
 
-
-	/* decompress dxt3 first */
-	r = DDSDecompressDXT3( buffer, width, height, pixels );
-
-	/* return to sender */
-	return r;
+	/* return ok */
+	return 0;
 }
 
 
 
 /*
-DDSDecompressDXT4()
-decompresses a dxt4 format texture (fixme: un-premultiply alpha)
+DDSDecompressBlockRows()
+decompresses the rows of 4x4 blocks [firstRow, firstRow + numRows) of a dds mipmap into an
+rgba image buffer of width * height pixels, returns 0 on success. blocks exceeding the image
+are clipped, such that mipmaps smaller than a block are decoded too. distinct rows can be
+decompressed by several threads at once.
 */
 
-static int DDSDecompressDXT4( const unsigned char* buffer, int width, int height, unsigned char *pixels ) {
-	int		r;
-
+int DDSDecompressBlockRows( ddsPF_t pf, const unsigned char* buffer, int width, int height,
+							int firstRow, int numRows, unsigned char *pixels ) {
+	ddsBlockDecoder_t	decode;
+	unsigned int		tile[ 16 ];
+	const unsigned char	*block;
+	unsigned char		*out;
+	int					x, y, row, blockBytes, xBlocks, columns, rows, lines;
 
-	/* decompress dxt5 first */
-	r = DDSDecompressDXT5( buffer, width, height, pixels );
 
-	/* return to sender */
-	return r;
-}
+	/* the rows beyond the image are dropped */
+	if( (firstRow + numRows) * 4 > height )
+		numRows = (height + 3) / 4 - firstRow;
+	if( numRows <= 0 || width <= 0 )
+		return 0;
 
+	/* the lines of pixels covered by the rows */
+	lines = numRows * 4;
+	if( firstRow * 4 + lines > height )
+		lines = height - firstRow * 4;
 
+	switch( pf ) {
+		case DDS_PF_ARGB8888:
+			return DDSDecompressARGB8888( buffer, width, firstRow * 4, lines, pixels );
 
-/*
-DDSDecompressARGB8888()
-decompresses an argb 8888 format texture
-*/
+		case DDS_PF_DXT1:
+			decode = DDSDecodeBlockDXT1;
+			break;
 
-static int DDSDecompressARGB8888( const unsigned char* buffer, int width, int height, unsigned char *pixels ) {
-	int							x, y;
-	const unsigned char		*in;
-	unsigned char *out;
+		case DDS_PF_DXT2:
+		case DDS_PF_DXT3:
+			decode = DDSDecodeBlockDXT3;
+			break;
 
+		case DDS_PF_DXT4:
+		case DDS_PF_DXT5:
+			decode = DDSDecodeBlockDXT5;
+			break;
 
-	/* setup */
-	in = buffer;
-	out = pixels;
+		case DDS_PF_DXT5_RXGB:
+			decode = DDSDecodeBlockRXGB;
+			break;
 
-	/* walk y */
-	for( y = 0; y < height; y++ ) {
-		/* walk x */
-		for( x = 0; x < width; x++ ) {
-			*out++ = *in++;
-			*out++ = *in++;
-			*out++ = *in++;
-			*out++ = *in++;
-		}
-	}
+		case DDS_PF_ATI1:
+			decode = DDSDecodeBlockATI1;
+			break;
 
-	/* return ok */
-	return 0;
-}
+		case DDS_PF_ATI2:
+			decode = DDSDecodeBlockATI2;
+			break;
 
-/** greebo: This decompresses a DXT5 RXGB texture as used by the Doom3 engine.
- */
-static int DDSDecompressRXGB( const unsigned char* buffer, int width, int height, unsigned char *pixels ) {
-	int							x, y, xBlocks, yBlocks;
-	unsigned int				*pixel, redZero;
-	ddsColorBlock_t				*block;
-	ddsAlphaBlock3BitLinear_t	*alphaBlock;
-	ddsColor_t					colors[ 4 ];
+		default:
+			memset( pixels + firstRow * 4 * width * 4, 0xFF, lines * width * 4 );
+			return -1;
+	}
 
 	/* setup */
-	xBlocks = width / 4;
-	yBlocks = height / 4;
-
-	/* create zero red */
-	colors[ 0 ].r = 0;
-	colors[ 0 ].a = 0xFF;
-	colors[ 0 ].g = 0xFF;
-	colors[ 0 ].b = 0xFF;
-	redZero = *((unsigned int*) &colors[ 0 ]);
+	blockBytes = DDSGetBlockBytes( pf );
+	xBlocks = (width + 3) / 4;
 
 	/* walk y */
-	for( y = 0; y < yBlocks; y++ ) {
-		/* 8 bytes (64 bit) per block, 1 block for alpha, 1 block for color */
-		block = (ddsColorBlock_t*) ((uintptr_t) buffer + y * xBlocks * 16);
+	for( y = firstRow; y < firstRow + numRows; y++ ) {
+		block = buffer + y * xBlocks * blockBytes;
+		out = pixels + y * 4 * width * 4;
+		rows = height - y * 4 < 4 ? height - y * 4 : 4;
 
 		/* walk x */
-		for( x = 0; x < xBlocks; x++, block++ ) {
-			/* get alpha block */
-			alphaBlock = (ddsAlphaBlock3BitLinear_t*) block;
-
-			/* get color block */
-			block++;
-			// Decode the colour values from the 5:6:5 word and derive the c2 and c3 colours
-			// The result is stored in the <colors> variable
-			DDSGetColorBlockColors( block, colors );
-
-			/* decode color block */
-			pixel = (unsigned int*) (pixels + x * 16 + (y * 4) * width * 4);
-			DDSDecodeColorBlock( pixel, block, width, (unsigned int*) colors );
-
-			/* overwrite alpha bits with alpha block */
-			DDSDecodeRXGBAlpha3BitLinear( pixel, alphaBlock, width, redZero );
+		for( x = 0; x < xBlocks; x++, block += blockBytes, out += 16 ) {
+			columns = width - x * 4 < 4 ? width - x * 4 : 4;
+
+			if( rows == 4 && columns == 4 ) {
+				decode( (unsigned int*) out, width, block );
+				continue;
+			}
+
+			/* blocks exceeding the image are decoded into a tile and clipped */
+			decode( tile, 4, block );
+
+			for( row = 0; row < rows; row++ )
+				memcpy( out + row * width * 4, tile + row * 4, columns * 4 );
 		}
 	}
 
@@ -823,6 +619,8 @@ static int DDSDecompressRXGB( const unsigned char* buffer, int width, int height
 	return 0;
 }
 
+
+
 /*
 DDSDecompress()
 decompresses a dds texture into an rgba image buffer, returns 0 on success
@@ -839,44 +637,5 @@ int DDSDecompress( const DDSHeader* header, const unsigned char* buffer, unsigne
 		return r;
 
 	/* decompress */
-	switch( pf ) {
-		case DDS_PF_ARGB8888:
-			/* fixme: support other [a]rgb formats */
-			r = DDSDecompressARGB8888( buffer, width, height, pixels );
-			break;
-
-		case DDS_PF_DXT1:
-			r = DDSDecompressDXT1( buffer, width, height, pixels );
-			break;
-
-		case DDS_PF_DXT2:
-			r = DDSDecompressDXT2( buffer, width, height, pixels );
-			break;
-
-		case DDS_PF_DXT3:
-			r = DDSDecompressDXT3( buffer, width, height, pixels );
-			break;
-
-		case DDS_PF_DXT4:
-			r = DDSDecompressDXT4( buffer, width, height, pixels );
-			break;
-
-		case DDS_PF_DXT5:
-			r = DDSDecompressDXT5( buffer, width, height, pixels );
-			break;
-
-		case DDS_PF_DXT5_RXGB:
-			r = DDSDecompressRXGB( buffer, width, height, pixels );
-			break;
-
-		default:
-		case DDS_PF_UNKNOWN:
-			memset( pixels, 0xFF, width * height * 4 );
-			r = -1;
-			break;
-	}
-
-	/* return to sender */
-	return r;
+	return DDSDecompressBlockRows( pf, buffer, width, height, 0, (height + 3) / 4, pixels );
 }
-
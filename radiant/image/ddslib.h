@@ -67,6 +67,8 @@ typedef enum
 	DDS_PF_DXT4,
 	DDS_PF_DXT5,
 	DDS_PF_DXT5_RXGB,	/* Doom 3's swizzled format */
+	DDS_PF_ATI1,		/* BC4, a single channel */
+	DDS_PF_ATI2,		/* BC5, two channels (normal maps) */
 	DDS_PF_UNKNOWN
 }
 ddsPF_t;
@@ -268,6 +270,9 @@ ddsColor_t;
 /* public functions */
 int						DDSGetInfo( const DDSHeader* header, int *width, int *height, ddsPF_t *pf );
 int						DDSDecompress( const DDSHeader* header, const unsigned char* buffer, unsigned char *pixels );
+int						DDSGetBlockBytes( ddsPF_t pf );
+int						DDSDecompressBlockRows( ddsPF_t pf, const unsigned char* buffer, int width, int height,
+												int firstRow, int numRows, unsigned char *pixels );
 
 
 
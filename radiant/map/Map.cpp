@@ -20,6 +20,9 @@
 #include "iaasfile.h"
 #include "igame.h"
 #include "imapformat.h"
+#include "ibrush.h"
+#include "ipatch.h"
+#include "ishaders.h"
 
 #include "registry/registry.h"
 #include "stream/TextFileInputStream.h"
@@ -104,6 +107,10 @@ void Map::loadMapResourceFromPath(const std::string& path)
 	// Traverse the scenegraph and find the worldspawn
 	findWorldspawn();
 
+    // Get the materials of the map parsed in the background, while they are
+    // captured one by one by the render system below
+    prioritiseMapMaterials();
+
     // Associate the Scenegaph with the global RenderSystem
     // This usually takes a while since all editor textures are loaded - display a dialog to inform the user
     {
@@ -117,6 +124,38 @@ void Map::loadMapResourceFromPath(const std::string& path)
     emitMapEvent(MapLoaded);
 }
 
+void Map::prioritiseMapMaterials()
+{
+    std::set<std::string> materials;
+
+    GlobalSceneGraph().foreachNode([&](const scene::INodePtr& node)->bool
+    {
+        IBrush* brush = Node_getIBrush(node);
+
+        if (brush != nullptr)
+        {
+            for (std::size_t i = 0; i < brush->getNumFaces(); ++i)
+            {
+                materials.insert(brush->getFace(i).getShader());
+            }
+
+            return false;
+        }
+
+        IPatch* patch = Node_getIPatch(node);
+
+        if (patch != nullptr)
+        {
+            materials.insert(patch->getShader());
+            return false;
+        }
+
+        return true; // traverse further
+    });
+
+    GlobalMaterialManager().prioritiseMaterials(materials);
+}
+
 void Map::updateTitle()
 {
     std::string title = _mapName;
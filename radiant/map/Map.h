@@ -223,6 +223,10 @@ private:
 	// Creates a fresh worldspawn node and inserts it into the root scene node
 	scene::INodePtr createWorldspawn();
 
+	// Requests the materials of the brushes and patches in the scene to be
+	// parsed ahead of the other ones
+	void prioritiseMapMaterials();
+
 	void loadMapResourceFromPath(const std::string& path);
 
 	void emitMapEvent(MapEvent ev);
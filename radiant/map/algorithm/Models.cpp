@@ -140,6 +140,34 @@ void refreshSelectedModels(bool blockScreenUpdates)
 	}
 }
 
+void refreshModelsByPath(const std::set<std::string>& modelPaths)
+{
+	// Collect the entities first, refreshing them changes the scene
+	std::set<IEntityNodePtr> entities;
+
+	GlobalSceneGraph().foreachNode([&](const scene::INodePtr& node)->bool
+	{
+		model::ModelNodePtr model = Node_getModel(node);
+
+		if (model && modelPaths.count(model->getIModel().getModelPath()) > 0)
+		{
+			IEntityNodePtr entity = std::dynamic_pointer_cast<IEntityNode>(node->getParent());
+
+			if (entity)
+			{
+				entities.insert(entity);
+			}
+		}
+
+		return true;
+	});
+
+	for (const IEntityNodePtr& entityNode : entities)
+	{
+		entityNode->refreshModel();
+	}
+}
+
 }
 
 }
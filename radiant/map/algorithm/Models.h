@@ -1,5 +1,8 @@
 #pragma once
 
+#include <set>
+#include <string>
+
 namespace map
 {
 
@@ -12,6 +15,10 @@ void refreshModels(bool blockScreenUpdates);
 // This reloads all selected models in the map
 void refreshSelectedModels(bool blockScreenUpdates);
 
+// Refreshes all models in the map using one of the given model paths,
+// these should have been removed from the model cache beforehand
+void refreshModelsByPath(const std::set<std::string>& modelPaths);
+
 }
 
 }
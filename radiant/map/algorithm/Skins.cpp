@@ -29,6 +29,21 @@ void reloadSkins(const cmd::ArgumentList& args)
 	});
 }
 
+void refreshSkinnedModels(const std::set<std::string>& skinNames)
+{
+	GlobalSceneGraph().foreachNode([&] (const scene::INodePtr& node)->bool
+	{
+		SkinnedModelPtr skinned = std::dynamic_pointer_cast<SkinnedModel>(node);
+
+		if (skinned && skinNames.count(skinned->getSkin()) > 0)
+		{
+			skinned->skinChanged(skinned->getSkin());
+		}
+
+		return true; // traverse further
+	});
+}
+
 } // namespace
 
 } // namespace
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "icommandsystem.h"
+#include <set>
 
 namespace map
 {
@@ -10,6 +11,9 @@ namespace algorithm
 
 void reloadSkins(const cmd::ArgumentList& args);
 
+// Re-applies the named skins to all models in the scene using them
+void refreshSkinnedModels(const std::set<std::string>& skinNames);
+
 } // namespace
 
 } // namespace
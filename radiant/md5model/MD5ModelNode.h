@@ -57,6 +57,7 @@ public:
 
 	// LitObject implementation
 	bool intersectsLight(const RendererLight& light) const override;
+	AABB litObjectAABB() const override;
 	void insertLight(const RendererLight& light) override;
 	void clearLights() override;
 
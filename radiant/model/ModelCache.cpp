@@ -165,6 +165,31 @@ sigc::signal<void> ModelCache::signal_modelsReloaded()
 	return _sigModelsReloaded;
 }
 
+void ModelCache::onFilesChanged(const std::set<std::string>& changedFiles)
+{
+	std::set<std::string> changedModels;
+
+	for (const std::string& file : changedFiles)
+	{
+		if (_modelMap.find(file) != _modelMap.end())
+		{
+			changedModels.insert(file);
+			removeModel(file);
+		}
+	}
+
+	if (changedModels.empty())
+	{
+		return;
+	}
+
+	rMessage() << "[ModelCache] Reloading " << changedModels.size() << " changed models." << std::endl;
+
+	map::algorithm::refreshModelsByPath(changedModels);
+
+	_sigModelsReloaded.emit();
+}
+
 // RegisterableModule implementation
 const std::string& ModelCache::getName() const 
 {
@@ -180,6 +205,7 @@ const StringSet& ModelCache::getDependencies() const
 	{
 		_dependencies.insert(MODULE_MODELFORMATMANAGER);
 		_dependencies.insert(MODULE_COMMANDSYSTEM);
+		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
 	}
 
 	return _dependencies;
@@ -196,10 +222,14 @@ void ModelCache::initialiseModule(const ApplicationContext& ctx)
 
 	GlobalEventManager().addCommand("RefreshModels", "RefreshModels");
 	GlobalEventManager().addCommand("RefreshSelectedModels", "RefreshSelectedModels");
+
+	GlobalFileSystem().addObserver(*this);
 }
 
 void ModelCache::shutdownModule()
 {
+	GlobalFileSystem().removeObserver(*this);
+
 	clear();
 }
 
@@ -4,12 +4,14 @@
 #include <string>
 #include "imodelcache.h"
 #include "icommandsystem.h"
+#include "ifilesystem.h"
 
 namespace model
 {
 
 class ModelCache :
-	public IModelCache
+	public IModelCache,
+	public vfs::VirtualFileSystem::Observer
 {
 private:
 	// The container maps model names to instances
@@ -37,6 +39,9 @@ public:
 	// Public events
 	sigc::signal<void> signal_modelsReloaded() override;
 
+	// VFS::Observer implementation, reloads the changed models
+	void onFilesChanged(const std::set<std::string>& changedFiles) override;
+
 	// RegisterableModule implementation
 	const std::string& getName() const override;
 	const StringSet& getDependencies() const override;
@@ -9,11 +9,14 @@
 #include "ieventmanager.h"
 #include "itextstream.h"
 #include "ifilesystem.h"
+#include "ideclcache.h"
+#include "ideclloadscheduler.h"
 #include "iarchive.h"
 #include "igame.h"
 #include "i18n.h"
 
 #include "parser/DefTokeniser.h"
+#include "parser/TokenListTokeniser.h"
 #include "math/Vector4.h"
 #include "os/fs.h"
 
@@ -40,7 +43,7 @@ namespace
 }
 
 ParticlesManager::ParticlesManager() :
-    _defLoader(std::bind(&ParticlesManager::reloadParticleDefs, this))
+    _defLoader("Particles", std::bind(&ParticlesManager::reloadParticleDefs, this))
 {}
 
 sigc::signal<void> ParticlesManager::signal_particlesReloaded() const
@@ -150,12 +153,9 @@ void ParticlesManager::ensureDefsLoaded()
     _defLoader.ensureFinished();
 }
 
-// Parse particle defs from string
-void ParticlesManager::parseStream(std::istream& contents, const std::string& filename)
+// Parse particle defs from the tokens of a file
+void ParticlesManager::parseTokens(parser::DefTokeniser& tok, const std::string& filename)
 {
-	// Usual ritual, get a parser::DefTokeniser and start tokenising the DEFs
-	parser::BasicDefTokeniser<std::istream> tok(contents);
-
 	while (tok.hasMoreTokens())
 	{
 		parseParticleDef(tok, filename);
@@ -220,6 +220,8 @@ const StringSet& ParticlesManager::getDependencies() const
 		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
 		_dependencies.insert(MODULE_COMMANDSYSTEM);
 		_dependencies.insert(MODULE_EVENTMANAGER);
+		_dependencies.insert(MODULE_DECLLOADSCHEDULER);
+		_dependencies.insert(MODULE_DECLCACHE);
 	}
 
 	return _dependencies;
@@ -242,34 +244,66 @@ void ParticlesManager::reloadParticleDefs()
 {
 	ScopedDebugTimer timer("Particle definitions parsed: ");
 
+    std::vector<std::string> filenames;
+
     GlobalFileSystem().forEachFile(
         PARTICLES_DIR, PARTICLES_EXT,
         [&](const vfs::FileInfo& fileInfo)
         {
-            // Attempt to open the file in text mode
-            ArchiveTextFilePtr file = GlobalFileSystem().openTextFile(PARTICLES_DIR + fileInfo.name);
+            filenames.push_back(fileInfo.name);
+        },
+        1 // depth == 1: don't search subdirectories
+    );
+
+    // Fetch the tokens in parallel, unchanged files come from the decl cache
+    std::vector<decl::DeclFilePtr> files(filenames.size());
+    std::vector<std::string> errors(filenames.size());
+    std::vector<std::function<void()>> tasks;
 
-            if (file != NULL)
+    for (std::size_t i = 0; i < filenames.size(); ++i)
+    {
+        tasks.emplace_back([&, i]()
+        {
+            try
             {
-                // File is open, so parse the tokens
-                try 
-                {
-                    std::istream is(&(file->getInputStream()));
-                    parseStream(is, fileInfo.name);
-                }
-                catch (parser::ParseException& e)
-                {
-                    rError() << "[particles] Failed to parse " << fileInfo.name
-                        << ": " << e.what() << std::endl;
-                }
+                files[i] = GlobalDeclCache().getFile(PARTICLES_DIR + filenames[i],
+                    decl::DeclFileContents::Tokens);
             }
-            else
+            catch (parser::ParseException& e)
             {
-                rError() << "[particles] Unable to open " << fileInfo.name << std::endl;
+                errors[i] = e.what();
             }
-        },
-        1 // depth == 1: don't search subdirectories
-    );
+        });
+    }
+
+    GlobalDeclLoadScheduler().runSubTasks(tasks);
+
+    for (std::size_t i = 0; i < files.size(); ++i)
+    {
+        if (files[i])
+        {
+            // File is tokenised, so parse the tokens
+            try
+            {
+                parser::TokenListTokeniser tok(files[i]->tokens);
+                parseTokens(tok, filenames[i]);
+            }
+            catch (parser::ParseException& e)
+            {
+                rError() << "[particles] Failed to parse " << filenames[i]
+                    << ": " << e.what() << std::endl;
+            }
+        }
+        else if (!errors[i].empty())
+        {
+            rError() << "[particles] Failed to parse " << filenames[i]
+                << ": " << errors[i] << std::endl;
+        }
+        else
+        {
+            rError() << "[particles] Unable to open " << filenames[i] << std::endl;
+        }
+    }
 
     rMessage() << "Found " << _particleDefs.size() << " particle definitions." << std::endl;
 
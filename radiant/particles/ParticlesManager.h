@@ -90,10 +90,10 @@ private:
     void ensureDefsLoaded();
 
     /**
-    * Accept a stream containing particle definitions to parse and add to the
-    * list.
+    * Parse the tokens of a file containing particle definitions and add them
+    * to the list.
     */
-    void parseStream(std::istream& s, const std::string& filename);
+    void parseTokens(parser::DefTokeniser& tok, const std::string& filename);
 
 	// Recursive-descent parse functions
 	void parseParticleDef(parser::DefTokeniser& tok, const std::string& filename);
@@ -124,6 +124,7 @@ public:
 
 	// LitObject implementation
 	bool intersectsLight(const RendererLight& light) const override;
+	AABB litObjectAABB() const override;
 
 	// Renderable implementation
 
@@ -0,0 +1,156 @@
+#include "LightInteractions.h"
+
+#include "debugging/debugging.h"
+#include "math/AABB.h"
+
+#include <tuple>
+
+namespace render
+{
+
+LightInteractions::ObjectLights::ObjectLights(LightInteractions& owner, LitObject& object) :
+	_owner(owner),
+	_litObject(object),
+	_dirty(true)
+{}
+
+void LightInteractions::ObjectLights::calculateIntersectingLights() const
+{
+	// Changed lights mark the objects in their old and new volume as dirty
+	_owner.updateChangedLights();
+
+	if (!_dirty)
+	{
+		return;
+	}
+
+	_dirty = false;
+
+	_activeLights.clear();
+	_litObject.clearLights();
+
+	AABB bounds = _litObject.litObjectAABB();
+
+	// Index the object at its current bounds, for later light changes to find it
+	_owner._objects.link(&_litObject, bounds);
+
+	// Determine which of the lights overlapping the object intersect it
+	_owner._lights.forEachIntersecting(bounds, [&](RendererLight* light)
+	{
+		if (_litObject.intersectsLight(*light))
+		{
+			_activeLights.push_back(light);
+			_litObject.insertLight(*light);
+		}
+	});
+}
+
+void LightInteractions::ObjectLights::forEachLight(const RendererLightCallback& callback) const
+{
+	calculateIntersectingLights();
+
+	for (RendererLight* light : _activeLights)
+	{
+		callback(*light);
+	}
+}
+
+void LightInteractions::ObjectLights::setDirty()
+{
+	_dirty = true;
+}
+
+LightList& LightInteractions::attachLitObject(LitObject& object)
+{
+	return _lightLists.emplace(
+		std::piecewise_construct,
+		std::forward_as_tuple(&object),
+		std::forward_as_tuple(*this, object)
+	).first->second;
+}
+
+void LightInteractions::detachLitObject(LitObject& object)
+{
+	_objects.unlink(&object);
+	_lightLists.erase(&object);
+}
+
+void LightInteractions::litObjectChanged(LitObject& object)
+{
+	LightLists::iterator i = _lightLists.find(&object);
+	assert(i != _lightLists.end());
+
+	i->second.setDirty();
+}
+
+void LightInteractions::attachLight(RendererLight& light)
+{
+	ASSERT_MESSAGE(!_lights.contains(&light), "light could not be attached");
+
+	AABB bounds = light.lightVolumeAABB();
+
+	setObjectsDirty(bounds);
+	_lights.link(&light, bounds);
+}
+
+void LightInteractions::detachLight(RendererLight& light)
+{
+	AABB bounds;
+	bool attached = _lights.getBounds(&light, bounds);
+
+	ASSERT_MESSAGE(attached, "light could not be detached");
+
+	if (!attached)
+	{
+		return;
+	}
+
+	// The light may have changed since it has been indexed, but in that case
+	// the objects lit by it have still been found at the indexed bounds
+	setObjectsDirty(bounds);
+
+	_lights.unlink(&light);
+	_changedLights.erase(&light);
+}
+
+void LightInteractions::lightChanged(RendererLight& light)
+{
+	if (_lights.contains(&light))
+	{
+		_changedLights.insert(&light);
+	}
+}
+
+void LightInteractions::updateChangedLights()
+{
+	if (_changedLights.empty())
+	{
+		return;
+	}
+
+	for (RendererLight* light : _changedLights)
+	{
+		AABB oldBounds;
+		_lights.getBounds(light, oldBounds);
+
+		AABB newBounds = light->lightVolumeAABB();
+
+		// Only the objects inside the old or the new volume are affected
+		setObjectsDirty(oldBounds);
+		setObjectsDirty(newBounds);
+
+		_lights.link(light, newBounds);
+	}
+
+	_changedLights.clear();
+}
+
+void LightInteractions::setObjectsDirty(const AABB& bounds)
+{
+	_objects.forEachIntersecting(bounds, [this](LitObject* object)
+	{
+		_lightLists.find(object)->second.setDirty();
+	});
+}
+
+} // namespace render
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "irender.h"
+#include "SpatialHashGrid.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace render
+{
+
+/**
+ * \brief
+ * Keeps track of which lights intersect which lit objects.
+ *
+ * Both the lights and the lit objects are indexed by their bounds, such that
+ * a lit object only needs to test the lights overlapping it, and a changed
+ * light only invalidates the light lists of the objects overlapping its old
+ * or new volume.
+ *
+ * Changed lights are collected and processed the next time any lit object
+ * calculates its lights, since lights usually change many times in a row
+ * while being dragged.
+ */
+class LightInteractions
+{
+private:
+	// The LightList implementation handed out to the lit objects
+	class ObjectLights :
+		public LightList
+	{
+	private:
+		LightInteractions& _owner;
+
+		// Target object
+		LitObject& _litObject;
+
+		// List of lights which are intersecting our lit object
+		typedef std::vector<RendererLight*> Lights;
+		mutable Lights _activeLights;
+
+		// Dirty flag indicating recalculation needed
+		mutable bool _dirty;
+
+	public:
+		ObjectLights(LightInteractions& owner, LitObject& object);
+
+		// LightList implementation
+		void calculateIntersectingLights() const override;
+		void forEachLight(const RendererLightCallback& callback) const override;
+		void setDirty() override;
+	};
+
+	typedef std::map<LitObject*, ObjectLights> LightLists;
+	LightLists _lightLists;
+
+	// Lit objects, indexed by their bounds at the time their lights have
+	// last been calculated. Objects which have not yet been rendered are
+	// not indexed at all.
+	SpatialHashGrid<LitObject*> _objects;
+
+	// All attached lights, indexed by their volume at the time the last
+	// change has been processed
+	SpatialHashGrid<RendererLight*> _lights;
+
+	// Lights which changed since the last update
+	std::set<RendererLight*> _changedLights;
+
+public:
+	LightList& attachLitObject(LitObject& object);
+	void detachLitObject(LitObject& object);
+	void litObjectChanged(LitObject& object);
+
+	void attachLight(RendererLight& light);
+	void detachLight(RendererLight& light);
+	void lightChanged(RendererLight& light);
+
+private:
+	// Moves the changed lights to their new volume in the index
+	void updateChangedLights();
+
+	// Marks the light lists of all objects overlapping the given bounds as dirty
+	void setObjectsDirty(const AABB& bounds);
+};
+
+} // namespace render
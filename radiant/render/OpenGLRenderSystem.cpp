@@ -6,7 +6,9 @@
 #include "math/Matrix4.h"
 #include "modulesystem/StaticModule.h"
 #include "backend/GLProgramFactory.h"
+#include "RenderStatistics.h"
 #include "debugging/debugging.h"
+#include "string/predicate.h"
 
 #include <functional>
 
@@ -42,7 +44,7 @@ OpenGLRenderSystem::OpenGLRenderSystem() :
     _glProgramFactory(std::make_shared<GLProgramFactory>()),
 	_currentShaderProgram(SHADER_PROGRAM_NONE),
 	_time(0),
-	m_lightsChanged(true),
+	_sortIndicesValid(false),
 	m_traverseRenderablesMutex(false)
 {
 	// For the static default rendersystem, the MaterialManager is not existent yet,
@@ -53,6 +55,8 @@ OpenGLRenderSystem::OpenGLRenderSystem() :
 			sigc::mem_fun(*this, &OpenGLRenderSystem::realise));
 		_materialDefsUnloaded = GlobalMaterialManager().signal_DefsUnloaded().connect(
 			sigc::mem_fun(*this, &OpenGLRenderSystem::unrealise));
+		_materialChanged = GlobalMaterialManager().signal_MaterialChanged().connect(
+			sigc::mem_fun(*this, &OpenGLRenderSystem::onMaterialChanged));
 
 		if (GlobalMaterialManager().isRealised())
 		{
@@ -73,6 +77,7 @@ OpenGLRenderSystem::~OpenGLRenderSystem()
 {
 	_materialDefsLoaded.disconnect();
 	_materialDefsUnloaded.disconnect();
+	_materialChanged.disconnect();
 }
 
 ShaderPtr OpenGLRenderSystem::capture(const std::string& name)
@@ -200,44 +205,42 @@ void OpenGLRenderSystem::render(RenderStateFlags globalstate,
 	glHint(GL_FOG_HINT, GL_NICEST);
     glDisable(GL_FOG);
 
-#if 0
-	std::size_t count = 0 ;
+    if (!_sortIndicesValid)
+    {
+        updateSortIndices();
+    }
 
-	for (OpenGLStates::iterator i = _state_sorted.begin();
-		i != _state_sorted.end();
-		++i)
-	{
-		// Render the OpenGLShaderPass
-		if (!i->second->empty())
-		{
-			count++;
-		}
-	}
+    // Sort the renderables of all passes by the position of the pass in the
+    // sorted states, then render the contents of each pass. Each pass is
+    // passed a reference to the "current" state, which it can change.
+    _renderQueue.sort();
 
-	rMessage() << "R1 " << count << " of " << _state_sorted.size() << "\n";
+    for (RenderQueue::const_iterator i = _renderQueue.begin(); i != _renderQueue.end();)
+    {
+        OpenGLShaderPass* pass = i->pass;
 
-	std::size_t curObject = 0;
-#endif
+        RenderQueue::const_iterator passEnd = i;
 
-    // Iterate over the sorted mapping between OpenGLStates and their
-    // OpenGLShaderPasses (containing the renderable geometry), and render the
-    // contents of each bucket. Each pass is passed a reference to the "current"
-    // state, which it can change.
-	for (OpenGLStates::iterator i = _state_sorted.begin();
-		i != _state_sorted.end();
-		++i)
-	{
-		// Render the OpenGLShaderPass
-        if (!i->second->empty())
+        while (passEnd != _renderQueue.end() && passEnd->pass == pass)
         {
-#if 0
-			rMessage() << curObject << " " << (*i->second);
-			curObject++;
-#endif
+            ++passEnd;
+        }
 
-            i->second->render(current, globalstate, viewer, _time);
+        // Passes which have been removed from the sorted states are sorted last
+        if (pass->getSortIndex() == OpenGLShaderPass::NO_SORT_INDEX)
+        {
+            break;
         }
-	}
+
+        pass->render(current, globalstate, viewer, _time, i, passEnd);
+
+        i = passEnd;
+    }
+
+    const RenderQueue::Statistics& queueStatistics = _renderQueue.getStatistics();
+    RenderStatistics::Instance().addStateChanges(queueStatistics.stateChanges);
+
+    _renderQueue.clear();
 
 	glPopAttrib();
 }
@@ -293,6 +296,24 @@ void OpenGLRenderSystem::unrealise()
 	}
 }
 
+void OpenGLRenderSystem::onMaterialChanged(const std::string& materialName)
+{
+    if (!_realised)
+    {
+        return;
+    }
+
+    // Material names are case-insensitive
+    for (ShaderMap::value_type& pair : _shaders)
+    {
+        if (string::iequals(pair.first, materialName))
+        {
+            pair.second->unrealise();
+            pair.second->realise(pair.first);
+        }
+    }
+}
+
 GLProgramFactory& OpenGLRenderSystem::getGLProgramFactory()
 {
     return *_glProgramFactory;
@@ -421,73 +442,69 @@ sigc::signal<void> OpenGLRenderSystem::signal_extensionsInitialised()
 
 LightList& OpenGLRenderSystem::attachLitObject(LitObject& object)
 {
-	return m_lightLists.insert(
-		LightLists::value_type(
-			&object,
-			LinearLightList(
-                object,
-                m_lights,
-                std::bind(
-                    &OpenGLRenderSystem::propagateLightChangedFlagToAllLights,
-                    this
-                )
-            )
-        )
-    ).first->second;
+	return _lightInteractions.attachLitObject(object);
 }
 
 void OpenGLRenderSystem::detachLitObject(LitObject& object) 
 {
-	m_lightLists.erase(&object);
+	_lightInteractions.detachLitObject(object);
 }
 
 void OpenGLRenderSystem::litObjectChanged(LitObject& object) 
 {
-	LightLists::iterator i = m_lightLists.find(&object);
-    assert(i != m_lightLists.end());
-
-	i->second.setDirty();
+	_lightInteractions.litObjectChanged(object);
 }
 
 void OpenGLRenderSystem::attachLight(RendererLight& light)
 {
-    ASSERT_MESSAGE(m_lights.find(&light) == m_lights.end(), "light could not be attached");
-    m_lights.insert(&light);
-    lightChanged(light);
+	_lightInteractions.attachLight(light);
 }
 
 void OpenGLRenderSystem::detachLight(RendererLight& light)
 {
-    ASSERT_MESSAGE(m_lights.find(&light) != m_lights.end(), "light could not be detached");
-    m_lights.erase(&light);
-    lightChanged(light);
+	_lightInteractions.detachLight(light);
 }
 
 void OpenGLRenderSystem::lightChanged(RendererLight& light)
 {
-    m_lightsChanged = true;
-}
-
-void OpenGLRenderSystem::propagateLightChangedFlagToAllLights()
-{
-    if (m_lightsChanged)
-    {
-    	m_lightsChanged = false;
-    	for (LightLists::iterator i = m_lightLists.begin();
-             i != m_lightLists.end();
-             ++i) 
-        {
-    		i->second.setDirty();
-    	}
-	}
+	_lightInteractions.lightChanged(light);
 }
 
 void OpenGLRenderSystem::insertSortedState(const OpenGLStates::value_type& val) {
 	_state_sorted.insert(val);
+	_sortIndicesValid = false;
 }
 
 void OpenGLRenderSystem::eraseSortedState(const OpenGLStates::key_type& key) {
-	_state_sorted.erase(key);
+	OpenGLStates::iterator found = _state_sorted.find(key);
+
+	if (found != _state_sorted.end())
+	{
+		// The pass might be deleted before the next frame is rendered
+		_renderQueue.remove(*found->second);
+		found->second->setSortIndex(OpenGLShaderPass::NO_SORT_INDEX);
+
+		_state_sorted.erase(found);
+	}
+
+	_sortIndicesValid = false;
+}
+
+void OpenGLRenderSystem::updateSortIndices()
+{
+	std::size_t sortIndex = 0;
+
+	for (const OpenGLStates::value_type& pair : _state_sorted)
+	{
+		pair.second->setSortIndex(sortIndex++);
+	}
+
+	_sortIndicesValid = true;
+}
+
+RenderQueue& OpenGLRenderSystem::getRenderQueue()
+{
+	return _renderQueue;
 }
 
 // renderables
@@ -540,6 +557,8 @@ void OpenGLRenderSystem::initialiseModule(const ApplicationContext& ctx)
 		sigc::mem_fun(*this, &OpenGLRenderSystem::realise));
 	_materialDefsUnloaded = GlobalMaterialManager().signal_DefsUnloaded().connect(
 		sigc::mem_fun(*this, &OpenGLRenderSystem::unrealise));
+	_materialChanged = GlobalMaterialManager().signal_MaterialChanged().connect(
+		sigc::mem_fun(*this, &OpenGLRenderSystem::onMaterialChanged));
 
 	if (GlobalMaterialManager().isRealised())
 	{
@@ -555,6 +574,7 @@ void OpenGLRenderSystem::shutdownModule()
 {
 	_materialDefsLoaded.disconnect();
 	_materialDefsUnloaded.disconnect();
+	_materialChanged.disconnect();
 }
 
 // Define the static ShaderCache module
@@ -6,7 +6,8 @@
 #include "imodule.h"
 #include "backend/OpenGLStateManager.h"
 #include "backend/OpenGLShader.h"
-#include "LinearLightList.h"
+#include "backend/RenderQueue.h"
+#include "LightInteractions.h"
 #include "render/backend/OpenGLStateLess.h"
 
 namespace render
@@ -40,22 +41,31 @@ private:
 	// Map of OpenGLState references, with access functions.
 	OpenGLStates _state_sorted;
 
+	// The renderables submitted to the shader passes for the next frame
+	RenderQueue _renderQueue;
+
+	// False if the sort indices of the passes need to be assigned again
+	// since the sorted states have changed
+	bool _sortIndicesValid;
+
 	// Render time
 	std::size_t _time;
 
-	// Lights
-	RendererLights m_lights;
-	bool m_lightsChanged;
-	typedef std::map<LitObject*, LinearLightList> LightLists;
-	LightLists m_lightLists;
+	// Lights and the objects lit by them
+	LightInteractions _lightInteractions;
 
 	sigc::signal<void> _sigExtensionsInitialised;
 
 	sigc::connection _materialDefsLoaded;
 	sigc::connection _materialDefsUnloaded;
+	sigc::connection _materialChanged;
 
 private:
-	void propagateLightChangedFlagToAllLights();
+	// Assigns the positions in the sorted states to their shader passes
+	void updateSortIndices();
+
+	// Re-realises the shader using the given (redefined) material
+	void onMaterialChanged(const std::string& materialName);
 
 public:
 
@@ -78,6 +88,9 @@ public:
 
     GLProgramFactory& getGLProgramFactory();
 
+	// The queue collecting the renderables of all shader passes
+	RenderQueue& getRenderQueue();
+
 	std::size_t getTime() const override;
 	void setTime(std::size_t milliSeconds) override;
 
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <wx/stopwatch.h>
-#include "string/string.h"
+#include <chrono>
+#include <fmt/format.h>
+#include "string/convert.h"
 
 namespace render
 {
@@ -14,6 +16,21 @@ class RenderStatistics
 	std::size_t _countStates;
 	std::size_t _countTransforms;
 
+	// Changes of pass, entity or transform in the sorted render queue
+	std::size_t _countStateChanges;
+
+	// Nodes whose renderables have been retained from an earlier frame,
+	// and the ones which needed to submit them again
+	std::size_t _countRetainedNodes;
+	std::size_t _countRecordedNodes;
+
+	// CPU time spent collecting the renderables of the scene
+	std::chrono::steady_clock::duration _collectionTime;
+
+	// The orthoviews render through the same render system, only the
+	// camera frame between resetStats() and stopCounting() is counted
+	bool _counting = false;
+
 	wxStopWatch _timer;
 public:
 	const std::string& getStatString()
@@ -21,20 +38,76 @@ public:
         _statStr = "prims: " + string::to_string(_countPrims) +
 				  " | states: " + string::to_string(_countStates) +
 				  " | transforms: "	+ string::to_string(_countTransforms) +
-				  " | msec: " + string::to_string(_timer.Time());
+				  " | state changes: " + string::to_string(_countStateChanges) +
+				  " | msec: " + string::to_string(_timer.Time()) +
+				  fmt::format(" | collect msec: {0:.2f}", getCollectionTime());
+
+		if (_countRetainedNodes > 0 || _countRecordedNodes > 0)
+		{
+			_statStr += " | retained: " + string::to_string(_countRetainedNodes) +
+					   " | recorded: " + string::to_string(_countRecordedNodes);
+		}
 
 		return _statStr;
 	}
 
-	void resetStats() 
+	void resetStats()
     {
 		_countPrims = 0;
 		_countStates = 0;
 		_countTransforms = 0;
+		_countStateChanges = 0;
+		_countRetainedNodes = 0;
+		_countRecordedNodes = 0;
+		_collectionTime = std::chrono::steady_clock::duration::zero();
+
+		_counting = true;
 
 		_timer.Start();
 	}
 
+	void stopCounting()
+	{
+		_counting = false;
+	}
+
+	void increasePrimitives()
+	{
+		if (_counting) ++_countPrims;
+	}
+
+	void increaseStates()
+	{
+		if (_counting) ++_countStates;
+	}
+
+	void increaseTransforms()
+	{
+		if (_counting) ++_countTransforms;
+	}
+
+	void addStateChanges(std::size_t stateChanges)
+	{
+		if (_counting) _countStateChanges += stateChanges;
+	}
+
+	void addCollectionTime(std::chrono::steady_clock::duration duration)
+	{
+		_collectionTime += duration;
+	}
+
+	// Returns the time spent collecting renderables in milliseconds
+	double getCollectionTime() const
+	{
+		return std::chrono::duration<double, std::milli>(_collectionTime).count();
+	}
+
+	void setRetainedNodes(std::size_t retained, std::size_t recorded)
+	{
+		_countRetainedNodes = retained;
+		_countRecordedNodes = recorded;
+	}
+
 	static RenderStatistics& Instance()
     {
 		static RenderStatistics _instance;
@@ -0,0 +1,325 @@
+#pragma once
+
+#include "math/AABB.h"
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace render
+{
+
+/**
+ * A uniform grid of cubic cells indexing elements by their bounds, such that
+ * the elements overlapping a region can be found without visiting every one
+ * of them. Only the cells containing elements are stored, in a hash map.
+ *
+ * Elements with invalid bounds or bounds spanning too many cells are not
+ * stored in the cells, they are visited by every query instead.
+ *
+ * The Element type must be usable as key of a std::unordered_map, usually
+ * it is a pointer.
+ */
+template<typename Element>
+class SpatialHashGrid
+{
+public:
+	// Elements covering more cells than this are visited by every query
+	static const std::uint64_t MAX_CELLS_PER_ELEMENT = 64;
+
+private:
+	// Cell coordinates are clamped to this range, such that they fit into a CellKey
+	static const long MAX_CELL = (1L << 20) - 1;
+
+	typedef std::uint64_t CellKey;
+
+	// The inclusive range of cells covered by some bounds
+	struct CellRange
+	{
+		long min[3];
+		long max[3];
+
+		std::uint64_t getNumCells() const
+		{
+			return static_cast<std::uint64_t>(max[0] - min[0] + 1) *
+				static_cast<std::uint64_t>(max[1] - min[1] + 1) *
+				static_cast<std::uint64_t>(max[2] - min[2] + 1);
+		}
+	};
+
+	struct Entry
+	{
+		Element element;
+		AABB bounds;
+
+		// True if this entry is not stored in the cells
+		bool global;
+		CellRange cells;
+
+		// The query this entry has last been visited by
+		std::size_t queryStamp;
+	};
+
+	// References to the entries stay valid when the map is rehashed
+	typedef std::unordered_map<Element, Entry> Entries;
+	Entries _entries;
+
+	typedef std::vector<Entry*> CellEntries;
+	std::unordered_map<CellKey, CellEntries> _cells;
+
+	CellEntries _globalEntries;
+
+	double _cellSize;
+
+	std::size_t _queryStamp;
+
+public:
+	SpatialHashGrid(double cellSize = 512) :
+		_cellSize(cellSize),
+		_queryStamp(0)
+	{}
+
+	// The cells refer to the entries of this instance
+	SpatialHashGrid(const SpatialHashGrid& other) = delete;
+	SpatialHashGrid& operator=(const SpatialHashGrid& other) = delete;
+
+	/// Adds the element with the given bounds, or moves it if already present
+	void link(const Element& element, const AABB& bounds)
+	{
+		auto result = _entries.insert(std::make_pair(element, Entry()));
+		Entry& entry = result.first->second;
+
+		if (result.second)
+		{
+			entry.element = element;
+			entry.queryStamp = 0;
+		}
+		else
+		{
+			removeFromCells(entry);
+		}
+
+		entry.bounds = bounds;
+		insertIntoCells(entry);
+	}
+
+	/// Removes the element, returns false if it has not been linked
+	bool unlink(const Element& element)
+	{
+		auto found = _entries.find(element);
+
+		if (found == _entries.end())
+		{
+			return false;
+		}
+
+		removeFromCells(found->second);
+		_entries.erase(found);
+
+		return true;
+	}
+
+	bool contains(const Element& element) const
+	{
+		return _entries.find(element) != _entries.end();
+	}
+
+	/// Retrieves the bounds the element has been linked with, returns false if not linked
+	bool getBounds(const Element& element, AABB& bounds) const
+	{
+		auto found = _entries.find(element);
+
+		if (found == _entries.end())
+		{
+			return false;
+		}
+
+		bounds = found->second.bounds;
+		return true;
+	}
+
+	std::size_t size() const
+	{
+		return _entries.size();
+	}
+
+	/// The number of cells containing at least one element
+	std::size_t getNumCells() const
+	{
+		return _cells.size();
+	}
+
+	/**
+	 * Invokes the functor once for every element whose bounds overlap the
+	 * given ones. Touching bounds count as overlapping, and invalid bounds
+	 * overlap everything. The functor must not link or unlink elements.
+	 */
+	template<typename Functor>
+	void forEachIntersecting(const AABB& bounds, const Functor& functor)
+	{
+		++_queryStamp;
+
+		CellRange range;
+
+		// Visiting all the cells would take longer than visiting all elements
+		if (!getCellRange(bounds, range) || range.getNumCells() > _entries.size())
+		{
+			for (auto& pair : _entries)
+			{
+				visit(pair.second, bounds, functor);
+			}
+
+			return;
+		}
+
+		for (Entry* entry : _globalEntries)
+		{
+			visit(*entry, bounds, functor);
+		}
+
+		forEachCell(range, [&](CellKey key)
+		{
+			auto cell = _cells.find(key);
+
+			if (cell == _cells.end()) return;
+
+			for (Entry* entry : cell->second)
+			{
+				visit(*entry, bounds, functor);
+			}
+		});
+	}
+
+private:
+	template<typename Functor>
+	void visit(Entry& entry, const AABB& bounds, const Functor& functor)
+	{
+		// Elements covering several cells are found more than once
+		if (entry.queryStamp == _queryStamp) return;
+
+		entry.queryStamp = _queryStamp;
+
+		if (overlaps(entry.bounds, bounds))
+		{
+			functor(entry.element);
+		}
+	}
+
+	static bool overlaps(const AABB& a, const AABB& b)
+	{
+		if (!a.isValid() || !b.isValid())
+		{
+			return true;
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			if (fabs(a.origin[i] - b.origin[i]) > a.extents[i] + b.extents[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	long getCell(double value) const
+	{
+		double cell = std::floor(value / _cellSize);
+
+		return static_cast<long>(std::max(-static_cast<double>(MAX_CELL),
+			std::min(static_cast<double>(MAX_CELL), cell)));
+	}
+
+	bool getCellRange(const AABB& bounds, CellRange& range) const
+	{
+		if (!bounds.isValid())
+		{
+			return false;
+		}
+
+		for (int i = 0; i < 3; ++i)
+		{
+			range.min[i] = getCell(bounds.origin[i] - bounds.extents[i]);
+			range.max[i] = getCell(bounds.origin[i] + bounds.extents[i]);
+		}
+
+		return true;
+	}
+
+	static CellKey getCellKey(long x, long y, long z)
+	{
+		// 21 bits per axis, offset to be positive
+		return (static_cast<CellKey>(x + MAX_CELL + 1) << 42) |
+			(static_cast<CellKey>(y + MAX_CELL + 1) << 21) |
+			static_cast<CellKey>(z + MAX_CELL + 1);
+	}
+
+	void insertIntoCells(Entry& entry)
+	{
+		entry.global = !getCellRange(entry.bounds, entry.cells) ||
+			entry.cells.getNumCells() > MAX_CELLS_PER_ELEMENT;
+
+		if (entry.global)
+		{
+			_globalEntries.push_back(&entry);
+			return;
+		}
+
+		forEachCell(entry.cells, [&](CellKey key)
+		{
+			_cells[key].push_back(&entry);
+		});
+	}
+
+	void removeFromCells(Entry& entry)
+	{
+		if (entry.global)
+		{
+			removeEntry(_globalEntries, entry);
+			return;
+		}
+
+		forEachCell(entry.cells, [&](CellKey key)
+		{
+			auto cell = _cells.find(key);
+
+			removeEntry(cell->second, entry);
+
+			if (cell->second.empty())
+			{
+				_cells.erase(cell);
+			}
+		});
+	}
+
+	template<typename Functor>
+	static void forEachCell(const CellRange& range, const Functor& functor)
+	{
+		for (long x = range.min[0]; x <= range.max[0]; ++x)
+		{
+			for (long y = range.min[1]; y <= range.max[1]; ++y)
+			{
+				for (long z = range.min[2]; z <= range.max[2]; ++z)
+				{
+					functor(getCellKey(x, y, z));
+				}
+			}
+		}
+	}
+
+	static void removeEntry(CellEntries& entries, Entry& entry)
+	{
+		auto found = std::find(entries.begin(), entries.end(), &entry);
+
+		if (found != entries.end())
+		{
+			*found = entries.back();
+			entries.pop_back();
+		}
+	}
+};
+
+} // namespace render
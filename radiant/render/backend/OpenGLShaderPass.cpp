@@ -1,5 +1,7 @@
 #include "OpenGLShaderPass.h"
 #include "OpenGLShader.h"
+#include "../OpenGLRenderSystem.h"
+#include "../RenderStatistics.h"
 
 #include "math/Matrix4.h"
 #include "math/AABB.h"
@@ -301,6 +303,8 @@ void OpenGLShaderPass::applyState(OpenGLState& current,
                                   std::size_t time,
                                   const IRenderEntity* entity)
 {
+    RenderStatistics::Instance().increaseStates();
+
     // Evaluate any shader expressions
     if (_glState.stage0)
     {
@@ -571,7 +575,7 @@ void OpenGLShaderPass::addRenderable(const OpenGLRenderable& renderable,
                                       const Matrix4& modelview,
                                       const RendererLight* light)
 {
-    _renderablesWithoutEntity.push_back(TransformedRenderable(renderable, modelview, light, NULL));
+    _owner.getRenderSystem().getRenderQueue().push(*this, renderable, modelview, light, nullptr);
 }
 
 void OpenGLShaderPass::addRenderable(const OpenGLRenderable& renderable,
@@ -579,21 +583,16 @@ void OpenGLShaderPass::addRenderable(const OpenGLRenderable& renderable,
                                       const IRenderEntity& entity,
                                       const RendererLight* light)
 {
-    RenderablesByEntity::iterator i = _renderables.find(&entity);
-
-    if (i == _renderables.end())
-    {
-        i = _renderables.insert(RenderablesByEntity::value_type(&entity, Renderables())).first;
-    }
-
-    i->second.push_back(TransformedRenderable(renderable, modelview, light, &entity));
+    _owner.getRenderSystem().getRenderQueue().push(*this, renderable, modelview, light, &entity);
 }
 
 // Render the bucket contents
 void OpenGLShaderPass::render(OpenGLState& current,
                               unsigned int flagsMask,
                               const Vector3& viewer,
-                              std::size_t time)
+                              std::size_t time,
+                              RenderQueue::const_iterator begin,
+                              RenderQueue::const_iterator end)
 {
     // Reset the texture matrix
     glMatrixMode(GL_TEXTURE);
@@ -601,31 +600,38 @@ void OpenGLShaderPass::render(OpenGLState& current,
 
     glMatrixMode(GL_MODELVIEW);
 
+    markTexturesUsed();
+
     // Apply our state to the current state object
     applyState(current, flagsMask, viewer, time, NULL);
 
-    if (!_renderablesWithoutEntity.empty())
+    // The entries are sorted by entity, the ones without entity coming first.
+    // Entities sharing a sort key might alternate, which costs an extra state
+    // application but is otherwise harmless.
+    for (RenderQueue::const_iterator i = begin; i != end;)
     {
-        renderAllContained(_renderablesWithoutEntity, current, viewer, time);
-    }
+        const IRenderEntity* entity = i->entity;
 
-    for (RenderablesByEntity::const_iterator i = _renderables.begin();
-         i != _renderables.end();
-         ++i)
-    {
-        // Apply our state to the current state object
-        applyState(current, flagsMask, viewer, time, i->first);
+        RenderQueue::const_iterator groupEnd = i;
 
-        if (!stateIsActive())
+        while (groupEnd != end && groupEnd->entity == entity)
         {
-            continue;
+            ++groupEnd;
         }
 
-        renderAllContained(i->second, current, viewer, time);
-    }
+        if (entity != nullptr)
+        {
+            // Apply our state to the current state object
+            applyState(current, flagsMask, viewer, time, entity);
+        }
 
-    _renderablesWithoutEntity.clear();
-    _renderables.clear();
+        if (entity == nullptr || stateIsActive())
+        {
+            renderAllContained(i, groupEnd, current, viewer, time);
+        }
+
+        i = groupEnd;
+    }
 }
 
 bool OpenGLShaderPass::stateIsActive()
@@ -636,6 +642,19 @@ bool OpenGLShaderPass::stateIsActive()
             (_glState.stage3 == NULL || _glState.stage3->isVisible()));
 }
 
+void OpenGLShaderPass::markTexturesUsed()
+{
+    // Evicted textures are loaded again once they're drawn
+    for (GLint texture : { _glState.texture0, _glState.texture1, _glState.texture2,
+                           _glState.texture3, _glState.texture4 })
+    {
+        if (texture != 0)
+        {
+            GlobalMaterialManager().markTextureUsed(static_cast<GLuint>(texture));
+        }
+    }
+}
+
 // Setup lighting
 void OpenGLShaderPass::setUpLightingCalculation(OpenGLState& current,
                                                 const RendererLight* light,
@@ -691,7 +710,8 @@ void OpenGLShaderPass::setUpLightingCalculation(OpenGLState& current,
 }
 
 // Flush renderables
-void OpenGLShaderPass::renderAllContained(const Renderables& renderables,
+void OpenGLShaderPass::renderAllContained(RenderQueue::const_iterator begin,
+                                          RenderQueue::const_iterator end,
                                           OpenGLState& current,
                                           const Vector3& viewer,
                                           std::size_t time)
@@ -701,9 +721,11 @@ void OpenGLShaderPass::renderAllContained(const Renderables& renderables,
 
     glPushMatrix();
 
-    // Iterate over each transformed renderable in the vector
-    for (const TransformedRenderable& r : renderables)
+    // Iterate over each transformed renderable in the range
+    for (RenderQueue::const_iterator i = begin; i != end; ++i)
     {
+        const RenderQueue::Entry& r = *i;
+
         // If the current iteration's transform matrix was different from the
         // last, apply it and store for the next iteration
         if (transform == NULL ||
@@ -714,6 +736,8 @@ void OpenGLShaderPass::renderAllContained(const Renderables& renderables,
             glPushMatrix();
             glMultMatrixd(*transform);
 
+            RenderStatistics::Instance().increaseTransforms();
+
             // Determine the face direction
             if (current.testRenderFlag(RENDER_CULLFACE)
                 && transform->getHandedness() == Matrix4::RIGHTHANDED)
@@ -737,6 +761,8 @@ void OpenGLShaderPass::renderAllContained(const Renderables& renderables,
         // Render the renderable
         RenderInfo info(current.getRenderFlags(), viewer, current.cubeMapMode);
         r.renderable->render(info);
+
+        RenderStatistics::Instance().increasePrimitives();
     }
 
     // Cleanup
@@ -2,9 +2,9 @@
 
 #include "math/Vector3.h"
 #include "iglrender.h"
+#include "RenderQueue.h"
 
-#include <vector>
-#include <map>
+#include <limits>
 
 /* FORWARD DECLS */
 class Matrix4;
@@ -20,8 +20,9 @@ class OpenGLShader;
  * @brief A single component pass of an OpenGL shader.
  *
  * Each OpenGLShader may contain multiple passes, which are rendered
- * independently. Each pass retains its own OpenGLState and a list of renderable
- * objects to be rendered in this pass.
+ * independently. Each pass retains its own OpenGLState, the renderable objects
+ * to be rendered in this pass are collected in the RenderQueue of the render
+ * system.
  */
 class OpenGLShaderPass
 {
@@ -30,44 +31,8 @@ class OpenGLShaderPass
 	// The state applied to this bucket
 	OpenGLState _glState;
 
-	/*
-	 * Representation of a transformed-and-lit renderable object. Stores a
-	 * single object, with its transform matrix and illuminating light source.
-	 */
-	struct TransformedRenderable
-	{
-    	// The renderable object
-    	const OpenGLRenderable* renderable;
-
-    	// The modelview transform for this renderable
-    	const Matrix4* transform;
-
-		// The light falling on this obejct
-    	const RendererLight* light;
-
-		// The entity attached to this renderable
-		const IRenderEntity* entity;
-
-		// Constructor
-		TransformedRenderable(const OpenGLRenderable& r,
-							  const Matrix4& t,
-							  const RendererLight* l,
-							  const IRenderEntity* e)
-		: renderable(&r),
-		  transform(&t),
-		  light(l),
-		  entity(e)
-		{}
-	};
-
-	// Vector of transformed renderables using this state
-	typedef std::vector<TransformedRenderable> Renderables;
-	Renderables _renderablesWithoutEntity;
-	
-	// Renderables sorted by RenderEntity
-	typedef std::map<const IRenderEntity*, Renderables> RenderablesByEntity;
-
-	RenderablesByEntity _renderables;
+	// The position of this pass in the render order, see setSortIndex()
+	std::size_t _sortIndex;
 
 private:
 
@@ -83,10 +48,14 @@ private:
 	// Returns true if the stage associated to this pass is active and should be rendered
 	bool stateIsActive();
 
+	// Tells the material manager which textures are drawn in this frame
+	void markTexturesUsed();
+
 	void setupTextureMatrix(GLenum textureUnit, const ShaderLayerPtr& stage);
 
-	// Render all of the given TransformedRenderables
-	void renderAllContained(const Renderables& renderables,
+	// Render all of the given queue entries
+	void renderAllContained(RenderQueue::const_iterator begin,
+							RenderQueue::const_iterator end,
 							OpenGLState& current,
 						    const Vector3& viewer,
 							std::size_t time);
@@ -121,13 +90,18 @@ private:
 
 public:
 
+	// The sort index of passes which are not part of the sorted states
+	static const std::size_t NO_SORT_INDEX = std::numeric_limits<std::size_t>::max();
+
 	OpenGLShaderPass(OpenGLShader& owner) :
-		_owner(owner)
+		_owner(owner),
+		_sortIndex(NO_SORT_INDEX)
 	{}
 
 	/**
 	 * Add a renderable to this state bucket with the given object transform
-	 * matrix and light.
+	 * matrix and light. The renderable is queued in the render system until
+	 * the next frame is rendered.
 	 */
 	void addRenderable(const OpenGLRenderable& renderable,
 					   const Matrix4& modelview,
@@ -160,9 +134,24 @@ public:
 		return &_glState;
 	}
 
+	/**
+	 * Set the position of this pass in the render order, which is the position
+	 * of its state in the sorted states of the render system. Passes which are
+	 * not part of the sorted states have NO_SORT_INDEX and are not rendered.
+	 */
+	void setSortIndex(std::size_t sortIndex)
+	{
+		_sortIndex = sortIndex;
+	}
+
+	std::size_t getSortIndex() const
+	{
+		return _sortIndex;
+	}
+
 	/**
 	 * \brief
-     * Render the renderables attached to this shader pass.
+     * Render the given renderables of this shader pass.
      *
      * \param current
      * The current OpenGL state variables.
@@ -173,19 +162,15 @@ public:
      * \param viewer
      * Viewer location in world space.
      *
+     * \param begin, end
+     * The sorted queue entries of this pass.
      */
 	void render(OpenGLState& current,
 				unsigned int flagsMask,
 				const Vector3& viewer,
-				std::size_t time);
-
-	/**
-	 * Returns true if this shaderpass doesn't have anything to render.
-	 */
-	bool empty() const
-	{
-		return _renderables.empty() && _renderablesWithoutEntity.empty();
-	}
+				std::size_t time,
+				RenderQueue::const_iterator begin,
+				RenderQueue::const_iterator end);
 
 	friend std::ostream& operator<<(std::ostream& st, const OpenGLShaderPass& self);
 };
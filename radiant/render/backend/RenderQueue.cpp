@@ -0,0 +1,218 @@
+#include "RenderQueue.h"
+
+#include "OpenGLShaderPass.h"
+
+#include <algorithm>
+#include <array>
+
+namespace render
+{
+
+namespace
+{
+	// Layout of the sort keys, from the most significant bits:
+	// pass sort index, entity, transform
+	const unsigned int TRANSFORM_BITS = 24;
+	const unsigned int ENTITY_BITS = 20;
+	const unsigned int PASS_BITS = 64 - ENTITY_BITS - TRANSFORM_BITS;
+
+	const std::uint64_t TRANSFORM_MASK = (1ull << TRANSFORM_BITS) - 1;
+	const std::uint64_t ENTITY_MASK = (1ull << ENTITY_BITS) - 1;
+	const std::uint64_t PASS_MASK = (1ull << PASS_BITS) - 1;
+
+	const unsigned int DIGIT_BITS = 8;
+	const std::size_t NUM_DIGITS = 64 / DIGIT_BITS;
+	const std::size_t DIGIT_VALUES = 1 << DIGIT_BITS;
+}
+
+RenderQueue::RenderQueue() :
+	_lastTransform(nullptr),
+	_transformIndex(0)
+{}
+
+void RenderQueue::push(OpenGLShaderPass& pass, const OpenGLRenderable& renderable, const Matrix4& transform,
+					   const RendererLight* light, const IRenderEntity* entity)
+{
+	if (&transform != _lastTransform)
+	{
+		_lastTransform = &transform;
+
+		// Further transforms share the last index, they're just not grouped
+		if (_transformIndex < TRANSFORM_MASK)
+		{
+			++_transformIndex;
+		}
+	}
+
+	_items.push_back(SortItem{
+		(GetEntityKey(entity) << TRANSFORM_BITS) | _transformIndex,
+		static_cast<std::uint32_t>(_entries.size())
+	});
+
+	_entries.push_back(Entry{ &pass, &renderable, &transform, light, entity, _transformIndex });
+}
+
+void RenderQueue::remove(const OpenGLShaderPass& pass)
+{
+	std::size_t numEntries = 0;
+
+	for (std::size_t i = 0; i < _entries.size(); ++i)
+	{
+		if (_entries[i].pass == &pass)
+		{
+			continue;
+		}
+
+		_entries[numEntries] = _entries[i];
+		_items[numEntries].key = _items[i].key;
+		_items[numEntries].index = static_cast<std::uint32_t>(numEntries);
+		++numEntries;
+	}
+
+	_entries.resize(numEntries);
+	_items.resize(numEntries);
+}
+
+void RenderQueue::sort()
+{
+	// The sort indices of the passes might have changed since the entries were pushed
+	for (SortItem& item : _items)
+	{
+		std::uint64_t passIndex = std::min<std::uint64_t>(_entries[item.index].pass->getSortIndex(), PASS_MASK);
+
+		item.key = (item.key & ~(PASS_MASK << (ENTITY_BITS + TRANSFORM_BITS))) |
+			(passIndex << (ENTITY_BITS + TRANSFORM_BITS));
+	}
+
+	RadixSort(_items, _sortBuffer);
+
+	// Move the entries into their sorted order
+	_entryBuffer.resize(_entries.size());
+
+	for (std::size_t i = 0; i < _items.size(); ++i)
+	{
+		_entryBuffer[i] = _entries[_items[i].index];
+		_items[i].index = static_cast<std::uint32_t>(i);
+	}
+
+	_entries.swap(_entryBuffer);
+
+	_statistics.stateChanges = CountStateChanges(_entries);
+}
+
+RenderQueue::const_iterator RenderQueue::begin() const
+{
+	return _entries.begin();
+}
+
+RenderQueue::const_iterator RenderQueue::end() const
+{
+	return _entries.end();
+}
+
+bool RenderQueue::empty() const
+{
+	return _entries.empty();
+}
+
+void RenderQueue::clear()
+{
+	_entries.clear();
+	_items.clear();
+
+	_lastTransform = nullptr;
+	_transformIndex = 0;
+}
+
+const RenderQueue::Statistics& RenderQueue::getStatistics() const
+{
+	return _statistics;
+}
+
+void RenderQueue::RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& buffer)
+{
+	std::size_t numItems = items.size();
+
+	if (numItems < 2)
+	{
+		return;
+	}
+
+	// Count the values of all digits at once
+	std::array<std::array<std::size_t, DIGIT_VALUES>, NUM_DIGITS> counts = {};
+
+	for (const SortItem& item : items)
+	{
+		for (std::size_t digit = 0; digit < NUM_DIGITS; ++digit)
+		{
+			++counts[digit][(item.key >> (digit * DIGIT_BITS)) & (DIGIT_VALUES - 1)];
+		}
+	}
+
+	buffer.resize(numItems);
+
+	for (std::size_t digit = 0; digit < NUM_DIGITS; ++digit)
+	{
+		auto& digitCounts = counts[digit];
+		unsigned int shift = static_cast<unsigned int>(digit * DIGIT_BITS);
+
+		// Nothing to do if all keys have the same value here
+		if (digitCounts[(items[0].key >> shift) & (DIGIT_VALUES - 1)] == numItems)
+		{
+			continue;
+		}
+
+		// Turn the counts into the first position of each value
+		std::size_t position = 0;
+
+		for (std::size_t& count : digitCounts)
+		{
+			std::size_t valueCount = count;
+			count = position;
+			position += valueCount;
+		}
+
+		for (const SortItem& item : items)
+		{
+			buffer[digitCounts[(item.key >> shift) & (DIGIT_VALUES - 1)]++] = item;
+		}
+
+		items.swap(buffer);
+	}
+}
+
+std::size_t RenderQueue::CountStateChanges(const std::vector<Entry>& entries)
+{
+	std::size_t changes = 0;
+
+	for (std::size_t i = 1; i < entries.size(); ++i)
+	{
+		const Entry& previous = entries[i - 1];
+		const Entry& entry = entries[i];
+
+		if (entry.pass != previous.pass || entry.entity != previous.entity ||
+			entry.transform != previous.transform)
+		{
+			++changes;
+		}
+	}
+
+	return changes;
+}
+
+std::uint64_t RenderQueue::GetEntityKey(const IRenderEntity* entity)
+{
+	if (entity == nullptr)
+	{
+		return 0;
+	}
+
+	// Entities with the same key are still rendered correctly, their
+	// renderables just aren't grouped
+	std::uint64_t hash = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(entity)) *
+		0x9E3779B97F4A7C15ull;
+
+	return 1 + (hash >> (64 - ENTITY_BITS)) % ENTITY_MASK;
+}
+
+}
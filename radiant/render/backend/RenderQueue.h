@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class Matrix4;
+class OpenGLRenderable;
+class RendererLight;
+class IRenderEntity;
+
+namespace render
+{
+
+class OpenGLShaderPass;
+
+/**
+ * The renderables submitted to the shader passes of a render system in the
+ * current frame, replacing the lists of the passes themselves.
+ *
+ * Before rendering, the renderables are sorted by a 64 bit key made of the
+ * sort index of their pass (the position of its state in the sorted states,
+ * see OpenGLShaderPass::getSortIndex()), their render entity and their
+ * transform, such that each pass and entity state is applied once and the
+ * renderables sharing a transform stay together.
+ *
+ * The storage is kept between frames, such that no allocations are needed
+ * once it has grown large enough.
+ */
+class RenderQueue
+{
+public:
+	// A transformed-and-lit renderable object. Multiple entries exist for the
+	// same renderable if there are multiple lights illuminating it.
+	struct Entry
+	{
+		OpenGLShaderPass* pass;
+
+		const OpenGLRenderable* renderable;
+
+		// The modelview transform for this renderable
+		const Matrix4* transform;
+
+		// The light falling on this object
+		const RendererLight* light;
+
+		// The entity attached to this renderable
+		const IRenderEntity* entity;
+
+		// Identifies the transform in the sort key, renderables submitted
+		// right after each other with the same transform share it
+		std::uint32_t transformIndex;
+	};
+
+	typedef std::vector<Entry>::const_iterator const_iterator;
+
+	// The number of times the pass, entity or transform changes
+	// between subsequent entries
+	struct Statistics
+	{
+		std::size_t stateChanges = 0;
+	};
+
+private:
+	std::vector<Entry> _entries;
+
+	// Sort keys and entry indices, the same size as the entries
+	struct SortItem
+	{
+		std::uint64_t key;
+		std::uint32_t index;
+	};
+
+	std::vector<SortItem> _items;
+
+	// Scratch buffers used by sort()
+	std::vector<SortItem> _sortBuffer;
+	std::vector<Entry> _entryBuffer;
+
+	const Matrix4* _lastTransform;
+	std::uint32_t _transformIndex;
+
+	Statistics _statistics;
+
+public:
+	RenderQueue();
+
+	void push(OpenGLShaderPass& pass, const OpenGLRenderable& renderable, const Matrix4& transform,
+			  const RendererLight* light, const IRenderEntity* entity);
+
+	// Removes the entries of the given pass, e.g. before it is deleted
+	void remove(const OpenGLShaderPass& pass);
+
+	/**
+	 * Sorts the entries, using the current sort indices of their passes. Entries
+	 * with the same pass are sorted by entity, the ones without entity coming
+	 * first. Entries which compare equal keep their submission order.
+	 */
+	void sort();
+
+	// Iterate over the entries, sorted after calling sort()
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	bool empty() const;
+
+	// Removes all entries, keeping the storage
+	void clear();
+
+	// Returns the state changes of the entries, determined by sort()
+	const Statistics& getStatistics() const;
+
+private:
+	/**
+	 * Stable LSD radix sort of the given items by their keys, using the given
+	 * buffer (which is resized as needed). Digits which are the same for all
+	 * keys are skipped.
+	 */
+	static void RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& buffer);
+
+	// Counts the changes of pass, entity or transform between subsequent entries
+	static std::size_t CountStateChanges(const std::vector<Entry>& entries);
+
+	static std::uint64_t GetEntityKey(const IRenderEntity* entity);
+};
+
+}
@@ -4,6 +4,7 @@
 #include "ientity.h"
 #include "ieclass.h"
 #include "iscenegraph.h"
+#include "RetainedRenderables.h"
 #include <functional>
 
 namespace render
@@ -28,10 +29,15 @@ private:
     // The view we're using for culling
     const VolumeTest& _volume;
 
+    // Stores the renderables of the nodes supporting it, optional
+    RetainedRenderables* _retained;
+
     // Construct with RenderableCollector to receive renderables
-    RenderableCollectionWalker(RenderableCollector& collector, const VolumeTest& volume) : 
+    RenderableCollectionWalker(RenderableCollector& collector, const VolumeTest& volume,
+                               RetainedRenderables* retained = nullptr) :
 		_collector(collector), 
-		_volume(volume)
+		_volume(volume),
+		_retained(retained)
     {}
 
 public:
@@ -91,6 +97,13 @@ public:
 			_collector.setHighlightFlag(RenderableCollector::Highlight::Primitives, false);
 			_collector.setHighlightFlag(RenderableCollector::Highlight::Faces, false);
 			_collector.setHighlightFlag(RenderableCollector::Highlight::GroupMember, false);
+
+			// Nodes which haven't changed submit the same renderables as in the last frame
+			if (_retained != nullptr && _collector.supportsFullMaterials() &&
+				_retained->submit(node, _collector, _volume))
+			{
+				return true;
+			}
 		}
 
 		dispatchRenderable(*node);
@@ -102,11 +115,16 @@ public:
      * \brief
      * Use a RenderableCollectionWalker to find all renderables in the global
      * scenegraph.
+     *
+     * \param retained
+     * If given, the renderables of nodes supporting retained rendering are
+     * stored there and submitted again in subsequent frames, until they change.
      */
-    static void CollectRenderablesInScene(RenderableCollector& collector, const VolumeTest& volume)
+    static void CollectRenderablesInScene(RenderableCollector& collector, const VolumeTest& volume,
+                                          RetainedRenderables* retained = nullptr)
     {
         // Instantiate a new walker class
-        RenderableCollectionWalker renderHighlightWalker(collector, volume);
+        RenderableCollectionWalker renderHighlightWalker(collector, volume, retained);
 
         // Submit renderables from scene graph
         GlobalSceneGraph().foreachVisibleNodeInVolume(volume, renderHighlightWalker);
@@ -118,6 +136,11 @@ public:
 		{
 			walker.dispatchRenderable(renderable);
 		});
+
+        if (retained != nullptr)
+        {
+            retained->endFrame();
+        }
     }
 };
 
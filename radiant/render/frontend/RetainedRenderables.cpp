@@ -0,0 +1,244 @@
+#include "RetainedRenderables.h"
+
+#include "ivolumetest.h"
+
+namespace render
+{
+
+namespace
+{
+	// Records of deleted nodes are removed once per this many frames
+	const std::size_t PURGE_INTERVAL = 256;
+
+	/**
+	 * Volume letting everything pass, such that the stored renderables don't
+	 * depend on the view they have been stored in. The view matrices are the
+	 * ones of the actual view.
+	 */
+	class UnculledVolume :
+		public VolumeTest
+	{
+	private:
+		const VolumeTest& _view;
+
+	public:
+		UnculledVolume(const VolumeTest& view) :
+			_view(view)
+		{}
+
+		bool TestPoint(const Vector3& point) const override
+		{
+			return true;
+		}
+
+		bool TestLine(const Segment& segment) const override
+		{
+			return true;
+		}
+
+		bool TestPlane(const Plane3& plane) const override
+		{
+			return true;
+		}
+
+		bool TestPlane(const Plane3& plane, const Matrix4& localToWorld) const override
+		{
+			return true;
+		}
+
+		VolumeIntersectionValue TestAABB(const AABB& aabb) const override
+		{
+			return VOLUME_INSIDE;
+		}
+
+		VolumeIntersectionValue TestAABB(const AABB& aabb, const Matrix4& localToWorld) const override
+		{
+			return VOLUME_INSIDE;
+		}
+
+		bool fill() const override
+		{
+			return _view.fill();
+		}
+
+		const Matrix4& GetViewport() const override
+		{
+			return _view.GetViewport();
+		}
+
+		const Matrix4& GetProjection() const override
+		{
+			return _view.GetProjection();
+		}
+
+		const Matrix4& GetModelview() const override
+		{
+			return _view.GetModelview();
+		}
+	};
+}
+
+/**
+ * Passes the renderables on to the actual collector and stores them.
+ * Highlighted renderables are passed on, but they make the stored ones invalid.
+ */
+class RetainedRenderables::Recorder :
+	public RenderableCollector
+{
+private:
+	RenderableCollector& _collector;
+	std::vector<Submission>& _submissions;
+
+	bool _highlighted;
+
+public:
+	Recorder(RenderableCollector& collector, std::vector<Submission>& submissions) :
+		_collector(collector),
+		_submissions(submissions),
+		_highlighted(false)
+	{}
+
+	bool isHighlighted() const
+	{
+		return _highlighted;
+	}
+
+	void addRenderable(const ShaderPtr& shader, const OpenGLRenderable& renderable,
+		const Matrix4& world) override
+	{
+		_submissions.push_back(Submission{ shader, &renderable, &world, nullptr, nullptr });
+		_collector.addRenderable(shader, renderable, world);
+	}
+
+	void addRenderable(const ShaderPtr& shader, const OpenGLRenderable& renderable,
+		const Matrix4& world, const IRenderEntity& entity) override
+	{
+		_submissions.push_back(Submission{ shader, &renderable, &world, &entity, nullptr });
+		_collector.addRenderable(shader, renderable, world, entity);
+	}
+
+	void addRenderable(const ShaderPtr& shader, const OpenGLRenderable& renderable,
+		const Matrix4& world, const IRenderEntity& entity, const LightList& lights) override
+	{
+		_submissions.push_back(Submission{ shader, &renderable, &world, &entity, &lights });
+		_collector.addRenderable(shader, renderable, world, entity, lights);
+	}
+
+	bool supportsFullMaterials() const override
+	{
+		return _collector.supportsFullMaterials();
+	}
+
+	void setHighlightFlag(Highlight::Flags flags, bool enabled) override
+	{
+		if (enabled)
+		{
+			_highlighted = true;
+		}
+
+		_collector.setHighlightFlag(flags, enabled);
+	}
+};
+
+RetainedRenderables::RetainedRenderables() :
+	_frame(0)
+{}
+
+bool RetainedRenderables::submit(const scene::INodePtr& node, RenderableCollector& collector,
+	const VolumeTest& volume)
+{
+	std::size_t generation = node->getRenderGeneration();
+
+	if (generation == 0)
+	{
+		return false;
+	}
+
+	Record& record = _records[node.get()];
+
+	// A live node at the address of a deleted one must be a different node
+	if (record.generation != generation || record.node.expired())
+	{
+		_current.storedRenderables -= record.submissions.size();
+
+		record.node = node;
+		record.generation = generation;
+		record.submissions.clear();
+
+		Recorder recorder(collector, record.submissions);
+		node->renderSolid(recorder, UnculledVolume(volume));
+
+		if (recorder.isHighlighted())
+		{
+			record.generation = 0;
+		}
+
+		_current.storedRenderables += record.submissions.size();
+		++_current.recordedNodes;
+
+		return true;
+	}
+
+	node->updateRetainedRenderables();
+
+	for (const Submission& submission : record.submissions)
+	{
+		if (submission.lights != nullptr)
+		{
+			collector.addRenderable(submission.shader, *submission.renderable, *submission.transform,
+				*submission.entity, *submission.lights);
+		}
+		else if (submission.entity != nullptr)
+		{
+			collector.addRenderable(submission.shader, *submission.renderable, *submission.transform,
+				*submission.entity);
+		}
+		else
+		{
+			collector.addRenderable(submission.shader, *submission.renderable, *submission.transform);
+		}
+	}
+
+	++_current.retainedNodes;
+
+	return true;
+}
+
+void RetainedRenderables::endFrame()
+{
+	if (++_frame % PURGE_INTERVAL == 0)
+	{
+		for (auto i = _records.begin(); i != _records.end();)
+		{
+			if (i->second.node.expired())
+			{
+				_current.storedRenderables -= i->second.submissions.size();
+				i = _records.erase(i);
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	_statistics = _current;
+
+	_current.retainedNodes = 0;
+	_current.recordedNodes = 0;
+}
+
+void RetainedRenderables::clear()
+{
+	_records.clear();
+
+	_current = Statistics();
+	_statistics = Statistics();
+}
+
+const RetainedRenderables::Statistics& RetainedRenderables::getStatistics() const
+{
+	return _statistics;
+}
+
+} // namespace
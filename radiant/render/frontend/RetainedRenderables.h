@@ -0,0 +1,96 @@
+#pragma once
+
+#include "inode.h"
+#include "irenderable.h"
+
+#include <unordered_map>
+#include <vector>
+
+class VolumeTest;
+
+namespace render
+{
+
+/**
+ * Stores the renderables submitted by the scene nodes supporting retained
+ * rendering (see Renderable::getRenderGeneration()), such that they can be
+ * submitted again in subsequent frames without asking the nodes. The stored
+ * renderables of a node are replaced once its render generation changes.
+ *
+ * The renderables are stored without being culled, the nodes themselves are
+ * culled by the scene traversal. Highlighted nodes are not stored, they submit
+ * their renderables each frame.
+ *
+ * Each view keeps its own instance, since the renderables depend on the
+ * RenderableCollector they are submitted to.
+ */
+class RetainedRenderables
+{
+public:
+	struct Statistics
+	{
+		// Nodes whose stored renderables have been submitted in the last frame
+		std::size_t retainedNodes = 0;
+
+		// Nodes whose renderables have been stored (again) in the last frame
+		std::size_t recordedNodes = 0;
+
+		// Number of stored renderables, including the ones of culled nodes
+		std::size_t storedRenderables = 0;
+	};
+
+private:
+	// A single addRenderable() call, the renderable, transform, entity
+	// and lights are owned by the node
+	struct Submission
+	{
+		ShaderPtr shader;
+		const OpenGLRenderable* renderable;
+		const Matrix4* transform;
+		const IRenderEntity* entity;
+		const LightList* lights;
+	};
+
+	// The collector storing the renderables of a node, see the .cpp file
+	class Recorder;
+
+	struct Record
+	{
+		// Detects nodes which have been deleted in the meantime
+		scene::INodeWeakPtr node;
+
+		// 0 if the renderables need to be stored again
+		std::size_t generation = 0;
+
+		std::vector<Submission> submissions;
+	};
+
+	std::unordered_map<const scene::INode*, Record> _records;
+
+	std::size_t _frame;
+
+	// The statistics of the current and of the last frame
+	Statistics _current;
+	Statistics _statistics;
+
+public:
+	RetainedRenderables();
+
+	/**
+	 * Submits the renderables of the given node to the collector, which has to
+	 * support full materials. Returns false without submitting anything if the
+	 * node doesn't support retained rendering.
+	 */
+	bool submit(const scene::INodePtr& node, RenderableCollector& collector, const VolumeTest& volume);
+
+	// Ends the current frame, the records of deleted nodes are removed every now and then
+	void endFrame();
+
+	// Removes all stored renderables
+	void clear();
+
+	// Returns the statistics of the last frame
+	const Statistics& getStatistics() const;
+};
+
+} // namespace
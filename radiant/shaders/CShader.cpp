@@ -59,9 +59,31 @@ TexturePtr CShader::getEditorImage()
     return _editorTexture;
 }
 
+TexturePtr CShader::getEditorThumbnail()
+{
+    if (!_editorThumbnail)
+    {
+        MapExpressionPtr editorTex = std::dynamic_pointer_cast<MapExpression>(
+            _template->getEditorTexture()
+        );
+
+        // Cube maps and missing images are shown as they are
+        if (!editorTex || editorTex->isCubeMap())
+        {
+            return getEditorImage();
+        }
+
+        _editorThumbnail = GetTextureManager().getBinding(
+            std::make_shared<ThumbnailExpression>(_name, editorTex, GetThumbnailCache())
+        );
+    }
+
+    return _editorThumbnail;
+}
+
 bool CShader::isEditorImageNoTex()
 {
-	return (getEditorImage() == GetTextureManager().getShaderNotFound());
+	return GetTextureManager().isShaderNotFound(getEditorImage());
 }
 
 // Return the falloff texture name
@@ -220,6 +242,21 @@ void CShader::setName(const std::string& name) {
 	_name = name;
 }
 
+void CShader::setDefinition(const ShaderDefinition& definition)
+{
+	unrealise();
+
+	_template = definition.shaderTemplate;
+	_fileName = definition.file.name;
+
+	// Images are looked up again on demand
+	_editorTexture.reset();
+	_editorThumbnail.reset();
+	_texLightFalloff.reset();
+
+	realise();
+}
+
 ShaderLayer* CShader::firstLayer() const
 {
 	if (_layers.empty())
@@ -24,6 +24,9 @@ private:
 	// The 2D editor texture
 	TexturePtr _editorTexture;
 
+	// Its thumbnail, shown by the texture browsers
+	TexturePtr _editorThumbnail;
+
 	TexturePtr _texLightFalloff;
 
 	bool m_bInUse;
@@ -48,6 +51,7 @@ public:
     int getSortRequest() const;
     float getPolygonOffset() const;
 	TexturePtr getEditorImage();
+	TexturePtr getEditorThumbnail();
 	bool isEditorImageNoTex();
 
 	// Return the light falloff texture (Z dimension).
@@ -118,6 +122,10 @@ public:
 	 */
 	void setName(const std::string& name);
 
+	// Replaces the definition of this shader (after its file has been
+	// re-parsed), re-realising the shader.
+	void setDefinition(const ShaderDefinition& definition);
+
 	ShaderLayer* firstLayer() const;
 
     /* Material implementation */
@@ -81,6 +81,7 @@ const IShaderExpressionPtr Doom3ShaderLayer::NULL_EXPRESSION;
 Doom3ShaderLayer::Doom3ShaderLayer(ShaderTemplate& material, ShaderLayer::Type type, const NamedBindablePtr& btex)
 :	_material(material),
 	_registers(NUM_RESERVED_REGISTERS),
+	_program(_registers),
 	_condition(REG_ONE),
 	_bindableTex(btex),
 	_type(type),
@@ -152,10 +153,8 @@ Colour4 Doom3ShaderLayer::getColour() const
 
 void Doom3ShaderLayer::setColourExpression(ColourComponentSelector comp, const IShaderExpressionPtr& expr)
 {
-	// Store the expression and link it to our registers
-	_expressions.push_back(expr);
-
-	std::size_t index = expr->linkToRegister(_registers);
+	// Compile the expression into our registers
+	std::size_t index = _program.compile(expr);
 
 	// Now assign the index to our colour components
 	switch (comp)
@@ -191,8 +190,9 @@ void Doom3ShaderLayer::setColour(const Vector4& col)
 	// Assign all 3 components of the colour, allocating new registers on the fly where needed
 	for (std::size_t i = 0; i < 4; ++i)
 	{
-		// Does this colour component refer to a reserved constant index?
-		if (_colIdx[i] < NUM_RESERVED_REGISTERS)
+		// Does this colour component refer to a reserved or compiled register?
+		// The latter might be shared with other expressions.
+		if (_colIdx[i] < NUM_RESERVED_REGISTERS || _program.ownsRegister(_colIdx[i]))
 		{
 			// Yes, break this up by allocating a new register for this value
 			_colIdx[i] = getNewRegister(static_cast<float>(col[i]));
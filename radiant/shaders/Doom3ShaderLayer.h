@@ -5,6 +5,7 @@
 
 #include "math/Vector4.h"
 #include "NamedBindable.h"
+#include "ExpressionProgram.h"
 
 namespace shaders
 {
@@ -39,9 +40,8 @@ private:
     // The registers keeping the results of expression evaluations
     Registers _registers;
 
-    // The expressions used in this stage
-    typedef std::vector<IShaderExpressionPtr> Expressions;
-    Expressions _expressions;
+    // The expressions used in this stage, compiled into the registers above
+    ExpressionProgram _program;
 
     static const IShaderExpressionPtr NULL_EXPRESSION;
 
@@ -133,27 +133,18 @@ public:
 
     void setCondition(const IShaderExpressionPtr& conditionExpr)
     {
-        // Store the expression in our list
-        _expressions.push_back(conditionExpr);
-
-        // Link the result to our local registers
-        _condition = conditionExpr->linkToRegister(_registers);
+        // Compile the expression, the result ends up in our local registers
+        _condition = _program.compile(conditionExpr);
     }
 
     void evaluateExpressions(std::size_t time) 
     {
-        for (Expressions::iterator i = _expressions.begin(); i != _expressions.end(); ++i)
-        {
-            (*i)->evaluate(time);
-        }
+        _program.evaluate(time);
     }
 
     void evaluateExpressions(std::size_t time, const IRenderEntity& entity)
     {
-        for (Expressions::iterator i = _expressions.begin(); i != _expressions.end(); ++i)
-        {
-            (*i)->evaluate(time, entity);
-        }
+        _program.evaluate(time, entity);
     }
 
     /**
@@ -296,11 +287,8 @@ public:
      */
     void setScale(const IShaderExpressionPtr& xExpr, const IShaderExpressionPtr& yExpr)
     {
-        _expressions.push_back(xExpr);
-        _expressions.push_back(yExpr);
-
-        _scale[0] = xExpr->linkToRegister(_registers);
-        _scale[1] = yExpr->linkToRegister(_registers);
+        _scale[0] = _program.compile(xExpr);
+        _scale[1] = _program.compile(yExpr);
     }
 
     Vector2 getTranslation() 
@@ -313,11 +301,8 @@ public:
      */
     void setTranslation(const IShaderExpressionPtr& xExpr, const IShaderExpressionPtr& yExpr)
     {
-        _expressions.push_back(xExpr);
-        _expressions.push_back(yExpr);
-
-        _translation[0] = xExpr->linkToRegister(_registers);
-        _translation[1] = yExpr->linkToRegister(_registers);
+        _translation[0] = _program.compile(xExpr);
+        _translation[1] = _program.compile(yExpr);
     }
 
     float getRotation() 
@@ -330,9 +315,7 @@ public:
      */
     void setRotation(const IShaderExpressionPtr& expr)
     {
-        _expressions.push_back(expr);
-
-        _rotation = expr->linkToRegister(_registers);
+        _rotation = _program.compile(expr);
     }
 
     Vector2 getShear() 
@@ -345,11 +328,8 @@ public:
      */
     void setShear(const IShaderExpressionPtr& xExpr, const IShaderExpressionPtr& yExpr)
     {
-        _expressions.push_back(xExpr);
-        _expressions.push_back(yExpr);
-
-        _shear[0] = xExpr->linkToRegister(_registers);
-        _shear[1] = yExpr->linkToRegister(_registers);
+        _shear[0] = _program.compile(xExpr);
+        _shear[1] = _program.compile(yExpr);
     }
 
     /**
@@ -367,8 +347,7 @@ public:
      */
     void setAlphaTest(const IShaderExpressionPtr& expr)
     {
-        _expressions.push_back(expr);
-        _alphaTest = expr->linkToRegister(_registers);
+        _alphaTest = _program.compile(expr);
     }
 
     // Returns the value of the given register
@@ -422,25 +401,21 @@ public:
     {
         assert(parm0);
 
-        _expressions.push_back(parm0);
-        std::size_t parm0Reg = parm0->linkToRegister(_registers);
+        std::size_t parm0Reg = _program.compile(parm0);
 
         _vertexParms.push_back(parm0Reg);
 
         if (parm1)
         {
-            _expressions.push_back(parm1);
-            _vertexParms.push_back(parm1->linkToRegister(_registers));
+            _vertexParms.push_back(_program.compile(parm1));
 
             if (parm2)
             {
-                _expressions.push_back(parm2);
-                _vertexParms.push_back(parm2->linkToRegister(_registers));
+                _vertexParms.push_back(_program.compile(parm2));
 
                 if (parm3)
                 {
-                    _expressions.push_back(parm3);
-                    _vertexParms.push_back(parm3->linkToRegister(_registers));
+                    _vertexParms.push_back(_program.compile(parm3));
                 }
                 else
                 {
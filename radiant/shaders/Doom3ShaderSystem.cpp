@@ -11,12 +11,18 @@
 #include "iradiant.h"
 #include "igame.h"
 #include "iarchive.h"
+#include "ideclloadscheduler.h"
+#include "ideclcache.h"
+#include "registry/registry.h"
 
 #include "xmlutil/Node.h"
 #include "xmlutil/MissingXMLNodeException.h"
 
 #include "ShaderDefinition.h"
 #include "ShaderExpression.h"
+#include "MapExpressionCache.h"
+#include "textures/TextureManipulator.h"
+#include "textures/TextureUploader.h"
 
 #include "debugging/ScopedDebugTimer.h"
 #include "modulesystem/StaticModule.h"
@@ -40,6 +46,36 @@ in game descriptor";
     const std::string IMAGE_FLAT = "_flat.bmp";
     const std::string IMAGE_BLACK = "_black.bmp";
 
+    const char* const RKEY_PREPARSE_MATERIALS = "user/ui/textures/preParseMaterials";
+    const char* const RKEY_LOAD_TEXTURES_IN_BACKGROUND = "user/ui/textures/loadInBackground";
+    const char* const RKEY_MAP_EXPRESSION_CACHE_SIZE = "user/ui/textures/mapExpressionCacheSize";
+    const char* const RKEY_TEXTURE_BUDGET = "user/ui/textures/textureBudget";
+
+    // Get the shaders path (including trailing slash) from the XML game file
+    std::string getMaterialsBasePath()
+    {
+        xml::NodeList nlShaderPath =
+            GlobalGameManager().currentGame()->getLocalXPath("/filesystem/shaders/basepath");
+        if (nlShaderPath.empty())
+            throw xml::MissingXMLNodeException(MISSING_BASEPATH_NODE);
+
+        std::string sPath = nlShaderPath[0].getContent();
+        if (!string::ends_with(sPath, "/"))
+            sPath += "/";
+
+        return sPath;
+    }
+
+    // Get the material file extension from the XML game file
+    std::string getMaterialsExtension()
+    {
+        xml::NodeList nlShaderExt =
+            GlobalGameManager().currentGame()->getLocalXPath("/filesystem/shaders/extension");
+        if (nlShaderExt.empty())
+            throw xml::MissingXMLNodeException(MISSING_EXTENSION_NODE);
+
+        return nlShaderExt[0].getContent();
+    }
 }
 
 namespace shaders
@@ -47,7 +83,8 @@ namespace shaders
 
 // Constructor
 Doom3ShaderSystem::Doom3ShaderSystem() :
-    _defLoader(std::bind(&Doom3ShaderSystem::loadMaterialFiles, this)),
+    _defLoader("Materials", std::bind(&Doom3ShaderSystem::loadMaterialFiles, this),
+        {}, decl::LoadPriority::High),
     _enableActiveUpdates(true),
     _realised(false)
 {}
@@ -56,6 +93,30 @@ void Doom3ShaderSystem::construct()
 {
     _library = std::make_shared<ShaderLibrary>();
     _textureManager = std::make_shared<GLTextureManager>();
+    _textureManager->setBitmapsPath(GlobalRegistry().get(RKEY_BITMAPS_PATH));
+    _textureUploader = std::make_shared<TextureUploader>(*_textureManager,
+        std::bind(&Doom3ShaderSystem::onTexturesUploaded, this));
+    _preParser.reset(new MaterialPreParser(GlobalDeclLoadScheduler()));
+
+    // The decoders resample images, make sure the manipulator is constructed
+    // on the main thread before any of them is running
+    TextureManipulator::instance().getImageKernels().setSubTaskRunner(
+        std::bind(&decl::ILoadScheduler::runSubTasks, &GlobalDeclLoadScheduler(), std::placeholders::_1));
+
+    loadTexturesInBackgroundChanged();
+    GlobalRegistry().signalForKey(RKEY_LOAD_TEXTURES_IN_BACKGROUND).connect(
+        sigc::mem_fun(this, &Doom3ShaderSystem::loadTexturesInBackgroundChanged)
+    );
+
+    mapExpressionCacheSizeChanged();
+    GlobalRegistry().signalForKey(RKEY_MAP_EXPRESSION_CACHE_SIZE).connect(
+        sigc::mem_fun(this, &Doom3ShaderSystem::mapExpressionCacheSizeChanged)
+    );
+
+    textureBudgetChanged();
+    GlobalRegistry().signalForKey(RKEY_TEXTURE_BUDGET).connect(
+        sigc::mem_fun(this, &Doom3ShaderSystem::textureBudgetChanged)
+    );
 
     // Register this class as VFS observer
     GlobalFileSystem().addObserver(*this);
@@ -66,6 +127,13 @@ void Doom3ShaderSystem::destroy()
     // De-register this class as VFS Observer
     GlobalFileSystem().removeObserver(*this);
 
+    // Wait for the background parser before the templates go away
+    _preParser->cancel();
+
+    // No more uploads, the decoders stop as well
+    _textureUploader.reset();
+    _textureManager->cancelDecoding();
+
     // Free the shaders if we're in realised state
     if (_realised) 
     {
@@ -78,23 +146,9 @@ void Doom3ShaderSystem::destroy()
 
 ShaderLibraryPtr Doom3ShaderSystem::loadMaterialFiles()
 {
-    // Get the shaders path and extension from the XML game file
-    xml::NodeList nlShaderPath =
-        GlobalGameManager().currentGame()->getLocalXPath("/filesystem/shaders/basepath");
-    if (nlShaderPath.empty())
-        throw xml::MissingXMLNodeException(MISSING_BASEPATH_NODE);
-
-    xml::NodeList nlShaderExt =
-        GlobalGameManager().currentGame()->getLocalXPath("/filesystem/shaders/extension");
-    if (nlShaderExt.empty())
-        throw xml::MissingXMLNodeException(MISSING_EXTENSION_NODE);
-
     // Load the shader files from the VFS
-    std::string sPath = nlShaderPath[0].getContent();
-    if (!string::ends_with(sPath, "/"))
-        sPath += "/";
-
-    std::string extension = nlShaderExt[0].getContent();
+    std::string sPath = getMaterialsBasePath();
+    std::string extension = getMaterialsExtension();
 
     ShaderLibraryPtr library = std::make_shared<ShaderLibrary>();
 
@@ -103,14 +157,93 @@ ShaderLibraryPtr Doom3ShaderSystem::loadMaterialFiles()
         ScopedDebugTimer timer("ShaderFiles parsed: ");
         ShaderFileLoader<ShaderLibrary> loader(GlobalFileSystem(), *library,
                                                sPath, extension);
+        loader.setSubTaskRunner(std::bind(&decl::ILoadScheduler::runSubTasks,
+                                          &GlobalDeclLoadScheduler(), std::placeholders::_1));
+        loader.setDeclCache(&GlobalDeclCache());
         loader.parseFiles();
     }
 
+    // Remember what has been loaded, for the incremental reloads
+    _materialFiles.reset(GlobalFileSystem(), sPath, extension);
+
     rMessage() << library->getNumDefinitions() << " shader definitions found." << std::endl;
 
     return library;
 }
 
+void Doom3ShaderSystem::reloadMaterialFiles(const std::set<std::string>& files)
+{
+    ensureDefsLoaded();
+
+    std::string basePath = getMaterialsBasePath();
+
+    // Deleted files are not parsed, their definitions just go away
+    std::vector<vfs::FileInfo> existingFiles;
+
+    for (const std::string& file : files)
+    {
+        if (GlobalFileSystem().getFileCount(file) > 0)
+        {
+            existingFiles.push_back(vfs::FileInfo{ basePath, file.substr(basePath.length()) });
+        }
+    }
+
+    std::set<std::string> changedNames;
+
+    try
+    {
+        ScopedDebugTimer timer("Changed ShaderFiles parsed: ");
+
+        ShaderLibrary reparsed;
+        ShaderFileLoader<ShaderLibrary> loader(GlobalFileSystem(), reparsed, existingFiles);
+        loader.setSubTaskRunner(std::bind(&decl::ILoadScheduler::runSubTasks,
+                                          &GlobalDeclLoadScheduler(), std::placeholders::_1));
+        loader.setDeclCache(&GlobalDeclCache());
+        loader.parseFiles();
+
+        // The background parser is reading the tables of the library
+        _preParser->cancel();
+
+        changedNames = _library->replaceDefinitions(files, reparsed);
+        startPreParser();
+    }
+    catch (const std::runtime_error& ex)
+    {
+        rError() << "[shaders] Failed to reload material files: " << ex.what() << std::endl;
+        return;
+    }
+
+    rMessage() << "[shaders] " << changedNames.size() << " definitions changed in "
+        << files.size() << " files." << std::endl;
+
+    if (changedNames.empty())
+    {
+        return;
+    }
+
+    for (const std::string& name : changedNames)
+    {
+        _signalMaterialChanged.emit(name);
+    }
+
+    activeShadersChangedNotify();
+}
+
+void Doom3ShaderSystem::reloadChangedMaterialFiles()
+{
+    ensureDefsLoaded();
+
+    std::set<std::string> changedFiles = _materialFiles.findChangedFiles(GlobalFileSystem());
+
+    if (changedFiles.empty())
+    {
+        rMessage() << "[shaders] No material files changed." << std::endl;
+        return;
+    }
+
+    reloadMaterialFiles(changedFiles);
+}
+
 void Doom3ShaderSystem::realise()
 {
     if (!_realised) 
@@ -139,9 +272,32 @@ void Doom3ShaderSystem::ensureDefsLoaded()
     if (_library->getNumDefinitions() == 0)
     {
         _library = _defLoader.get();
+
+        if (_library->getNumDefinitions() > 0)
+        {
+            startPreParser();
+        }
     }
 }
 
+void Doom3ShaderSystem::startPreParser()
+{
+    if (!registry::getValue<bool>(RKEY_PREPARSE_MATERIALS))
+    {
+        return;
+    }
+
+    std::vector<ShaderTemplatePtr> templates;
+    templates.reserve(_library->getNumDefinitions());
+
+    _library->foreachTemplate([&](const ShaderTemplatePtr& shaderTemplate)
+    {
+        templates.push_back(shaderTemplate);
+    });
+
+    _preParser->start(templates);
+}
+
 void Doom3ShaderSystem::onFileSystemInitialise()
 {
     realise();
@@ -152,10 +308,43 @@ void Doom3ShaderSystem::onFileSystemShutdown()
     unrealise();
 }
 
+void Doom3ShaderSystem::onFilesChanged(const std::set<std::string>& changedFiles)
+{
+    if (!_realised)
+    {
+        return;
+    }
+
+    std::string basePath = getMaterialsBasePath();
+    std::string extension = "." + getMaterialsExtension();
+
+    std::set<std::string> materialFiles;
+
+    for (const std::string& file : changedFiles)
+    {
+        if (string::starts_with(file, basePath) && string::ends_with(file, extension))
+        {
+            materialFiles.insert(file);
+        }
+    }
+
+    if (!materialFiles.empty())
+    {
+        reloadMaterialFiles(materialFiles);
+        _materialFiles.update(GlobalFileSystem(), materialFiles);
+    }
+}
+
 void Doom3ShaderSystem::freeShaders() {
+    _preParser->cancel();
     _library->clear();
     _defLoader.reset();
+    _materialFiles.clear();
     _textureManager->checkBindings();
+
+    // The image files might have changed as well
+    MapExpressionCache::Instance().clear();
+
     activeShadersChangedNotify();
 }
 
@@ -181,6 +370,50 @@ sigc::signal<void>& Doom3ShaderSystem::signal_DefsUnloaded()
     return _signalDefsUnloaded;
 }
 
+sigc::signal<void, const std::string&>& Doom3ShaderSystem::signal_MaterialChanged()
+{
+    return _signalMaterialChanged;
+}
+
+sigc::signal<void>& Doom3ShaderSystem::signal_TexturesUploaded()
+{
+    return _signalTexturesUploaded;
+}
+
+void Doom3ShaderSystem::markTextureUsed(GLuint textureNum)
+{
+    _textureManager->markTextureUsed(textureNum);
+}
+
+void Doom3ShaderSystem::loadTexturesInBackgroundChanged()
+{
+    _textureManager->setLoadInBackground(
+        registry::getValue<bool>(RKEY_LOAD_TEXTURES_IN_BACKGROUND)
+    );
+}
+
+void Doom3ShaderSystem::mapExpressionCacheSizeChanged()
+{
+    // The preference is given in MB
+    std::size_t megaBytes = registry::getValue<std::size_t>(RKEY_MAP_EXPRESSION_CACHE_SIZE);
+    MapExpressionCache::Instance().setCapacity(megaBytes * 1024 * 1024);
+}
+
+void Doom3ShaderSystem::textureBudgetChanged()
+{
+    // The preference is given in MB, 0 disables the budget
+    std::size_t megaBytes = registry::getValue<std::size_t>(RKEY_TEXTURE_BUDGET);
+    _textureManager->setTextureBudget(megaBytes * 1024 * 1024);
+}
+
+void Doom3ShaderSystem::onTexturesUploaded()
+{
+    // The uploaded textures replace the placeholders in the views
+    GlobalMainFrame().updateAllWindows();
+
+    _signalTexturesUploaded.emit();
+}
+
 // Return a shader by name
 MaterialPtr Doom3ShaderSystem::getMaterialForName(const std::string& name)
 {
@@ -205,6 +438,29 @@ void Doom3ShaderSystem::foreachShaderName(const ShaderNameCallback& callback)
     _library->foreachShaderName(callback);
 }
 
+void Doom3ShaderSystem::prioritiseMaterials(const std::set<std::string>& names)
+{
+    ensureDefsLoaded();
+
+    if (!registry::getValue<bool>(RKEY_PREPARSE_MATERIALS))
+    {
+        return;
+    }
+
+    std::vector<ShaderTemplatePtr> templates;
+
+    for (const std::string& name : names)
+    {
+        // Don't create any definitions for unknown names
+        if (_library->definitionExists(name))
+        {
+            templates.push_back(_library->getDefinition(name).shaderTemplate);
+        }
+    }
+
+    _preParser->prioritise(templates);
+}
+
 void Doom3ShaderSystem::setLightingEnabled(bool enabled)
 {
     ensureDefsLoaded();
@@ -238,6 +494,11 @@ GLTextureManager& Doom3ShaderSystem::getTextureManager()
     return *_textureManager;
 }
 
+ThumbnailCache& Doom3ShaderSystem::getThumbnailCache()
+{
+    return *_thumbnailCache;
+}
+
 // Get default textures
 TexturePtr Doom3ShaderSystem::getDefaultInteractionTexture(ShaderLayer::Type type)
 {
@@ -306,16 +567,60 @@ TableDefinitionPtr Doom3ShaderSystem::getTableForName(const std::string& name)
     return _library->getTableForName(name);
 }
 
+void Doom3ShaderSystem::printMaterialParseStatisticsCmd(const cmd::ArgumentList& args)
+{
+    ShaderTemplate::ParseStatistics statistics = ShaderTemplate::getParseStatistics();
+
+    rMessage() << "[shaders] Materials parsed in the background: " << statistics.preParsed
+        << ", on demand: " << statistics.onDemand
+        << " (main thread: " << statistics.onDemandMainThread << ")" << std::endl;
+
+    MapExpressionCache::Statistics cacheStatistics = MapExpressionCache::Instance().getStatistics();
+
+    rMessage() << "[shaders] Map expression cache: " << cacheStatistics.hits << " hits, "
+        << cacheStatistics.misses << " misses, " << cacheStatistics.evictions << " evictions, "
+        << cacheStatistics.numImages << " images (" << (cacheStatistics.size / (1024 * 1024)) << " MB)"
+        << std::endl;
+
+    TextureResidency::Statistics residencyStatistics = _textureManager->getResidencyStatistics();
+
+    rMessage() << "[shaders] Texture residency: " << residencyStatistics.numTextures << " textures ("
+        << (residencyStatistics.size / (1024 * 1024)) << " of " << (residencyStatistics.budget / (1024 * 1024))
+        << " MB, peak " << (residencyStatistics.peakSize / (1024 * 1024)) << " MB), "
+        << residencyStatistics.evictions << " evictions, " << residencyStatistics.reloads << " reloads"
+        << std::endl;
+
+    ThumbnailCache::Statistics thumbnailStatistics = _thumbnailCache->getStatistics();
+
+    rMessage() << "[shaders] Thumbnail cache: " << thumbnailStatistics.hits << " hits, "
+        << thumbnailStatistics.misses << " misses, " << thumbnailStatistics.numThumbnails << " thumbnails ("
+        << (thumbnailStatistics.fileSize / 1024) << " KB)" << std::endl;
+}
+
+void Doom3ShaderSystem::invalidateThumbnailCacheCmd(const cmd::ArgumentList& args)
+{
+    _thumbnailCache->invalidate();
+    rMessage() << "[shaders] Thumbnail cache invalidated, thumbnails will be created again." << std::endl;
+}
+
 void Doom3ShaderSystem::refreshShadersCmd(const cmd::ArgumentList& args)
 {
     // Disable screen updates for the scope of this function
     IScopedScreenUpdateBlockerPtr blocker = GlobalMainFrame().getScopedScreenUpdateBlocker(_("Processing..."), _("Loading Shaders"));
 
-    // Reload the Shadersystem, this will also trigger an 
-    // OpenGLRenderSystem unrealise/realise sequence as the rendersystem
-    // is attached to this class as Observer
-    // We can't do this refresh() operation in a thread it seems due to context binding
-    refresh();
+    if (!_realised || (!args.empty() && args[0].getString() == "full"))
+    {
+        // Reload the Shadersystem, this will also trigger an
+        // OpenGLRenderSystem unrealise/realise sequence as the rendersystem
+        // is attached to this class as Observer
+        // We can't do this refresh() operation in a thread it seems due to context binding
+        refresh();
+    }
+    else
+    {
+        // Only the changed materials are updated, along with their users
+        reloadChangedMaterialFiles();
+    }
 
     GlobalMainFrame().updateAllWindows();
 }
@@ -336,6 +641,8 @@ const StringSet& Doom3ShaderSystem::getDependencies() const
         _dependencies.insert(MODULE_XMLREGISTRY);
         _dependencies.insert(MODULE_GAMEMANAGER);
         _dependencies.insert(MODULE_PREFERENCESYSTEM);
+        _dependencies.insert(MODULE_DECLLOADSCHEDULER);
+        _dependencies.insert(MODULE_DECLCACHE);
     }
 
     return _dependencies;
@@ -345,9 +652,29 @@ void Doom3ShaderSystem::initialiseModule(const ApplicationContext& ctx)
 {
     rMessage() << getName() << "::initialiseModule called" << std::endl;
 
-    GlobalCommandSystem().addCommand("RefreshShaders", 
-        std::bind(&Doom3ShaderSystem::refreshShadersCmd, this, std::placeholders::_1));
+    GlobalCommandSystem().addCommand("RefreshShaders",
+        std::bind(&Doom3ShaderSystem::refreshShadersCmd, this, std::placeholders::_1),
+        { cmd::ARGTYPE_STRING | cmd::ARGTYPE_OPTIONAL });
     GlobalEventManager().addCommand("RefreshShaders", "RefreshShaders");
+    GlobalCommandSystem().addCommand("PrintMaterialParseStatistics",
+        std::bind(&Doom3ShaderSystem::printMaterialParseStatisticsCmd, this, std::placeholders::_1));
+    GlobalCommandSystem().addCommand("InvalidateThumbnailCache",
+        std::bind(&Doom3ShaderSystem::invalidateThumbnailCacheCmd, this, std::placeholders::_1));
+
+    // Thumbnails are created on demand, the index of the existing ones is read right away
+    _thumbnailCache.reset(new ThumbnailCache(ctx.getSettingsPath() + "thumbnails.bin",
+        Material::THUMBNAIL_SIZE));
+    _thumbnailCache->load();
+
+    // Parses of the main thread are the ones the background parser is meant to avoid
+    ShaderTemplate::setMainThread(std::this_thread::get_id());
+
+    IPreferencePage& page = GlobalPreferenceSystem().getPage("Settings/Textures");
+    page.appendCheckBox(_("Parse materials in the background"), RKEY_PREPARSE_MATERIALS);
+    page.appendCheckBox(_("Load textures in the background"), RKEY_LOAD_TEXTURES_IN_BACKGROUND);
+    page.appendSpinner(_("Texture upload time per frame (ms)"), TextureUploader::RKEY_UPLOAD_TIME, 1, 100, 0);
+    page.appendSpinner(_("Map expression image cache (MB)"), RKEY_MAP_EXPRESSION_CACHE_SIZE, 0, 4096, 0);
+    page.appendSpinner(_("Texture memory budget (MB, 0 = unlimited)"), RKEY_TEXTURE_BUDGET, 0, 16384, 0);
 
     construct();
     realise();
@@ -522,8 +849,12 @@ void Doom3ShaderSystem::shutdownModule()
 {
     rMessage() << "Doom3ShaderSystem::shutdownModule called" << std::endl;
 
+    printMaterialParseStatisticsCmd(cmd::ArgumentList());
+
     destroy();
     unrealise();
+
+    _thumbnailCache->save();
 }
 
 // Accessor function encapsulating the static shadersystem instance
@@ -541,6 +872,11 @@ GLTextureManager& GetTextureManager()
     return GetShaderSystem()->getTextureManager();
 }
 
+ThumbnailCache& GetThumbnailCache()
+{
+    return GetShaderSystem()->getThumbnailCache();
+}
+
 // Static module instance
 module::StaticModule<Doom3ShaderSystem> d3ShaderSystemModule;
 
@@ -10,12 +10,17 @@
 
 #include "ShaderLibrary.h"
 #include "TableDefinition.h"
+#include "MaterialPreParser.h"
 #include "textures/GLTextureManager.h"
+#include "ThumbnailCache.h"
 #include "ThreadedDefLoader.h"
+#include "decl/DeclFileIndex.h"
 
 namespace shaders 
 {
 
+class TextureUploader;
+
 /**
  * \brief
  * Implementation of the MaterialManager for Doom 3 .
@@ -31,9 +36,21 @@ class Doom3ShaderSystem :
     // The ShaderFileLoader will provide a new ShaderLibrary once complete
     util::ThreadedDefLoader<ShaderLibraryPtr> _defLoader;
 
+    // The state of the material files as of the last (re)load
+    decl::DeclFileIndex _materialFiles;
+
+    // Parses the templates of the library in the background
+    std::unique_ptr<MaterialPreParser> _preParser;
+
 	// The manager that handles the texture caching.
 	GLTextureManagerPtr _textureManager;
 
+	// Uploads the textures decoded in the background
+	std::shared_ptr<TextureUploader> _textureUploader;
+
+	// The thumbnails shown by the texture browsers, kept on disk
+	std::unique_ptr<ThumbnailCache> _thumbnailCache;
+
 	// Active shaders list changed signal
     sigc::signal<void> _signalActiveShadersChanged;
 
@@ -46,6 +63,8 @@ class Doom3ShaderSystem :
 	// Signals for module subscribers
 	sigc::signal<void> _signalDefsLoaded;
 	sigc::signal<void> _signalDefsUnloaded;
+	sigc::signal<void, const std::string&> _signalMaterialChanged;
+	sigc::signal<void> _signalTexturesUploaded;
 
 public:
 
@@ -58,6 +77,9 @@ public:
 	// Gets called on shutdown
     void onFileSystemShutdown() override;
 
+	// Re-parses the changed material files
+	void onFilesChanged(const std::set<std::string>& changedFiles) override;
+
 	// greebo: This parses the material files and emits the defs loaded signal
     void realise() override;
 
@@ -72,6 +94,9 @@ public:
 
 	sigc::signal<void>& signal_DefsLoaded() override;
 	sigc::signal<void>& signal_DefsUnloaded() override;
+	sigc::signal<void, const std::string&>& signal_MaterialChanged() override;
+	sigc::signal<void>& signal_TexturesUploaded() override;
+	void markTextureUsed(GLuint textureNum) override;
 
 	// Return a shader by name
     MaterialPtr getMaterialForName(const std::string& name) override;
@@ -80,6 +105,8 @@ public:
 
     void foreachShaderName(const ShaderNameCallback& callback) override;
 
+    void prioritiseMaterials(const std::set<std::string>& names) override;
+
 	void activeShadersChangedNotify();
 
 	// Enable or disable the active shaders callback
@@ -103,6 +130,8 @@ public:
 
 	GLTextureManager& getTextureManager();
 
+	ThumbnailCache& getThumbnailCache();
+
     // Get default textures for D,B,S layers
     TexturePtr getDefaultInteractionTexture(ShaderLayer::Type t) override;
 
@@ -128,7 +157,8 @@ private:
     // For methods accessing the ShaderLibrary the parser thread must be done
     void ensureDefsLoaded();
 
-    // The "Flush & Reload Shaders" command target
+    // The "Reload Materials" command target, reloads the changed material
+    // files only, unless "full" is passed to flush and reload everything
     void refreshShadersCmd(const cmd::ArgumentList& args);
 
     // Unloads all the existing shaders and calls activeShadersChangedNotify()
@@ -138,6 +168,31 @@ private:
     * (doesn't load any textures yet).	*/
     ShaderLibraryPtr loadMaterialFiles();
 
+    // Parses the given material files again, updating the existing materials
+    void reloadMaterialFiles(const std::set<std::string>& files);
+
+    // Reloads the material files which have been added, removed or modified
+    // since they have been loaded
+    void reloadChangedMaterialFiles();
+
+    // Starts parsing all templates of the library in the background (if enabled)
+    void startPreParser();
+
+    // Applies the texture loading preference to the texture manager
+    void loadTexturesInBackgroundChanged();
+
+    // Applies the cache size preference to the MapExpressionCache
+    void mapExpressionCacheSizeChanged();
+
+    // Applies the texture memory budget preference to the texture manager
+    void textureBudgetChanged();
+
+    // Invoked by the TextureUploader
+    void onTexturesUploaded();
+
+    void printMaterialParseStatisticsCmd(const cmd::ArgumentList& args);
+    void invalidateThumbnailCacheCmd(const cmd::ArgumentList& args);
+
 	void testShaderExpressionParsing();
 }; // class Doom3ShaderSystem
 
@@ -147,4 +202,6 @@ Doom3ShaderSystemPtr GetShaderSystem();
 
 GLTextureManager& GetTextureManager();
 
+ThumbnailCache& GetThumbnailCache();
+
 } // namespace shaders
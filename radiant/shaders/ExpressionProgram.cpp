@@ -0,0 +1,281 @@
+#include "ExpressionProgram.h"
+
+#include "irender.h"
+#include "ShaderExpression.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace shaders
+{
+
+ExpressionProgram::ExpressionProgram(Registers& registers) :
+	_registers(registers),
+	_dependencies(registers.size(), Dependency::None),
+	_lastTime(0),
+	_timeEvaluated(false)
+{
+	assert(_registers.size() >= NUM_RESERVED_REGISTERS);
+
+	_dependencies[REG_ZERO] = Dependency::Constant;
+	_dependencies[REG_ONE] = Dependency::Constant;
+
+	_constants[0] = REG_ZERO;
+
+	float one = 1.0f;
+	std::uint32_t oneBits;
+	std::memcpy(&oneBits, &one, sizeof(oneBits));
+
+	_constants[oneBits] = REG_ONE;
+}
+
+std::size_t ExpressionProgram::compile(const IShaderExpressionPtr& expression)
+{
+	assert(expression);
+
+	auto shaderExpression = std::dynamic_pointer_cast<ShaderExpression>(expression);
+
+	if (shaderExpression)
+	{
+		return shaderExpression->compile(*this);
+	}
+
+	// Some other implementation, evaluate it as a whole
+	return addInstruction(OpCode::Evaluate, 0, 0, Dependency::Entity, TableDefinitionPtr(), expression);
+}
+
+void ExpressionProgram::evaluate(std::size_t time)
+{
+	evaluateTime(time);
+	execute(_entityInstructions, time, nullptr);
+}
+
+void ExpressionProgram::evaluate(std::size_t time, const IRenderEntity& entity)
+{
+	evaluateTime(time);
+	execute(_entityInstructions, time, &entity);
+}
+
+bool ExpressionProgram::ownsRegister(std::size_t index) const
+{
+	return getDependency(index) != Dependency::None;
+}
+
+std::size_t ExpressionProgram::getNumTimeInstructions() const
+{
+	return _timeInstructions.size();
+}
+
+std::size_t ExpressionProgram::getNumEntityInstructions() const
+{
+	return _entityInstructions.size();
+}
+
+std::size_t ExpressionProgram::addConstant(float value)
+{
+	std::uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	auto found = _constants.find(bits);
+
+	if (found != _constants.end())
+	{
+		return found->second;
+	}
+
+	std::size_t index = allocateRegister(Dependency::Constant);
+	_registers[index] = value;
+	_constants[bits] = index;
+
+	return index;
+}
+
+std::size_t ExpressionProgram::addTime()
+{
+	return addInstruction(OpCode::Time, 0, 0, Dependency::Time);
+}
+
+std::size_t ExpressionProgram::addShaderParm(int parmNum)
+{
+	return addInstruction(OpCode::ShaderParm, static_cast<std::size_t>(parmNum), 0, Dependency::Entity);
+}
+
+std::size_t ExpressionProgram::addTableLookup(const TableDefinitionPtr& table, std::size_t index)
+{
+	assert(table);
+
+	// Not folded for constant indices, tables are parsed on their first lookup
+	return addInstruction(OpCode::TableLookup, index, 0, getDependency(index), table);
+}
+
+std::size_t ExpressionProgram::addOperation(OpCode op, std::size_t a, std::size_t b)
+{
+	Dependency depA = getDependency(a);
+	Dependency depB = getDependency(b);
+
+	assert(depA != Dependency::None && depB != Dependency::None);
+
+	if (depA == Dependency::Constant && depB == Dependency::Constant)
+	{
+		return addConstant(Apply(op, _registers[a], _registers[b]));
+	}
+
+	// Order the operands of commutative operations, such that a+b and b+a are shared
+	switch (op)
+	{
+	case OpCode::Add:
+	case OpCode::Multiply:
+	case OpCode::Equal:
+	case OpCode::NotEqual:
+	case OpCode::LogicalAnd:
+	case OpCode::LogicalOr:
+		if (b < a)
+		{
+			std::swap(a, b);
+		}
+		break;
+	default:
+		break;
+	};
+
+	return addInstruction(op, a, b, std::max(depA, depB));
+}
+
+float ExpressionProgram::Apply(OpCode op, float a, float b)
+{
+	switch (op)
+	{
+	case OpCode::Add:
+		return a + b;
+	case OpCode::Subtract:
+		return a - b;
+	case OpCode::Multiply:
+		return a * b;
+	case OpCode::Divide:
+		return a / b;
+	case OpCode::Modulo:
+		return fmod(a, b);
+	case OpCode::LesserThan:
+		return a < b ? 1.0f : 0;
+	case OpCode::LesserThanOrEqual:
+		return a <= b ? 1.0f : 0;
+	case OpCode::GreaterThan:
+		return a > b ? 1.0f : 0;
+	case OpCode::GreaterThanOrEqual:
+		return a >= b ? 1.0f : 0;
+	case OpCode::Equal:
+		return a == b ? 1.0f : 0;
+	case OpCode::NotEqual:
+		return a != b ? 1.0f : 0;
+	case OpCode::LogicalAnd:
+		return (a != 0 && b != 0) ? 1.0f : 0;
+	case OpCode::LogicalOr:
+		return (a != 0 || b != 0) ? 1.0f : 0;
+	default:
+		assert(false);
+		return 0;
+	};
+}
+
+std::size_t ExpressionProgram::addInstruction(OpCode op, std::size_t a, std::size_t b, Dependency dependency,
+	const TableDefinitionPtr& table, const IShaderExpressionPtr& expression)
+{
+	// Foreign expressions are evaluated one by one, everything else is shared
+	if (!expression)
+	{
+		auto found = _results.find(std::make_tuple(op, a, b, static_cast<const void*>(table.get())));
+
+		if (found != _results.end())
+		{
+			return found->second;
+		}
+	}
+
+	// Only a TableLookup of a constant index ends up here, which stays the same over time
+	if (dependency == Dependency::Constant)
+	{
+		dependency = Dependency::Time;
+	}
+
+	Instruction instruction;
+	instruction.op = op;
+	instruction.result = allocateRegister(dependency);
+	instruction.a = a;
+	instruction.b = b;
+	instruction.table = table;
+	instruction.expression = expression;
+
+	if (!expression)
+	{
+		_results[std::make_tuple(op, a, b, static_cast<const void*>(table.get()))] = instruction.result;
+	}
+
+	(dependency == Dependency::Time ? _timeInstructions : _entityInstructions).push_back(instruction);
+
+	// The new register needs to be written before its first use
+	_timeEvaluated = false;
+
+	return instruction.result;
+}
+
+std::size_t ExpressionProgram::allocateRegister(Dependency dependency)
+{
+	_registers.push_back(0);
+
+	// The registers might have been allocated by the owner in the meantime
+	_dependencies.resize(_registers.size(), Dependency::None);
+	_dependencies.back() = dependency;
+
+	return _registers.size() - 1;
+}
+
+ExpressionProgram::Dependency ExpressionProgram::getDependency(std::size_t index) const
+{
+	return index < _dependencies.size() ? _dependencies[index] : Dependency::None;
+}
+
+void ExpressionProgram::evaluateTime(std::size_t time)
+{
+	if (_timeEvaluated && time == _lastTime)
+	{
+		return;
+	}
+
+	execute(_timeInstructions, time, nullptr);
+
+	_lastTime = time;
+	_timeEvaluated = true;
+}
+
+void ExpressionProgram::execute(const Instructions& instructions, std::size_t time, const IRenderEntity* entity)
+{
+	for (const Instruction& instruction : instructions)
+	{
+		float& result = _registers[instruction.result];
+
+		switch (instruction.op)
+		{
+		case OpCode::Time:
+			result = time / 1000.0f; // convert msecs to secs
+			break;
+		case OpCode::ShaderParm:
+			// parmNN is 0 without entity
+			result = entity != nullptr ? entity->getShaderParm(static_cast<int>(instruction.a)) : 0.0f;
+			break;
+		case OpCode::TableLookup:
+			result = instruction.table->getValue(_registers[instruction.a]);
+			break;
+		case OpCode::Evaluate:
+			result = entity != nullptr ? instruction.expression->getValue(time, *entity) :
+				instruction.expression->getValue(time);
+			break;
+		default:
+			result = Apply(instruction.op, _registers[instruction.a], _registers[instruction.b]);
+			break;
+		};
+	}
+}
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ishaderexpression.h"
+#include "util/Noncopyable.h"
+#include "TableDefinition.h"
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace shaders
+{
+
+/**
+ * The shader expressions of a material stage, compiled into a flat list of
+ * instructions operating on the stage's registers. Rendering evaluates the
+ * expressions once per renderable, walking the expression trees each time
+ * would be considerably slower.
+ *
+ * While compiling, operations on constants are folded, and identical
+ * sub-expressions share their register (e.g. a "sintable[time * 0.3]" used
+ * for both scale values). The instructions which only depend on the time
+ * are kept apart from those using shader parms: they are run once per time
+ * value, not once per renderable.
+ */
+class ExpressionProgram :
+	public util::Noncopyable
+{
+public:
+	enum class OpCode
+	{
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Modulo,
+		LesserThan,
+		LesserThanOrEqual,
+		GreaterThan,
+		GreaterThanOrEqual,
+		Equal,
+		NotEqual,
+		LogicalAnd,
+		LogicalOr,
+		Time,			// the time in seconds
+		ShaderParm,		// the entity's shader parm a, 0 without entity
+		TableLookup,	// the table's value at index a
+		Evaluate,		// an expression which can't be compiled
+	};
+
+private:
+	struct Instruction
+	{
+		OpCode op;
+		std::size_t result;
+		std::size_t a;
+		std::size_t b;
+		TableDefinitionPtr table;
+		IShaderExpressionPtr expression;
+	};
+	typedef std::vector<Instruction> Instructions;
+
+	// What the value of a register depends on
+	enum class Dependency
+	{
+		None,		// not written by this program
+		Constant,
+		Time,
+		Entity,
+	};
+
+	// The registers of the stage, this program appends its own ones
+	Registers& _registers;
+	std::vector<Dependency> _dependencies;
+
+	Instructions _timeInstructions;
+	Instructions _entityInstructions;
+
+	// The register of each constant (by its bits) and instruction, to share them
+	std::map<std::uint32_t, std::size_t> _constants;
+	std::map<std::tuple<OpCode, std::size_t, std::size_t, const void*>, std::size_t> _results;
+
+	// The time the time-dependent registers have been evaluated for
+	std::size_t _lastTime;
+	bool _timeEvaluated;
+
+public:
+	// Compiles into the given registers, which must outlive this program.
+	// The reserved registers must have been allocated already.
+	ExpressionProgram(Registers& registers);
+
+	/**
+	 * Compiles the given expression, returning the register its value is
+	 * written to by evaluate(). The register might be shared with other
+	 * expressions, it must not be modified.
+	 */
+	std::size_t compile(const IShaderExpressionPtr& expression);
+
+	// Runs the instructions, shader parms evaluate to 0
+	void evaluate(std::size_t time);
+
+	// Runs the instructions, using the shader parms of the given entity
+	void evaluate(std::size_t time, const IRenderEntity& entity);
+
+	// True if the given register is written or shared by this program
+	bool ownsRegister(std::size_t index) const;
+
+	std::size_t getNumTimeInstructions() const;
+	std::size_t getNumEntityInstructions() const;
+
+	// Methods used by the ShaderExpressions to compile themselves,
+	// returning the register holding the value of the added term
+	std::size_t addConstant(float value);
+	std::size_t addTime();
+	std::size_t addShaderParm(int parmNum);
+	std::size_t addTableLookup(const TableDefinitionPtr& table, std::size_t index);
+	std::size_t addOperation(OpCode op, std::size_t a, std::size_t b);
+
+	// Applies the given binary operation to the operands
+	static float Apply(OpCode op, float a, float b);
+
+private:
+	std::size_t addInstruction(OpCode op, std::size_t a, std::size_t b, Dependency dependency,
+		const TableDefinitionPtr& table = TableDefinitionPtr(),
+		const IShaderExpressionPtr& expression = IShaderExpressionPtr());
+
+	std::size_t allocateRegister(Dependency dependency);
+
+	Dependency getDependency(std::size_t index) const;
+
+	void evaluateTime(std::size_t time);
+
+	void execute(const Instructions& instructions, std::size_t time, const IRenderEntity* entity);
+};
+
+} // namespace
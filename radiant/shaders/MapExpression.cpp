@@ -11,10 +11,13 @@
 #include "math/Vector3.h"
 
 #include "RGBAImage.h"
-#include "textures/HeightmapCreator.h"
+#include "ThumbnailCache.h"
 #include "textures/TextureManipulator.h"
 #include "string/predicate.h"
 
+#include <algorithm>
+#include <vector>
+
 /* CONSTANTS */
 namespace {
 
@@ -33,6 +36,26 @@ namespace {
 	const std::string IMAGE_SCRATCH = "_scratch.bmp";
 	const std::string IMAGE_SPOTLIGHT = "_spotlight.bmp";
 	const std::string IMAGE_WHITE = "_white.bmp";
+
+	// 64 bit FNV-1a, used for the thumbnail signatures
+	const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+	const std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+	void hashBytes(std::uint64_t& hash, const void* data, std::size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			hash = (hash ^ bytes[i]) * FNV_PRIME;
+		}
+	}
+
+	void hashString(std::uint64_t& hash, const std::string& str)
+	{
+		// Include the terminator, to keep "ab" + "c" apart from "a" + "bc"
+		hashBytes(hash, str.c_str(), str.size() + 1);
+	}
 }
 
 namespace shaders {
@@ -109,6 +132,22 @@ ImagePtr MapExpression::getResampled(const ImagePtr& input, std::size_t width, s
 	}
 }
 
+ImagePtr MapExpression::getDecompressed(const ImagePtr& input)
+{
+	if (!input->isPrecompressed()) {
+		return input;
+	}
+
+	ImagePtr decompressed = input->getDecompressedMipMap(0);
+
+	if (!decompressed) {
+		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
+		return input;
+	}
+
+	return decompressed;
+}
+
 HeightMapExpression::HeightMapExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	heightMapExp = createForToken(token);
@@ -117,29 +156,42 @@ HeightMapExpression::HeightMapExpression (DefTokeniser& token) {
 	token.assertNextToken(")");
 }
 
-ImagePtr HeightMapExpression::getImage() const {
+ImagePtr HeightMapExpression::createImage(const std::string& bitmapsPath) const {
 	// Get the heightmap from the contained expression
-	ImagePtr heightMap = heightMapExp->getImage();
+	ImagePtr heightMap = heightMapExp->getImage(bitmapsPath);
 
 	if (heightMap == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	heightMap = getDecompressed(heightMap);
+
 	if (heightMap->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return heightMap;
 	}
 
+	std::size_t width = heightMap->getWidth(0);
+	std::size_t height = heightMap->getHeight(0);
+
 	// Convert the heightmap into a normalmap
-	ImagePtr normalMap = createNormalmapFromHeightmap(heightMap, scale);
+	ImagePtr normalMap(new RGBAImage(width, height));
+
+	TextureManipulator::instance().getImageKernels().createNormalMap(
+		heightMap->getMipMapPixels(0), normalMap->getMipMapPixels(0), width, height, scale);
+
 	return normalMap;
 }
 
 std::string HeightMapExpression::getIdentifier() const {
-	std::string identifier = "_heightmap_";
-	identifier.append(heightMapExp->getIdentifier() + string::to_string(scale));
+	// The operands are delimited, identifiers are used as image cache keys
+	std::string identifier = "_heightmap_(";
+	identifier.append(heightMapExp->getIdentifier() + "," + string::to_string(scale) + ")");
 	return identifier;
 }
 
+void HeightMapExpression::collectImageNames(std::set<std::string>& names) const {
+	heightMapExp->collectImageNames(names);
+}
+
 AddNormalsExpression::AddNormalsExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExpOne = createForToken(token);
@@ -148,21 +200,23 @@ AddNormalsExpression::AddNormalsExpression (DefTokeniser& token) {
 	token.assertNextToken(")");
 }
 
-ImagePtr AddNormalsExpression::getImage() const {
-    ImagePtr imgOne = mapExpOne->getImage();
+ImagePtr AddNormalsExpression::createImage(const std::string& bitmapsPath) const {
+    ImagePtr imgOne = mapExpOne->getImage(bitmapsPath);
 
     if (imgOne == NULL) return ImagePtr();
 
     std::size_t width = imgOne->getWidth(0);
     std::size_t height = imgOne->getHeight(0);
 
-    ImagePtr imgTwo = mapExpTwo->getImage();
+    ImagePtr imgTwo = mapExpTwo->getImage(bitmapsPath);
 
     if (imgTwo == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	imgOne = getDecompressed(imgOne);
+	imgTwo = getDecompressed(imgTwo);
+
 	if (imgOne->isPrecompressed() || imgTwo->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return imgOne;
 	}
 
@@ -171,64 +225,40 @@ ImagePtr AddNormalsExpression::getImage() const {
 
     ImagePtr result (new RGBAImage(width, height));
 
-    byte* pixOne = imgOne->getMipMapPixels(0);
-    byte* pixTwo = imgTwo->getMipMapPixels(0);
-    byte* pixOut = result->getMipMapPixels(0);
+    // Take the mean value of the two vectors
+    TextureManipulator::instance().getImageKernels().addNormals(
+        imgOne->getMipMapPixels(0), imgTwo->getMipMapPixels(0), result->getMipMapPixels(0), width * height);
 
-    // iterate through the pixels
-    for( std::size_t y = 0; y < height; y++ )
-	{
-		for( std::size_t x = 0; x < width; x++ )
-		{
-			// create the two vectors
-			Vector3 vectorOne(
-    			static_cast<double>(pixOne[0]),
-    			static_cast<double>(pixOne[1]),
-    			static_cast<double>(pixOne[2])
-			);
-			Vector3 vectorTwo(
-    			static_cast<double>(pixTwo[0]),
-    			static_cast<double>(pixTwo[1]),
-    			static_cast<double>(pixTwo[2])
-			);
-			// Take the mean value of the two vectors
-			Vector3 vectorOut = (vectorOne + vectorTwo) * 0.5;
-
-			pixOut[0] = static_cast<byte>(float_to_integer(vectorOut.x()));
-			pixOut[1] = static_cast<byte>(float_to_integer(vectorOut.y()));
-			pixOut[2] = static_cast<byte>(float_to_integer(vectorOut.z()));
-			pixOut[3] = 255;
-
-			// advance the pixel pointer
-			pixOne += 4;
-			pixTwo += 4;
-			pixOut += 4;
-		}
-    }
     return result;
 }
 
 std::string AddNormalsExpression::getIdentifier() const {
-	std::string identifier = "_addnormals_";
-	identifier.append(mapExpOne->getIdentifier() + mapExpTwo->getIdentifier());
+	std::string identifier = "_addnormals_(";
+	identifier.append(mapExpOne->getIdentifier() + "," + mapExpTwo->getIdentifier() + ")");
 	return identifier;
 }
 
+void AddNormalsExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExpOne->collectImageNames(names);
+	mapExpTwo->collectImageNames(names);
+}
+
 SmoothNormalsExpression::SmoothNormalsExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
 	token.assertNextToken(")");
 }
 
-ImagePtr SmoothNormalsExpression::getImage() const {
+ImagePtr SmoothNormalsExpression::createImage(const std::string& bitmapsPath) const {
 
-	ImagePtr normalMap = mapExp->getImage();
+	ImagePtr normalMap = mapExp->getImage(bitmapsPath);
 
 	if (normalMap == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	normalMap = getDecompressed(normalMap);
+
 	if (normalMap->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return normalMap;
 	}
 
@@ -237,56 +267,10 @@ ImagePtr SmoothNormalsExpression::getImage() const {
 
 	ImagePtr result (new RGBAImage(width, height));
 
-	byte* in = normalMap->getMipMapPixels(0);
-	byte* out = result->getMipMapPixels(0);
-
-	struct KernelElement {
-		// offset to the current pixel
-		int dx, dy;
-	};
-
-	// a 3x3 kernel with the surrounding pixels including the pixel itself
-	const int kernelSize = 9;
-	KernelElement kernel[kernelSize] = {
-		{-1, -1 },
-		{ 0, -1 },
-		{ 1, -1 },
-		{ 1,  0 },
-		{ 1,  1 },
-		{ 0,  1 },
-		{-1,  1 },
-		{-1,  0 },
-		{ 0,  0 }
-	};
-	const float perKernelSize = 1.0f/kernelSize;
-
-	// iterate through the pixels
-	for( std::size_t y = 0; y < height; y++) {
-		for( std::size_t x = 0; x < width; x++) {
-			//the new normal vector for this pixel
-			Vector3 smoothVector(0,0,0);
-
-			// calculate the average direction of the surrounding vectors
-			for (KernelElement* i = kernel; i != kernel + kernelSize; ++i) {
-				// temporary vector to represent one of the surrounding pixels
-				byte* pixel = getPixel(in, width, height, x + i->dx, y + i->dy);
-				Vector3 temp(pixel[0], pixel[1], pixel[2]);
+	// Take the average direction of the surrounding vectors
+	TextureManipulator::instance().getImageKernels().smoothNormals(
+		normalMap->getMipMapPixels(0), result->getMipMapPixels(0), width, height);
 
-				smoothVector += temp;
-			}
-
-			// Take the average normal vector as result
-			smoothVector *= perKernelSize;
-
-			out[0] = static_cast<byte>(float_to_integer(smoothVector.x()));
-			out[1] = static_cast<byte>(float_to_integer(smoothVector.y()));
-			out[2] = static_cast<byte>(float_to_integer(smoothVector.z()));
-			out[3] = 255;
-
-			// advance the pixel pointer
-			out += 4;
-	    }
-	}
     return result;
 }
 
@@ -296,6 +280,10 @@ std::string SmoothNormalsExpression::getIdentifier() const {
 	return identifier;
 }
 
+void SmoothNormalsExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 AddExpression::AddExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExpOne = createForToken(token);
@@ -304,21 +292,23 @@ AddExpression::AddExpression (DefTokeniser& token) {
 	token.assertNextToken(")");
 }
 
-ImagePtr AddExpression::getImage() const {
-    ImagePtr imgOne = mapExpOne->getImage();
+ImagePtr AddExpression::createImage(const std::string& bitmapsPath) const {
+    ImagePtr imgOne = mapExpOne->getImage(bitmapsPath);
 
     if (imgOne == NULL) return ImagePtr();
 
     std::size_t width = imgOne->getWidth(0);
     std::size_t height = imgOne->getHeight(0);
 
-	ImagePtr imgTwo = mapExpTwo->getImage();
+	ImagePtr imgTwo = mapExpTwo->getImage(bitmapsPath);
 
 	if (imgTwo == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	imgOne = getDecompressed(imgOne);
+	imgTwo = getDecompressed(imgTwo);
+
 	if (imgOne->isPrecompressed() || imgTwo->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return imgOne;
 	}
 
@@ -352,11 +342,16 @@ ImagePtr AddExpression::getImage() const {
 }
 
 std::string AddExpression::getIdentifier() const {
-	std::string identifier = "_add_";
-	identifier.append(mapExpOne->getIdentifier() + mapExpTwo->getIdentifier());
+	std::string identifier = "_add_(";
+	identifier.append(mapExpOne->getIdentifier() + "," + mapExpTwo->getIdentifier() + ")");
 	return identifier;
 }
 
+void AddExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExpOne->collectImageNames(names);
+	mapExpTwo->collectImageNames(names);
+}
+
 ScaleExpression::ScaleExpression (DefTokeniser& token) : scaleGreen(0),scaleBlue(0),scaleAlpha(0) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
@@ -377,14 +372,15 @@ ScaleExpression::ScaleExpression (DefTokeniser& token) : scaleGreen(0),scaleBlue
 	token.assertNextToken(")");
 }
 
-ImagePtr ScaleExpression::getImage() const {
-    ImagePtr img = mapExp->getImage();
+ImagePtr ScaleExpression::createImage(const std::string& bitmapsPath) const {
+    ImagePtr img = mapExp->getImage(bitmapsPath);
 
     if (img == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	img = getDecompressed(img);
+
 	if (img->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return img;
 	}
 
@@ -428,25 +424,30 @@ ImagePtr ScaleExpression::getImage() const {
 }
 
 std::string ScaleExpression::getIdentifier() const {
-	std::string identifier = "_scale_";
-	identifier.append(mapExp->getIdentifier() + string::to_string(scaleRed) + string::to_string(scaleGreen) + string::to_string(scaleBlue) + string::to_string(scaleAlpha));
+	std::string identifier = "_scale_(";
+	identifier.append(mapExp->getIdentifier() + "," + string::to_string(scaleRed) + "," + string::to_string(scaleGreen) + "," + string::to_string(scaleBlue) + "," + string::to_string(scaleAlpha) + ")");
 	return identifier;
 }
 
+void ScaleExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 InvertAlphaExpression::InvertAlphaExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
 	token.assertNextToken(")");
 }
 
-ImagePtr InvertAlphaExpression::getImage() const {
-	ImagePtr img = mapExp->getImage();
+ImagePtr InvertAlphaExpression::createImage(const std::string& bitmapsPath) const {
+	ImagePtr img = mapExp->getImage(bitmapsPath);
 
 	if (img == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	img = getDecompressed(img);
+
 	if (img->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return img;
 	}
 
@@ -483,20 +484,25 @@ std::string InvertAlphaExpression::getIdentifier() const {
 	return identifier;
 }
 
+void InvertAlphaExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 InvertColorExpression::InvertColorExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
 	token.assertNextToken(")");
 }
 
-ImagePtr InvertColorExpression::getImage() const {
-	ImagePtr img = mapExp->getImage();
+ImagePtr InvertColorExpression::createImage(const std::string& bitmapsPath) const {
+	ImagePtr img = mapExp->getImage(bitmapsPath);
 
 	if (img == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	img = getDecompressed(img);
+
 	if (img->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return img;
 	}
 
@@ -531,20 +537,25 @@ std::string InvertColorExpression::getIdentifier() const {
 	return identifier;
 }
 
+void InvertColorExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 MakeIntensityExpression::MakeIntensityExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
 	token.assertNextToken(")");
 }
 
-ImagePtr MakeIntensityExpression::getImage() const {
-	ImagePtr img = mapExp->getImage();
+ImagePtr MakeIntensityExpression::createImage(const std::string& bitmapsPath) const {
+	ImagePtr img = mapExp->getImage(bitmapsPath);
 
 	if (img == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	img = getDecompressed(img);
+
 	if (img->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return img;
 	}
 
@@ -581,20 +592,25 @@ std::string MakeIntensityExpression::getIdentifier() const {
 	return identifier;
 }
 
+void MakeIntensityExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 MakeAlphaExpression::MakeAlphaExpression (DefTokeniser& token) {
 	token.assertNextToken("(");
 	mapExp = createForToken(token);
 	token.assertNextToken(")");
 }
 
-ImagePtr MakeAlphaExpression::getImage() const {
-	ImagePtr img = mapExp->getImage();
+ImagePtr MakeAlphaExpression::createImage(const std::string& bitmapsPath) const {
+	ImagePtr img = mapExp->getImage(bitmapsPath);
 
 	if (img == NULL) return ImagePtr();
 
-	// Don't process precompressed images
+	// Precompressed images are decompressed, unsupported formats are passed through
+	img = getDecompressed(img);
+
 	if (img->isPrecompressed()) {
-		rWarning() << "Cannot evaluate map expression with precompressed texture." << std::endl;
 		return img;
 	}
 
@@ -631,6 +647,10 @@ std::string MakeAlphaExpression::getIdentifier() const {
 	return identifier;
 }
 
+void MakeAlphaExpression::collectImageNames(std::set<std::string>& names) const {
+	mapExp->collectImageNames(names);
+}
+
 /* ImageExpression */
 
 ImageExpression::ImageExpression(const std::string& imgName)
@@ -641,77 +661,77 @@ ImageExpression::ImageExpression(const std::string& imgName)
 	_imgName = os::standardPath(imgName).substr(0, imgName.rfind("."));
 }
 
-ImagePtr ImageExpression::getImage() const
+ImagePtr ImageExpression::createImage(const std::string& bitmapsPath) const
 {
 	// Check for some image keywords and load the correct file
 	if (_imgName == "_black") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_BLACK
+            bitmapsPath + IMAGE_BLACK
         );
 	}
 	else if (_imgName == "_cubiclight") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_CUBICLIGHT
+            bitmapsPath + IMAGE_CUBICLIGHT
         );
 	}
 	else if (_imgName == "_currentRender") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_CURRENTRENDER
+            bitmapsPath + IMAGE_CURRENTRENDER
         );
 	}
 	else if (_imgName == "_default") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_DEFAULT
+            bitmapsPath + IMAGE_DEFAULT
         );
 	}
 	else if (_imgName == "_flat") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_FLAT
+            bitmapsPath + IMAGE_FLAT
         );
 	}
 	else if (_imgName == "_fog") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_FOG
+            bitmapsPath + IMAGE_FOG
         );
 	}
 	else if (_imgName == "_nofalloff") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_NOFALLOFF
+            bitmapsPath + IMAGE_NOFALLOFF
         );
 	}
 	else if (_imgName == "_pointlight1") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_POINTLIGHT1
+            bitmapsPath + IMAGE_POINTLIGHT1
         );
 	}
 	else if (_imgName == "_pointlight2") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_POINTLIGHT2
+            bitmapsPath + IMAGE_POINTLIGHT2
         );
 	}
 	else if (_imgName == "_pointlight3") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_POINTLIGHT3
+            bitmapsPath + IMAGE_POINTLIGHT3
         );
 	}
 	else if (_imgName == "_quadratic") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_QUADRATIC
+            bitmapsPath + IMAGE_QUADRATIC
         );
 	}
 	else if (_imgName == "_scratch") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_SCRATCH
+            bitmapsPath + IMAGE_SCRATCH
         );
 	}
 	else if (_imgName == "_spotlight") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_SPOTLIGHT
+            bitmapsPath + IMAGE_SPOTLIGHT
         );
 	}
 	else if (_imgName == "_white") {
 		return GlobalImageLoader().imageFromFile(
-            GlobalRegistry().get("user/paths/bitmapsPath") + IMAGE_WHITE
+            bitmapsPath + IMAGE_WHITE
         );
 	}
 	else
@@ -726,4 +746,134 @@ std::string ImageExpression::getIdentifier() const
 	return _imgName;
 }
 
+void ImageExpression::collectImageNames(std::set<std::string>& names) const
+{
+	names.insert(_imgName);
+}
+
+/* ThumbnailExpression */
+
+ThumbnailExpression::ThumbnailExpression(const std::string& materialName,
+	const MapExpressionPtr& source, ThumbnailCache& cache) :
+	_materialName(materialName),
+	_source(source),
+	_cache(cache),
+	_signature(FNV_OFFSET_BASIS)
+{
+	hashString(_signature, _source->getIdentifier());
+
+	std::set<std::string> imageNames;
+	_source->collectImageNames(imageNames);
+
+	// The file stamps tell whether the images have changed since the
+	// thumbnail has been created, without loading them
+	for (const std::string& imageName : imageNames)
+	{
+		vfs::FileStamp stamp;
+		bool found = GlobalImageLoader().getImageStamp(imageName, stamp);
+
+		hashString(_signature, imageName);
+		hashBytes(_signature, &found, sizeof(found));
+
+		if (found)
+		{
+			hashString(_signature, stamp.archive);
+			hashBytes(_signature, &stamp.size, sizeof(stamp.size));
+			hashBytes(_signature, &stamp.modificationTime, sizeof(stamp.modificationTime));
+		}
+	}
+}
+
+std::string ThumbnailExpression::getIdentifier() const
+{
+	// The signature keeps outdated thumbnails apart in the image cache
+	std::string identifier = "_thumbnail_(";
+	identifier.append(_materialName + "," + string::to_string(_signature) + ")");
+	return identifier;
+}
+
+void ThumbnailExpression::collectImageNames(std::set<std::string>& names) const
+{
+	_source->collectImageNames(names);
+}
+
+bool ThumbnailExpression::getImageSize(std::size_t& width, std::size_t& height) const
+{
+	return _cache.getSize(_materialName, _signature, width, height);
+}
+
+ImagePtr ThumbnailExpression::createImage(const std::string& bitmapsPath) const
+{
+	return _cache.get(_materialName, _signature, [&]() -> ImagePtr
+	{
+		ImagePtr image = _source->getImage(bitmapsPath);
+
+		if (!image)
+		{
+			return ImagePtr();
+		}
+
+		std::size_t thumbnailSize = _cache.getThumbnailSize();
+
+		if (image->isPrecompressed())
+		{
+			// Decompress the smallest mipmap which is still large enough
+			std::size_t mipMap = 0;
+
+			while (mipMap + 1 < image->getMipMapCount() &&
+				   std::max(image->getWidth(mipMap + 1), image->getHeight(mipMap + 1)) >= thumbnailSize)
+			{
+				++mipMap;
+			}
+
+			ImagePtr decompressed = image->getDecompressedMipMap(mipMap);
+			image = decompressed ? decompressed : getDecompressed(image);
+
+			if (image->isPrecompressed())
+			{
+				return image;
+			}
+		}
+
+		std::size_t width = image->getWidth(0);
+		std::size_t height = image->getHeight(0);
+		std::size_t larger = std::max(width, height);
+
+		if (larger <= thumbnailSize)
+		{
+			return image;
+		}
+
+		// Keep the aspect ratio
+		std::size_t thumbnailWidth = std::max<std::size_t>(width * thumbnailSize / larger, 1);
+		std::size_t thumbnailHeight = std::max<std::size_t>(height * thumbnailSize / larger, 1);
+
+		// Halve the image as far as possible, resampling is only done for the last step
+		const byte* pixels = image->getMipMapPixels(0);
+		std::vector<byte> reduced;
+
+		while (width >= 2 * thumbnailWidth && height >= 2 * thumbnailHeight)
+		{
+			if (reduced.empty())
+			{
+				reduced.resize((width / 2) * (height / 2) * 4);
+			}
+
+			TextureManipulator::instance().getImageKernels().mipReduce(pixels, reduced.data(),
+				width, height, width / 2, height / 2);
+
+			pixels = reduced.data();
+			width /= 2;
+			height /= 2;
+		}
+
+		RGBAImagePtr thumbnail(new RGBAImage(thumbnailWidth, thumbnailHeight));
+
+		TextureManipulator::instance().resampleTexture(pixels, width, height,
+			thumbnail->getMipMapPixels(0), thumbnailWidth, thumbnailHeight, 4);
+
+		return thumbnail;
+	});
+}
+
 } // namespace shaders
@@ -2,10 +2,15 @@
 #define MAPEXPRESSION_H_
 
 #include <string>
+#include <set>
+#include <cstdint>
 
 #include <memory>
 
+#include "iregistry.h"
+#include "imodule.h"
 #include "NamedBindable.h"
+#include "MapExpressionCache.h"
 #include "parser/DefTokeniser.h"
 
 using parser::DefTokeniser;
@@ -13,6 +18,8 @@ using parser::DefTokeniser;
 namespace shaders
 {
 
+class ThumbnailCache;
+
 class MapExpression;
 typedef std::shared_ptr<MapExpression> MapExpressionPtr;
 
@@ -30,9 +37,29 @@ public: /* INTERFACE METHODS */
 
 	/**
      * \brief
-     * Construct and return the image created from this map expression.
+     * Return the image created from this map expression.
+     *
+     * Images are cached by their expression's identifier, materials sharing
+     * the same (sub-)expression share the image. It must not be modified.
+     *
+     * \param bitmapsPath
+     * The directory of the built-in images like _black or _flat. It is read
+     * from the registry on the main thread and passed along, since the
+     * texture decoders create images on other threads.
      */
-	virtual ImagePtr getImage() const = 0;
+	ImagePtr getImage(const std::string& bitmapsPath) const
+	{
+		return MapExpressionCache::Instance().get(getIdentifier(), [&]()
+		{
+			return createImage(bitmapsPath);
+		});
+	}
+
+	// Return the image using the current bitmaps path, main thread only
+	ImagePtr getImage() const
+	{
+		return getImage(GlobalRegistry().get(RKEY_BITMAPS_PATH));
+	}
 
     /**
      * \brief
@@ -47,6 +74,23 @@ public: /* INTERFACE METHODS */
         return false;
     }
 
+    /**
+     * \brief
+     * Add the names of the images this map expression is created from to the
+     * given set, e.g. to check whether they have changed.
+     */
+    virtual void collectImageNames(std::set<std::string>& names) const = 0;
+
+    /**
+     * \brief
+     * Return the dimensions of the image if they are known without creating
+     * it, which is the case for cached thumbnails.
+     */
+    virtual bool getImageSize(std::size_t& width, std::size_t& height) const
+    {
+        return false;
+    }
+
 public:
 
     /* BindableTexture interface */
@@ -69,6 +113,14 @@ public: /* STATIC CONSTRUCTION METHODS */
 
 protected:
 
+	/**
+     * \brief
+     * Construct the image of this map expression, invoked by getImage() if
+     * the image is not cached. Sub-expressions are passed the same bitmaps
+     * path.
+     */
+	virtual ImagePtr createImage(const std::string& bitmapsPath) const = 0;
+
 	/** greebo: Assures that the image is matching the desired dimensions.
 	 *
 	 * @input: The image to be rescaled. If it doesn't match <width x height>
@@ -80,6 +132,13 @@ protected:
 	 * @returns: the resampled image, this might as well be input.
 	 */
 	static ImagePtr getResampled(const ImagePtr& input, std::size_t width, std::size_t height);
+
+	/**
+	 * Returns the RGBA version of a precompressed image, such that its pixels
+	 * can be processed. Uncompressed images are returned as they are, and so
+	 * are precompressed ones which can't be decompressed.
+	 */
+	static ImagePtr getDecompressed(const ImagePtr& input);
 };
 
 // the specific MapExpressions
@@ -88,8 +147,10 @@ class HeightMapExpression : public MapExpression {
 	float scale;
 public:
 	HeightMapExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 class AddNormalsExpression : public MapExpression {
@@ -97,16 +158,20 @@ class AddNormalsExpression : public MapExpression {
 	MapExpressionPtr mapExpTwo;
 public:
 	AddNormalsExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 class SmoothNormalsExpression : public MapExpression {
 	MapExpressionPtr mapExp;
 public:
 	SmoothNormalsExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 class AddExpression : public MapExpression {
@@ -114,8 +179,10 @@ class AddExpression : public MapExpression {
 	MapExpressionPtr mapExpTwo;
 public:
 	AddExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 class ScaleExpression : public MapExpression {
@@ -126,40 +193,50 @@ class ScaleExpression : public MapExpression {
 	float scaleAlpha;
 public:
 	ScaleExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 class InvertAlphaExpression : public MapExpression {
 	MapExpressionPtr mapExp;
 public:
 	InvertAlphaExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 class InvertColorExpression : public MapExpression {
 	MapExpressionPtr mapExp;
 public:
 	InvertColorExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 class MakeIntensityExpression : public MapExpression {
 	MapExpressionPtr mapExp;
 public:
 	MakeIntensityExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 class MakeAlphaExpression : public MapExpression {
 	MapExpressionPtr mapExp;
 public:
 	MakeAlphaExpression (DefTokeniser& token);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 /**
@@ -177,8 +254,41 @@ public:
 
     /* MapExpression interface */
 	ImageExpression(const std::string& imgName);
-	ImagePtr getImage() const;
 	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
+};
+
+/**
+ * \brief
+ * MapExpression creating the thumbnail of a material's editor image, which
+ * is at most as large as the thumbnail size of the given cache.
+ *
+ * Thumbnails are kept in the ThumbnailCache along with a signature of the
+ * source expression and the files of its images, the source image is only
+ * loaded if the signature has changed.
+ */
+class ThumbnailExpression
+: public MapExpression
+{
+	std::string _materialName;
+	MapExpressionPtr _source;
+	ThumbnailCache& _cache;
+
+	// Calculated on construction, the thumbnail is only valid as long as
+	// the image files stay the same
+	std::uint64_t _signature;
+
+public:
+	ThumbnailExpression(const std::string& materialName, const MapExpressionPtr& source,
+		ThumbnailCache& cache);
+
+	std::string getIdentifier() const;
+	void collectImageNames(std::set<std::string>& names) const;
+	bool getImageSize(std::size_t& width, std::size_t& height) const;
+protected:
+	ImagePtr createImage(const std::string& bitmapsPath) const;
 };
 
 } // namespace shaders
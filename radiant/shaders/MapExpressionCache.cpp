@@ -0,0 +1,170 @@
+#include "MapExpressionCache.h"
+
+namespace shaders
+{
+
+namespace
+{
+	// Used until the shader system applies the preference
+	const std::size_t DEFAULT_CAPACITY = 256 * 1024 * 1024;
+}
+
+MapExpressionCache::MapExpressionCache(std::size_t capacity) :
+	_capacity(capacity),
+	_lastEntryId(0)
+{}
+
+ImagePtr MapExpressionCache::get(const std::string& key, const std::function<ImagePtr()>& createImage)
+{
+	std::promise<ImagePtr> promise;
+	std::size_t id = 0;
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+
+		auto found = _entries.find(key);
+
+		if (found != _entries.end())
+		{
+			_statistics.hits++;
+
+			// Move the key to the front of the LRU list
+			_lru.splice(_lru.begin(), _lru, found->second.lruPosition);
+
+			std::shared_future<ImagePtr> cached = found->second.image;
+			lock.unlock();
+
+			// Blocks if another thread is still creating the image
+			return cached.get();
+		}
+
+		_statistics.misses++;
+
+		_lru.push_front(key);
+
+		id = ++_lastEntryId;
+
+		Entry& entry = _entries[key];
+		entry.image = promise.get_future().share();
+		entry.id = id;
+		entry.lruPosition = _lru.begin();
+	}
+
+	ImagePtr created;
+
+	try
+	{
+		created = createImage();
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			auto found = _entries.find(key);
+
+			// clear() might have removed the entry already
+			if (found != _entries.end() && found->second.id == id)
+			{
+				_lru.erase(found->second.lruPosition);
+				_entries.erase(found);
+			}
+		}
+
+		// Threads waiting for the image get the exception too
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto found = _entries.find(key);
+
+		if (found != _entries.end() && found->second.id == id)
+		{
+			found->second.ready = true;
+			found->second.size = GetImageSize(created);
+
+			_statistics.size += found->second.size;
+			evict();
+		}
+	}
+
+	promise.set_value(created);
+
+	return created;
+}
+
+void MapExpressionCache::setCapacity(std::size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_capacity = capacity;
+	evict();
+}
+
+void MapExpressionCache::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Images which are being created are not added once they're done
+	_entries.clear();
+	_lru.clear();
+	_statistics.size = 0;
+}
+
+MapExpressionCache::Statistics MapExpressionCache::getStatistics()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Statistics statistics = _statistics;
+	statistics.numImages = _entries.size();
+
+	return statistics;
+}
+
+std::size_t MapExpressionCache::GetImageSize(const ImagePtr& image)
+{
+	if (!image)
+	{
+		return 0;
+	}
+
+	std::size_t numPixels = image->getWidth(0) * image->getHeight(0);
+
+	// DXT compressed images use a byte per pixel or less
+	return image->isPrecompressed() ? numPixels : numPixels * 4;
+}
+
+void MapExpressionCache::evict()
+{
+	auto i = _lru.end();
+
+	while (_statistics.size > _capacity && i != _lru.begin())
+	{
+		--i;
+
+		auto entry = _entries.find(*i);
+
+		// Leave the images alone which are still being created
+		if (!entry->second.ready)
+		{
+			continue;
+		}
+
+		_statistics.size -= entry->second.size;
+		_statistics.evictions++;
+
+		_entries.erase(entry);
+		i = _lru.erase(i);
+	}
+}
+
+MapExpressionCache& MapExpressionCache::Instance()
+{
+	static MapExpressionCache _instance(DEFAULT_CAPACITY);
+	return _instance;
+}
+
+}
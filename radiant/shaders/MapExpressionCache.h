@@ -0,0 +1,101 @@
+#pragma once
+
+#include "iimage.h"
+
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace shaders
+{
+
+/**
+ * Cache of the images created by map expressions, keyed by the expression's
+ * identifier. Materials often share the same sub-expressions (the same
+ * heightmap or diffuse image), which are thus loaded and processed once.
+ *
+ * The cache holds images up to a given number of bytes, evicting the least
+ * recently used ones. An image requested by several threads at once is
+ * created by the first one, the others wait for it.
+ *
+ * Cached images are shared by all users and must not be modified.
+ */
+class MapExpressionCache
+{
+public:
+	struct Statistics
+	{
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+		std::size_t evictions = 0;
+
+		// Number and total size of the cached images
+		std::size_t numImages = 0;
+		std::size_t size = 0;
+	};
+
+private:
+	typedef std::list<std::string> KeyList;
+
+	struct Entry
+	{
+		// Ready once the image has been created
+		std::shared_future<ImagePtr> image;
+
+		// Tells the creating thread whether the entry is still its own
+		// after it has been cleared and requested again meanwhile
+		std::size_t id = 0;
+		bool ready = false;
+
+		// Estimated memory footprint of the image
+		std::size_t size = 0;
+
+		// Position in the LRU list
+		KeyList::iterator lruPosition;
+	};
+
+	std::mutex _mutex;
+
+	std::unordered_map<std::string, Entry> _entries;
+
+	// Keys of the entries, most recently used first
+	KeyList _lru;
+
+	std::size_t _capacity;
+	std::size_t _lastEntryId;
+	Statistics _statistics;
+
+public:
+	// Pass the number of bytes the cached images may occupy
+	MapExpressionCache(std::size_t capacity);
+
+	/**
+	 * Returns the image cached for the given key. On a miss the image is
+	 * created by invoking the given function, which is done outside of the
+	 * lock, such that it can recursively request other images.
+	 */
+	ImagePtr get(const std::string& key, const std::function<ImagePtr()>& createImage);
+
+	// Changes the capacity, evicting images if necessary
+	void setCapacity(std::size_t capacity);
+
+	// Removes all images, e.g. after the image files have been changed
+	void clear();
+
+	Statistics getStatistics();
+
+	// Estimates the number of bytes occupied by the given image
+	static std::size_t GetImageSize(const ImagePtr& image);
+
+	// The cache used by the map expressions
+	static MapExpressionCache& Instance();
+
+private:
+	// Evicts images until the total size fits, requires _mutex to be held
+	void evict();
+};
+
+}
@@ -0,0 +1,128 @@
+#include "MaterialPreParser.h"
+
+#include <algorithm>
+
+namespace shaders
+{
+
+MaterialPreParser::MaterialPreParser(decl::ILoadScheduler& scheduler) :
+    _scheduler(scheduler),
+    _next(0),
+    _cancelled(false),
+    _active(false)
+{}
+
+MaterialPreParser::~MaterialPreParser()
+{
+    cancel();
+}
+
+void MaterialPreParser::start(const std::vector<ShaderTemplatePtr>& templates)
+{
+    cancel();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _templates = templates;
+    _next = 0;
+    _cancelled = false;
+
+    ensureJobScheduled();
+}
+
+void MaterialPreParser::prioritise(const std::vector<ShaderTemplatePtr>& templates)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_cancelled)
+    {
+        return;
+    }
+
+    _prioritised.insert(_prioritised.end(), templates.begin(), templates.end());
+
+    ensureJobScheduled();
+}
+
+void MaterialPreParser::cancel()
+{
+    std::vector<decl::ILoadScheduler::JobPtr> jobs;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _cancelled = true;
+        _prioritised.clear();
+        _templates.clear();
+        _next = 0;
+
+        jobs.swap(_jobs);
+    }
+
+    // The workers stop after their current template
+    for (const auto& job : jobs)
+    {
+        job->wait();
+    }
+}
+
+void MaterialPreParser::ensureJobScheduled()
+{
+    if (_active)
+    {
+        return;
+    }
+
+    // Forget about the jobs which are done
+    _jobs.erase(std::remove_if(_jobs.begin(), _jobs.end(),
+        [](const decl::ILoadScheduler::JobPtr& job) { return job->isFinished(); }), _jobs.end());
+
+    _active = true;
+    _jobs.push_back(_scheduler.schedule("MaterialPreParser",
+        std::bind(&MaterialPreParser::run, this), {}, decl::LoadPriority::Low));
+}
+
+void MaterialPreParser::run()
+{
+    // Keep all workers busy, every sub-task is processing the queue
+    std::vector<decl::ILoadScheduler::Task> tasks(_scheduler.getNumWorkers(), [this]()
+    {
+        ShaderTemplatePtr next;
+
+        while (takeNext(next))
+        {
+            next->preParse();
+        }
+    });
+
+    _scheduler.runSubTasks(tasks);
+}
+
+bool MaterialPreParser::takeNext(ShaderTemplatePtr& next)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (!_cancelled)
+    {
+        if (!_prioritised.empty())
+        {
+            next = _prioritised.front();
+            _prioritised.pop_front();
+            return true;
+        }
+
+        if (_next < _templates.size())
+        {
+            next = _templates[_next++];
+            return true;
+        }
+    }
+
+    // Queue is empty, prioritise() needs to schedule a new job
+    _active = false;
+    next.reset();
+
+    return false;
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ideclloadscheduler.h"
+#include "ShaderTemplate.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace shaders
+{
+
+/**
+ * Parses the ShaderTemplates of the material library in the background, such
+ * that the templates are (mostly) parsed already by the time the UI thread
+ * is accessing them for the first time.
+ *
+ * The templates are processed by jobs of the decl load scheduler, using all
+ * of its workers. Templates passed to prioritise() are parsed before the
+ * remaining ones. Parsing is thread-safe on the ShaderTemplate level, a
+ * template accessed while being parsed blocks until the parse is done.
+ */
+class MaterialPreParser
+{
+private:
+    decl::ILoadScheduler& _scheduler;
+
+    // Protects the members below
+    std::mutex _mutex;
+
+    // Templates to be parsed first, in request order
+    std::deque<ShaderTemplatePtr> _prioritised;
+
+    // All templates of the library, _next is the first one not processed yet
+    std::vector<ShaderTemplatePtr> _templates;
+    std::size_t _next;
+
+    bool _cancelled;
+
+    // Whether a job is processing the queue
+    bool _active;
+    std::vector<decl::ILoadScheduler::JobPtr> _jobs;
+
+public:
+    MaterialPreParser(decl::ILoadScheduler& scheduler);
+
+    // Waits for the running parses to finish
+    ~MaterialPreParser();
+
+    // Starts parsing the given templates in the background, replacing the
+    // ones of a previous pass
+    void start(const std::vector<ShaderTemplatePtr>& templates);
+
+    // Parses the given templates ahead of the remaining ones, restarting the
+    // background pass if it is done already. Doesn't block.
+    void prioritise(const std::vector<ShaderTemplatePtr>& templates);
+
+    // Stops the background pass and waits for the running parses to finish.
+    // Needs to be called before the templates are discarded or replaced.
+    void cancel();
+
+private:
+    // Schedules a job processing the queue, requires _mutex to be held
+    void ensureJobScheduled();
+
+    // Processes the queue on all workers until it is empty
+    void run();
+
+    // Takes the next template to be parsed, returns false if done
+    bool takeNext(ShaderTemplatePtr& next);
+};
+
+}
@@ -2,10 +2,10 @@
 
 #include "ifilesystem.h"
 
-#include <map>
 #include <string>
+#include <unordered_map>
 #include "ShaderTemplate.h"
-#include "ShaderNameCompareFunctor.h"
+#include "decl/DeclName.h"
 
 namespace shaders
 {
@@ -31,6 +31,7 @@ struct ShaderDefinition
 
 };
 
-typedef std::map<std::string, ShaderDefinition, ShaderNameCompareFunctor> ShaderDefinitionMap;
+// Definitions are indexed by their interned, case-insensitive name
+typedef std::unordered_map<decl::DeclName, ShaderDefinition> ShaderDefinitionMap;
 
 }
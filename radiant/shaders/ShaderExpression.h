@@ -4,6 +4,7 @@
 #include "irender.h"
 #include "parser/DefTokeniser.h"
 #include "TableDefinition.h"
+#include "ExpressionProgram.h"
 
 namespace shaders
 {
@@ -64,6 +65,10 @@ public:
 		return _index;
 	}
 
+	// Adds the instructions evaluating this expression to the given program,
+	// returning the register receiving the value
+	virtual std::size_t compile(ExpressionProgram& program) const = 0;
+
 	static IShaderExpressionPtr createFromString(const std::string& exprStr);
 
 	static IShaderExpressionPtr createFromTokens(parser::DefTokeniser& tokeniser);
@@ -97,6 +102,11 @@ public:
 	{
 		return entity.getShaderParm(_parmNum);
 	}
+
+	virtual std::size_t compile(ExpressionProgram& program) const
+	{
+		return program.addShaderParm(_parmNum);
+	}
 };
 
 class GlobalShaderParmExpression :
@@ -121,6 +131,12 @@ public:
 	{
 		return getValue(time);
 	}
+
+	virtual std::size_t compile(ExpressionProgram& program) const
+	{
+		// Always 0, see above
+		return program.addConstant(0.0f);
+	}
 };
 
 // An expression returning the current (game) time as result
@@ -141,6 +157,11 @@ public:
 	{
 		return getValue(time);
 	}
+
+	virtual std::size_t compile(ExpressionProgram& program) const
+	{
+		return program.addTime();
+	}
 };
 
 // An expression representing a constant floating point number
@@ -165,6 +186,11 @@ public:
 	{
 		return getValue(time);
 	}
+
+	virtual std::size_t compile(ExpressionProgram& program) const
+	{
+		return program.addConstant(_value);
+	}
 };
 
 // An expression looking up a value in a table def
@@ -198,6 +224,11 @@ public:
 		float lookupVal = _lookupExpr->getValue(time, entity);
 		return _tableDef->getValue(lookupVal);
 	}
+
+	virtual std::size_t compile(ExpressionProgram& program) const
+	{
+		return program.addTableLookup(_tableDef, program.compile(_lookupExpr));
+	}
 };
 
 // Abstract base class for an expression taking two sub-expression as arguments
@@ -249,6 +280,16 @@ public:
 	{
 		_b = b;
 	}
+
+	virtual std::size_t compile(ExpressionProgram& program) const
+	{
+		std::size_t a = program.compile(_a);
+		return program.addOperation(getOpCode(), a, program.compile(_b));
+	}
+
+protected:
+	// The operation performed on the operands
+	virtual ExpressionProgram::OpCode getOpCode() const = 0;
 };
 typedef std::shared_ptr<BinaryExpression> BinaryExpressionPtr;
 
@@ -271,6 +312,12 @@ public:
 	{
 		return _a->getValue(time, entity) + _b->getValue(time, entity);
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::Add;
+	}
 };
 
 // An expression subtracting the value of two expressions
@@ -292,6 +339,12 @@ public:
 	{
 		return _a->getValue(time, entity) - _b->getValue(time, entity);
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::Subtract;
+	}
 };
 
 // An expression multiplying the value of two expressions
@@ -313,6 +366,12 @@ public:
 	{
 		return _a->getValue(time, entity) * _b->getValue(time, entity);
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::Multiply;
+	}
 };
 
 // An expression dividing the value of two expressions
@@ -334,6 +393,12 @@ public:
 	{
 		return _a->getValue(time, entity) / _b->getValue(time, entity);
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::Divide;
+	}
 };
 
 // An expression returning modulo of A % B
@@ -355,6 +420,12 @@ public:
 	{
 		return fmod(_a->getValue(time, entity), _b->getValue(time, entity));
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::Modulo;
+	}
 };
 
 // An expression returning 1 if A < B, otherwise 0
@@ -376,6 +447,12 @@ public:
 	{
 		return _a->getValue(time, entity) < _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::LesserThan;
+	}
 };
 
 // An expression returning 1 if A <= B, otherwise 0
@@ -397,6 +474,12 @@ public:
 	{
 		return _a->getValue(time, entity) <= _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::LesserThanOrEqual;
+	}
 };
 
 // An expression returning 1 if A > B, otherwise 0
@@ -418,6 +501,12 @@ public:
 	{
 		return _a->getValue(time, entity) > _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::GreaterThan;
+	}
 };
 
 // An expression returning 1 if A >= B, otherwise 0
@@ -439,6 +528,12 @@ public:
 	{
 		return _a->getValue(time, entity) >= _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::GreaterThanOrEqual;
+	}
 };
 
 // An expression returning 1 if A == B, otherwise 0
@@ -460,6 +555,12 @@ public:
 	{
 		return _a->getValue(time, entity) == _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::Equal;
+	}
 };
 
 // An expression returning 1 if A != B, otherwise 0
@@ -481,6 +582,12 @@ public:
 	{
 		return _a->getValue(time, entity) != _b->getValue(time, entity) ? 1.0f : 0;
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::NotEqual;
+	}
 };
 
 // An expression returning 1 if both A and B are true (non-zero), otherwise 0
@@ -502,6 +609,12 @@ public:
 	{
 		return (_a->getValue(time, entity) != 0 && _b->getValue(time, entity) != 0) ? 1.0f : 0;
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::LogicalAnd;
+	}
 };
 
 // An expression returning 1 if either A or B are true (non-zero), otherwise 0
@@ -523,6 +636,12 @@ public:
 	{
 		return (_a->getValue(time, entity) != 0 || _b->getValue(time, entity) != 0) ? 1.0f : 0;
 	}
+
+protected:
+	virtual ExpressionProgram::OpCode getOpCode() const
+	{
+		return ExpressionProgram::OpCode::LogicalOr;
+	}
 };
 
 } // namespace
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <deque>
+#include <future>
 #include <regex>
 
 #include "iarchive.h"
 #include "ifilesystem.h"
+#include "ideclcache.h"
 
 #include "TableDefinition.h"
 #include "ShaderTemplate.h"
@@ -12,10 +15,18 @@
 #include "parser/DefBlockTokeniser.h"
 #include "string/replace.h"
 #include "string/predicate.h"
+#include "util/ThreadPool.h"
 
 namespace shaders
 {
 
+/// How ShaderFileLoader::parseFiles() processes the material files
+enum class FileParseMode
+{
+    Sequential, // one file after the other on the calling thread
+    Parallel,   // files are parsed on worker threads
+};
+
 // VFS functor class which loads material (mtr) files.
 template<typename ShaderLibrary_T> class ShaderFileLoader
 {
@@ -27,9 +38,33 @@ template<typename ShaderLibrary_T> class ShaderFileLoader
     // List of shader definition files to parse
     std::vector<vfs::FileInfo> _files;
 
+public:
+    // Runs the given tasks in parallel, returning when all of them are done
+    typedef std::function<void(const std::vector<std::function<void()>>&)> SubTaskRunner;
+
 private:
+    // Used by the parallel mode, a temporary thread pool is used if empty
+    SubTaskRunner _subTaskRunner;
 
-    bool parseTable(const parser::BlockTokeniser::Block& block, const vfs::FileInfo& fileInfo)
+    // Provides the blocks of unchanged files without tokenising them, optional
+    decl::IDeclCache* _declCache;
+
+    // Number of files the sequential mode has the VFS read ahead of the parser
+    static constexpr std::size_t MAX_FILES_READ_AHEAD = 8;
+
+    // Declarations found in a single file. Files are parsed into these
+    // partial results independently, which are merged into the library
+    // in VFS order afterwards, such that definition precedence and the
+    // duplicate warnings don't depend on the order the files are parsed in.
+    struct ParseResult
+    {
+        std::vector<TableDefinitionPtr> tables;
+        std::vector<std::pair<std::string, ShaderTemplatePtr>> templates;
+    };
+
+private:
+
+    static bool parseTable(const parser::BlockTokeniser::Block& block, ParseResult& result)
     {
         if (block.name.length() <= 5 || !string::starts_with(block.name, "table"))
         {
@@ -45,12 +80,7 @@ private:
         {
             auto tableName = matches[1].str();
 
-            auto table = std::make_shared<TableDefinition>(tableName, block.contents);
-
-            if (!_library.addTableDefinition(table))
-            {
-                rError() << "[shaders] " << fileInfo.name << ": table " << tableName << " already defined." << std::endl;
-            }
+            result.tables.push_back(std::make_shared<TableDefinition>(tableName, block.contents));
 
             return true;
         }
@@ -58,8 +88,33 @@ private:
         return false;
     }
 
-    // Parse a shader file with the given contents and filename
-    void parseShaderFile(std::istream& inStr, const vfs::FileInfo& fileInfo)
+    // Sort the given block into the result
+    static void processBlock(parser::BlockTokeniser::Block& block, ParseResult& result)
+    {
+        // Try to parse tables
+        if (parseTable(block, result))
+        {
+            return; // table successfully parsed
+        }
+
+        if (block.name.substr(0, 5) == "skin ")
+        {
+            return; // skip skin definition
+        }
+
+        if (block.name.substr(0, 9) == "particle ")
+        {
+            return; // skip particle definition
+        }
+
+        string::replace_all(block.name, "\\", "/"); // use forward slashes
+
+        result.templates.emplace_back(block.name,
+            std::make_shared<ShaderTemplate>(block.name, block.contents));
+    }
+
+    // Parse a shader file with the given contents, doesn't touch the library
+    static void parseShaderFile(std::istream& inStr, ParseResult& result)
     {
         // Parse the file with a blocktokeniser, the actual block contents
         // will be parsed separately.
@@ -69,45 +124,191 @@ private:
         {
             // Get the next block
             parser::BlockTokeniser::Block block = tokeniser.nextBlock();
+            processBlock(block, result);
+        }
+    }
 
-            // Try to parse tables
-            if (parseTable(block, fileInfo))
-            {
-                continue; // table successfully parsed
-            }
-            
-            if (block.name.substr(0, 5) == "skin ")
+    // Opens and parses the given file, to be called from any thread
+    ParseResult parseFile(const vfs::FileInfo& fileInfo)
+    {
+        ParseResult result;
+
+        if (_declCache)
+        {
+            decl::DeclFilePtr cached = _declCache->getFile(fileInfo.fullPath(),
+                decl::DeclFileContents::Blocks);
+
+            if (!cached)
             {
-                continue; // skip skin definition
+                throw std::runtime_error("Unable to read shaderfile: " + fileInfo.name);
             }
-            
-            if (block.name.substr(0, 9) == "particle ")
+
+            for (const decl::DeclBlock& cachedBlock : cached->blocks)
             {
-                continue; // skip particle definition
+                parser::BlockTokeniser::Block block;
+                block.name = cachedBlock.name;
+                block.contents = cachedBlock.contents;
+
+                processBlock(block, result);
             }
 
-            string::replace_all(block.name, "\\", "/"); // use forward slashes
+            return result;
+        }
+
+        ArchiveTextFilePtr file = _vfs.openTextFile(fileInfo.fullPath());
 
-            auto shaderTemplate = std::make_shared<ShaderTemplate>(block.name, block.contents);
+        if (!file)
+        {
+            throw std::runtime_error("Unable to read shaderfile: " + fileInfo.name);
+        }
 
+        std::istream is(&(file->getInputStream()));
+        parseShaderFile(is, result);
+
+        return result;
+    }
+
+    // Adds the declarations parsed from the given file to the library
+    void mergeResult(const ParseResult& result, const vfs::FileInfo& fileInfo)
+    {
+        for (const TableDefinitionPtr& table : result.tables)
+        {
+            if (!_library.addTableDefinition(table))
+            {
+                rError() << "[shaders] " << fileInfo.name << ": table " << table->getName() << " already defined." << std::endl;
+            }
+        }
+
+        for (const auto& pair : result.templates)
+        {
             // Construct the ShaderDefinition wrapper class
-            ShaderDefinition def(shaderTemplate, fileInfo);
+            ShaderDefinition def(pair.second, fileInfo);
 
             // Insert into the definitions map, if not already present
-            if (!_library.addDefinition(block.name, def))
+            if (!_library.addDefinition(pair.first, def))
             {
-                rError() << "[shaders] " << fileInfo.name << ": shader " << block.name << " already defined." << std::endl;
+                rError() << "[shaders] " << fileInfo.name << ": shader " << pair.first << " already defined." << std::endl;
             }
         }
     }
 
+    void parseFilesSequentially()
+    {
+        if (_declCache)
+        {
+            // Most files are expected to come from the cache, no need to read ahead
+            for (const vfs::FileInfo& fileInfo : _files)
+            {
+                mergeResult(parseFile(fileInfo), fileInfo);
+            }
+
+            return;
+        }
+
+        // Have the VFS read the next few files in the background while we're
+        // parsing, requesting a new one whenever a file has been taken. Each
+        // loaded file is held in memory until it is parsed.
+        std::deque<std::future<ArchiveTextFilePtr>> loadedFiles;
+        std::size_t numRequested = 0;
+
+        for (std::size_t i = 0; i < _files.size(); ++i)
+        {
+            while (numRequested < _files.size() && numRequested < i + MAX_FILES_READ_AHEAD)
+            {
+                auto requested = _vfs.openTextFilesAsync({ _files[numRequested++].fullPath() });
+                loadedFiles.emplace_back(std::move(requested.front()));
+            }
+
+            const vfs::FileInfo& fileInfo = _files[i];
+
+            auto file = loadedFiles.front().get();
+            loadedFiles.pop_front();
+
+            if (file)
+            {
+                ParseResult result;
+
+                std::istream is(&(file->getInputStream()));
+                parseShaderFile(is, result);
+
+                mergeResult(result, fileInfo);
+            }
+            else
+            {
+                throw std::runtime_error("Unable to read shaderfile: " + fileInfo.name);
+            }
+        }
+    }
+
+    void parseFilesInParallel()
+    {
+        std::vector<ParseResult> results(_files.size());
+
+        std::vector<std::function<void()>> tasks;
+        tasks.reserve(_files.size());
+
+        for (std::size_t i = 0; i < _files.size(); ++i)
+        {
+            tasks.emplace_back([this, &results, i]() { results[i] = parseFile(_files[i]); });
+        }
+
+        if (_subTaskRunner)
+        {
+            _subTaskRunner(tasks);
+        }
+        else
+        {
+            runOnThreadPool(tasks);
+        }
+
+        // Merge in VFS order, regardless of the order the files were parsed in
+        for (std::size_t i = 0; i < _files.size(); ++i)
+        {
+            mergeResult(results[i], _files[i]);
+        }
+    }
+
+    // Fallback if no sub-task runner has been set
+    static void runOnThreadPool(const std::vector<std::function<void()>>& tasks)
+    {
+        util::ThreadPool pool(std::min(util::ThreadPool::getDefaultNumThreads(), tasks.size()));
+
+        std::vector<std::future<void>> futures;
+        futures.reserve(tasks.size());
+
+        for (const auto& task : tasks)
+        {
+            futures.emplace_back(pool.submit(task));
+        }
+
+        // Wait for all of them before passing on the first exception
+        std::exception_ptr exception;
+
+        for (auto& future : futures)
+        {
+            try
+            {
+                future.get();
+            }
+            catch (...)
+            {
+                if (!exception) exception = std::current_exception();
+            }
+        }
+
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
 public:
 
     /// Construct and initialise the ShaderFileLoader
     ShaderFileLoader(vfs::VirtualFileSystem& fs, ShaderLibrary_T& library,
                      const std::string& basedir,
                      const std::string& extension = "mtr")
-    : _vfs(fs), _library(library)
+    : _vfs(fs), _library(library), _declCache(nullptr)
     {
         _files.reserve(200);
 
@@ -119,22 +320,37 @@ public:
         );
     }
 
-    void parseFiles()
+    /// Construct a ShaderFileLoader parsing the given files only
+    ShaderFileLoader(vfs::VirtualFileSystem& fs, ShaderLibrary_T& library,
+                     const std::vector<vfs::FileInfo>& files)
+    : _vfs(fs), _library(library), _files(files), _declCache(nullptr)
+    {}
+
+    /// Set the function running the parse tasks in the parallel mode,
+    /// e.g. to use the workers of the DeclLoadScheduler
+    void setSubTaskRunner(const SubTaskRunner& runner)
     {
-        for (const vfs::FileInfo& fileInfo: _files)
-        {
-            // Open the file
-            auto file = _vfs.openTextFile(fileInfo.fullPath());
+        _subTaskRunner = runner;
+    }
 
-            if (file)
-            {
-                std::istream is(&(file->getInputStream()));
-                parseShaderFile(is, fileInfo);
-            }
-            else
-            {
-                throw std::runtime_error("Unable to read shaderfile: " + fileInfo.name);
-            }
+    /// Take the file contents from the given decl cache instead of
+    /// tokenising every file, pass nullptr to disable the cache again
+    void setDeclCache(decl::IDeclCache* declCache)
+    {
+        _declCache = declCache;
+    }
+
+    /// Parse all files and add their declarations to the library. Both modes
+    /// produce the same library contents and warnings.
+    void parseFiles(FileParseMode mode = FileParseMode::Parallel)
+    {
+        if (mode == FileParseMode::Parallel && _files.size() > 1)
+        {
+            parseFilesInParallel();
+        }
+        else
+        {
+            parseFilesSequentially();
         }
     }
 };
@@ -1,10 +1,12 @@
 #include "ShaderLibrary.h"
 
+#include <algorithm>
 #include <iostream>
 #include <utility>
 #include "iimage.h"
 #include "itextstream.h"
 #include "ShaderTemplate.h"
+#include "ShaderNameCompareFunctor.h"
 
 namespace shaders 
 {
@@ -14,16 +16,21 @@ bool ShaderLibrary::addDefinition(const std::string& name,
 								  const ShaderDefinition& def)
 {
 	std::pair<ShaderDefinitionMap::iterator, bool> result = _definitions.insert(
-		ShaderDefinitionMap::value_type(name, def)
+		ShaderDefinitionMap::value_type(decl::DeclName(name), def)
 	);
 
+	if (result.second)
+	{
+		_sortedDefinitionNames.reset();
+	}
+
 	return result.second;
 }
 
 ShaderDefinition& ShaderLibrary::getDefinition(const std::string& name)
 {
-	// Try to lookup the named definition
-	ShaderDefinitionMap::iterator i = _definitions.find(name);
+	// Try to lookup the named definition, the name is interned below if needed
+	ShaderDefinitionMap::iterator i = _definitions.find(decl::DeclName::Find(name));
 
 	if (i != _definitions.end())
     {
@@ -48,7 +55,8 @@ ShaderDefinition& ShaderLibrary::getDefinition(const std::string& name)
 		ShaderDefinition def(shaderTemplate);
 
 		// Insert the shader definition and set the iterator to it
-		i = _definitions.insert(ShaderDefinitionMap::value_type(name, def)).first;
+		i = _definitions.insert(ShaderDefinitionMap::value_type(decl::DeclName(name), def)).first;
+		_sortedDefinitionNames.reset();
 
 		return i->second;
 	}
@@ -64,7 +72,8 @@ ShaderDefinition& ShaderLibrary::getDefinition(const std::string& name)
 		ShaderDefinition def(shaderTemplate);
 
 		// Insert the shader definition and set the iterator to it
-		i = _definitions.insert(ShaderDefinitionMap::value_type(name, def)).first;
+		i = _definitions.insert(ShaderDefinitionMap::value_type(decl::DeclName(name), def)).first;
+		_sortedDefinitionNames.reset();
 
 		return i->second;
 	}
@@ -72,15 +81,15 @@ ShaderDefinition& ShaderLibrary::getDefinition(const std::string& name)
 
 bool ShaderLibrary::definitionExists(const std::string& name) const
 {
-	ShaderDefinitionMap::const_iterator i = _definitions.find(name);
+	decl::DeclName declName = decl::DeclName::Find(name);
 
-	return i != _definitions.end();
+	return !declName.empty() && _definitions.count(declName) > 0;
 }
 
 CShaderPtr ShaderLibrary::findShader(const std::string& name)
 {
 	// Try to lookup the shader in the active shaders list
-	ShaderMap::iterator i = _shaders.find(name);
+	ShaderMap::iterator i = _shaders.find(decl::DeclName::Find(name));
 
 	if (i != _shaders.end())
     {
@@ -97,7 +106,8 @@ CShaderPtr ShaderLibrary::findShader(const std::string& name)
         // map
         CShaderPtr shader(new CShader(name, def));
 
-		_shaders[name] = shader;
+		_shaders[decl::DeclName(name)] = shader;
+		_sortedShaders.reset();
 
 		return shader;
 	}
@@ -108,6 +118,9 @@ void ShaderLibrary::clear()
 	_shaders.clear();
 	_definitions.clear();
     _tables.clear();
+
+	_sortedDefinitionNames.reset();
+	_sortedShaders.reset();
 }
 
 std::size_t ShaderLibrary::getNumDefinitions()
@@ -117,24 +130,82 @@ std::size_t ShaderLibrary::getNumDefinitions()
 
 void ShaderLibrary::foreachShaderName(const ShaderNameCallback& callback)
 {
-    for (const auto& pair : _definitions)
+	if (!_sortedDefinitionNames)
+	{
+		std::shared_ptr<SortedNames> names = std::make_shared<SortedNames>();
+		names->reserve(_definitions.size());
+
+		for (const auto& pair : _definitions)
+		{
+			if (pair.second.file.visibility == vfs::Visibility::NORMAL)
+				names->emplace_back(pair.second.shaderTemplate->getName());
+		}
+
+		// The hashed map has no order, but the UI expects the names sorted
+		std::sort(names->begin(), names->end(), ShaderNameCompareFunctor());
+
+		_sortedDefinitionNames = names;
+	}
+
+	// The callback might add definitions, which resets the member
+	std::shared_ptr<const SortedNames> names = _sortedDefinitionNames;
+
+	for (const std::string& name : *names)
 	{
-        if (pair.second.file.visibility == vfs::Visibility::NORMAL)
-            callback(pair.first);
+		callback(name);
 	}
 }
 
 void ShaderLibrary::foreachShader(const std::function<void(const CShaderPtr&)>& func)
 {
-	for (const ShaderMap::value_type& pair : _shaders)
+	if (!_sortedShaders)
+	{
+		std::vector<std::pair<std::string, CShaderPtr>> named;
+		named.reserve(_shaders.size());
+
+		for (const ShaderMap::value_type& pair : _shaders)
+		{
+			named.emplace_back(pair.second->getName(), pair.second);
+		}
+
+		// Keep the alphabetical order the texture browser is displaying
+		std::sort(named.begin(), named.end(), [](const std::pair<std::string, CShaderPtr>& a,
+			const std::pair<std::string, CShaderPtr>& b)
+		{
+			return ShaderNameCompareFunctor()(a.first, b.first);
+		});
+
+		std::shared_ptr<SortedShaders> shaders = std::make_shared<SortedShaders>();
+		shaders->reserve(named.size());
+
+		for (const auto& pair : named)
+		{
+			shaders->push_back(pair.second);
+		}
+
+		_sortedShaders = shaders;
+	}
+
+	// The functor might create shaders, which resets the member
+	std::shared_ptr<const SortedShaders> shaders = _sortedShaders;
+
+	for (const CShaderPtr& shader : *shaders)
+	{
+        func(shader);
+	}
+}
+
+void ShaderLibrary::foreachTemplate(const std::function<void(const ShaderTemplatePtr&)>& func)
+{
+	for (const ShaderDefinitionMap::value_type& pair : _definitions)
 	{
-        func(pair.second);
+		func(pair.second.shaderTemplate);
 	}
 }
 
 TableDefinitionPtr ShaderLibrary::getTableForName(const std::string& name)
 {
-    TableDefinitions::const_iterator i = _tables.find(name);
+    TableDefinitions::const_iterator i = _tables.find(decl::DeclName::Find(name));
 
     return i != _tables.end() ? i->second : TableDefinitionPtr();
 }
@@ -142,9 +213,79 @@ TableDefinitionPtr ShaderLibrary::getTableForName(const std::string& name)
 bool ShaderLibrary::addTableDefinition(const TableDefinitionPtr& def)
 {
     std::pair<TableDefinitions::iterator, bool> result = _tables.insert(
-        TableDefinitions::value_type(def->getName(), def));
+        TableDefinitions::value_type(decl::DeclName(def->getName()), def));
 
     return result.second;
 }
 
+std::set<std::string> ShaderLibrary::replaceDefinitions(const std::set<std::string>& files,
+	const ShaderLibrary& reparsed)
+{
+	std::set<std::string> changedNames;
+
+	// The assets.lst is not re-read, keep the visibility of the known files
+	std::map<std::string, vfs::Visibility> visibilities;
+
+	for (ShaderDefinitionMap::iterator i = _definitions.begin(); i != _definitions.end();)
+	{
+		std::string path = i->second.file.fullPath();
+
+		if (files.count(path) > 0)
+		{
+			visibilities[path] = i->second.file.visibility;
+			changedNames.insert(i->second.shaderTemplate->getName());
+
+			_definitions.erase(i++);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	for (const ShaderDefinitionMap::value_type& pair : reparsed._definitions)
+	{
+		ShaderDefinition def = pair.second;
+
+		auto visibility = visibilities.find(def.file.fullPath());
+
+		if (visibility != visibilities.end())
+		{
+			def.file.visibility = visibility->second;
+		}
+
+		// Definitions in other files take precedence, as they did before
+		if (_definitions.insert(ShaderDefinitionMap::value_type(pair.first, def)).second)
+		{
+			changedNames.insert(def.shaderTemplate->getName());
+		}
+		else
+		{
+			rError() << "[shaders] " << def.file.name << ": shader "
+				<< def.shaderTemplate->getName() << " already defined." << std::endl;
+		}
+	}
+
+	_sortedDefinitionNames.reset();
+
+	for (const TableDefinitions::value_type& pair : reparsed._tables)
+	{
+		_tables[pair.first] = pair.second;
+	}
+
+	// Update the active shaders, the ones which have been removed
+	// receive the same default definition as any unknown shader
+	for (const std::string& name : changedNames)
+	{
+		ShaderMap::iterator shader = _shaders.find(decl::DeclName::Find(name));
+
+		if (shader != _shaders.end())
+		{
+			shader->second->setDefinition(getDefinition(name));
+		}
+	}
+
+	return changedNames;
+}
+
 } // namespace shaders
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <string>
-#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include "CShader.h"
 #include "TableDefinition.h"
 
@@ -14,13 +16,22 @@ class ShaderLibrary
 	// These are referenced by name.
 	ShaderDefinitionMap _definitions;
 
-	typedef std::map<std::string, CShaderPtr, ShaderNameCompareFunctor> ShaderMap;
+	typedef std::unordered_map<decl::DeclName, CShaderPtr> ShaderMap;
     ShaderMap _shaders;
 
     // The lookup tables used in shader expressions
-    typedef std::map<std::string, TableDefinitionPtr, ShaderNameCompareFunctor> TableDefinitions;
+    typedef std::unordered_map<decl::DeclName, TableDefinitionPtr> TableDefinitions;
     TableDefinitions _tables;
 
+	// The maps have no order, the names of the visible definitions and the
+	// active shaders are sorted once for the foreach methods. Reset when
+	// elements are added or removed, the visitors keep their own reference.
+	typedef std::vector<std::string> SortedNames;
+	std::shared_ptr<const SortedNames> _sortedDefinitionNames;
+
+	typedef std::vector<CShaderPtr> SortedShaders;
+	std::shared_ptr<const SortedShaders> _sortedShaders;
+
 public:
 
 	/* greebo: Add a shader definition to the internal list
@@ -52,16 +63,32 @@ public:
 	 */
 	CShaderPtr findShader(const std::string& name);
 
+	// Visits the names of the visible definitions in alphabetical order
 	void foreachShaderName(const ShaderNameCallback& callback);
 
-	// Traverse the library using the given functor
+	// Traverse the library using the given functor, in alphabetical order
 	void foreachShader(const std::function<void(const CShaderPtr&)>& func);
 
+	// Visits the templates of all known shader definitions
+	void foreachTemplate(const std::function<void(const ShaderTemplatePtr&)>& func);
+
     // Look up a table def, return NULL if not found
     TableDefinitionPtr getTableForName(const std::string& name);
 
     // Method for adding tables, returns FALSE if a def with the same name already exists
     bool addTableDefinition(const TableDefinitionPtr& def);
+
+	/**
+	 * Replaces all definitions parsed from the given files (identified by
+	 * their VFS paths) with the ones found in the other library, which is
+	 * holding the re-parsed contents of these files. Existing shaders are
+	 * updated in place, tables replace the existing ones of the same name.
+	 *
+	 * @returns: the names of all definitions which have been changed,
+	 * added or removed.
+	 */
+	std::set<std::string> replaceDefinitions(const std::set<std::string>& files,
+		const ShaderLibrary& reparsed);
 };
 typedef std::shared_ptr<ShaderLibrary> ShaderLibraryPtr;
 
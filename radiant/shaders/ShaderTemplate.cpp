@@ -17,14 +17,85 @@
 namespace shaders
 {
 
+namespace
+{
+    std::atomic<std::size_t> numPreParsed(0);
+    std::atomic<std::size_t> numParsedOnDemand(0);
+    std::atomic<std::size_t> numParsedOnDemandMainThread(0);
+
+    std::thread::id mainThreadId;
+}
+
 NamedBindablePtr ShaderTemplate::getEditorTexture()
 {
     if (!_parsed)
-        parseDefinition();
+        parseOnDemand();
 
     return _editorTex;
 }
 
+bool ShaderTemplate::preParse()
+{
+    if (_parsed || !parseOnce())
+    {
+        return false;
+    }
+
+    ++numPreParsed;
+    return true;
+}
+
+void ShaderTemplate::parseOnDemand()
+{
+    if (!parseOnce())
+    {
+        return;
+    }
+
+    ++numParsedOnDemand;
+
+    if (std::this_thread::get_id() == mainThreadId)
+    {
+        ++numParsedOnDemandMainThread;
+    }
+}
+
+bool ShaderTemplate::parseOnce()
+{
+    std::lock_guard<std::recursive_mutex> lock(_parseLock);
+
+    // Another thread might have been faster
+    if (_parsed || _parsing)
+    {
+        return false;
+    }
+
+    _parsing = true;
+    parseDefinition();
+    _parsing = false;
+
+    // Accessors of other threads can go ahead from now on
+    _parsed = true;
+
+    return true;
+}
+
+ShaderTemplate::ParseStatistics ShaderTemplate::getParseStatistics()
+{
+    ParseStatistics statistics;
+
+    statistics.preParsed = numPreParsed;
+    statistics.onDemand = numParsedOnDemand;
+    statistics.onDemandMainThread = numParsedOnDemandMainThread;
+
+    return statistics;
+}
+
+void ShaderTemplate::setMainThread(std::thread::id mainThread)
+{
+    mainThreadId = mainThread;
+}
+
 IShaderExpressionPtr ShaderTemplate::parseSingleExpressionTerm(parser::DefTokeniser& tokeniser)
 {
 	std::string token = tokeniser.nextToken();
@@ -1152,8 +1223,6 @@ void ShaderTemplate::parseDefinition()
         "{}(),"  // add the comma character to the kept delimiters
     );
 
-    _parsed = true; // we're parsed from now on
-
     try
     {
         int level = 1;  // we always start at top level
@@ -1303,7 +1372,7 @@ void ShaderTemplate::addLayer(ShaderLayer::Type type, const MapExpressionPtr& ma
 
 bool ShaderTemplate::hasDiffusemap()
 {
-	if (!_parsed) parseDefinition();
+	if (!_parsed) parseOnDemand();
 
 	for (Layers::const_iterator i = _layers.begin(); i != _layers.end(); ++i)
     {
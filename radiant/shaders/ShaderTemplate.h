@@ -7,8 +7,11 @@
 #include "parser/DefTokeniser.h"
 #include "math/Vector3.h"
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace shaders { class MapExpression; }
 
@@ -86,8 +89,13 @@ private:
 	// Raw material declaration
 	std::string _blockContents;
 
-	// Whether the block has been parsed
-	bool _parsed;
+	// Whether the block has been parsed. The block is parsed on demand or
+	// by the background parser, whichever comes first.
+	std::atomic<bool> _parsed;
+
+	// Serialises the parsing threads, _parsing guards against re-entrance
+	std::recursive_mutex _parseLock;
+	bool _parsing;
 
 public:
 
@@ -112,7 +120,8 @@ public:
       _polygonOffset(0.0f),
 	  _coverage(Material::MC_UNDETERMINED),
 	  _blockContents(blockContents),
-	  _parsed(false)
+	  _parsed(false),
+	  _parsing(false)
 	{
 		_decalInfo.stayMilliSeconds = 0;
 		_decalInfo.fadeMilliSeconds = 0;
@@ -138,97 +147,97 @@ public:
 
 	const std::string& getDescription()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return description;
 	}
 
 	int getMaterialFlags()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _materialFlags;
 	}
 
 	Material::CullType getCullType()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _cullType;
 	}
 
 	ClampType getClampType()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _clampType;
 	}
 
 	int getSurfaceFlags()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _surfaceFlags;
 	}
 
 	Material::SurfaceType getSurfaceType()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _surfaceType;
 	}
 
 	Material::DeformType getDeformType()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _deformType;
 	}
 
 	int getSpectrum()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _spectrum;
 	}
 
 	const Material::DecalInfo& getDecalInfo()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _decalInfo;
 	}
 
 	Material::Coverage getCoverage()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _coverage;
 	}
 
 	const Layers& getLayers()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _layers;
 	}
 
 	bool isFogLight()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return fogLight;
 	}
 
 	bool isAmbientLight()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return ambientLight;
 	}
 
 	bool isBlendLight()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return blendLight;
 	}
 
     int getSortRequest()
     {
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
         return _sortReq;
     }
 
     float getPolygonOffset()
     {
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
         return _polygonOffset;
     }
 
@@ -252,7 +261,7 @@ public:
 
 	const shaders::MapExpressionPtr& getLightFalloff()
 	{
-		if (!_parsed) parseDefinition();
+		if (!_parsed) parseOnDemand();
 		return _lightFalloff;
 	}
 
@@ -262,11 +271,41 @@ public:
 	// Returns true if this shader template includes a diffusemap stage
 	bool hasDiffusemap();
 
+	/**
+	 * Parses the definition, unless this has been done already. Can be called
+	 * from any thread, concurrent accessors wait for the parse to finish.
+	 * Returns true if the definition has been parsed by this call.
+	 */
+	bool preParse();
+
+	// The number of definitions parsed by preParse(), and the number of
+	// definitions parsed on demand when first accessed
+	struct ParseStatistics
+	{
+		std::size_t preParsed = 0;
+		std::size_t onDemand = 0;
+
+		// The on-demand parses which happened on the main thread
+		std::size_t onDemandMainThread = 0;
+	};
+
+	static ParseStatistics getParseStatistics();
+
+	// Sets the thread on-demand parses are counted separately for
+	static void setMainThread(std::thread::id mainThread);
+
 private:
 
 	// Add the given layer and assigns editor preview layer if applicable
 	void addLayer(const Doom3ShaderLayerPtr& layer);
 
+	// Parses the definition when accessed for the first time
+	void parseOnDemand();
+
+	// Parses the definition unless done already (or in progress on this
+	// thread), returns true if parsed by this call
+	bool parseOnce();
+
 	/**
 	 * Parse a Doom 3 material decl. This is the master parse function, it
 	 * returns no value but exceptions may be thrown at any stage of the
@@ -0,0 +1,430 @@
+#include "ThumbnailCache.h"
+
+#include "itextstream.h"
+#include "os/fs.h"
+#include "RGBAImage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace shaders
+{
+
+namespace
+{
+	// Bump the version whenever the file layout or the thumbnail creation changes
+	const char CACHE_MAGIC[4] = { 'D', 'R', 'T', 'C' };
+	const std::uint32_t CACHE_VERSION = 1;
+
+	// Magic, version and thumbnail size
+	const std::uint64_t HEADER_SIZE = sizeof(CACHE_MAGIC) + 2 * sizeof(std::uint32_t);
+
+	// Plain binary I/O in host byte order, the cache is not meant to be portable
+	template<typename T>
+	void writeValue(std::ostream& stream, T value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void writeString(std::ostream& stream, const std::string& str)
+	{
+		writeValue<std::uint32_t>(stream, static_cast<std::uint32_t>(str.size()));
+		stream.write(str.data(), str.size());
+	}
+
+	template<typename T>
+	T readValue(std::istream& stream)
+	{
+		T value = T();
+		stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+		return value;
+	}
+
+	// Returns false if the string doesn't fit into the given number of bytes
+	// left in the stream, before allocating anything for it
+	bool readString(std::istream& stream, std::uint64_t available, std::string& str)
+	{
+		std::uint32_t length = readValue<std::uint32_t>(stream);
+
+		if (!stream || length > available - std::min<std::uint64_t>(available, sizeof(length)))
+		{
+			return false;
+		}
+
+		str.resize(length);
+		stream.read(&str[0], length);
+
+		return static_cast<bool>(stream);
+	}
+
+	// Name, signature, dimensions and pixels
+	std::uint64_t getRecordSize(const std::string& name, std::uint32_t width, std::uint32_t height)
+	{
+		return sizeof(std::uint32_t) + name.size() + sizeof(std::uint64_t) + 2 * sizeof(std::uint32_t) +
+			static_cast<std::uint64_t>(width) * height * 4;
+	}
+}
+
+ThumbnailCache::ThumbnailCache(const std::string& cacheFile, std::size_t thumbnailSize) :
+	_cacheFile(cacheFile),
+	_thumbnailSize(thumbnailSize),
+	_fileSize(0),
+	_obsoleteBytes(0)
+{}
+
+std::size_t ThumbnailCache::getThumbnailSize() const
+{
+	return _thumbnailSize;
+}
+
+bool ThumbnailCache::getSize(const std::string& name, std::uint64_t signature,
+							 std::size_t& width, std::size_t& height)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto found = _entries.find(name);
+
+	if (found == _entries.end() || found->second.signature != signature)
+	{
+		return false;
+	}
+
+	width = found->second.width;
+	height = found->second.height;
+
+	return true;
+}
+
+ImagePtr ThumbnailCache::get(const std::string& name, std::uint64_t signature,
+							 const std::function<ImagePtr()>& createThumbnail)
+{
+	Entry entry;
+	bool cached = false;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto found = _entries.find(name);
+
+		if (found != _entries.end() && found->second.signature == signature)
+		{
+			entry = found->second;
+			cached = true;
+		}
+	}
+
+	if (cached)
+	{
+		ImagePtr thumbnail = readThumbnail(entry);
+
+		if (thumbnail)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			++_statistics.hits;
+
+			return thumbnail;
+		}
+
+		// The file has been removed or truncated, create the thumbnail again
+	}
+
+	ImagePtr thumbnail = createThumbnail();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	++_statistics.misses;
+
+	if (thumbnail && !thumbnail->isPrecompressed() &&
+		thumbnail->getWidth(0) <= _thumbnailSize && thumbnail->getHeight(0) <= _thumbnailSize)
+	{
+		writeThumbnail(name, signature, *thumbnail);
+	}
+
+	return thumbnail;
+}
+
+void ThumbnailCache::invalidate()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	closeOutput();
+
+	_entries.clear();
+	_statistics = Statistics();
+	_fileSize = 0;
+	_obsoleteBytes = 0;
+
+	if (!_cacheFile.empty() && fs::exists(_cacheFile))
+	{
+		fs::remove(_cacheFile);
+	}
+}
+
+ThumbnailCache::Statistics ThumbnailCache::getStatistics()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Statistics statistics = _statistics;
+	statistics.numThumbnails = _entries.size();
+	statistics.fileSize = _fileSize;
+
+	return statistics;
+}
+
+bool ThumbnailCache::load()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	closeOutput();
+
+	_entries.clear();
+	_fileSize = 0;
+	_obsoleteBytes = 0;
+
+	std::ifstream stream(_cacheFile, std::ios::binary | std::ios::ate);
+
+	if (!stream)
+	{
+		return false;
+	}
+
+	std::uint64_t length = static_cast<std::uint64_t>(stream.tellg());
+	stream.seekg(0);
+
+	char magic[sizeof(CACHE_MAGIC)];
+	stream.read(magic, sizeof(magic));
+
+	if (!stream || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 ||
+		readValue<std::uint32_t>(stream) != CACHE_VERSION ||
+		readValue<std::uint32_t>(stream) != _thumbnailSize)
+	{
+		rMessage() << "[shaders] Ignoring outdated thumbnail cache " << _cacheFile << std::endl;
+		return false;
+	}
+
+	std::uint64_t position = HEADER_SIZE;
+
+	while (position < length)
+	{
+		std::string name;
+		bool nameValid = readString(stream, length - position, name);
+
+		Entry entry;
+		entry.signature = readValue<std::uint64_t>(stream);
+		entry.width = readValue<std::uint32_t>(stream);
+		entry.height = readValue<std::uint32_t>(stream);
+		entry.offset = static_cast<std::uint64_t>(stream.tellg());
+
+		std::uint64_t recordSize = getRecordSize(name, entry.width, entry.height);
+
+		// Seeking past the end doesn't fail, check the length of the file instead
+		if (!nameValid || !stream || entry.width > _thumbnailSize || entry.height > _thumbnailSize ||
+			position + recordSize > length)
+		{
+			rWarning() << "[shaders] Thumbnail cache " << _cacheFile << " is corrupt, ignoring it." << std::endl;
+			_entries.clear();
+			_obsoleteBytes = 0;
+			return false;
+		}
+
+		// Replaced thumbnails are followed by their new version
+		auto existing = _entries.find(name);
+
+		if (existing != _entries.end())
+		{
+			_obsoleteBytes += getRecordSize(name, existing->second.width, existing->second.height);
+		}
+
+		_entries[name] = entry;
+
+		position += recordSize;
+		stream.seekg(position);
+	}
+
+	_fileSize = position;
+
+	rMessage() << "[shaders] Loaded the index of " << _entries.size() << " cached thumbnails." << std::endl;
+
+	return true;
+}
+
+void ThumbnailCache::save()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	closeOutput();
+
+	if (_fileSize > 0 && _obsoleteBytes > _fileSize - HEADER_SIZE - _obsoleteBytes)
+	{
+		compact();
+	}
+}
+
+ImagePtr ThumbnailCache::readThumbnail(const Entry& entry)
+{
+	std::ifstream stream(_cacheFile, std::ios::binary);
+
+	if (!stream)
+	{
+		return ImagePtr();
+	}
+
+	RGBAImagePtr image(new RGBAImage(entry.width, entry.height));
+
+	stream.seekg(entry.offset);
+	stream.read(reinterpret_cast<char*>(image->getMipMapPixels(0)),
+		static_cast<std::streamsize>(entry.width) * entry.height * 4);
+
+	return stream ? image : ImagePtr();
+}
+
+void ThumbnailCache::writeThumbnail(const std::string& name, std::uint64_t signature, const Image& image)
+{
+	if (!_output.is_open())
+	{
+		if (_fileSize == 0)
+		{
+			// No valid file yet, start a new one
+			_output.open(_cacheFile, std::ios::binary | std::ios::trunc);
+
+			_output.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+			writeValue<std::uint32_t>(_output, CACHE_VERSION);
+			writeValue<std::uint32_t>(_output, static_cast<std::uint32_t>(_thumbnailSize));
+
+			_fileSize = HEADER_SIZE;
+		}
+		else
+		{
+			_output.open(_cacheFile, std::ios::binary | std::ios::app);
+		}
+
+		if (!_output)
+		{
+			rWarning() << "[shaders] Cannot write thumbnail cache " << _cacheFile << std::endl;
+			closeOutput();
+			return;
+		}
+	}
+
+	Entry entry;
+	entry.signature = signature;
+	entry.width = static_cast<std::uint32_t>(image.getWidth(0));
+	entry.height = static_cast<std::uint32_t>(image.getHeight(0));
+	entry.offset = _fileSize + getRecordSize(name, entry.width, entry.height) -
+		static_cast<std::uint64_t>(entry.width) * entry.height * 4;
+
+	writeString(_output, name);
+	writeValue<std::uint64_t>(_output, entry.signature);
+	writeValue<std::uint32_t>(_output, entry.width);
+	writeValue<std::uint32_t>(_output, entry.height);
+	_output.write(reinterpret_cast<const char*>(image.getMipMapPixels(0)),
+		static_cast<std::streamsize>(entry.width) * entry.height * 4);
+
+	// Other threads might read the thumbnail right away
+	_output.flush();
+
+	if (!_output)
+	{
+		rWarning() << "[shaders] Failed to write thumbnail cache " << _cacheFile << std::endl;
+
+		// The file might end in a partial record, start over next time
+		closeOutput();
+		_entries.clear();
+		_fileSize = 0;
+		_obsoleteBytes = 0;
+		return;
+	}
+
+	auto existing = _entries.find(name);
+
+	if (existing != _entries.end())
+	{
+		_obsoleteBytes += getRecordSize(name, existing->second.width, existing->second.height);
+	}
+
+	_entries[name] = entry;
+	_fileSize += getRecordSize(name, entry.width, entry.height);
+}
+
+void ThumbnailCache::compact()
+{
+	// Write to a temporary file first, to not leave a broken cache behind
+	std::string tempFile = _cacheFile + ".tmp";
+
+	std::ifstream input(_cacheFile, std::ios::binary);
+	std::uint64_t fileSize = HEADER_SIZE;
+	std::map<std::string, Entry> entries;
+
+	{
+		std::ofstream output(tempFile, std::ios::binary | std::ios::trunc);
+
+		if (!input || !output)
+		{
+			rWarning() << "[shaders] Cannot compact thumbnail cache " << _cacheFile << std::endl;
+			return;
+		}
+
+		output.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+		writeValue<std::uint32_t>(output, CACHE_VERSION);
+		writeValue<std::uint32_t>(output, static_cast<std::uint32_t>(_thumbnailSize));
+
+		std::vector<char> pixels;
+
+		for (const auto& pair : _entries)
+		{
+			const Entry& entry = pair.second;
+
+			pixels.resize(static_cast<std::size_t>(entry.width) * entry.height * 4);
+
+			input.seekg(entry.offset);
+			input.read(pixels.data(), pixels.size());
+
+			writeString(output, pair.first);
+			writeValue<std::uint64_t>(output, entry.signature);
+			writeValue<std::uint32_t>(output, entry.width);
+			writeValue<std::uint32_t>(output, entry.height);
+			output.write(pixels.data(), pixels.size());
+
+			std::uint64_t recordSize = getRecordSize(pair.first, entry.width, entry.height);
+
+			Entry& compacted = entries[pair.first];
+			compacted = entry;
+			compacted.offset = fileSize + recordSize - pixels.size();
+
+			fileSize += recordSize;
+		}
+
+		if (!input || !output)
+		{
+			rWarning() << "[shaders] Failed to compact thumbnail cache " << _cacheFile << std::endl;
+			return;
+		}
+	}
+
+	input.close();
+
+	try
+	{
+		fs::rename(tempFile, _cacheFile);
+
+		_entries.swap(entries);
+		_fileSize = fileSize;
+		_obsoleteBytes = 0;
+	}
+	catch (const fs::filesystem_error& ex)
+	{
+		rWarning() << "[shaders] Cannot replace thumbnail cache " << _cacheFile << ": " << ex.what() << std::endl;
+	}
+}
+
+void ThumbnailCache::closeOutput()
+{
+	if (_output.is_open())
+	{
+		_output.close();
+	}
+
+	_output.clear();
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "iimage.h"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace shaders
+{
+
+/**
+ * Persistent cache of the material thumbnails shown by the texture and media
+ * browsers, such that they don't need to load the full images.
+ *
+ * The thumbnails are stored in a single file in the user settings folder.
+ * Its index is read by load(), the pixels of a thumbnail are read when it is
+ * requested. Each thumbnail is stored along with a signature of its source
+ * images (see ThumbnailExpression), it is created again if the signature
+ * changed. New thumbnails are appended to the file, save() compacts the file
+ * once the replaced ones take up more space than the valid ones.
+ *
+ * All methods can be called from any thread.
+ */
+class ThumbnailCache
+{
+public:
+	struct Statistics
+	{
+		std::size_t hits = 0;
+		std::size_t misses = 0;
+
+		// Number of cached thumbnails and the size of the file
+		std::size_t numThumbnails = 0;
+		std::uint64_t fileSize = 0;
+	};
+
+private:
+	struct Entry
+	{
+		std::uint64_t signature = 0;
+
+		// Position of the pixels in the file
+		std::uint64_t offset = 0;
+
+		std::uint32_t width = 0;
+		std::uint32_t height = 0;
+	};
+
+	std::string _cacheFile;
+
+	// The maximum width and height of the thumbnails
+	std::size_t _thumbnailSize;
+
+	std::mutex _mutex;
+	std::map<std::string, Entry> _entries;
+	Statistics _statistics;
+
+	// New thumbnails are appended here, opened on the first one
+	std::ofstream _output;
+
+	// The end of the file and the number of bytes used by replaced thumbnails
+	std::uint64_t _fileSize;
+	std::uint64_t _obsoleteBytes;
+
+public:
+	// Constructs an empty cache using the given file and thumbnail size
+	ThumbnailCache(const std::string& cacheFile, std::size_t thumbnailSize);
+
+	std::size_t getThumbnailSize() const;
+
+	/**
+	 * Returns the dimensions of the cached thumbnail, if there is one for the
+	 * given material and signature. This doesn't read the file.
+	 */
+	bool getSize(const std::string& name, std::uint64_t signature,
+				 std::size_t& width, std::size_t& height);
+
+	/**
+	 * Returns the cached thumbnail of the given material, if the signature
+	 * matches. Otherwise the thumbnail is created using the given function
+	 * and stored, unless the function returns an empty pointer.
+	 * The function must return RGBA images.
+	 */
+	ImagePtr get(const std::string& name, std::uint64_t signature,
+				 const std::function<ImagePtr()>& createThumbnail);
+
+	// Removes all thumbnails, along with the cache file
+	void invalidate();
+
+	Statistics getStatistics();
+
+	// Reads the index of the cache file. Returns false if there is no (valid)
+	// cache file, leaving the cache empty.
+	bool load();
+
+	// Closes the cache file, compacting it if it contains too many replaced thumbnails
+	void save();
+
+private:
+	// Reads the pixels of the given entry, the file is opened for each read
+	// such that several threads can read at once
+	ImagePtr readThumbnail(const Entry& entry);
+
+	// Appends the thumbnail to the file, _mutex must be locked
+	void writeThumbnail(const std::string& name, std::uint64_t signature, const Image& image);
+
+	// Rewrites the file without the replaced thumbnails, _mutex must be locked
+	void compact();
+
+	void closeOutput();
+};
+
+}
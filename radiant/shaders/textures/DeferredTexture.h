@@ -0,0 +1,89 @@
+#pragma once
+
+#include "BasicTexture2D.h"
+#include "../MapExpression.h"
+
+namespace shaders
+{
+
+class GLTextureManager;
+class TextureDecoder;
+
+/**
+ * A 2D texture whose image is decoded in the background by the
+ * GLTextureManager. The GL texture number is allocated right away and shows
+ * a placeholder image until the decoded image has been uploaded on the main
+ * thread. Since the number doesn't change on upload, render passes which
+ * copied it don't need to be rebuilt.
+ *
+ * Asking for the dimensions of a texture which hasn't been decoded yet
+ * waits for its image, they are needed to calculate texture coordinates.
+ *
+ * Textures which haven't been used for a while can be evicted to stay
+ * within the texture memory budget, they keep their dimensions.
+ */
+class DeferredTexture :
+	public BasicTexture2D,
+	public std::enable_shared_from_this<DeferredTexture>
+{
+public:
+	enum class State
+	{
+		Queued,		// waiting for a decoder
+		Decoding,	// claimed by a decoder
+		Decoded,	// waiting for upload
+		Uploaded,
+		Evicted,	// showing the placeholder again, queued on its next use
+	};
+
+private:
+	friend class GLTextureManager;
+	friend class TextureDecoder;
+class TextureDecoder;
+
+	GLTextureManager& _manager;
+
+	// The expression to evaluate in the background
+	MapExpressionPtr _expression;
+
+	// These are guarded by the mutex of the manager's TextureDecoder
+	State _state;
+	ImagePtr _image;
+
+	// Main thread only: true once the dimensions have been set, and
+	// whether the "shader not found" image had to be used instead
+	bool _sizeKnown;
+	bool _missing;
+
+public:
+	DeferredTexture(GLTextureManager& manager, GLuint texNum, const std::string& name,
+		const MapExpressionPtr& expression) :
+		BasicTexture2D(texNum, name),
+		_manager(manager),
+		_expression(expression),
+		_state(State::Queued),
+		_sizeKnown(false),
+		_missing(false)
+	{}
+
+	std::size_t getWidth() const override
+	{
+		ensureSizeKnown();
+		return BasicTexture2D::getWidth();
+	}
+
+	std::size_t getHeight() const override
+	{
+		ensureSizeKnown();
+		return BasicTexture2D::getHeight();
+	}
+
+	// Counts as a use of the texture, loading it again if it has been evicted
+	GLuint getGLTexNum() const override;
+
+private:
+	void ensureSizeKnown() const;
+};
+typedef std::shared_ptr<DeferredTexture> DeferredTexturePtr;
+
+} // namespace shaders
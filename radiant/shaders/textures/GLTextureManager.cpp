@@ -7,14 +7,61 @@
 #include "../MapExpression.h"
 #include "TextureManipulator.h"
 #include "parser/DefTokeniser.h"
+#include "RGBAImage.h"
+
+#include <algorithm>
 
 namespace
 {
     const std::string SHADER_NOT_FOUND = "notex.bmp";
+
+    // The GL default, textures use as many mipmap levels as they define
+    const GLint DEFAULT_MAX_LEVEL = 1000;
 }
 
 namespace shaders {
 
+void DeferredTexture::ensureSizeKnown() const
+{
+    if (!_sizeKnown)
+    {
+        _manager.waitForImage(const_cast<DeferredTexture&>(*this));
+    }
+}
+
+GLuint DeferredTexture::getGLTexNum() const
+{
+    GLuint textureNum = BasicTexture2D::getGLTexNum();
+    _manager.markTextureUsed(textureNum);
+
+    return textureNum;
+}
+
+GLTextureManager::GLTextureManager() :
+    _loadInBackground(false),
+    _residency(0)
+{}
+
+GLTextureManager::~GLTextureManager()
+{
+    cancelDecoding();
+}
+
+void GLTextureManager::setLoadInBackground(bool loadInBackground)
+{
+    _loadInBackground = loadInBackground;
+}
+
+void GLTextureManager::setBitmapsPath(const std::string& bitmapsPath)
+{
+    _decoder.setBitmapsPath(bitmapsPath);
+}
+
+void GLTextureManager::setImageDecodedCallback(const std::function<void()>& callback)
+{
+    _decoder.setImageDecodedCallback(callback);
+}
+
 void GLTextureManager::checkBindings() {
     // Check the TextureMap for unique pointers and release them
     // as they aren't used by anyone else than this class.
@@ -24,6 +71,18 @@ void GLTextureManager::checkBindings() {
     {
         // If the std::shared_ptr is unique (i.e. refcount==1), remove it
         if (i->second.unique()) {
+            // Only deferred textures are tracked by their texture number. Read
+            // it from the base class, since DeferredTexture::getGLTexNum()
+            // counts as a use and would queue an evicted texture again.
+            DeferredTexturePtr deferred = std::dynamic_pointer_cast<DeferredTexture>(i->second);
+
+            if (deferred)
+            {
+                GLuint textureNum = deferred->BasicTexture2D::getGLTexNum();
+                _residency.remove(textureNum);
+                _deferredTextures.erase(textureNum);
+            }
+
             // Be sure to increment the iterator with a postfix ++,
             // so that the iterator is incremented right before deletion
             _textures.erase(i++);
@@ -53,6 +112,15 @@ TexturePtr GLTextureManager::getBinding(NamedBindablePtr bindable)
     }
     else
     {
+        // 2D map expressions can be evaluated in the background, cube maps
+        // need all of their images at once
+        MapExpressionPtr expression = std::dynamic_pointer_cast<MapExpression>(bindable);
+
+        if (_loadInBackground && expression && !expression->isCubeMap())
+        {
+            return createDeferredTexture(identifier, expression);
+        }
+
         // Create and insert texture object, if it is valid
         TexturePtr texture = bindable->bindTexture(identifier);
         if (texture)
@@ -110,6 +178,243 @@ TexturePtr GLTextureManager::getShaderNotFound()
     return _shaderNotFound;
 }
 
+bool GLTextureManager::isShaderNotFound(const TexturePtr& texture)
+{
+    if (texture == getShaderNotFound())
+    {
+        return true;
+    }
+
+    DeferredTexturePtr deferred = std::dynamic_pointer_cast<DeferredTexture>(texture);
+
+    if (!deferred)
+    {
+        return false;
+    }
+
+    // This waits for the image if necessary
+    deferred->ensureSizeKnown();
+
+    return deferred->_missing;
+}
+
+const ImagePtr& GLTextureManager::getShaderNotFoundImage()
+{
+    if (!_shaderNotFoundImage)
+    {
+        _shaderNotFoundImage = GlobalImageLoader().imageFromFile(
+            GlobalRegistry().get("user/paths/bitmapsPath") + SHADER_NOT_FOUND
+        );
+    }
+
+    return _shaderNotFoundImage;
+}
+
+TexturePtr GLTextureManager::createDeferredTexture(const std::string& identifier,
+    const MapExpressionPtr& expression)
+{
+    if (!_placeholderImage)
+    {
+        // A single grey pixel
+        RGBAImagePtr placeholder(new RGBAImage(1, 1));
+
+        placeholder->pixels[0].red = 128;
+        placeholder->pixels[0].green = 128;
+        placeholder->pixels[0].blue = 128;
+        placeholder->pixels[0].alpha = 255;
+
+        _placeholderImage = placeholder;
+    }
+
+    // The texture number is handed out right away, the image is uploaded
+    // into it once it has been decoded
+    GLuint textureNum;
+    glGenTextures(1, &textureNum);
+
+    _placeholderImage->uploadTexture(textureNum);
+
+    DeferredTexturePtr texture(new DeferredTexture(*this, textureNum, identifier, expression));
+    _textures.insert(TextureMap::value_type(identifier, texture));
+    _deferredTextures[textureNum] = texture;
+
+    // Cached thumbnails know their size, asking for it doesn't need to wait
+    std::size_t width, height;
+
+    if (expression->getImageSize(width, height))
+    {
+        texture->setWidth(width);
+        texture->setHeight(height);
+        texture->_sizeKnown = true;
+    }
+
+    _decoder.queue(texture);
+
+    return texture;
+}
+
+void GLTextureManager::waitForImage(DeferredTexture& texture)
+{
+    ImagePtr image = _decoder.waitForImage(texture);
+
+    if (!image)
+    {
+        texture._missing = true;
+        image = getShaderNotFoundImage();
+    }
+
+    if (image)
+    {
+        texture.setWidth(image->getWidth(0));
+        texture.setHeight(image->getHeight(0));
+    }
+
+    texture._sizeKnown = true;
+}
+
+void GLTextureManager::uploadTexture(DeferredTexture& texture, ImagePtr image)
+{
+    GLuint textureNum = texture.BasicTexture2D::getGLTexNum();
+
+    // Lift the limit set by evictTexture()
+    glBindTexture(GL_TEXTURE_2D, textureNum);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, DEFAULT_MAX_LEVEL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (image && image->uploadTexture(textureNum))
+    {
+        _residency.insert(textureNum, TextureResidency::GetTextureSize(*image));
+    }
+    else
+    {
+        rError() << "[shaders] Unable to load texture: "
+                            << texture.getName() << std::endl;
+
+        texture._missing = true;
+        image = getShaderNotFoundImage();
+
+        if (image)
+        {
+            image->uploadTexture(textureNum);
+        }
+    }
+
+    if (image)
+    {
+        texture.setWidth(image->getWidth(0));
+        texture.setHeight(image->getHeight(0));
+    }
+
+    texture._sizeKnown = true;
+}
+
+std::size_t GLTextureManager::uploadDecodedTextures(std::chrono::milliseconds budget)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::size_t numUploaded = 0;
+
+    while (std::chrono::steady_clock::now() - start < budget)
+    {
+        ImagePtr image;
+        DeferredTexturePtr texture = _decoder.takeDecodedTexture(image);
+
+        if (!texture)
+        {
+            break;
+        }
+
+        uploadTexture(*texture, image);
+        ++numUploaded;
+    }
+
+    return numUploaded;
+}
+
+void GLTextureManager::setTextureBudget(std::size_t budget)
+{
+    _residency.setBudget(budget);
+}
+
+void GLTextureManager::markTextureUsed(GLuint textureNum)
+{
+    if (!_residency.markUsed(textureNum))
+    {
+        return;
+    }
+
+    // The texture has been evicted, load it again
+    auto found = _deferredTextures.find(textureNum);
+    DeferredTexturePtr texture = found != _deferredTextures.end() ? found->second.lock() : DeferredTexturePtr();
+
+    if (texture && _decoder.isEvicted(*texture))
+    {
+        _decoder.queue(texture);
+    }
+}
+
+std::size_t GLTextureManager::evictTextures()
+{
+    std::vector<GLuint> evicted = _residency.collectEvictions();
+
+    for (GLuint textureNum : evicted)
+    {
+        auto found = _deferredTextures.find(textureNum);
+        DeferredTexturePtr texture = found != _deferredTextures.end() ? found->second.lock() : DeferredTexturePtr();
+
+        if (texture)
+        {
+            evictTexture(*texture);
+        }
+    }
+
+    return evicted.size();
+}
+
+void GLTextureManager::evictTexture(DeferredTexture& texture)
+{
+    _decoder.setEvicted(texture);
+
+    GLuint textureNum = texture.BasicTexture2D::getGLTexNum();
+
+    // Uploading the placeholder only replaces the first mipmap level, the
+    // others need to be released explicitly
+    glBindTexture(GL_TEXTURE_2D, textureNum);
+
+    for (GLint level = 1; level < 32; ++level)
+    {
+        GLint width = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+
+        if (width == 0)
+        {
+            break;
+        }
+
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    _placeholderImage->uploadTexture(textureNum);
+
+    // The placeholder has no other levels, keep the texture complete
+    glBindTexture(GL_TEXTURE_2D, textureNum);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+TextureResidency::Statistics GLTextureManager::getResidencyStatistics() const
+{
+    return _residency.getStatistics();
+}
+
+bool GLTextureManager::hasDecodedTextures()
+{
+    return _decoder.hasDecodedTextures();
+}
+
+void GLTextureManager::cancelDecoding()
+{
+    _decoder.cancel();
+}
+
 TexturePtr GLTextureManager::loadStandardTexture(const std::string& filename)
 {
     // Create the texture path
@@ -2,9 +2,15 @@
 #define GLTEXTUREMANAGER_H_
 
 #include "ishaders.h"
+#include <chrono>
+#include <functional>
 #include <map>
 #include "../MapExpression.h"
 #include "texturelib.h"
+#include "DeferredTexture.h"
+#include "TextureDecoder.h"
+#include "TextureResidency.h"
+#include <unordered_map>
 
 namespace shaders
 {
@@ -17,17 +23,127 @@ class GLTextureManager
 
 	// The fallback textures in case a texture is empty or broken
 	TexturePtr _shaderNotFound;
+	ImagePtr _shaderNotFoundImage;
+
+	// Shown by deferred textures until their image is uploaded
+	ImagePtr _placeholderImage;
+
+	// Whether map expressions are evaluated by the decoders (see getBinding)
+	bool _loadInBackground;
+
+	// Evaluates the map expressions of the deferred textures
+	TextureDecoder _decoder;
+
+	// All deferred textures by their texture number, to find the evicted ones
+	std::unordered_map<GLuint, std::weak_ptr<DeferredTexture>> _deferredTextures;
+
+	// Main thread only: the uploaded deferred textures and the budget they share
+	TextureResidency _residency;
 
 private:
 
 	// Constructs the fallback textures like "Shader Image Missing"
 	TexturePtr loadStandardTexture(const std::string& filename);
 
+	const ImagePtr& getShaderNotFoundImage();
+
+	// Creates a deferred texture showing the placeholder and queues it
+	TexturePtr createDeferredTexture(const std::string& identifier,
+		const MapExpressionPtr& expression);
+
+	// Uploads the given decoded image of the texture, main thread only
+	void uploadTexture(DeferredTexture& texture, ImagePtr image);
+
+	// Replaces the image of the given texture with the placeholder
+	void evictTexture(DeferredTexture& texture);
+
+	// Sets the dimensions of the given texture, waiting for its image
+	void waitForImage(DeferredTexture& texture);
+	friend class DeferredTexture;
+
 public:
+	GLTextureManager();
+	~GLTextureManager();
+
+	/**
+	 * \brief
+	 * Enable or disable evaluating map expressions in the background. When
+	 * enabled, getBinding() returns textures showing a placeholder until
+	 * uploadDecodedTextures() has uploaded their image.
+	 */
+	void setLoadInBackground(bool loadInBackground);
+
+	/**
+	 * \brief
+	 * Set the directory of the built-in images like _black, which the map
+	 * expressions loaded in the background are evaluated with. Must be called
+	 * on the main thread, the decoders don't access the registry.
+	 */
+	void setBitmapsPath(const std::string& bitmapsPath);
+
+	/**
+	 * \brief
+	 * Set the function to be invoked whenever an image has been decoded.
+	 * It is called on the decoding thread, which is not necessarily the main
+	 * thread.
+	 */
+	void setImageDecodedCallback(const std::function<void()>& callback);
+
+	/**
+	 * \brief
+	 * Upload the images decoded so far to GL, until the given time is
+	 * exceeded. Must be called on the main thread.
+	 *
+	 * \return
+	 * The number of uploaded textures.
+	 */
+	std::size_t uploadDecodedTextures(std::chrono::milliseconds budget);
+
+	// Returns true if there are decoded images waiting for uploadDecodedTextures()
+	bool hasDecodedTextures();
+
+	/**
+	 * \brief
+	 * Set the number of bytes the textures loaded in the background may
+	 * occupy, 0 meaning no limit. The budget is applied by evictTextures().
+	 */
+	void setTextureBudget(std::size_t budget);
+
+	/**
+	 * \brief
+	 * Mark the given texture as used in the current frame, an evicted texture
+	 * is queued for the decoders again. Textures which haven't been loaded in
+	 * the background are ignored. Must be called on the main thread.
+	 */
+	void markTextureUsed(GLuint textureNum);
+
+	/**
+	 * \brief
+	 * Evict the least recently used textures until the textures loaded in the
+	 * background fit the budget, and start the next frame. Evicted textures
+	 * show the placeholder until they are used again. Must be called on the
+	 * main thread.
+	 *
+	 * \return
+	 * The number of evicted textures.
+	 */
+	std::size_t evictTextures();
+
+	TextureResidency::Statistics getResidencyStatistics() const;
+
+	/**
+	 * \brief
+	 * Wait for the running decoder and drop the textures waiting for it.
+	 * The dropped textures keep showing the placeholder.
+	 */
+	void cancelDecoding();
 
     /**
      * \brief
      * Construct a bound texture from a generic named bindable.
+     *
+     * If loading in the background is enabled, 2D map expressions are
+     * evaluated by the decoders and a DeferredTexture is returned.
      */
 	TexturePtr getBinding(NamedBindablePtr bindable);
 
@@ -45,6 +161,13 @@ public:
      */
 	TexturePtr getShaderNotFound();
 
+	/**
+	 * \brief
+	 * Returns true if the given texture is the "shader not found" texture,
+	 * or a deferred texture whose image couldn't be loaded.
+	 */
+	bool isShaderNotFound(const TexturePtr& texture);
+
 	/* greebo: This is some sort of "cleanup" call, which causes
 	 * the TextureManager to go through the list of textures and
 	 * remove the unused ones.
@@ -0,0 +1,1267 @@
+#include "ImageKernels.h"
+
+#include "itextstream.h"
+#include "math/FloatTools.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define IMAGE_KERNELS_X86
+	#define IMAGE_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#define IMAGE_KERNELS_X86
+	#define IMAGE_KERNELS_TARGET_AVX2
+	#include <intrin.h>
+#endif
+
+#ifdef IMAGE_KERNELS_X86
+	// SSE2 is part of the x86-64 baseline, 32 bit builds need to enable it
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define IMAGE_KERNELS_SSE2
+		#include <emmintrin.h>
+	#endif
+
+	// AVX2 code is compiled for the respective functions only and used
+	// after checking the CPU at runtime
+	#if defined(IMAGE_KERNELS_SSE2) && (!defined(__GNUC__) || defined(__clang__) || __GNUC__ >= 5)
+		#define IMAGE_KERNELS_AVX2
+		#include <immintrin.h>
+	#endif
+#endif
+
+namespace shaders
+{
+
+struct ImageKernels::Functions
+{
+	InstructionSet instructionSet;
+
+	// Interpolates an RGBA line of inwidth pixels to outwidth pixels
+	void (*lerpLine)(const byte* in, byte* out, std::size_t inwidth, std::size_t outwidth);
+
+	// out = row1 + (row2 - row1) * lerp / 65536 for numBytes bytes, lerp < 65536
+	void (*lerpRows)(const byte* row1, const byte* row2, byte* out, std::size_t numBytes, std::size_t lerp);
+
+	// Average 2x2 blocks, pairs of pixels and pairs of rows to numPixels
+	// output pixels. out may be the same as row1 or in.
+	void (*reduceBoth)(const byte* row1, const byte* row2, byte* out, std::size_t numPixels);
+	void (*reduceWidth)(const byte* in, byte* out, std::size_t numPixels);
+	void (*reduceHeight)(const byte* row1, const byte* row2, byte* out, std::size_t numPixels);
+
+	void (*applyTable)(byte* pixels, std::size_t numPixels, const byte* table);
+
+	// Normal map calculation and smoothing of the rows [yStart, yEnd) of an
+	// image with the given dimensions
+	void (*normalMapRows)(const byte* in, byte* out, std::size_t width, std::size_t height,
+		std::size_t yStart, std::size_t yEnd, float scale);
+	void (*smoothNormalsRows)(const byte* in, byte* out, std::size_t width, std::size_t height,
+		std::size_t yStart, std::size_t yEnd);
+
+	void (*addNormals)(const byte* first, const byte* second, byte* out, std::size_t numPixels);
+};
+
+namespace
+{
+
+// Row buffers of resample(), per thread since map expressions are evaluated
+// by several threads at once
+thread_local byte *row1 = NULL, *row2 = NULL;
+thread_local std::size_t rowsize = 0;
+
+// Images are split into sub-tasks of at least this many pixels
+const std::size_t PIXELS_PER_TASK = 65536;
+
+/* Scalar implementations, these define the output of all others */
+
+void lerpLineScalar(const byte* in, byte* out, std::size_t inwidth, std::size_t outwidth,
+					std::size_t bytesperpixel, std::size_t start, std::size_t f)
+{
+	std::size_t fstep = static_cast<std::size_t>(inwidth * 65536.0f / outwidth);
+	std::size_t endx = (inwidth - 1);
+
+	out += start * bytesperpixel;
+
+	for (std::size_t j = start; j < outwidth; j++, f += fstep)
+	{
+		std::size_t xi = f >> 16;
+		const byte* pixel = in + xi * bytesperpixel;
+
+		if (xi < endx)
+		{
+			std::size_t lerp = f & 0xFFFF;
+
+			for (std::size_t c = 0; c < bytesperpixel; ++c)
+			{
+				*out++ = (byte) ((((pixel[bytesperpixel + c] - pixel[c]) * lerp) >> 16) + pixel[c]);
+			}
+		}
+		else // last pixel of the line has no pixel to lerp to
+		{
+			for (std::size_t c = 0; c < bytesperpixel; ++c)
+			{
+				*out++ = pixel[c];
+			}
+		}
+	}
+}
+
+void lerpLineRGBScalar(const byte* in, byte* out, std::size_t inwidth, std::size_t outwidth)
+{
+	lerpLineScalar(in, out, inwidth, outwidth, 3, 0, 0);
+}
+
+void lerpLineRGBAScalar(const byte* in, byte* out, std::size_t inwidth, std::size_t outwidth)
+{
+	lerpLineScalar(in, out, inwidth, outwidth, 4, 0, 0);
+}
+
+void lerpRowsScalar(const byte* row1, const byte* row2, byte* out, std::size_t numBytes, std::size_t lerp)
+{
+	for (std::size_t i = 0; i < numBytes; ++i)
+	{
+		out[i] = (byte) ((((row2[i] - row1[i]) * lerp) >> 16) + row1[i]);
+	}
+}
+
+void reduceBothScalar(const byte* row1, const byte* row2, byte* out, std::size_t numPixels)
+{
+	for (std::size_t x = 0; x < numPixels; ++x, out += 4, row1 += 8, row2 += 8)
+	{
+		out[0] = (byte) ((row1[0] + row1[4] + row2[0] + row2[4]) >> 2);
+		out[1] = (byte) ((row1[1] + row1[5] + row2[1] + row2[5]) >> 2);
+		out[2] = (byte) ((row1[2] + row1[6] + row2[2] + row2[6]) >> 2);
+		out[3] = (byte) ((row1[3] + row1[7] + row2[3] + row2[7]) >> 2);
+	}
+}
+
+void reduceWidthScalar(const byte* in, byte* out, std::size_t numPixels)
+{
+	for (std::size_t x = 0; x < numPixels; ++x, out += 4, in += 8)
+	{
+		out[0] = (byte) ((in[0] + in[4]) >> 1);
+		out[1] = (byte) ((in[1] + in[5]) >> 1);
+		out[2] = (byte) ((in[2] + in[6]) >> 1);
+		out[3] = (byte) ((in[3] + in[7]) >> 1);
+	}
+}
+
+void reduceHeightScalar(const byte* row1, const byte* row2, byte* out, std::size_t numPixels)
+{
+	for (std::size_t i = 0; i < numPixels * 4; ++i)
+	{
+		out[i] = (byte) ((row1[i] + row2[i]) >> 1);
+	}
+}
+
+void applyTableScalar(byte* pixels, std::size_t numPixels, const byte* table)
+{
+	for (std::size_t i = 0; i < numPixels * 4; i += 4)
+	{
+		pixels[i] = table[pixels[i]];
+		pixels[i + 1] = table[pixels[i + 1]];
+		pixels[i + 2] = table[pixels[i + 2]];
+	}
+}
+
+// Wraps around at the borders, x and y may be one pixel outside the image
+inline const byte* getPixel(const byte* pixels, std::size_t width, std::size_t height, std::size_t x, std::size_t y)
+{
+	return pixels + (((((y + height) % height) * width) + ((x + width) % width)) * 4);
+}
+
+struct KernelElement
+{
+	int x, y;
+	float w;
+};
+
+// 3x3 Prewitt filtering, see http://en.wikipedia.org/wiki/Edge_detection
+const KernelElement KERNEL_DU[] =
+{
+	{-1, 1,-1.0f },
+	{-1, 0,-1.0f },
+	{-1,-1,-1.0f },
+	{ 1, 1, 1.0f },
+	{ 1, 0, 1.0f },
+	{ 1,-1, 1.0f }
+};
+
+const KernelElement KERNEL_DV[] =
+{
+	{-1, 1, 1.0f },
+	{ 0, 1, 1.0f },
+	{ 1, 1, 1.0f },
+	{-1,-1,-1.0f },
+	{ 0,-1,-1.0f },
+	{ 1,-1,-1.0f }
+};
+
+void normalMapRowsScalar(const byte* in, byte* out, std::size_t width, std::size_t height,
+						 std::size_t yStart, std::size_t yEnd, float scale)
+{
+	out += yStart * width * 4;
+
+	for (std::size_t y = yStart; y < yEnd; ++y)
+	{
+		for (std::size_t x = 0; x < width; ++x, out += 4)
+		{
+			float du = 0;
+			for (const KernelElement& i : KERNEL_DU) {
+				du += (getPixel(in, width, height, x + i.x, y + i.y)[0] / 255.0f) * i.w;
+			}
+			float dv = 0;
+			for (const KernelElement& i : KERNEL_DV) {
+				dv += (getPixel(in, width, height, x + i.x, y + i.y)[0] / 255.0f) * i.w;
+			}
+
+			float nx = -du * scale;
+			float ny = -dv * scale;
+			float nz = 1.0;
+
+			// Normalize
+			float norm = 1.0f/std::sqrt(nx*nx + ny*ny + nz*nz);
+			out[0] = static_cast<byte>(float_to_integer(((nx * norm) + 1) * 127.5));
+			out[1] = static_cast<byte>(float_to_integer(((ny * norm) + 1) * 127.5));
+			out[2] = static_cast<byte>(float_to_integer(((nz * norm) + 1) * 127.5));
+			out[3] = 255;
+		}
+	}
+}
+
+void smoothNormalsRowsScalar(const byte* in, byte* out, std::size_t width, std::size_t height,
+							 std::size_t yStart, std::size_t yEnd)
+{
+	// The average of the 3x3 pixels around and including the current one
+	const double perKernelSize = 1.0f / 9;
+
+	out += yStart * width * 4;
+
+	for (std::size_t y = yStart; y < yEnd; ++y)
+	{
+		for (std::size_t x = 0; x < width; ++x, out += 4)
+		{
+			int sum[3] = { 0, 0, 0 };
+
+			for (int dy = -1; dy <= 1; ++dy)
+			{
+				for (int dx = -1; dx <= 1; ++dx)
+				{
+					const byte* pixel = getPixel(in, width, height, x + dx, y + dy);
+
+					sum[0] += pixel[0];
+					sum[1] += pixel[1];
+					sum[2] += pixel[2];
+				}
+			}
+
+			out[0] = static_cast<byte>(float_to_integer(sum[0] * perKernelSize));
+			out[1] = static_cast<byte>(float_to_integer(sum[1] * perKernelSize));
+			out[2] = static_cast<byte>(float_to_integer(sum[2] * perKernelSize));
+			out[3] = 255;
+		}
+	}
+}
+
+void addNormalsScalar(const byte* first, const byte* second, byte* out, std::size_t numPixels)
+{
+	for (std::size_t i = 0; i < numPixels; ++i, first += 4, second += 4, out += 4)
+	{
+		// The mean value of the two vectors
+		out[0] = static_cast<byte>(float_to_integer((static_cast<double>(first[0]) + second[0]) * 0.5));
+		out[1] = static_cast<byte>(float_to_integer((static_cast<double>(first[1]) + second[1]) * 0.5));
+		out[2] = static_cast<byte>(float_to_integer((static_cast<double>(first[2]) + second[2]) * 0.5));
+		out[3] = 255;
+	}
+}
+
+/* Helpers of the vectorised normal map calculations, which work on column
+ * sums with integer arithmetic, avoiding the per-pixel kernel loops. */
+
+// Calculates the sums of the heights of the rows above, at and below y for
+// each column, and the differences between the rows below and above. Both
+// arrays have one element of padding at either end, holding the values of
+// the opposite border.
+void prepareNormalMapRow(const byte* in, std::size_t width, std::size_t height, std::size_t y,
+						 int* sums, int* differences)
+{
+	const byte* above = in + ((y + height - 1) % height) * width * 4;
+	const byte* row = in + y * width * 4;
+	const byte* below = in + ((y + 1) % height) * width * 4;
+
+	for (std::size_t x = 0; x < width; ++x)
+	{
+		sums[x + 1] = above[x * 4] + row[x * 4] + below[x * 4];
+		differences[x + 1] = below[x * 4] - above[x * 4];
+	}
+
+	sums[0] = sums[width];
+	sums[width + 1] = sums[1];
+	differences[0] = differences[width];
+	differences[width + 1] = differences[1];
+}
+
+// Writes the normal for the given (unscaled) Prewitt sums, factor is -scale / 255
+inline void writeNormal(byte* out, int du, int dv, float factor)
+{
+	float nx = du * factor;
+	float ny = dv * factor;
+	float norm = 1.0f / std::sqrt(nx * nx + ny * ny + 1.0f);
+
+	out[0] = static_cast<byte>(lrintf((nx * norm + 1.0f) * 127.5f));
+	out[1] = static_cast<byte>(lrintf((ny * norm + 1.0f) * 127.5f));
+	out[2] = static_cast<byte>(lrintf((norm + 1.0f) * 127.5f));
+	out[3] = 255;
+}
+
+// Calculates the sums of the components of the rows above, at and below y,
+// with one pixel of padding at either end like prepareNormalMapRow()
+void sumSmoothingColumns(const byte* above, const byte* row, const byte* below, std::size_t width,
+						 std::size_t start, std::uint16_t* sums)
+{
+	std::size_t numBytes = width * 4;
+	std::uint16_t* columnSums = sums + 4;
+
+	for (std::size_t i = start; i < numBytes; ++i)
+	{
+		columnSums[i] = above[i] + row[i] + below[i];
+	}
+
+	for (std::size_t c = 0; c < 4; ++c)
+	{
+		sums[c] = columnSums[numBytes - 4 + c];
+		columnSums[numBytes + c] = columnSums[c];
+	}
+}
+
+// Writes the smoothed pixels from start to the end of the row. Rounding the
+// sum / 9 is exact in integer arithmetic, the fraction is never one half.
+void writeSmoothedPixels(const std::uint16_t* sums, byte* out, std::size_t width, std::size_t start)
+{
+	for (std::size_t x = start; x < width; ++x)
+	{
+		for (std::size_t c = 0; c < 3; ++c)
+		{
+			out[x * 4 + c] = static_cast<byte>((sums[x * 4 + c] + sums[x * 4 + 4 + c] + sums[x * 4 + 8 + c] + 4) / 9);
+		}
+
+		out[x * 4 + 3] = 255;
+	}
+}
+
+const ImageKernels::Functions SCALAR_FUNCTIONS =
+{
+	ImageKernels::InstructionSet::Scalar,
+	lerpLineRGBAScalar,
+	lerpRowsScalar,
+	reduceBothScalar,
+	reduceWidthScalar,
+	reduceHeightScalar,
+	applyTableScalar,
+	normalMapRowsScalar,
+	smoothNormalsRowsScalar,
+	addNormalsScalar,
+};
+
+#ifdef IMAGE_KERNELS_SSE2
+
+/* SSE2 implementations. Bytes are widened to 16 bit words for the
+ * arithmetic and packed again afterwards. */
+
+// Returns (d * lerp) >> 16 for the signed words d and the unsigned words
+// lerp, rounding down like the scalar code. _mm_mulhi_epi16 treats lerp
+// values >= 32768 as lerp - 65536, which is corrected by adding d.
+inline __m128i mulLerp(__m128i d, __m128i lerp)
+{
+	return _mm_add_epi16(_mm_mulhi_epi16(d, lerp), _mm_and_si128(d, _mm_srai_epi16(lerp, 15)));
+}
+
+void lerpLineRGBASSE2(const byte* in, byte* out, std::size_t inwidth, std::size_t outwidth)
+{
+	std::size_t fstep = static_cast<std::size_t>(inwidth * 65536.0f / outwidth);
+	std::size_t endx = (inwidth - 1);
+	const __m128i zero = _mm_setzero_si128();
+
+	std::size_t j = 0, f = 0;
+
+	// Two output pixels at a time, as long as both have a pixel to lerp to
+	for (; j + 2 <= outwidth; j += 2, f += 2 * fstep)
+	{
+		std::size_t f2 = f + fstep;
+		std::size_t xi1 = f >> 16;
+		std::size_t xi2 = f2 >> 16;
+
+		if (xi2 >= endx)
+		{
+			break;
+		}
+
+		// Each load contains the source pixel and the one to its right
+		__m128i pixels1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + xi1 * 4));
+		__m128i pixels2 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + xi2 * 4));
+
+		__m128i interleaved = _mm_unpacklo_epi32(pixels1, pixels2);
+		__m128i left = _mm_unpacklo_epi8(interleaved, zero);
+		__m128i right = _mm_unpackhi_epi8(interleaved, zero);
+
+		short lerp1 = static_cast<short>(f & 0xFFFF);
+		short lerp2 = static_cast<short>(f2 & 0xFFFF);
+		__m128i lerp = _mm_set_epi16(lerp2, lerp2, lerp2, lerp2, lerp1, lerp1, lerp1, lerp1);
+
+		__m128i result = _mm_add_epi16(left, mulLerp(_mm_sub_epi16(right, left), lerp));
+
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out + j * 4), _mm_packus_epi16(result, result));
+	}
+
+	lerpLineScalar(in, out, inwidth, outwidth, 4, j, f);
+}
+
+void lerpRowsSSE2(const byte* row1, const byte* row2, byte* out, std::size_t numBytes, std::size_t lerp)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lerpWords = _mm_set1_epi16(static_cast<short>(lerp));
+
+	std::size_t i = 0;
+
+	for (; i + 16 <= numBytes; i += 16)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row2 + i));
+
+		__m128i aLow = _mm_unpacklo_epi8(a, zero);
+		__m128i aHigh = _mm_unpackhi_epi8(a, zero);
+
+		__m128i low = _mm_add_epi16(aLow, mulLerp(_mm_sub_epi16(_mm_unpacklo_epi8(b, zero), aLow), lerpWords));
+		__m128i high = _mm_add_epi16(aHigh, mulLerp(_mm_sub_epi16(_mm_unpackhi_epi8(b, zero), aHigh), lerpWords));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, high));
+	}
+
+	lerpRowsScalar(row1 + i, row2 + i, out + i, numBytes - i, lerp);
+}
+
+// Sums the pixels of each horizontal pair in the given 16 bytes (4 pixels)
+// of two rows, returning the two sums as words
+inline __m128i sumPairs(__m128i a, __m128i b)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	// Pixels 0 and 1 in low, pixels 2 and 3 in high
+	__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+	__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+
+	return _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+}
+
+void reduceBothSSE2(const byte* row1, const byte* row2, byte* out, std::size_t numPixels)
+{
+	std::size_t x = 0;
+
+	// Four output pixels at a time, all loads precede the store as out
+	// might point into row1
+	for (; x + 4 <= numPixels; x += 4, out += 16, row1 += 32, row2 += 32)
+	{
+		__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+		__m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 16));
+		__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row2));
+		__m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row2 + 16));
+
+		__m128i low = _mm_srli_epi16(sumPairs(a1, b1), 2);
+		__m128i high = _mm_srli_epi16(sumPairs(a2, b2), 2);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(low, high));
+	}
+
+	reduceBothScalar(row1, row2, out, numPixels - x);
+}
+
+void reduceWidthSSE2(const byte* in, byte* out, std::size_t numPixels)
+{
+	const __m128i zero = _mm_setzero_si128();
+	std::size_t x = 0;
+
+	for (; x + 4 <= numPixels; x += 4, out += 16, in += 32)
+	{
+		__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+		__m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+
+		__m128i low = _mm_srli_epi16(sumPairs(a1, zero), 1);
+		__m128i high = _mm_srli_epi16(sumPairs(a2, zero), 1);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(low, high));
+	}
+
+	reduceWidthScalar(in, out, numPixels - x);
+}
+
+void reduceHeightSSE2(const byte* row1, const byte* row2, byte* out, std::size_t numPixels)
+{
+	const __m128i lowBits = _mm_set1_epi8(0x7F);
+	std::size_t numBytes = numPixels * 4;
+	std::size_t i = 0;
+
+	for (; i + 16 <= numBytes; i += 16)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + i));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row2 + i));
+
+		// (a + b) >> 1 without overflow: (a & b) + ((a ^ b) >> 1)
+		__m128i halfDifference = _mm_and_si128(_mm_srli_epi16(_mm_xor_si128(a, b), 1), lowBits);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi8(_mm_and_si128(a, b), halfDifference));
+	}
+
+	reduceHeightScalar(row1 + i, row2 + i, out + i, (numBytes - i) / 4);
+}
+
+void normalMapRowsSSE2(const byte* in, byte* out, std::size_t width, std::size_t height,
+					   std::size_t yStart, std::size_t yEnd, float scale)
+{
+	std::vector<int> sums(width + 2);
+	std::vector<int> differences(width + 2);
+
+	const float factor = -scale / 255.0f;
+	const __m128 factors = _mm_set1_ps(factor);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 halfRange = _mm_set1_ps(127.5f);
+	const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+	for (std::size_t y = yStart; y < yEnd; ++y)
+	{
+		prepareNormalMapRow(in, width, height, y, sums.data(), differences.data());
+
+		const int* sum = sums.data();
+		const int* difference = differences.data();
+		byte* pixels = out + y * width * 4;
+
+		std::size_t x = 0;
+
+		for (; x + 4 <= width; x += 4)
+		{
+			// The sums of the columns left and right, the differences of
+			// the three columns around x
+			__m128i du = _mm_sub_epi32(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(sum + x + 2)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(sum + x)));
+
+			__m128i dv = _mm_add_epi32(
+				_mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(difference + x)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(difference + x + 1))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(difference + x + 2)));
+
+			__m128 nx = _mm_mul_ps(_mm_cvtepi32_ps(du), factors);
+			__m128 ny = _mm_mul_ps(_mm_cvtepi32_ps(dv), factors);
+			__m128 norm = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), one)));
+
+			__m128i r = _mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(nx, norm), one), halfRange));
+			__m128i g = _mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(ny, norm), one), halfRange));
+			__m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_add_ps(norm, one), halfRange));
+
+			__m128i rgba = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), alpha));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + x * 4), rgba);
+		}
+
+		for (; x < width; ++x)
+		{
+			writeNormal(pixels + x * 4, sum[x + 2] - sum[x], difference[x] + difference[x + 1] + difference[x + 2], factor);
+		}
+	}
+}
+
+void smoothNormalsRowsSSE2(const byte* in, byte* out, std::size_t width, std::size_t height,
+						   std::size_t yStart, std::size_t yEnd)
+{
+	std::vector<std::uint16_t> sums((width + 2) * 4);
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rounding = _mm_set1_epi16(4);
+	// x / 9 == (x * 7282) >> 16 for the sums of nine bytes
+	const __m128i reciprocal = _mm_set1_epi16(7282);
+	const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+	std::size_t numBytes = width * 4;
+
+	for (std::size_t y = yStart; y < yEnd; ++y)
+	{
+		const byte* above = in + ((y + height - 1) % height) * numBytes;
+		const byte* row = in + y * numBytes;
+		const byte* below = in + ((y + 1) % height) * numBytes;
+
+		std::uint16_t* columnSums = sums.data() + 4;
+		std::size_t i = 0;
+
+		for (; i + 16 <= numBytes; i += 16)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i));
+			__m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i));
+
+			__m128i low = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(r, zero)), _mm_unpacklo_epi8(b, zero));
+			__m128i high = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(r, zero)), _mm_unpackhi_epi8(b, zero));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(columnSums + i), low);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(columnSums + i + 8), high);
+		}
+
+		sumSmoothingColumns(above, row, below, width, i, sums.data());
+
+		byte* pixels = out + y * numBytes;
+		const std::uint16_t* sum = sums.data();
+		std::size_t x = 0;
+
+		// Four pixels at a time, two per register
+		for (; x + 4 <= width; x += 4)
+		{
+			const std::uint16_t* left = sum + x * 4;
+
+			__m128i low = _mm_add_epi16(_mm_add_epi16(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(left)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 4))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 8)));
+
+			__m128i high = _mm_add_epi16(_mm_add_epi16(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 8)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 12))),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 16)));
+
+			low = _mm_mulhi_epu16(_mm_add_epi16(low, rounding), reciprocal);
+			high = _mm_mulhi_epu16(_mm_add_epi16(high, rounding), reciprocal);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + x * 4), _mm_or_si128(_mm_packus_epi16(low, high), alpha));
+		}
+
+		writeSmoothedPixels(sum, pixels, width, x);
+	}
+}
+
+// Averages the given bytes, rounding ties to even like the scalar lrint()
+inline __m128i averageNormals(__m128i a, __m128i b)
+{
+	const __m128i lowBits = _mm_set1_epi8(0x7F);
+	const __m128i lowestBit = _mm_set1_epi8(1);
+
+	__m128i difference = _mm_xor_si128(a, b);
+	__m128i average = _mm_add_epi8(_mm_and_si128(a, b), _mm_and_si128(_mm_srli_epi16(difference, 1), lowBits));
+
+	// An odd sum has been rounded down, which needs to be undone for odd averages
+	return _mm_add_epi8(average, _mm_and_si128(_mm_and_si128(difference, average), lowestBit));
+}
+
+void addNormalsSSE2(const byte* first, const byte* second, byte* out, std::size_t numPixels)
+{
+	const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+	std::size_t i = 0;
+
+	for (; i + 4 <= numPixels; i += 4)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i * 4));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + i * 4));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm_or_si128(averageNormals(a, b), alpha));
+	}
+
+	addNormalsScalar(first + i * 4, second + i * 4, out + i * 4, numPixels - i);
+}
+
+const ImageKernels::Functions SSE2_FUNCTIONS =
+{
+	ImageKernels::InstructionSet::SSE2,
+	lerpLineRGBASSE2,
+	lerpRowsSSE2,
+	reduceBothSSE2,
+	reduceWidthSSE2,
+	reduceHeightSSE2,
+	applyTableScalar, // table lookups need a gather instruction
+	normalMapRowsSSE2,
+	smoothNormalsRowsSSE2,
+	addNormalsSSE2,
+};
+
+#endif
+
+#ifdef IMAGE_KERNELS_AVX2
+
+/* AVX2 implementations, processing twice the bytes of the SSE2 ones. Note
+ * that the unpack and pack instructions operate on the two 128 bit lanes
+ * separately. */
+
+IMAGE_KERNELS_TARGET_AVX2
+inline __m256i mulLerp256(__m256i d, __m256i lerp)
+{
+	return _mm256_add_epi16(_mm256_mulhi_epi16(d, lerp), _mm256_and_si256(d, _mm256_srai_epi16(lerp, 15)));
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+void lerpRowsAVX2(const byte* row1, const byte* row2, byte* out, std::size_t numBytes, std::size_t lerp)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lerpWords = _mm256_set1_epi16(static_cast<short>(lerp));
+
+	std::size_t i = 0;
+
+	for (; i + 32 <= numBytes; i += 32)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row2 + i));
+
+		__m256i aLow = _mm256_unpacklo_epi8(a, zero);
+		__m256i aHigh = _mm256_unpackhi_epi8(a, zero);
+
+		__m256i low = _mm256_add_epi16(aLow, mulLerp256(_mm256_sub_epi16(_mm256_unpacklo_epi8(b, zero), aLow), lerpWords));
+		__m256i high = _mm256_add_epi16(aHigh, mulLerp256(_mm256_sub_epi16(_mm256_unpackhi_epi8(b, zero), aHigh), lerpWords));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_packus_epi16(low, high));
+	}
+
+	lerpRowsScalar(row1 + i, row2 + i, out + i, numBytes - i, lerp);
+}
+
+// Sums the pixels of each horizontal pair in the given 32 bytes (8 pixels)
+// of two rows. The sums of the pairs end up in the order 0, 1, 4, 5 | 2, 3, 6, 7
+// after packing two results, which is undone by permuteSums().
+IMAGE_KERNELS_TARGET_AVX2
+inline __m256i sumPairs256(__m256i a, __m256i b)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	__m256i low = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero));
+	__m256i high = _mm256_add_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero));
+
+	return _mm256_add_epi16(_mm256_unpacklo_epi64(low, high), _mm256_unpackhi_epi64(low, high));
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+inline __m256i permuteSums(__m256i packed)
+{
+	return _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+void reduceBothAVX2(const byte* row1, const byte* row2, byte* out, std::size_t numPixels)
+{
+	std::size_t x = 0;
+
+	for (; x + 8 <= numPixels; x += 8, out += 32, row1 += 64, row2 += 64)
+	{
+		__m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1));
+		__m256i a2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + 32));
+		__m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row2));
+		__m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row2 + 32));
+
+		__m256i low = _mm256_srli_epi16(sumPairs256(a1, b1), 2);
+		__m256i high = _mm256_srli_epi16(sumPairs256(a2, b2), 2);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), permuteSums(_mm256_packus_epi16(low, high)));
+	}
+
+	reduceBothSSE2(row1, row2, out, numPixels - x);
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+void reduceWidthAVX2(const byte* in, byte* out, std::size_t numPixels)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	std::size_t x = 0;
+
+	for (; x + 8 <= numPixels; x += 8, out += 32, in += 64)
+	{
+		__m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+		__m256i a2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32));
+
+		__m256i low = _mm256_srli_epi16(sumPairs256(a1, zero), 1);
+		__m256i high = _mm256_srli_epi16(sumPairs256(a2, zero), 1);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), permuteSums(_mm256_packus_epi16(low, high)));
+	}
+
+	reduceWidthSSE2(in, out, numPixels - x);
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+void reduceHeightAVX2(const byte* row1, const byte* row2, byte* out, std::size_t numPixels)
+{
+	const __m256i lowBits = _mm256_set1_epi8(0x7F);
+	std::size_t numBytes = numPixels * 4;
+	std::size_t i = 0;
+
+	for (; i + 32 <= numBytes; i += 32)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + i));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row2 + i));
+
+		__m256i halfDifference = _mm256_and_si256(_mm256_srli_epi16(_mm256_xor_si256(a, b), 1), lowBits);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi8(_mm256_and_si256(a, b), halfDifference));
+	}
+
+	reduceHeightScalar(row1 + i, row2 + i, out + i, (numBytes - i) / 4);
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+void applyTableAVX2(byte* pixels, std::size_t numPixels, const byte* table)
+{
+	// The gather instruction loads 32 bit values
+	int table32[256];
+
+	for (int i = 0; i < 256; ++i)
+	{
+		table32[i] = table[i];
+	}
+
+	const __m256i byteMask = _mm256_set1_epi32(0xFF);
+	const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+	std::size_t i = 0;
+
+	for (; i + 8 <= numPixels; i += 8)
+	{
+		__m256i* address = reinterpret_cast<__m256i*>(pixels + i * 4);
+		__m256i rgba = _mm256_loadu_si256(address);
+
+		__m256i r = _mm256_i32gather_epi32(table32, _mm256_and_si256(rgba, byteMask), 4);
+		__m256i g = _mm256_i32gather_epi32(table32, _mm256_and_si256(_mm256_srli_epi32(rgba, 8), byteMask), 4);
+		__m256i b = _mm256_i32gather_epi32(table32, _mm256_and_si256(_mm256_srli_epi32(rgba, 16), byteMask), 4);
+
+		__m256i result = _mm256_or_si256(
+			_mm256_or_si256(r, _mm256_slli_epi32(g, 8)),
+			_mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_and_si256(rgba, alphaMask))
+		);
+
+		_mm256_storeu_si256(address, result);
+	}
+
+	applyTableScalar(pixels + i * 4, numPixels - i, table);
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+void normalMapRowsAVX2(const byte* in, byte* out, std::size_t width, std::size_t height,
+					   std::size_t yStart, std::size_t yEnd, float scale)
+{
+	std::vector<int> sums(width + 2);
+	std::vector<int> differences(width + 2);
+
+	const float factor = -scale / 255.0f;
+	const __m256 factors = _mm256_set1_ps(factor);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 halfRange = _mm256_set1_ps(127.5f);
+	const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+	for (std::size_t y = yStart; y < yEnd; ++y)
+	{
+		prepareNormalMapRow(in, width, height, y, sums.data(), differences.data());
+
+		const int* sum = sums.data();
+		const int* difference = differences.data();
+		byte* pixels = out + y * width * 4;
+
+		std::size_t x = 0;
+
+		for (; x + 8 <= width; x += 8)
+		{
+			__m256i du = _mm256_sub_epi32(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sum + x + 2)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(sum + x)));
+
+			__m256i dv = _mm256_add_epi32(
+				_mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(difference + x)),
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(difference + x + 1))),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(difference + x + 2)));
+
+			__m256 nx = _mm256_mul_ps(_mm256_cvtepi32_ps(du), factors);
+			__m256 ny = _mm256_mul_ps(_mm256_cvtepi32_ps(dv), factors);
+			__m256 norm = _mm256_div_ps(one, _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)), one)));
+
+			__m256i r = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(nx, norm), one), halfRange));
+			__m256i g = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(ny, norm), one), halfRange));
+			__m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_add_ps(norm, one), halfRange));
+
+			__m256i rgba = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(b, 16), alpha));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + x * 4), rgba);
+		}
+
+		for (; x < width; ++x)
+		{
+			writeNormal(pixels + x * 4, sum[x + 2] - sum[x], difference[x] + difference[x + 1] + difference[x + 2], factor);
+		}
+	}
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+void smoothNormalsRowsAVX2(const byte* in, byte* out, std::size_t width, std::size_t height,
+						   std::size_t yStart, std::size_t yEnd)
+{
+	std::vector<std::uint16_t> sums((width + 2) * 4);
+
+	const __m256i rounding = _mm256_set1_epi16(4);
+	const __m256i reciprocal = _mm256_set1_epi16(7282);
+	const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+	std::size_t numBytes = width * 4;
+
+	for (std::size_t y = yStart; y < yEnd; ++y)
+	{
+		const byte* above = in + ((y + height - 1) % height) * numBytes;
+		const byte* row = in + y * numBytes;
+		const byte* below = in + ((y + 1) % height) * numBytes;
+
+		std::uint16_t* columnSums = sums.data() + 4;
+		std::size_t i = 0;
+
+		// Widening 16 bytes at a time keeps the words in order
+		for (; i + 16 <= numBytes; i += 16)
+		{
+			__m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(above + i)));
+			__m256i r = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+			__m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(below + i)));
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(columnSums + i), _mm256_add_epi16(_mm256_add_epi16(a, r), b));
+		}
+
+		sumSmoothingColumns(above, row, below, width, i, sums.data());
+
+		byte* pixels = out + y * numBytes;
+		const std::uint16_t* sum = sums.data();
+		std::size_t x = 0;
+
+		// Eight pixels at a time, four per register
+		for (; x + 8 <= width; x += 8)
+		{
+			const std::uint16_t* left = sum + x * 4;
+
+			__m256i low = _mm256_add_epi16(_mm256_add_epi16(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + 4))),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + 8)));
+
+			__m256i high = _mm256_add_epi16(_mm256_add_epi16(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + 16)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + 20))),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + 24)));
+
+			low = _mm256_mulhi_epu16(_mm256_add_epi16(low, rounding), reciprocal);
+			high = _mm256_mulhi_epu16(_mm256_add_epi16(high, rounding), reciprocal);
+
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + x * 4),
+				_mm256_or_si256(permuteSums(_mm256_packus_epi16(low, high)), alpha));
+		}
+
+		writeSmoothedPixels(sum, pixels, width, x);
+	}
+}
+
+IMAGE_KERNELS_TARGET_AVX2
+void addNormalsAVX2(const byte* first, const byte* second, byte* out, std::size_t numPixels)
+{
+	const __m256i lowBits = _mm256_set1_epi8(0x7F);
+	const __m256i lowestBit = _mm256_set1_epi8(1);
+	const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+	std::size_t i = 0;
+
+	for (; i + 8 <= numPixels; i += 8)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + i * 4));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(second + i * 4));
+
+		__m256i difference = _mm256_xor_si256(a, b);
+		__m256i average = _mm256_add_epi8(_mm256_and_si256(a, b), _mm256_and_si256(_mm256_srli_epi16(difference, 1), lowBits));
+		average = _mm256_add_epi8(average, _mm256_and_si256(_mm256_and_si256(difference, average), lowestBit));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 4), _mm256_or_si256(average, alpha));
+	}
+
+	addNormalsSSE2(first + i * 4, second + i * 4, out + i * 4, numPixels - i);
+}
+
+const ImageKernels::Functions AVX2_FUNCTIONS =
+{
+	ImageKernels::InstructionSet::AVX2,
+	lerpLineRGBASSE2, // the source pixels are loaded one by one anyway
+	lerpRowsAVX2,
+	reduceBothAVX2,
+	reduceWidthAVX2,
+	reduceHeightAVX2,
+	applyTableAVX2,
+	normalMapRowsAVX2,
+	smoothNormalsRowsAVX2,
+	addNormalsAVX2,
+};
+
+bool cpuSupportsAVX2()
+{
+#if defined(__GNUC__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#else
+	int info[4];
+
+	__cpuid(info, 0);
+
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS needs to save the YMM registers on context switches
+	__cpuid(info, 1);
+
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+
+	if (!osxsave || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+#endif
+
+const ImageKernels::Functions& getFunctions(ImageKernels::InstructionSet instructionSet)
+{
+	if (!ImageKernels::IsSupported(instructionSet))
+	{
+		instructionSet = ImageKernels::GetBestInstructionSet();
+	}
+
+	switch (instructionSet)
+	{
+#ifdef IMAGE_KERNELS_AVX2
+	case ImageKernels::InstructionSet::AVX2:
+		return AVX2_FUNCTIONS;
+#endif
+#ifdef IMAGE_KERNELS_SSE2
+	case ImageKernels::InstructionSet::SSE2:
+		return SSE2_FUNCTIONS;
+#endif
+	default:
+		return SCALAR_FUNCTIONS;
+	}
+}
+
+} // namespace
+
+ImageKernels::ImageKernels() :
+	_functions(getFunctions(GetBestInstructionSet()))
+{}
+
+ImageKernels::ImageKernels(InstructionSet instructionSet) :
+	_functions(getFunctions(instructionSet))
+{}
+
+ImageKernels::InstructionSet ImageKernels::getInstructionSet() const
+{
+	return _functions.instructionSet;
+}
+
+void ImageKernels::setSubTaskRunner(const SubTaskRunner& runner)
+{
+	_subTaskRunner = runner;
+}
+
+void ImageKernels::resample(const void* indata, std::size_t inwidth, std::size_t inheight,
+							void* outdata, std::size_t outwidth, std::size_t outheight, int bytesperpixel) const
+{
+	if (bytesperpixel != 3 && bytesperpixel != 4)
+	{
+		rMessage() << "R_ResampleTexture: unsupported bytesperpixel " << bytesperpixel << "\n";
+		return;
+	}
+
+	void (*lerpLine)(const byte*, byte*, std::size_t, std::size_t) =
+		bytesperpixel == 4 ? _functions.lerpLine : lerpLineRGBScalar;
+
+	std::size_t inrowsize = inwidth * bytesperpixel;
+	std::size_t outrowsize = outwidth * bytesperpixel;
+
+	if (rowsize < outrowsize) {
+		if (row1)
+			free(row1);
+		if (row2)
+			free(row2);
+
+		rowsize = outrowsize;
+		row1 = (byte *)malloc(rowsize);
+		row2 = (byte *)malloc(rowsize);
+	}
+
+	std::size_t i, yi, oldy, f, fstep, endy = (inheight-1);
+	const byte* inrow = (const byte*)indata;
+	byte* out = (byte*)outdata;
+	fstep = (int) (inheight * 65536.0f / outheight);
+
+	oldy = 0;
+	lerpLine(inrow, row1, inwidth, outwidth);
+	lerpLine(inrow + inrowsize, row2, inwidth, outwidth);
+
+	for (i = 0, f = 0; i < outheight; i++, f += fstep, out += outrowsize) {
+		yi = f >> 16;
+		if (yi < endy) {
+			if (yi != oldy) {
+				inrow = (const byte*)indata + inrowsize * yi;
+				if (yi == oldy+1)
+					memcpy(row1, row2, outrowsize);
+				else
+					lerpLine(inrow, row1, inwidth, outwidth);
+
+				lerpLine(inrow + inrowsize, row2, inwidth, outwidth);
+				oldy = yi;
+			}
+
+			_functions.lerpRows(row1, row2, out, outrowsize, f & 0xFFFF);
+		}
+		else {
+			if (yi != oldy) {
+				inrow = (const byte*)indata + inrowsize * yi;
+				if (yi == oldy+1)
+					memcpy(row1, row2, outrowsize);
+				else
+					lerpLine(inrow, row1, inwidth, outwidth);
+
+				oldy = yi;
+			}
+			memcpy(out, row1, outrowsize);
+		}
+	}
+}
+
+void ImageKernels::mipReduce(const byte* in, byte* out,
+							 std::size_t width, std::size_t height,
+							 std::size_t destwidth, std::size_t destheight) const
+{
+	std::size_t y, width2, height2, nextrow = width << 2;
+	if (width > destwidth) {
+		width2 = width >> 1;
+		if (height > destheight) {
+			// reduce both
+			height2 = height >> 1;
+			for (y = 0; y < height2; y++, in += nextrow << 1, out += width2 << 2) {
+				_functions.reduceBoth(in, in + nextrow, out, width2);
+			}
+		}
+		else {
+			// reduce width
+			for (y = 0; y < height; y++, in += nextrow, out += width2 << 2) {
+				_functions.reduceWidth(in, out, width2);
+			}
+		}
+	}
+	else {
+		if (height > destheight) {
+			// reduce height
+			height2 = height >> 1;
+			for (y = 0; y < height2; y++, in += nextrow << 1, out += nextrow) {
+				_functions.reduceHeight(in, in + nextrow, out, width);
+			}
+		}
+		else {
+			rMessage() << "GL_MipReduce: desired size already achieved\n";
+		}
+	}
+}
+
+void ImageKernels::applyTable(byte* pixels, std::size_t numPixels, const byte* table) const
+{
+	_functions.applyTable(pixels, numPixels, table);
+}
+
+void ImageKernels::createNormalMap(const byte* heightMap, byte* out,
+								   std::size_t width, std::size_t height, float scale) const
+{
+	forEachRowRange(width, height, [&](std::size_t yStart, std::size_t yEnd)
+	{
+		_functions.normalMapRows(heightMap, out, width, height, yStart, yEnd, scale);
+	});
+}
+
+void ImageKernels::addNormals(const byte* first, const byte* second, byte* out, std::size_t numPixels) const
+{
+	// There are no dependencies between the rows, split the pixels into
+	// rows of a single one
+	forEachRowRange(1, numPixels, [&](std::size_t start, std::size_t end)
+	{
+		_functions.addNormals(first + start * 4, second + start * 4, out + start * 4, end - start);
+	});
+}
+
+void ImageKernels::smoothNormals(const byte* in, byte* out, std::size_t width, std::size_t height) const
+{
+	forEachRowRange(width, height, [&](std::size_t yStart, std::size_t yEnd)
+	{
+		_functions.smoothNormalsRows(in, out, width, height, yStart, yEnd);
+	});
+}
+
+void ImageKernels::forEachRowRange(std::size_t width, std::size_t height,
+								   const std::function<void(std::size_t, std::size_t)>& processRows) const
+{
+	std::size_t rowsPerTask = std::max<std::size_t>(PIXELS_PER_TASK / std::max<std::size_t>(width, 1), 1);
+
+	if (!_subTaskRunner || height <= rowsPerTask)
+	{
+		processRows(0, height);
+		return;
+	}
+
+	std::vector<std::function<void()>> tasks;
+
+	for (std::size_t y = 0; y < height; y += rowsPerTask)
+	{
+		std::size_t yEnd = std::min(y + rowsPerTask, height);
+		tasks.push_back([&processRows, y, yEnd]() { processRows(y, yEnd); });
+	}
+
+	_subTaskRunner(tasks);
+}
+
+bool ImageKernels::IsSupported(InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+	case InstructionSet::Scalar:
+		return true;
+#ifdef IMAGE_KERNELS_SSE2
+	case InstructionSet::SSE2:
+		return true;
+#endif
+#ifdef IMAGE_KERNELS_AVX2
+	case InstructionSet::AVX2:
+	{
+		static bool supported = cpuSupportsAVX2();
+		return supported;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+ImageKernels::InstructionSet ImageKernels::GetBestInstructionSet()
+{
+	if (IsSupported(InstructionSet::AVX2))
+	{
+		return InstructionSet::AVX2;
+	}
+
+	return IsSupported(InstructionSet::SSE2) ? InstructionSet::SSE2 : InstructionSet::Scalar;
+}
+
+const char* ImageKernels::GetName(InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+	case InstructionSet::SSE2:
+		return "SSE2";
+	case InstructionSet::AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+} // namespace shaders
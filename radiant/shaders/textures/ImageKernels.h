@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+typedef unsigned char byte;
+
+namespace shaders
+{
+
+/**
+ * The pixel processing loops of the TextureManipulator and the map
+ * expressions: resampling, mip reduction, gamma correction and normal map
+ * generation. They are implemented as plain scalar code and vectorised using
+ * SSE2 and AVX2, the best instruction set supported by the CPU is chosen at
+ * runtime. All implementations produce exactly the same output, except for
+ * createNormalMap() whose components might be off by one.
+ *
+ * This class doesn't depend on any module, such that the implementations
+ * can be compared by the tests and benchmarks.
+ */
+class ImageKernels
+{
+public:
+	enum class InstructionSet
+	{
+		Scalar,
+		SSE2,
+		AVX2,
+	};
+
+	// The implementations of the inner loops, defined in the .cpp file
+	struct Functions;
+
+	// Runs the given tasks in parallel, returning once all of them are done
+	typedef std::function<void(const std::vector<std::function<void()>>&)> SubTaskRunner;
+
+private:
+	const Functions& _functions;
+
+	SubTaskRunner _subTaskRunner;
+
+public:
+	// Uses the best instruction set supported by the CPU
+	ImageKernels();
+
+	// Uses the given instruction set, or the best supported one if the CPU
+	// lacks it
+	ImageKernels(InstructionSet instructionSet);
+
+	InstructionSet getInstructionSet() const;
+
+	// Set the function running the normal map calculations of large images
+	// in parallel, which are split into portions of a few rows. Without one
+	// all rows are processed by the calling thread.
+	void setSubTaskRunner(const SubTaskRunner& runner);
+
+	// Resamples the given image with 3 or 4 bytes per pixel using bilinear
+	// filtering. outdata must not overlap indata.
+	void resample(const void* indata, std::size_t inwidth, std::size_t inheight,
+				  void* outdata, std::size_t outwidth, std::size_t outheight, int bytesperpixel) const;
+
+	// Halves the width and/or height of the given RGBA image, as far as they
+	// exceed the destination dimensions. in can be the same as out.
+	void mipReduce(const byte* in, byte* out,
+				   std::size_t width, std::size_t height,
+				   std::size_t destwidth, std::size_t destheight) const;
+
+	// Replaces the RGB components of the given RGBA pixels with their entry
+	// in the 256 entries of the given table, alpha is left alone
+	void applyTable(byte* pixels, std::size_t numPixels, const byte* table) const;
+
+	// Calculates the normal map of the given RGBA height map using its red
+	// channel, the scale is applied to the slopes. The borders wrap around.
+	void createNormalMap(const byte* heightMap, byte* out,
+						 std::size_t width, std::size_t height, float scale) const;
+
+	// Averages the RGB components of the given normal maps, alpha is set to 255.
+	// out can be the same as one of the inputs.
+	void addNormals(const byte* first, const byte* second, byte* out, std::size_t numPixels) const;
+
+	// Averages the RGB components of each pixel and its eight neighbours,
+	// wrapping around at the borders. Alpha is set to 255.
+	void smoothNormals(const byte* in, byte* out, std::size_t width, std::size_t height) const;
+
+	static bool IsSupported(InstructionSet instructionSet);
+
+	static InstructionSet GetBestInstructionSet();
+
+	static const char* GetName(InstructionSet instructionSet);
+
+private:
+	// Calls the given function for portions of the rows [0, height), in
+	// parallel if there is a sub-task runner and the image is large enough
+	void forEachRowRange(std::size_t width, std::size_t height,
+						 const std::function<void(std::size_t yStart, std::size_t yEnd)>& processRows) const;
+};
+
+} // namespace shaders
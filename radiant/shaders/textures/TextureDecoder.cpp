@@ -0,0 +1,233 @@
+#include "TextureDecoder.h"
+
+#include "itextstream.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Number of textures claimed by the decoder per worker thread at once
+    const std::size_t DECODE_BATCH_SIZE_PER_WORKER = 4;
+}
+
+namespace shaders
+{
+
+TextureDecoder::TextureDecoder() :
+    _running(false),
+    _scheduler(nullptr)
+{}
+
+TextureDecoder::~TextureDecoder()
+{
+    cancel();
+}
+
+void TextureDecoder::setScheduler(decl::ILoadScheduler& scheduler)
+{
+    _scheduler = &scheduler;
+}
+
+void TextureDecoder::setBitmapsPath(const std::string& bitmapsPath)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _bitmapsPath = bitmapsPath;
+}
+
+void TextureDecoder::setImageDecodedCallback(const std::function<void()>& callback)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _imageDecodedCallback = callback;
+}
+
+decl::ILoadScheduler& TextureDecoder::getScheduler()
+{
+    return _scheduler != nullptr ? *_scheduler : GlobalDeclLoadScheduler();
+}
+
+void TextureDecoder::queue(const DeferredTexturePtr& texture)
+{
+    bool startDecoder = false;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        texture->_state = DeferredTexture::State::Queued;
+        _decodeQueue.push_back(texture);
+
+        startDecoder = !_running;
+        _running = true;
+    }
+
+    if (startDecoder)
+    {
+        _job = getScheduler().schedule("TextureDecoder",
+            std::bind(&TextureDecoder::decodeQueuedTextures, this));
+    }
+}
+
+void TextureDecoder::decodeQueuedTextures()
+{
+    std::size_t batchSize = getScheduler().getNumWorkers() * DECODE_BATCH_SIZE_PER_WORKER;
+
+    while (true)
+    {
+        std::vector<DeferredTexturePtr> batch;
+        std::string bitmapsPath;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            if (_decodeQueue.empty())
+            {
+                _running = false;
+                return;
+            }
+
+            while (!_decodeQueue.empty() && batch.size() < batchSize)
+            {
+                batch.push_back(_decodeQueue.front());
+                batch.back()->_state = DeferredTexture::State::Decoding;
+
+                _decodeQueue.pop_front();
+            }
+
+            bitmapsPath = _bitmapsPath;
+        }
+
+        std::vector<decl::ILoadScheduler::Task> tasks;
+        tasks.reserve(batch.size());
+
+        for (const DeferredTexturePtr& texture : batch)
+        {
+            tasks.push_back(std::bind(&TextureDecoder::decodeTexture, this, texture, std::cref(bitmapsPath)));
+        }
+
+        getScheduler().runSubTasks(tasks);
+    }
+}
+
+void TextureDecoder::decodeTexture(const DeferredTexturePtr& texture, const std::string& bitmapsPath)
+{
+    ImagePtr image;
+
+    try
+    {
+        // Loads, resamples and combines the images of the expression
+        image = texture->_expression->getImage(bitmapsPath);
+    }
+    catch (const std::exception& ex)
+    {
+        rError() << "[shaders] Exception while loading texture "
+            << texture->getName() << ": " << ex.what() << std::endl;
+    }
+
+    std::function<void()> callback;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        texture->_image = image;
+        texture->_state = DeferredTexture::State::Decoded;
+
+        _uploadQueue.push_back(texture);
+
+        callback = _imageDecodedCallback;
+    }
+
+    _imageDecoded.notify_all();
+
+    if (callback)
+    {
+        callback();
+    }
+}
+
+ImagePtr TextureDecoder::waitForImage(DeferredTexture& texture)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (texture._state == DeferredTexture::State::Queued)
+    {
+        // Not claimed by the decoder yet, don't wait for it
+        auto queued = std::find(_decodeQueue.begin(), _decodeQueue.end(),
+            texture.shared_from_this());
+
+        if (queued != _decodeQueue.end())
+        {
+            _decodeQueue.erase(queued);
+        }
+
+        texture._state = DeferredTexture::State::Decoding;
+
+        std::string bitmapsPath = _bitmapsPath;
+
+        lock.unlock();
+        decodeTexture(texture.shared_from_this(), bitmapsPath);
+        lock.lock();
+    }
+
+    _imageDecoded.wait(lock, [&]()
+    {
+        return texture._state != DeferredTexture::State::Decoding;
+    });
+
+    return texture._image;
+}
+
+DeferredTexturePtr TextureDecoder::takeDecodedTexture(ImagePtr& image)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_uploadQueue.empty())
+    {
+        return DeferredTexturePtr();
+    }
+
+    DeferredTexturePtr texture = _uploadQueue.front();
+    _uploadQueue.pop_front();
+
+    image = texture->_image;
+
+    texture->_image.reset();
+    texture->_state = DeferredTexture::State::Uploaded;
+
+    return texture;
+}
+
+bool TextureDecoder::hasDecodedTextures()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return !_uploadQueue.empty();
+}
+
+void TextureDecoder::setEvicted(DeferredTexture& texture)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    texture._state = DeferredTexture::State::Evicted;
+}
+
+bool TextureDecoder::isEvicted(DeferredTexture& texture)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return texture._state == DeferredTexture::State::Evicted;
+}
+
+void TextureDecoder::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // The decoder stops once it finds the queue empty, the dropped
+        // textures are decoded on demand when their size is requested
+        _decodeQueue.clear();
+    }
+
+    if (_job)
+    {
+        _job->wait();
+        _job.reset();
+    }
+}
+
+} // namespace shaders
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "ideclloadscheduler.h"
+#include "DeferredTexture.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace shaders
+{
+
+/**
+ * Evaluates the map expressions of deferred textures on the workers of the
+ * load scheduler. Decoded textures wait in a queue until the GLTextureManager
+ * uploads them on the main thread.
+ *
+ * The state and the image of the deferred textures are guarded by the
+ * decoder. It doesn't make any GL calls.
+ */
+class TextureDecoder
+{
+private:
+	// Guards the queues, the bitmaps path, the running flag and the state
+	// and image of the textures
+	std::mutex _mutex;
+
+	// Signalled whenever a texture has been decoded
+	std::condition_variable _imageDecoded;
+
+	std::deque<DeferredTexturePtr> _decodeQueue;
+	std::deque<DeferredTexturePtr> _uploadQueue;
+
+	// Passed to the map expressions, set on the main thread since the
+	// registry must not be accessed by the decoders
+	std::string _bitmapsPath;
+
+	// True while the decoder job is scheduled or running
+	bool _running;
+	decl::ILoadScheduler::JobPtr _job;
+
+	// Invoked by the decoders (on any thread) after decoding an image
+	std::function<void()> _imageDecodedCallback;
+
+	// The scheduler running the decoder, GlobalDeclLoadScheduler() if not set
+	decl::ILoadScheduler* _scheduler;
+
+public:
+	TextureDecoder();
+	~TextureDecoder();
+
+	// Use the given scheduler instead of the global one
+	void setScheduler(decl::ILoadScheduler& scheduler);
+
+	/**
+	 * \brief
+	 * Set the directory of the built-in images, which the map expressions
+	 * are evaluated with.
+	 */
+	void setBitmapsPath(const std::string& bitmapsPath);
+
+	/**
+	 * \brief
+	 * Set the function to be invoked whenever an image has been decoded.
+	 * It is called on the decoding thread.
+	 */
+	void setImageDecodedCallback(const std::function<void()>& callback);
+
+	// Queues the given texture, starting the decoder if necessary
+	void queue(const DeferredTexturePtr& texture);
+
+	/**
+	 * \brief
+	 * Return the decoded image of the given texture, waiting for the decoder
+	 * if it is decoding it. Textures which are still queued are decoded
+	 * right away on the calling thread.
+	 */
+	ImagePtr waitForImage(DeferredTexture& texture);
+
+	/**
+	 * \brief
+	 * Take the next decoded texture for uploading, moving its image into the
+	 * given pointer and marking it as uploaded. Returns an empty pointer if
+	 * there is none.
+	 */
+	DeferredTexturePtr takeDecodedTexture(ImagePtr& image);
+
+	// Returns true if there are decoded textures waiting to be taken
+	bool hasDecodedTextures();
+
+	// Marks the given texture as evicted, it is queued again on its next use
+	void setEvicted(DeferredTexture& texture);
+	bool isEvicted(DeferredTexture& texture);
+
+	/**
+	 * \brief
+	 * Wait for the running decoder and drop the textures waiting for it.
+	 * The dropped textures are decoded by waitForImage().
+	 */
+	void cancel();
+
+private:
+	decl::ILoadScheduler& getScheduler();
+
+	// Body of the decoder job, decodes batches of queued textures on the
+	// scheduler's workers until the queue is empty
+	void decodeQueuedTextures();
+
+	// Evaluates the map expression of a texture claimed by the calling thread
+	void decodeTexture(const DeferredTexturePtr& texture, const std::string& bitmapsPath);
+};
+
+} // namespace shaders
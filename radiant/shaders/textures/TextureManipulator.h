@@ -3,6 +3,7 @@
 #include "iimage.h"
 #include "ishaders.h"
 #include "iregistry.h"
+#include "ImageKernels.h"
 typedef unsigned char byte;
 
 namespace shaders
@@ -22,6 +23,9 @@ class TextureManipulator: public sigc::trackable
 	// The image reduction indicator (3 = no reduction, 0 = 12.5%)
 	std::size_t _textureQuality;
 
+	// The pixel loops, vectorised if supported by the CPU
+	ImageKernels _kernels;
+
 protected:
 	// this is a singleton
 	TextureManipulator();
@@ -38,6 +42,12 @@ public:
 	// Constructs the prefpage
 	void constructPreferences();
 
+	// The pixel loops, also used by the map expressions
+	ImageKernels& getImageKernels()
+	{
+		return _kernels;
+	}
+
 	void resampleTexture(const void *indata, std::size_t inwidth, std::size_t inheight,
 						 void *outdata, std::size_t outwidth, std::size_t outheight, int bytesperpixel);
 
@@ -75,9 +85,6 @@ private:
 	// This is called on first startup or if the user changes the value
 	void calculateGammaTable();
 
-	void resampleTextureLerpLine(const byte *in, byte *out,
-								 std::size_t inwidth, std::size_t outwidth, int bytesperpixel);
-
 }; // class TextureManipulator
 
 } // namespace shaders
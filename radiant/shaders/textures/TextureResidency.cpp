@@ -0,0 +1,144 @@
+#include "TextureResidency.h"
+
+#include <algorithm>
+
+namespace shaders
+{
+
+TextureResidency::TextureResidency(std::size_t budget) :
+	_budget(budget),
+	_frame(0),
+	_usedInFrame(false)
+{}
+
+void TextureResidency::setBudget(std::size_t budget)
+{
+	_budget = budget;
+}
+
+std::size_t TextureResidency::getBudget() const
+{
+	return _budget;
+}
+
+void TextureResidency::insert(GLuint texture, std::size_t size)
+{
+	remove(texture);
+
+	_lru.push_front(texture);
+
+	Entry& entry = _entries[texture];
+	entry.size = size;
+	entry.lastUsedFrame = _frame;
+	entry.lruPosition = _lru.begin();
+
+	_usedInFrame = true;
+
+	_statistics.size += size;
+	_statistics.peakSize = std::max(_statistics.peakSize, _statistics.size);
+}
+
+void TextureResidency::remove(GLuint texture)
+{
+	_evicted.erase(texture);
+
+	auto found = _entries.find(texture);
+
+	if (found == _entries.end())
+	{
+		return;
+	}
+
+	_statistics.size -= found->second.size;
+
+	_lru.erase(found->second.lruPosition);
+	_entries.erase(found);
+}
+
+bool TextureResidency::markUsed(GLuint texture)
+{
+	auto found = _entries.find(texture);
+
+	if (found == _entries.end())
+	{
+		// Evicted textures are reported once, until they're inserted again
+		if (_evicted.erase(texture) > 0)
+		{
+			_statistics.reloads++;
+			return true;
+		}
+
+		return false;
+	}
+
+	found->second.lastUsedFrame = _frame;
+	_usedInFrame = true;
+
+	// Move the texture to the front of the LRU list
+	_lru.splice(_lru.begin(), _lru, found->second.lruPosition);
+
+	return false;
+}
+
+std::vector<GLuint> TextureResidency::collectEvictions()
+{
+	std::vector<GLuint> evicted;
+
+	// Everything in front of a texture used in this frame has been used in it too
+	while (_budget > 0 && _statistics.size > _budget && !_lru.empty())
+	{
+		auto entry = _entries.find(_lru.back());
+
+		if (entry->second.lastUsedFrame == _frame)
+		{
+			break;
+		}
+
+		evicted.push_back(entry->first);
+		_evicted.insert(entry->first);
+
+		_statistics.size -= entry->second.size;
+		_statistics.evictions++;
+
+		_lru.pop_back();
+		_entries.erase(entry);
+	}
+
+	if (_usedInFrame)
+	{
+		++_frame;
+		_usedInFrame = false;
+	}
+
+	return evicted;
+}
+
+TextureResidency::Statistics TextureResidency::getStatistics() const
+{
+	Statistics statistics = _statistics;
+	statistics.numTextures = _entries.size();
+	statistics.budget = _budget;
+
+	return statistics;
+}
+
+std::size_t TextureResidency::GetTextureSize(const Image& image)
+{
+	if (image.isPrecompressed())
+	{
+		// DXT compressed images use a byte per pixel or less, the mipmaps are part of the image
+		std::size_t size = 0;
+
+		for (std::size_t i = 0; i < image.getMipMapCount(); ++i)
+		{
+			size += image.getWidth(i) * image.getHeight(i);
+		}
+
+		return size;
+	}
+
+	// The generated mipmaps add another third
+	return image.getWidth(0) * image.getHeight(0) * 4 * 4 / 3;
+}
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "iimage.h"
+
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace shaders
+{
+
+/**
+ * Keeps track of the memory occupied by the textures loaded in the
+ * background and of the frame they have last been used in, such that the
+ * least recently used ones can be evicted once they exceed a budget.
+ *
+ * Frames are counted by the eviction checks: a check following the use of
+ * any texture ends the current frame. Textures used in the current frame
+ * are never evicted.
+ *
+ * This is bookkeeping only, the GLTextureManager evicts the textures.
+ * It is used on the main thread only.
+ */
+class TextureResidency
+{
+public:
+	struct Statistics
+	{
+		// Number and estimated size of the resident textures
+		std::size_t numTextures = 0;
+		std::size_t size = 0;
+
+		// The largest size reached
+		std::size_t peakSize = 0;
+
+		std::size_t evictions = 0;
+
+		// Number of evicted textures which have been used again
+		std::size_t reloads = 0;
+
+		std::size_t budget = 0;
+	};
+
+private:
+	typedef std::list<GLuint> TextureList;
+
+	struct Entry
+	{
+		std::size_t size = 0;
+		std::size_t lastUsedFrame = 0;
+
+		// Position in the LRU list
+		TextureList::iterator lruPosition;
+	};
+
+	std::unordered_map<GLuint, Entry> _entries;
+
+	// Most recently used first
+	TextureList _lru;
+
+	// Evicted textures which haven't been used since
+	std::unordered_set<GLuint> _evicted;
+
+	// No limit if 0
+	std::size_t _budget;
+
+	std::size_t _frame;
+	bool _usedInFrame;
+
+	Statistics _statistics;
+
+public:
+	// Pass the number of bytes the textures may occupy, 0 means no limit
+	TextureResidency(std::size_t budget);
+
+	void setBudget(std::size_t budget);
+	std::size_t getBudget() const;
+
+	// Adds the given texture after its image has been uploaded, counting as a use
+	void insert(GLuint texture, std::size_t size);
+
+	// Forgets the given texture (if present), e.g. after it has been deleted
+	void remove(GLuint texture);
+
+	// Marks the given texture as used in the current frame. Returns true if
+	// it has been evicted, in which case it needs to be loaded again.
+	bool markUsed(GLuint texture);
+
+	/**
+	 * Removes the least recently used textures until the remaining ones fit
+	 * the budget, and returns them to be evicted. They are resident again
+	 * once they have been loaded and inserted again. Ends the current frame
+	 * if any texture has been used in it.
+	 */
+	std::vector<GLuint> collectEvictions();
+
+	Statistics getStatistics() const;
+
+	// Estimates the number of bytes occupied by the given image once it has
+	// been uploaded to GL, including its mipmaps
+	static std::size_t GetTextureSize(const Image& image);
+};
+
+}
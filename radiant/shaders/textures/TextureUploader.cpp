@@ -0,0 +1,53 @@
+#include "TextureUploader.h"
+
+#include <algorithm>
+#include <wx/app.h>
+#include "registry/registry.h"
+#include "GLTextureManager.h"
+
+namespace shaders
+{
+
+const char* const TextureUploader::RKEY_UPLOAD_TIME = "user/ui/textures/uploadTimePerFrame";
+
+TextureUploader::TextureUploader(GLTextureManager& manager, const std::function<void()>& texturesUploaded) :
+	_manager(manager),
+	_texturesUploaded(texturesUploaded)
+{
+	wxTheApp->Connect(wxEVT_IDLE, wxIdleEventHandler(TextureUploader::onIdle), nullptr, this);
+
+	// The application might be idle already when an image is done
+	_manager.setImageDecodedCallback([]() { wxWakeUpIdle(); });
+}
+
+TextureUploader::~TextureUploader()
+{
+	_manager.setImageDecodedCallback(std::function<void()>());
+
+	wxTheApp->Disconnect(wxEVT_IDLE, wxIdleEventHandler(TextureUploader::onIdle), nullptr, this);
+}
+
+void TextureUploader::onIdle(wxIdleEvent& ev)
+{
+	// Textures which haven't been drawn lately make room for the others
+	_manager.evictTextures();
+
+	if (!_manager.hasDecodedTextures())
+	{
+		return;
+	}
+
+	int uploadTime = registry::getValue<int>(RKEY_UPLOAD_TIME);
+
+	if (_manager.uploadDecodedTextures(std::chrono::milliseconds(std::max(uploadTime, 1))) > 0)
+	{
+		_texturesUploaded();
+	}
+
+	if (_manager.hasDecodedTextures())
+	{
+		ev.RequestMore();
+	}
+}
+
+}
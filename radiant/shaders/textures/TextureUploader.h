@@ -0,0 +1,38 @@
+#pragma once
+
+#include <functional>
+#include <wx/event.h>
+
+namespace shaders
+{
+
+class GLTextureManager;
+
+/**
+ * Uploads the textures decoded in the background by the GLTextureManager
+ * when the application is idle. Every idle event spends no more than the
+ * configured upload time, such that the views keep redrawing in between.
+ * Before uploading, the textures exceeding the texture memory budget are
+ * evicted.
+ */
+class TextureUploader :
+	public wxEvtHandler
+{
+private:
+	GLTextureManager& _manager;
+
+	// Invoked after a portion of the textures has been uploaded
+	std::function<void()> _texturesUploaded;
+
+public:
+	// The registry key of the upload time per idle event in milliseconds
+	static const char* const RKEY_UPLOAD_TIME;
+
+	TextureUploader(GLTextureManager& manager, const std::function<void()>& texturesUploaded);
+	~TextureUploader();
+
+private:
+	void onIdle(wxIdleEvent& ev);
+};
+
+}
@@ -2,9 +2,18 @@
 
 #include "itextstream.h"
 #include "ifilesystem.h"
-#include "iarchive.h"
+#include "ideclcache.h"
+#include "ideclloadscheduler.h"
+#include "iscenegraph.h"
 #include "modulesystem/StaticModule.h"
+#include "parser/TokenListTokeniser.h"
+#include "string/predicate.h"
 
+#include "map/algorithm/Skins.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <iostream>
 
 namespace skins
@@ -17,7 +26,7 @@ namespace
 }
 
 Doom3SkinCache::Doom3SkinCache() :
-    _defLoader(std::bind(&Doom3SkinCache::loadSkinFiles, this)),
+    _defLoader("Skins", std::bind(&Doom3SkinCache::loadSkinFiles, this)),
     _nullSkin("")
 {}
 
@@ -66,27 +75,17 @@ void Doom3SkinCache::loadSkinFiles()
 	// exceptions that may be thrown
 	try
 	{
+        std::vector<std::string> filenames;
+
         GlobalFileSystem().forEachFile(
             SKINS_FOLDER, "skin",
             [&] (const vfs::FileInfo& fileInfo)
             {
-                // Open the .skin file and get its contents as a std::string
-                ArchiveTextFilePtr file = GlobalFileSystem().openTextFile(SKINS_FOLDER + fileInfo.name);
-                assert(file);
-
-                std::istream is(&(file->getInputStream()));
-
-                try 
-                {
-                    // Pass the contents back to the SkinCache module for parsing
-                    parseFile(is, fileInfo.name);
-                }
-                catch (parser::ParseException& e)
-                {
-                    rError() << "[skins]: in " << fileInfo.name << ": " << e.what() << std::endl;
-                }
+                filenames.push_back(fileInfo.name);
             }
         );
+
+        parseFiles(filenames);
 	}
 	catch (parser::ParseException& e)
 	{
@@ -99,12 +98,121 @@ void Doom3SkinCache::loadSkinFiles()
 	_sigSkinsReloaded.emit();
 }
 
-// Parse the contents of a .skin file
-void Doom3SkinCache::parseFile(std::istream& contents, const std::string& filename)
+std::set<std::string> Doom3SkinCache::reloadSkinFiles(const std::set<std::string>& filenames)
+{
+    // Forget about all skins declared in these files
+    std::set<std::string> skinNames;
+
+    for (NamedSkinMap::iterator i = _namedSkins.begin(); i != _namedSkins.end();)
+    {
+        if (filenames.count(i->second->getSkinFileName()) > 0)
+        {
+            skinNames.insert(i->first);
+            _namedSkins.erase(i++);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    auto isRemoved = [&](const std::string& name) { return skinNames.count(name) > 0; };
+
+    _allSkins.erase(std::remove_if(_allSkins.begin(), _allSkins.end(), isRemoved), _allSkins.end());
+
+    for (ModelSkinMap::value_type& pair : _modelSkins)
+    {
+        pair.second.erase(std::remove_if(pair.second.begin(), pair.second.end(), isRemoved), pair.second.end());
+    }
+
+    // Parse the files again, deleted ones are skipped
+    parseFiles(std::vector<std::string>(filenames.begin(), filenames.end()));
+
+    for (const NamedSkinMap::value_type& pair : _namedSkins)
+    {
+        if (filenames.count(pair.second->getSkinFileName()) > 0)
+        {
+            skinNames.insert(pair.first);
+        }
+    }
+
+    return skinNames;
+}
+
+void Doom3SkinCache::onFilesChanged(const std::set<std::string>& changedFiles)
 {
-    // Construct a DefTokeniser to parse the file
-	parser::BasicDefTokeniser<std::istream> tok(contents);
+    std::set<std::string> skinFiles;
 
+    for (const std::string& file : changedFiles)
+    {
+        if (string::starts_with(file, SKINS_FOLDER) && string::ends_with(file, ".skin"))
+        {
+            skinFiles.insert(file.substr(std::strlen(SKINS_FOLDER)));
+        }
+    }
+
+    if (skinFiles.empty())
+    {
+        return;
+    }
+
+    ensureDefsLoaded();
+
+    std::set<std::string> skinNames = reloadSkinFiles(skinFiles);
+
+    rMessage() << "[skins] Reloaded " << skinFiles.size() << " skin files." << std::endl;
+
+    _sigSkinsReloaded.emit();
+
+    // Let the models in the scene pick up the changes
+    map::algorithm::refreshSkinnedModels(skinNames);
+}
+
+void Doom3SkinCache::parseFiles(const std::vector<std::string>& filenames)
+{
+    // Fetch the tokens in parallel, unchanged files come from the decl cache
+    std::vector<decl::DeclFilePtr> files(filenames.size());
+    std::vector<std::string> errors(filenames.size());
+    std::vector<std::function<void()>> tasks;
+
+    for (std::size_t i = 0; i < filenames.size(); ++i)
+    {
+        tasks.emplace_back([&, i]()
+        {
+            try
+            {
+                files[i] = GlobalDeclCache().getFile(SKINS_FOLDER + filenames[i],
+                    decl::DeclFileContents::Tokens);
+            }
+            catch (parser::ParseException& e)
+            {
+                errors[i] = e.what();
+            }
+        });
+    }
+
+    GlobalDeclLoadScheduler().runSubTasks(tasks);
+
+    // Parse in VFS order, the first declaration of a skin wins
+    for (std::size_t i = 0; i < filenames.size(); ++i)
+    {
+        if (!errors[i].empty())
+        {
+            rError() << "[skins]: in " << filenames[i] << ": " << errors[i] << std::endl;
+            continue;
+        }
+
+        // Deleted files are skipped
+        if (!files[i]) continue;
+
+        parser::TokenListTokeniser tokeniser(files[i]->tokens);
+        parseFile(tokeniser, filenames[i]);
+    }
+}
+
+// Parse the tokens of a .skin file
+void Doom3SkinCache::parseFile(parser::DefTokeniser& tok, const std::string& filename)
+{
 	// Call the parseSkin() function for each skin decl
 	while (tok.hasMoreTokens())
     {
@@ -207,6 +315,9 @@ const StringSet& Doom3SkinCache::getDependencies() const
 	if (_dependencies.empty())
     {
 		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
+		_dependencies.insert(MODULE_SCENEGRAPH);
+		_dependencies.insert(MODULE_DECLLOADSCHEDULER);
+		_dependencies.insert(MODULE_DECLCACHE);
 	}
 
 	return _dependencies;
@@ -227,10 +338,17 @@ void Doom3SkinCache::initialiseModule(const ApplicationContext& ctx)
 {
 	rMessage() << "Doom3SkinCache::initialiseModule called" << std::endl;
 
+    GlobalFileSystem().addObserver(*this);
+
     // Load the skins in a new thread
     refresh();
 }
 
+void Doom3SkinCache::shutdownModule()
+{
+    GlobalFileSystem().removeObserver(*this);
+}
+
 // Module instance
 module::StaticModule<Doom3SkinCache> skinCacheModule;
 
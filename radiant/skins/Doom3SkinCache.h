@@ -3,6 +3,7 @@
 #include "Doom3ModelSkin.h"
 
 #include "imodule.h"
+#include "ifilesystem.h"
 #include "modelskin.h"
 #include "parser/DefTokeniser.h"
 
@@ -19,7 +20,8 @@ namespace skins
  * Implementation of ModelSkinCache interface for Doom 3 skin management.
  */
 class Doom3SkinCache :
-	public ModelSkinCache
+	public ModelSkinCache,
+	public vfs::VirtualFileSystem::Observer
 {
 	// Table of named skin objects
 	typedef std::map<std::string, Doom3ModelSkinPtr> NamedSkinMap;
@@ -67,10 +69,14 @@ public:
 	// Public events
 	sigc::signal<void> signal_skinsReloaded() override;
 
+	// VFS::Observer implementation, re-parses the changed skin files
+	void onFilesChanged(const std::set<std::string>& changedFiles) override;
+
 	// RegisterableModule implementation
 	const std::string& getName() const override;
     const StringSet& getDependencies() const override;
     void initialiseModule(const ApplicationContext& ctx) override;
+    void shutdownModule() override;
 
 private:
     // Load and parse the skin files, populating internal data structures.
@@ -81,15 +87,23 @@ private:
     // Iterates over each skin file in the VFS skins/ folder
     void loadSkinFiles();
 
+    // Replaces the skins declared in the given files (relative to skins/)
+    // with their current contents, returns the names of the affected skins
+    std::set<std::string> reloadSkinFiles(const std::set<std::string>& filenames);
+
     // Parse an individual skin declaration and add return the skin object
     Doom3ModelSkinPtr parseSkin(parser::DefTokeniser& tokeniser);
 
-    /* Parse the provided istream as a .skin file, and add all skins found within
+    // Parses the given skin files (relative to skins/) in the given order,
+    // unchanged files are taken from the decl cache
+    void parseFiles(const std::vector<std::string>& filenames);
+
+    /* Parse the provided tokens of a .skin file, and add all skins found within
     * to the internal data structures.
     *
     * @filename: This is for informational purposes only (error message display).
     */
-    void parseFile(std::istream& contents, const std::string& filename);
+    void parseFile(parser::DefTokeniser& tokeniser, const std::string& filename);
 };
 typedef std::shared_ptr<Doom3SkinCache> Doom3SkinCachePtr;
 
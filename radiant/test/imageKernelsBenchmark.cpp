@@ -0,0 +1,236 @@
+/**
+ * Micro-benchmark comparing the scalar and vectorised pixel loops used by
+ * the TextureManipulator and the map expressions on RGBA images of various
+ * sizes. The output of each instruction set is checked against the scalar
+ * one. The best instruction set is measured once more running the normal map
+ * calculations on all cores.
+ *
+ * Usage: imageKernelsBenchmark [iterations]
+ */
+#include "radiant/shaders/textures/ImageKernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using shaders::ImageKernels;
+
+namespace
+{
+
+typedef std::vector<byte> Pixels;
+
+Pixels createRandomImage(std::size_t width, std::size_t height)
+{
+	std::mt19937 random(static_cast<unsigned int>(width * height));
+	std::uniform_int_distribution<int> distribution(0, 255);
+
+	Pixels pixels(width * height * 4);
+
+	for (byte& value : pixels)
+	{
+		value = static_cast<byte>(distribution(random));
+	}
+
+	return pixels;
+}
+
+// Runs the given function, returning the average number of milliseconds
+template<typename Func>
+double measure(int iterations, Func func)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		func();
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count() / iterations;
+}
+
+// Runs the given tasks on as many threads as there are cores
+void runInParallel(const std::vector<std::function<void()>>& tasks)
+{
+	std::atomic<std::size_t> next(0);
+	std::vector<std::thread> threads;
+
+	for (unsigned int i = 0; i < std::max(std::thread::hardware_concurrency(), 1u); ++i)
+	{
+		threads.emplace_back([&]()
+		{
+			for (std::size_t task = next++; task < tasks.size(); task = next++)
+			{
+				tasks[task]();
+			}
+		});
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+struct Results
+{
+	Pixels resampled;
+	Pixels reduced;
+	Pixels gammaCorrected;
+	Pixels normalMap;
+	Pixels addedNormals;
+	Pixels smoothedNormals;
+};
+
+// The normal maps are allowed to differ by one
+bool normalMapsMatch(const Pixels& a, const Pixels& b)
+{
+	return std::equal(a.begin(), a.end(), b.begin(), [](byte x, byte y) { return std::abs(x - y) <= 1; });
+}
+
+bool resultsMatch(const Results& a, const Results& b)
+{
+	return a.resampled == b.resampled && a.reduced == b.reduced && a.gammaCorrected == b.gammaCorrected &&
+		normalMapsMatch(a.normalMap, b.normalMap) && a.addedNormals == b.addedNormals &&
+		a.smoothedNormals == b.smoothedNormals;
+}
+
+Results runBenchmark(const ImageKernels& kernels, const std::string& label, const Pixels& source,
+	std::size_t size, int iterations, const byte* gammaTable)
+{
+	Results results;
+
+	// Stretching a non-power-of-two image to the next power of two
+	std::size_t sourceSize = size * 3 / 4;
+	results.resampled.resize(size * size * 4);
+
+	double resampleTime = measure(iterations, [&]()
+	{
+		kernels.resample(source.data(), sourceSize, sourceSize, results.resampled.data(), size, size, 4);
+	});
+
+	// Reducing the texture quality by one step
+	results.reduced.resize(size * size * 4);
+
+	double reduceTime = measure(iterations, [&]()
+	{
+		kernels.mipReduce(source.data(), results.reduced.data(), size, size, size / 2, size / 2);
+	});
+
+	results.reduced.resize(size * size);
+
+	// Applied repeatedly, which ends up the same for every instruction set
+	results.gammaCorrected = source;
+
+	double gammaTime = measure(iterations, [&]()
+	{
+		kernels.applyTable(results.gammaCorrected.data(), size * size, gammaTable);
+	});
+
+	results.normalMap.resize(size * size * 4);
+
+	double normalMapTime = measure(iterations, [&]()
+	{
+		kernels.createNormalMap(source.data(), results.normalMap.data(), size, size, 2.0f);
+	});
+
+	results.addedNormals.resize(size * size * 4);
+
+	double addNormalsTime = measure(iterations, [&]()
+	{
+		kernels.addNormals(source.data(), results.resampled.data(), results.addedNormals.data(), size * size);
+	});
+
+	results.smoothedNormals.resize(size * size * 4);
+
+	double smoothNormalsTime = measure(iterations, [&]()
+	{
+		kernels.smoothNormals(source.data(), results.smoothedNormals.data(), size, size);
+	});
+
+	std::cout << "  " << label << ": resample " << resampleTime << " ms, mip reduce " << reduceTime
+		<< " ms, gamma " << gammaTime << " ms" << std::endl
+		<< "  " << std::string(label.size(), ' ') << "  heightmap " << normalMapTime << " ms, addnormals "
+		<< addNormalsTime << " ms, smoothnormals " << smoothNormalsTime << " ms" << std::endl;
+
+	return results;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	int iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+
+	// The gamma table of the default gamma preference
+	byte gammaTable[256];
+
+	for (int i = 0; i < 256; ++i)
+	{
+		gammaTable[i] = static_cast<byte>(255 * pow((i + 0.5) / 255.5, 0.8) + 0.5);
+	}
+
+	const ImageKernels::InstructionSet instructionSets[] =
+	{
+		ImageKernels::InstructionSet::Scalar,
+		ImageKernels::InstructionSet::SSE2,
+		ImageKernels::InstructionSet::AVX2,
+	};
+
+	int result = 0;
+
+	for (std::size_t size = 512; size <= 2048; size <<= 1)
+	{
+		std::cout << size << "x" << size << " (" << iterations << " iterations)" << std::endl;
+
+		Pixels source = createRandomImage(size, size);
+		Results reference;
+
+		for (ImageKernels::InstructionSet instructionSet : instructionSets)
+		{
+			if (!ImageKernels::IsSupported(instructionSet))
+			{
+				std::cout << "  " << ImageKernels::GetName(instructionSet) << ": not supported" << std::endl;
+				continue;
+			}
+
+			Results results = runBenchmark(ImageKernels(instructionSet), ImageKernels::GetName(instructionSet),
+				source, size, iterations, gammaTable);
+
+			if (instructionSet == ImageKernels::InstructionSet::Scalar)
+			{
+				reference = results;
+			}
+			else if (!resultsMatch(results, reference))
+			{
+				std::cout << "  output differs from the scalar implementation" << std::endl;
+				result = 1;
+			}
+		}
+
+		ImageKernels parallel;
+		parallel.setSubTaskRunner(runInParallel);
+
+		Results results = runBenchmark(parallel, std::string(ImageKernels::GetName(parallel.getInstructionSet())) +
+			" on " + std::to_string(std::max(std::thread::hardware_concurrency(), 1u)) + " threads",
+			source, size, iterations, gammaTable);
+
+		if (!resultsMatch(results, reference))
+		{
+			std::cout << "  output differs from the scalar implementation" << std::endl;
+			result = 1;
+		}
+	}
+
+	return result;
+}
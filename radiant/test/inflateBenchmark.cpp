@@ -0,0 +1,124 @@
+/**
+ * Micro-benchmark comparing the streaming and whole-file read paths of
+ * the PK4 archive implementation.
+ *
+ * Usage: inflateBenchmark [iterations] [file.pk4 ...]
+ *
+ * Without any PK4 arguments the archives of the test data are used, located
+ * relative to the srcdir environment variable (as for the tests).
+ */
+#include "radiant/vfs/ZipArchive.h"
+#include "stream/ScopedArchiveBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+
+class FileCollector :
+	public Archive::Visitor
+{
+public:
+	std::vector<std::string> files;
+
+	void visitFile(const std::string& name) override
+	{
+		files.push_back(name);
+	}
+
+	bool visitDirectory(const std::string& name, std::size_t depth) override
+	{
+		return false;
+	}
+};
+
+// Read each file in 1 kB portions, the way the previous implementation was used
+std::size_t readStreaming(archive::ZipArchive& archive, const std::vector<std::string>& files)
+{
+	std::size_t total = 0;
+	InputStream::byte_type chunk[1024];
+
+	for (const auto& name : files)
+	{
+		auto file = archive.openFile(name);
+
+		for (auto count = file->getInputStream().read(chunk, sizeof(chunk)); count > 0;
+			 count = file->getInputStream().read(chunk, sizeof(chunk)))
+		{
+			total += count;
+		}
+	}
+
+	return total;
+}
+
+// Read each file with a single read() call
+std::size_t readWholeFile(archive::ZipArchive& archive, const std::vector<std::string>& files)
+{
+	std::size_t total = 0;
+
+	for (const auto& name : files)
+	{
+		auto file = archive.openFile(name);
+		archive::ScopedArchiveBuffer buffer(*file);
+
+		total += buffer.length;
+	}
+
+	return total;
+}
+
+template<typename ReadFunc>
+void runBenchmark(const std::string& label, int iterations, ReadFunc readFunc)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::size_t bytes = 0;
+
+	for (int i = 0; i < iterations; ++i)
+	{
+		bytes += readFunc();
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << "  " << label << ": " << bytes << " bytes in " << elapsed.count() << " s ("
+		<< (elapsed.count() > 0 ? bytes / elapsed.count() / (1024 * 1024) : 0) << " MB/s)" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	int iterations = argc > 1 ? std::atoi(argv[1]) : 100;
+
+	std::vector<std::string> archives(argv + std::min(argc, 2), argv + argc);
+
+	if (archives.empty())
+	{
+		const char* srcdir = getenv("srcdir");
+		std::string root = std::string(srcdir ? srcdir : ".") + "/test/data/vfs_root/";
+
+		archives.push_back(root + "tdm_example_mtrs.pk4");
+		archives.push_back(root + "test_models.pk4");
+	}
+
+	for (const auto& path : archives)
+	{
+		archive::ZipArchive archive(path);
+
+		FileCollector collector;
+		archive.traverse(collector, "");
+
+		std::cout << path << " (" << collector.files.size() << " files, "
+			<< iterations << " iterations)" << std::endl;
+
+		runBenchmark("streaming", iterations, [&]() { return readStreaming(archive, collector.files); });
+		runBenchmark("whole file", iterations, [&]() { return readWholeFile(archive, collector.files); });
+	}
+
+	return 0;
+}
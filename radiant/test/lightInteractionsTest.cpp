@@ -0,0 +1,279 @@
+#define BOOST_TEST_MODULE lightInteractionsTest
+#include <boost/test/included/unit_test.hpp>
+
+#include "radiant/render/LightInteractions.h"
+#include "math/Frustum.h"
+
+#include <cmath>
+#include <random>
+#include <set>
+
+using namespace render;
+
+namespace
+{
+    // A light lighting everything overlapping its volume
+    struct TestLight :
+        public RendererLight
+    {
+        AABB volume;
+
+        Vector3 direction;
+        ShaderPtr shader;
+
+        TestLight(const AABB& volume_) :
+            volume(volume_)
+        {}
+
+        float getShaderParm(int parmNum) const override { return 0; }
+        const Vector3& getDirection() const override { return direction; }
+        const ShaderPtr& getWireShader() const override { return shader; }
+
+        const ShaderPtr& getShader() const override { return shader; }
+        const Vector3& worldOrigin() const override { return volume.origin; }
+        Matrix4 getLightTextureTransformation() const override { return Matrix4::getIdentity(); }
+        Vector3 getLightOrigin() const override { return volume.origin; }
+
+        bool intersectsAABB(const AABB& aabb) const override
+        {
+            return volume.intersects(aabb);
+        }
+
+        AABB lightVolumeAABB() const override
+        {
+            return volume;
+        }
+    };
+
+    // Records the lights it is given and how often they're calculated
+    struct TestObject :
+        public LitObject
+    {
+        AABB bounds;
+
+        std::set<const RendererLight*> lights;
+        int numCalculations = 0;
+
+        TestObject(const AABB& bounds_) :
+            bounds(bounds_)
+        {}
+
+        bool intersectsLight(const RendererLight& light) const override
+        {
+            return light.intersectsAABB(bounds);
+        }
+
+        AABB litObjectAABB() const override
+        {
+            return bounds;
+        }
+
+        void insertLight(const RendererLight& light) override
+        {
+            lights.insert(&light);
+        }
+
+        void clearLights() override
+        {
+            lights.clear();
+            ++numCalculations;
+        }
+    };
+
+    // Four objects in a row, far enough apart to be in different cells
+    struct Fixture
+    {
+        LightInteractions interactions;
+
+        std::vector<std::unique_ptr<TestObject>> objects;
+        std::vector<LightList*> lightLists;
+
+        TestLight light;
+
+        Fixture() :
+            light(getBounds(0, 50))
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                objects.emplace_back(new TestObject(getBounds(i, 10)));
+                lightLists.push_back(&interactions.attachLitObject(*objects.back()));
+            }
+
+            interactions.attachLight(light);
+
+            calculateLights();
+        }
+
+        static AABB getBounds(int position, double extents)
+        {
+            return AABB(Vector3(position * 2000, 0, 0), Vector3(extents, extents, extents));
+        }
+
+        // Calculates the lights of all objects, as rendering does
+        void calculateLights()
+        {
+            for (std::size_t i = 0; i < objects.size(); ++i)
+            {
+                objects[i]->numCalculations = 0;
+                lightLists[i]->calculateIntersectingLights();
+            }
+        }
+
+        std::vector<int> getNumCalculations()
+        {
+            std::vector<int> counts;
+
+            for (const auto& object : objects)
+            {
+                counts.push_back(object->numCalculations);
+            }
+
+            return counts;
+        }
+    };
+
+    // A perspective projection as used by the camera, looking down the -z axis
+    Frustum createFrustum(double fov, double aspect, double near, double far)
+    {
+        double f = 1 / std::tan(fov / 2);
+
+        return Frustum::createFromViewproj(Matrix4::byColumns(
+            f / aspect, 0, 0, 0,
+            0, f, 0, 0,
+            0, 0, (far + near) / (near - far), -1,
+            0, 0, 2 * far * near / (near - far), 0
+        ));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(movingLightDirtiesOldAndNewBounds)
+{
+    Fixture fixture;
+
+    BOOST_TEST(fixture.objects[0]->lights == std::set<const RendererLight*>({ &fixture.light }));
+    BOOST_TEST(fixture.objects[1]->lights.empty());
+
+    // Nothing changed, nothing is calculated again
+    fixture.calculateLights();
+    BOOST_TEST(fixture.getNumCalculations() == std::vector<int>({ 0, 0, 0, 0 }));
+
+    // Move the light from the first to the third object
+    fixture.light.volume = Fixture::getBounds(2, 50);
+    fixture.interactions.lightChanged(fixture.light);
+
+    fixture.calculateLights();
+
+    BOOST_TEST(fixture.getNumCalculations() == std::vector<int>({ 1, 0, 1, 0 }));
+    BOOST_TEST(fixture.objects[0]->lights.empty());
+    BOOST_TEST(fixture.objects[2]->lights == std::set<const RendererLight*>({ &fixture.light }));
+
+    // Changing a light repeatedly before rendering only counts its last bounds
+    fixture.light.volume = Fixture::getBounds(1, 50);
+    fixture.interactions.lightChanged(fixture.light);
+    fixture.light.volume = Fixture::getBounds(3, 50);
+    fixture.interactions.lightChanged(fixture.light);
+
+    fixture.calculateLights();
+
+    BOOST_TEST(fixture.getNumCalculations() == std::vector<int>({ 0, 0, 1, 1 }));
+    BOOST_TEST(fixture.objects[3]->lights == std::set<const RendererLight*>({ &fixture.light }));
+}
+
+BOOST_AUTO_TEST_CASE(detachLightDirtiesIndexedBounds)
+{
+    Fixture fixture;
+
+    // The change is not processed before the light is detached, the objects
+    // at the bounds the light has been indexed with are still lit by it
+    fixture.light.volume = Fixture::getBounds(1, 50);
+    fixture.interactions.lightChanged(fixture.light);
+
+    fixture.interactions.detachLight(fixture.light);
+
+    fixture.calculateLights();
+
+    BOOST_TEST(fixture.getNumCalculations() == std::vector<int>({ 1, 0, 0, 0 }));
+
+    for (const auto& object : fixture.objects)
+    {
+        BOOST_TEST(object->lights.empty());
+    }
+
+    // Attaching it again dirties the objects at its current bounds
+    fixture.interactions.attachLight(fixture.light);
+
+    fixture.calculateLights();
+
+    BOOST_TEST(fixture.getNumCalculations() == std::vector<int>({ 0, 1, 0, 0 }));
+    BOOST_TEST(fixture.objects[1]->lights == std::set<const RendererLight*>({ &fixture.light }));
+}
+
+BOOST_AUTO_TEST_CASE(frustumBoundsEncloseFrustum)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> unit(0, 1);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        // Transformed like the frustum of a projected light
+        Matrix4 transform = Matrix4::getTranslation(Vector3(unit(random), unit(random), unit(random)) * 1000);
+        transform.multiplyBy(Matrix4::getRotation(
+            Vector3(unit(random) - 0.5, unit(random) - 0.5, unit(random) - 0.5).getNormalised(),
+            unit(random) * 6
+        ));
+
+        Frustum frustum = createFrustum(0.2 + unit(random) * 2.5, 0.5 + unit(random) * 2,
+                                        unit(random) * 10 + 0.1, 100 + unit(random) * 1000)
+                          .getTransformedBy(transform);
+
+        AABB bounds = frustum.getBounds();
+        BOOST_TEST_REQUIRE(bounds.isValid());
+
+        // Same margin for rounding errors as the lights use
+        bounds.extendBy(Vector3(1, 1, 1));
+
+        AABB samples = bounds;
+        samples.extents *= 1.5;
+
+        int numInside = 0;
+
+        for (int j = 0; j < 2000; ++j)
+        {
+            Vector3 point = samples.origin + Vector3(
+                (unit(random) * 2 - 1) * samples.extents.x(),
+                (unit(random) * 2 - 1) * samples.extents.y(),
+                (unit(random) * 2 - 1) * samples.extents.z()
+            );
+
+            // Frustum::testPoint() doesn't share the plane convention of the
+            // intersection test the lights are using
+            if (frustum.testIntersection(AABB(point, Vector3(0, 0, 0))) == VOLUME_OUTSIDE)
+            {
+                continue;
+            }
+
+            ++numInside;
+
+            // Every box touching the frustum is accepted by both tests
+            AABB box(point + Vector3(unit(random), unit(random), unit(random)) * 20, Vector3(20, 20, 20));
+
+            BOOST_TEST(bounds.intersects(point));
+            BOOST_TEST(frustum.testIntersection(box) != VOLUME_OUTSIDE);
+            BOOST_TEST(bounds.intersects(box));
+        }
+
+        BOOST_TEST(numInside > 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(degenerateFrustumHasNoBounds)
+{
+    Frustum frustum = createFrustum(1, 1, 1, 100);
+    BOOST_TEST(frustum.getBounds().isValid());
+
+    // The corners on the top and left planes don't exist, the bounds don't
+    // contain the origin that Plane3::intersect() returns for them either
+    frustum.top = frustum.left;
+
+    BOOST_TEST(!frustum.getBounds().isValid());
+}
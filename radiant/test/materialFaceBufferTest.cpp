@@ -0,0 +1,203 @@
+#define BOOST_TEST_MODULE materialFaceBufferTest
+#include <boost/test/included/unit_test.hpp>
+
+#include "radiant/brush/MaterialFaceBuffer.h"
+
+#include <cmath>
+
+namespace
+{
+    // Regular polygon in the XY plane with the given number of corners
+    IWinding makeWinding(std::size_t numVertices, double z = 0)
+    {
+        IWinding winding(numVertices);
+
+        for (std::size_t i = 0; i < numVertices; ++i)
+        {
+            double angle = 2 * 3.14159265358979 * i / numVertices;
+
+            winding[i].vertex = Vector3(cos(angle) * 64, sin(angle) * 64, z);
+            winding[i].texcoord = Vector2(cos(angle), sin(angle));
+            winding[i].normal = Vector3(0, 0, 1);
+        }
+
+        return winding;
+    }
+
+    // Checks that the indices of the face form a fan over its winding
+    void checkFace(const MaterialFaceBuffer& buffer, MaterialFaceBuffer::FaceId face,
+                   const IWinding& winding)
+    {
+        MaterialFaceBuffer::Range vertices = buffer.getFaceVertices(face);
+        MaterialFaceBuffer::Range indices = buffer.getFaceIndices(face);
+
+        BOOST_REQUIRE_EQUAL(vertices.count, winding.size());
+        BOOST_REQUIRE_EQUAL(indices.count, (winding.size() - 2) * 3);
+
+        for (std::size_t i = 0; i < winding.size(); ++i)
+        {
+            const VertexNT& vertex = buffer.getVertices()[vertices.start + i];
+
+            BOOST_CHECK_EQUAL(vertex.vertex, winding[i].vertex);
+            BOOST_CHECK_EQUAL(vertex.texcoord, winding[i].texcoord);
+            BOOST_CHECK_EQUAL(vertex.normal, winding[i].normal);
+        }
+
+        for (std::size_t i = 0; i < indices.count; i += 3)
+        {
+            const unsigned int* triangle = &buffer.getIndices()[indices.start + i];
+
+            BOOST_CHECK_EQUAL(triangle[0], vertices.start);
+            BOOST_CHECK_EQUAL(triangle[1], vertices.start + i / 3 + 1);
+            BOOST_CHECK_EQUAL(triangle[2], vertices.start + i / 3 + 2);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(addFaces)
+{
+    MaterialFaceBuffer buffer;
+
+    IWinding quad = makeWinding(4);
+    IWinding hexagon = makeWinding(6, 32);
+
+    MaterialFaceBuffer::FaceId first = buffer.addFace(quad);
+    MaterialFaceBuffer::FaceId second = buffer.addFace(hexagon);
+
+    BOOST_CHECK_NE(first, second);
+    BOOST_CHECK_EQUAL(buffer.getNumFaces(), 2);
+    BOOST_CHECK_EQUAL(buffer.getVertices().size(), 10);
+    BOOST_CHECK_EQUAL(buffer.getIndices().size(), 6 + 12);
+
+    checkFace(buffer, first, quad);
+    checkFace(buffer, second, hexagon);
+
+    // The faces follow each other, such that they can be drawn at once
+    BOOST_CHECK_EQUAL(buffer.getFaceIndices(second).start,
+                      buffer.getFaceIndices(first).start + buffer.getFaceIndices(first).count);
+
+    BOOST_CHECK(buffer.sizeChanged());
+    BOOST_CHECK_EQUAL(buffer.getChangedVertices().count, 10);
+    BOOST_CHECK_EQUAL(buffer.getChangedIndices().count, 18);
+}
+
+BOOST_AUTO_TEST_CASE(updateFaceInPlace)
+{
+    MaterialFaceBuffer buffer;
+
+    MaterialFaceBuffer::FaceId first = buffer.addFace(makeWinding(4));
+    MaterialFaceBuffer::FaceId second = buffer.addFace(makeWinding(6));
+    MaterialFaceBuffer::FaceId third = buffer.addFace(makeWinding(5));
+
+    buffer.clearChanges();
+
+    MaterialFaceBuffer::Range before = buffer.getFaceVertices(second);
+
+    // A smaller winding stays where it is, only its range has changed
+    IWinding triangle = makeWinding(3, 16);
+    buffer.updateFace(second, triangle);
+
+    BOOST_CHECK(!buffer.sizeChanged());
+    BOOST_CHECK_EQUAL(buffer.getFaceVertices(second).start, before.start);
+    BOOST_CHECK_EQUAL(buffer.getChangedVertices().start, before.start);
+    BOOST_CHECK_EQUAL(buffer.getChangedVertices().count, 6);
+    BOOST_CHECK_EQUAL(buffer.getChangedIndices().start, buffer.getFaceIndices(second).start);
+    BOOST_CHECK_EQUAL(buffer.getChangedIndices().count, 12);
+
+    checkFace(buffer, second, triangle);
+    checkFace(buffer, first, makeWinding(4));
+    checkFace(buffer, third, makeWinding(5));
+
+    // The unused indices of the face are degenerate
+    for (std::size_t i = 3; i < 12; ++i)
+    {
+        BOOST_CHECK_EQUAL(buffer.getIndices()[buffer.getFaceIndices(second).start + i], before.start);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(growFace)
+{
+    MaterialFaceBuffer buffer;
+
+    MaterialFaceBuffer::FaceId first = buffer.addFace(makeWinding(4));
+    MaterialFaceBuffer::FaceId second = buffer.addFace(makeWinding(4));
+
+    buffer.clearChanges();
+
+    // Larger windings are moved to the end of the arrays
+    IWinding octagon = makeWinding(8);
+    buffer.updateFace(first, octagon);
+
+    BOOST_CHECK(buffer.sizeChanged());
+    BOOST_CHECK_EQUAL(buffer.getFaceVertices(first).start, 8);
+    BOOST_CHECK_EQUAL(buffer.getVertices().size(), 16);
+
+    checkFace(buffer, first, octagon);
+    checkFace(buffer, second, makeWinding(4));
+}
+
+BOOST_AUTO_TEST_CASE(removeAndReuseFaces)
+{
+    MaterialFaceBuffer buffer;
+
+    MaterialFaceBuffer::FaceId first = buffer.addFace(makeWinding(4));
+    MaterialFaceBuffer::FaceId second = buffer.addFace(makeWinding(4));
+
+    buffer.removeFace(first);
+
+    BOOST_CHECK_EQUAL(buffer.getNumFaces(), 1);
+    BOOST_CHECK(buffer.getFaceIndices(first).empty());
+
+    // The id of the removed face is handed out again
+    IWinding pentagon = makeWinding(5);
+    MaterialFaceBuffer::FaceId third = buffer.addFace(pentagon);
+
+    BOOST_CHECK_EQUAL(third, first);
+    BOOST_CHECK_EQUAL(buffer.getNumFaces(), 2);
+
+    checkFace(buffer, second, makeWinding(4));
+    checkFace(buffer, third, pentagon);
+}
+
+BOOST_AUTO_TEST_CASE(compact)
+{
+    MaterialFaceBuffer buffer;
+
+    std::vector<MaterialFaceBuffer::FaceId> faces;
+
+    for (std::size_t i = 0; i < 1000; ++i)
+    {
+        faces.push_back(buffer.addFace(makeWinding(4 + i % 3, i)));
+    }
+
+    // Not enough unused space to bother
+    buffer.removeFace(faces[0]);
+    BOOST_CHECK(!buffer.compact());
+
+    // Remove all but every tenth face
+    for (std::size_t i = 1; i < faces.size(); ++i)
+    {
+        if (i % 10 != 0)
+        {
+            buffer.removeFace(faces[i]);
+        }
+    }
+
+    buffer.clearChanges();
+
+    BOOST_CHECK(buffer.compact());
+    BOOST_CHECK(buffer.sizeChanged());
+
+    std::size_t numVertices = 0;
+
+    for (std::size_t i = 10; i < faces.size(); i += 10)
+    {
+        IWinding winding = makeWinding(4 + i % 3, i);
+
+        checkFace(buffer, faces[i], winding);
+        numVertices += winding.size();
+    }
+
+    BOOST_CHECK_EQUAL(buffer.getNumFaces(), 99);
+    BOOST_CHECK_EQUAL(buffer.getVertices().size(), numVertices);
+}
@@ -0,0 +1,329 @@
+#define BOOST_TEST_MODULE parserTest
+#include <boost/test/included/unit_test.hpp>
+
+#include "parser/DefBlockTokeniser.h"
+#include "parser/CodeTokeniser.h"
+#include "radiant/vfs/Doom3FileSystem.h"
+#include "os/fs.h"
+
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using parser::BlockTokeniser;
+
+namespace
+{
+    typedef std::vector<BlockTokeniser::Block> Blocks;
+
+    // Tokenise the string through the contiguous fast path
+    Blocks tokeniseBuffer(const std::string& input)
+    {
+        Blocks blocks;
+        parser::BasicDefBlockTokeniser<std::string> tokeniser(input);
+
+        while (tokeniser.hasMoreBlocks())
+        {
+            blocks.push_back(tokeniser.nextBlock());
+        }
+
+        return blocks;
+    }
+
+    // Tokenise the string char by char, like the stream tokeniser used to
+    Blocks tokeniseCharByChar(const std::string& input)
+    {
+        std::istringstream stream(input);
+        stream >> std::noskipws;
+
+        typedef std::istream_iterator<char> CharStreamIterator;
+        string::Tokeniser<parser::DefBlockTokeniserFunc, CharStreamIterator, BlockTokeniser::Block>
+            tokeniser(CharStreamIterator(stream), CharStreamIterator(),
+                      parser::DefBlockTokeniserFunc(" \t\n\v\r", '{', '}'));
+
+        Blocks blocks;
+
+        for (auto i = tokeniser.getIterator(); !i.isExhausted(); ++i)
+        {
+            blocks.push_back(*i);
+        }
+
+        return blocks;
+    }
+
+    void checkIdenticalBlocks(const std::string& input)
+    {
+        Blocks expected = tokeniseCharByChar(input);
+        Blocks blocks = tokeniseBuffer(input);
+
+        BOOST_REQUIRE_MESSAGE(blocks.size() == expected.size(), "Block count differs for: " << input);
+
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            BOOST_REQUIRE_MESSAGE(blocks[i].name == expected[i].name &&
+                                  blocks[i].contents == expected[i].contents,
+                                  "Block " << i << " differs for: " << input);
+        }
+    }
+
+    std::string srcdir()
+    {
+        const char* envVal = getenv("srcdir");
+        if (envVal)
+            return std::string(envVal);
+        else
+            throw std::runtime_error("srcdir not set");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(tokeniseNestedBlocks)
+{
+    std::string input =
+        "// leading comment\n"
+        "textures/a\n"
+        "{\n"
+        "    diffusemap _white\n"
+        "    { blend add map \"{quoted}\" }\n"
+        "}\n"
+        "/* a { b } */ table sinTable { { 0, 1 } }\n"
+        "unterminated { {";
+
+    Blocks blocks = tokeniseBuffer(input);
+
+    BOOST_REQUIRE(blocks.size() == 3);
+
+    BOOST_TEST(blocks[0].name == "textures/a");
+    BOOST_TEST(blocks[0].contents ==
+               "\n    diffusemap _white\n    { blend add map \"{quoted}\" }\n");
+
+    BOOST_TEST(blocks[1].name == "table sinTable");
+    BOOST_TEST(blocks[1].contents == " { 0, 1 } ");
+
+    // Unterminated blocks run until the end of the input
+    BOOST_TEST(blocks[2].name == "unterminated");
+    BOOST_TEST(blocks[2].contents == " {");
+
+    checkIdenticalBlocks(input);
+}
+
+BOOST_AUTO_TEST_CASE(streamTokeniserMatchesCharByChar)
+{
+    std::ifstream file(srcdir() + "/test/data/vfs_root/materials/example.mtr");
+    BOOST_REQUIRE(file);
+
+    std::string input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    BOOST_REQUIRE(!input.empty());
+
+    std::istringstream stream(input);
+    parser::BasicDefBlockTokeniser<std::istream> tokeniser(stream);
+
+    Blocks expected = tokeniseCharByChar(input);
+    BOOST_TEST(!expected.empty());
+
+    for (const auto& block : expected)
+    {
+        BOOST_REQUIRE(tokeniser.hasMoreBlocks());
+
+        BlockTokeniser::Block streamed = tokeniser.nextBlock();
+        BOOST_TEST(streamed.name == block.name);
+        BOOST_TEST(streamed.contents == block.contents);
+    }
+
+    BOOST_TEST(!tokeniser.hasMoreBlocks());
+}
+
+BOOST_AUTO_TEST_CASE(fuzzBlockScanner)
+{
+    // Fragments with all characters of significance to the tokeniser
+    static const char* const FRAGMENTS[] = {
+        "{", "}", "{", "}", "/", "*", "//", "/*", "*/", "**/", "\"",
+        " ", " ", "\t", "\n", "\r\n", "\v",
+        "textures/a", "table", "b", "0.5", "map", "\\", nullptr,
+    };
+    static const std::size_t NUM_FRAGMENTS = sizeof(FRAGMENTS) / sizeof(FRAGMENTS[0]);
+
+    std::mt19937 random(4711);
+    std::uniform_int_distribution<std::size_t> fragment(0, NUM_FRAGMENTS - 1);
+    std::uniform_int_distribution<std::size_t> length(0, 200);
+
+    for (int i = 0; i < 5000; ++i)
+    {
+        std::string input;
+
+        for (std::size_t n = length(random); n > 0; --n)
+        {
+            std::size_t f = fragment(random);
+
+            // The null character needs to be appended explicitly
+            if (FRAGMENTS[f] == nullptr)
+            {
+                input += '\0';
+            }
+            else
+            {
+                input += FRAGMENTS[f];
+            }
+        }
+
+        checkIdenticalBlocks(input);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(tokeniseCodeFileWithMacros)
+{
+    std::istringstream stream(
+        "#define WIDTH 640\n"
+        "#define SET( a, b ) set a b ;\n"
+        "#define\n"
+        "windowDef Desktop { rect 0,0,WIDTH,480 SET(\"x\", 1) }\n");
+
+    auto file = parser::CodeFileTokens::Parse(stream, "guis/test.gui", parser::WHITESPACE, "{}(),;");
+
+    BOOST_TEST(file->name == "guis/test.gui");
+    BOOST_REQUIRE(file->tokens.size() == 21);
+    BOOST_TEST(file->tokens[0] == "#define WIDTH 640");
+    BOOST_TEST(file->tokens[3] == "windowDef");
+
+    // The valid #define statements are parsed along with the tokens
+    BOOST_REQUIRE(file->macros.size() == 2);
+
+    const parser::Macro& width = file->macros.at(0);
+    BOOST_TEST(width.name == "WIDTH");
+    BOOST_TEST(width.arguments.empty());
+    BOOST_TEST(width.tokens == std::list<std::string>{ "640" });
+
+    const parser::Macro& set = file->macros.at(1);
+    BOOST_TEST(set.name == "SET");
+    BOOST_TEST(set.arguments == (std::list<std::string>{ "a", "b" }));
+    BOOST_TEST(set.tokens == (std::list<std::string>{ "set", "a", "b", ";" }));
+}
+
+namespace
+{
+    // A VFS on a scratch directory holding the given GUI files
+    struct GuiFilesFixture
+    {
+        fs::path root;
+        vfs::Doom3FileSystem fileSystem;
+
+        GuiFilesFixture(const std::string& name) :
+            root(fs::temp_directory_path() / name)
+        {
+            fs::remove_all(root);
+            fs::create_directories(root / "guis");
+
+            vfs::SearchPaths searchPaths;
+            searchPaths.insertIfNotExists(root.string());
+
+            fileSystem.initialise(searchPaths, { "pk4" });
+        }
+
+        ~GuiFilesFixture()
+        {
+            fileSystem.shutdown();
+            fs::remove_all(root);
+        }
+
+        void writeFile(const std::string& path, const std::string& contents)
+        {
+            std::ofstream(fs::path(root / path).string()) << contents;
+        }
+
+        std::vector<std::string> tokenise(const std::string& path, parser::CodeFileCache& cache)
+        {
+            parser::CodeTokeniser tokeniser(fileSystem.openTextFile(path), parser::WHITESPACE, "{}(),;", &cache);
+            std::vector<std::string> tokens;
+
+            while (tokeniser.hasMoreTokens())
+            {
+                tokens.push_back(tokeniser.nextToken());
+            }
+
+            return tokens;
+        }
+    };
+}
+
+BOOST_AUTO_TEST_CASE(codeFileCacheRevalidatesFiles)
+{
+    GuiFilesFixture fixture("parserTest_codeFileCacheRevalidatesFiles");
+    fixture.writeFile("guis/common.guicode", "#define WIDTH 640\nrect 0,0,WIDTH,480\n");
+
+    parser::CodeFileCache cache(fixture.fileSystem);
+
+    auto file = cache.getFile("guis/common.guicode", parser::WHITESPACE, "{}(),;");
+    BOOST_REQUIRE(file);
+    BOOST_TEST(file->tokens.size() == 9);
+    BOOST_TEST(file->macros.size() == 1);
+
+    // Unchanged files are found in the cache
+    BOOST_TEST(cache.getFile("guis/common.guicode", parser::WHITESPACE, "{}(),;") == file);
+    BOOST_TEST(cache.getNumHits() == 1);
+    BOOST_TEST(cache.getNumMisses() == 1);
+
+    // Tokenising with other delimiters doesn't return the cached tokens
+    auto other = cache.getFile("guis/common.guicode", parser::WHITESPACE, "{}();");
+    BOOST_TEST(other != file);
+    BOOST_TEST(other->tokens.size() == 3);
+    BOOST_TEST(cache.getNumMisses() == 2);
+
+    // Changed files are tokenised again
+    fixture.writeFile("guis/common.guicode", "#define WIDTH 800\nrect 0,0,WIDTH,600 visible 1\n");
+
+    file = cache.getFile("guis/common.guicode", parser::WHITESPACE, "{}();");
+    BOOST_TEST(file->tokens.size() == 5);
+    BOOST_TEST(file->tokens.back() == "1");
+    BOOST_TEST(cache.getNumMisses() == 3);
+
+    // Missing files are reported as such
+    BOOST_TEST(!cache.getFile("guis/missing.guicode", parser::WHITESPACE, "{}();"));
+
+    cache.clear();
+    BOOST_TEST(cache.getNumHits() == 0);
+    BOOST_TEST(cache.getFile("guis/common.guicode", parser::WHITESPACE, "{}();") != file);
+    BOOST_TEST(cache.getNumMisses() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(replayIncludedTokens)
+{
+    GuiFilesFixture fixture("parserTest_replayIncludedTokens");
+    fixture.writeFile("guis/common.guicode",
+        "#define WIDTH 640\n"
+        "#define BUTTON windowDef Close { rect 0,0,WIDTH,32 }\n"
+        "windowDef Background { }\n");
+    fixture.writeFile("guis/a.gui",
+        "windowDef Desktop {\n"
+        "#include \"guis/common.guicode\"\n"
+        "BUTTON }\n");
+    fixture.writeFile("guis/b.gui",
+        "#include \"guis/common.guicode\"\n"
+        "rect 0,0,WIDTH,1\n");
+
+    parser::CodeFileCache cache(fixture.fileSystem);
+
+    // The included tokens are inserted in place, the macros defined there
+    // are expanded in the including file
+    std::vector<std::string> expected = {
+        "windowDef", "Desktop", "{",
+        "windowDef", "Background", "{", "}",
+        "windowDef", "Close", "{", "rect", "0", ",", "0", ",", "640", ",", "32", "}",
+        "}"
+    };
+
+    BOOST_TEST(fixture.tokenise("guis/a.gui", cache) == expected, boost::test_tools::per_element());
+    BOOST_TEST(cache.getNumMisses() == 1);
+
+    // Another file including the same code replays the cached tokens
+    expected = {
+        "windowDef", "Background", "{", "}",
+        "rect", "0", ",", "0", ",", "640", ",", "1"
+    };
+
+    BOOST_TEST(fixture.tokenise("guis/b.gui", cache) == expected, boost::test_tools::per_element());
+    BOOST_TEST(cache.getNumHits() == 1);
+    BOOST_TEST(cache.getNumMisses() == 1);
+
+    // Tokenising again yields the same tokens
+    BOOST_TEST(fixture.tokenise("guis/b.gui", cache) == expected, boost::test_tools::per_element());
+    BOOST_TEST(cache.getNumHits() == 2);
+}
@@ -0,0 +1,193 @@
+#define BOOST_TEST_MODULE renderQueueTest
+#include <boost/test/included/unit_test.hpp>
+
+#include "radiant/render/backend/OpenGLShaderPass.h"
+#include "irender.h"
+#include "math/Matrix4.h"
+
+#include <memory>
+#include <random>
+#include <set>
+
+using namespace render;
+
+namespace
+{
+    struct TestRenderable :
+        public OpenGLRenderable
+    {
+        void render(const RenderInfo& info) const override
+        {}
+    };
+
+    // The queue only compares the shaders, entities and transforms it is
+    // given, neither is dereferenced without rendering
+    struct Fixture
+    {
+        alignas(std::max_align_t) char shaderStorage[256];
+
+        std::vector<std::unique_ptr<OpenGLShaderPass>> passes;
+
+        char entityStorage[16];
+        std::vector<TestRenderable> renderables;
+        std::vector<Matrix4> transforms;
+
+        RenderQueue queue;
+
+        Fixture(std::size_t numPasses) :
+            renderables(4096),
+            transforms(64, Matrix4::getIdentity())
+        {
+            OpenGLShader& shader = *reinterpret_cast<OpenGLShader*>(shaderStorage);
+
+            for (std::size_t i = 0; i < numPasses; ++i)
+            {
+                passes.emplace_back(new OpenGLShaderPass(shader));
+                passes.back()->setSortIndex(i);
+            }
+        }
+
+        // Entity 0 stands for renderables without entity
+        const IRenderEntity* getEntity(std::size_t index)
+        {
+            return index == 0 ? nullptr : reinterpret_cast<const IRenderEntity*>(entityStorage + index);
+        }
+
+        std::size_t getRenderableIndex(const RenderQueue::Entry& entry)
+        {
+            return static_cast<const TestRenderable*>(entry.renderable) - renderables.data();
+        }
+    };
+
+    // Checks that the queue is ordered by pass, that the renderables without
+    // entity come first within each pass, that the ones of an entity are kept
+    // together and that the submission order is kept within these groups
+    void checkOrder(Fixture& fixture)
+    {
+        RenderQueue::const_iterator previous = fixture.queue.end();
+        std::set<const IRenderEntity*> finishedEntities;
+
+        for (RenderQueue::const_iterator i = fixture.queue.begin(); i != fixture.queue.end(); previous = i++)
+        {
+            if (previous == fixture.queue.end() || previous->pass != i->pass)
+            {
+                if (previous != fixture.queue.end())
+                {
+                    BOOST_TEST(previous->pass->getSortIndex() < i->pass->getSortIndex());
+                }
+
+                finishedEntities.clear();
+                continue;
+            }
+
+            if (previous->entity != i->entity)
+            {
+                BOOST_TEST(i->entity != nullptr);
+                BOOST_TEST(finishedEntities.insert(previous->entity).second);
+                BOOST_TEST(finishedEntities.count(i->entity) == 0);
+                continue;
+            }
+
+            BOOST_TEST(fixture.getRenderableIndex(*previous) < fixture.getRenderableIndex(*i));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sortByPassAndEntity)
+{
+    // More than 256 passes and enough entries to sort by several digits
+    Fixture fixture(300);
+
+    std::mt19937 random(11);
+    std::uniform_int_distribution<std::size_t> passDistribution(0, fixture.passes.size() - 1);
+    std::uniform_int_distribution<std::size_t> entityDistribution(0, 8);
+    std::uniform_int_distribution<std::size_t> transformDistribution(0, fixture.transforms.size() - 1);
+
+    for (std::size_t i = 0; i < fixture.renderables.size(); ++i)
+    {
+        fixture.queue.push(*fixture.passes[passDistribution(random)], fixture.renderables[i],
+                           fixture.transforms[transformDistribution(random)], nullptr,
+                           fixture.getEntity(entityDistribution(random)));
+    }
+
+    // The sort indices at the time of sorting are used
+    for (std::size_t i = 0; i < fixture.passes.size(); ++i)
+    {
+        fixture.passes[i]->setSortIndex(fixture.passes.size() - 1 - i);
+    }
+
+    fixture.queue.sort();
+
+    BOOST_TEST(std::distance(fixture.queue.begin(), fixture.queue.end()) == fixture.renderables.size());
+    BOOST_TEST(fixture.queue.begin()->pass == fixture.passes.back().get());
+
+    checkOrder(fixture);
+
+    // Every renderable is still there once
+    std::vector<bool> found(fixture.renderables.size(), false);
+
+    for (const RenderQueue::Entry& entry : fixture.queue)
+    {
+        BOOST_TEST(!found[fixture.getRenderableIndex(entry)]);
+        found[fixture.getRenderableIndex(entry)] = true;
+    }
+
+    fixture.queue.clear();
+    BOOST_TEST(fixture.queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(groupRenderablesSharingTransforms)
+{
+    Fixture fixture(1);
+    OpenGLShaderPass& pass = *fixture.passes.front();
+
+    // Alternating transforms are not reordered, they're kept in submission order
+    fixture.queue.push(pass, fixture.renderables[0], fixture.transforms[0], nullptr, nullptr);
+    fixture.queue.push(pass, fixture.renderables[1], fixture.transforms[0], nullptr, nullptr);
+    fixture.queue.push(pass, fixture.renderables[2], fixture.transforms[1], nullptr, nullptr);
+    fixture.queue.push(pass, fixture.renderables[3], fixture.transforms[0], nullptr, nullptr);
+
+    fixture.queue.sort();
+
+    std::vector<std::size_t> order;
+
+    for (const RenderQueue::Entry& entry : fixture.queue)
+    {
+        order.push_back(fixture.getRenderableIndex(entry));
+    }
+
+    BOOST_TEST(order == std::vector<std::size_t>({ 0, 1, 2, 3 }));
+    BOOST_TEST(fixture.queue.getStatistics().stateChanges == 2);
+}
+
+BOOST_AUTO_TEST_CASE(removePasses)
+{
+    Fixture fixture(3);
+
+    for (std::size_t i = 0; i < 30; ++i)
+    {
+        fixture.queue.push(*fixture.passes[i % 3], fixture.renderables[i], fixture.transforms[0],
+                           nullptr, fixture.getEntity(i % 4));
+    }
+
+    fixture.queue.remove(*fixture.passes[1]);
+
+    // Removed passes are sorted last, if they're still in the queue
+    fixture.passes[0]->setSortIndex(OpenGLShaderPass::NO_SORT_INDEX);
+
+    fixture.queue.sort();
+
+    BOOST_TEST(std::distance(fixture.queue.begin(), fixture.queue.end()) == 20);
+
+    for (RenderQueue::const_iterator i = fixture.queue.begin(); i != fixture.queue.end(); ++i)
+    {
+        BOOST_TEST((i->pass == fixture.passes[i - fixture.queue.begin() < 10 ? 2 : 0].get()));
+    }
+
+    checkOrder(fixture);
+
+    fixture.queue.remove(*fixture.passes[0]);
+    fixture.queue.remove(*fixture.passes[2]);
+
+    BOOST_TEST(fixture.queue.empty());
+}
@@ -5,6 +5,31 @@
 
 #include "radiant/shaders/ShaderFileLoader.h"
 #include "radiant/shaders/textures/GLTextureManager.h"
+#include "radiant/shaders/textures/ImageKernels.h"
+#include "radiant/shaders/textures/TextureDecoder.h"
+#include "radiant/shaders/textures/TextureResidency.h"
+#include "radiant/shaders/MapExpressionCache.h"
+#include "radiant/shaders/MaterialPreParser.h"
+#include "radiant/shaders/Doom3ShaderSystem.h"
+#include "radiant/shaders/ThumbnailCache.h"
+#include "radiant/shaders/ShaderExpression.h"
+#include "radiant/image/DDSImage.h"
+#include "radiant/decl/DeclLoadScheduler.h"
+#include "radiant/decl/DeclCache.h"
+#include "radiant/decl/DeclName.h"
+#include "radiant/decl/DeclFileIndex.h"
+#include "os/fs.h"
+#include "RGBAImage.h"
+#include "math/FloatTools.h"
+#include "math/Vector3.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <future>
+#include <random>
+
+#include <thread>
 
 namespace shaders
 {
@@ -17,6 +42,18 @@ GLTextureManager& GetTextureManager()
     return manager;
 }
 
+// The materials parsed by the tests don't use any tables, the application
+// version of the shader system isn't needed
+Doom3ShaderSystemPtr GetShaderSystem()
+{
+    return Doom3ShaderSystemPtr();
+}
+
+TableDefinitionPtr Doom3ShaderSystem::getTableForName(const std::string& name)
+{
+    return TableDefinitionPtr();
+}
+
 }
 
 using namespace shaders;
@@ -27,25 +64,32 @@ struct MockShaderLibrary
     // Shaders found
     std::map<std::string, ShaderDefinition> shaderDefs;
 
+    // Names of the tables and shaders (with their files) in insertion order
+    std::vector<std::string> insertions;
+
     // Required methods for ShaderFileLoader
     bool addTableDefinition(const TableDefinitionPtr& def)
-    { return true; }
+    {
+        insertions.push_back("table " + def->getName());
+        return true;
+    }
 
     bool addDefinition(const std::string& name, const ShaderDefinition& def)
     {
-        shaderDefs.insert(std::make_pair(name, def));
-        return true;
+        insertions.push_back(name + " in " + def.file.fullPath());
+        return shaderDefs.insert(std::make_pair(name, def)).second;
     }
 };
 
 void parseShadersFromPath(vfs::Doom3FileSystem& fs, const std::string& path,
-                          MockShaderLibrary& library)
+                          MockShaderLibrary& library,
+                          FileParseMode mode = FileParseMode::Parallel)
 {
     // Walk the filesystem and load .mtr files
     ShaderFileLoader<MockShaderLibrary> loader(fs, library, path);
 
     // Instruct the loader to parse MTR files and create ShaderDefinitions
-    loader.parseFiles();
+    loader.parseFiles(mode);
 }
 
 BOOST_FIXTURE_TEST_CASE(loadShaderFiles, VFSFixture)
@@ -102,3 +146,1535 @@ BOOST_FIXTURE_TEST_CASE(loadShaderFiles, VFSFixture)
     BOOST_TEST(hiddenTex2.file.name == "hidden.mtr");
     BOOST_TEST(hiddenTex2.file.visibility == vfs::Visibility::HIDDEN);
 }
+
+BOOST_FIXTURE_TEST_CASE(parallelParsingMatchesSequential, VFSFixture)
+{
+    MockShaderLibrary sequential;
+    parseShadersFromPath(fs, "materials/", sequential, FileParseMode::Sequential);
+
+    MockShaderLibrary parallel;
+    parseShadersFromPath(fs, "materials/", parallel, FileParseMode::Parallel);
+
+    // The library must see the same declarations in the same order
+    BOOST_TEST(!sequential.insertions.empty());
+    BOOST_TEST(parallel.insertions == sequential.insertions, boost::test_tools::per_element());
+
+    BOOST_REQUIRE(parallel.shaderDefs.size() == sequential.shaderDefs.size());
+
+    for (const auto& pair : sequential.shaderDefs)
+    {
+        auto found = parallel.shaderDefs.find(pair.first);
+        BOOST_REQUIRE(found != parallel.shaderDefs.end());
+
+        BOOST_TEST((found->second.file == pair.second.file));
+        BOOST_TEST(found->second.shaderTemplate->getBlockContents() ==
+                   pair.second.shaderTemplate->getBlockContents());
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(parseFilesOnDeclLoadScheduler, VFSFixture)
+{
+    MockShaderLibrary sequential;
+    parseShadersFromPath(fs, "materials/", sequential, FileParseMode::Sequential);
+
+    decl::DeclLoadScheduler scheduler(2);
+
+    MockShaderLibrary library;
+    ShaderFileLoader<MockShaderLibrary> loader(fs, library, "materials/");
+    loader.setSubTaskRunner(std::bind(&decl::DeclLoadScheduler::runSubTasks,
+                                      &scheduler, std::placeholders::_1));
+
+    // Parse from within a job, like the shader system does
+    auto job = scheduler.schedule("Materials", [&]() { loader.parseFiles(); },
+                                  {}, decl::LoadPriority::High);
+    job->wait();
+
+    BOOST_TEST(job->isFinished());
+    BOOST_TEST(library.insertions == sequential.insertions, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(declLoadSchedulerOrdersJobs)
+{
+    decl::DeclLoadScheduler scheduler(1);
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+
+    auto record = [&](const std::string& name)
+    {
+        return [&, name]()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(name);
+        };
+    };
+
+    // Keep the only worker busy until we're done scheduling
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    scheduler.schedule("Blocker", [released]() { released.wait(); }, {}, decl::LoadPriority::Normal);
+
+    // Guis depend on Materials, which have a lower priority than Skins
+    scheduler.schedule("Guis", record("Guis"), { "Materials" }, decl::LoadPriority::High);
+    scheduler.schedule("Materials", record("Materials"), {}, decl::LoadPriority::Normal);
+    scheduler.schedule("Skins", record("Skins"), {}, decl::LoadPriority::High);
+
+    // Waiting for a queued job runs it on the calling thread
+    std::thread::id runningThread;
+    auto sounds = scheduler.schedule("Sounds", [&]() { runningThread = std::this_thread::get_id(); },
+                                     {}, decl::LoadPriority::Low);
+    sounds->wait();
+    BOOST_TEST((runningThread == std::this_thread::get_id()));
+
+    release.set_value();
+    scheduler.stop();
+
+    std::vector<std::string> expected = { "Skins", "Materials", "Guis" };
+    BOOST_TEST(order == expected, boost::test_tools::per_element());
+}
+
+BOOST_FIXTURE_TEST_CASE(parseFilesThroughDeclCache, VFSFixture)
+{
+    fs::path cacheFile = fs::temp_directory_path() / "shadersTest_declcache.bin";
+    fs::remove(cacheFile);
+
+    MockShaderLibrary uncached;
+    parseShadersFromPath(fs, "materials/", uncached, FileParseMode::Sequential);
+
+    std::size_t numFiles = 0;
+    fs.forEachFile("materials/", "mtr", [&](const vfs::FileInfo&) { ++numFiles; }, 0);
+
+    // The first run tokenises every file
+    {
+        decl::DeclCache cache(fs, cacheFile.string());
+        BOOST_TEST(!cache.load());
+
+        MockShaderLibrary library;
+        ShaderFileLoader<MockShaderLibrary> loader(fs, library, "materials/");
+        loader.setDeclCache(&cache);
+        loader.parseFiles(FileParseMode::Sequential);
+
+        BOOST_TEST(library.insertions == uncached.insertions, boost::test_tools::per_element());
+        BOOST_TEST(cache.getStatistics().hits == 0);
+        BOOST_TEST(cache.getStatistics().misses == numFiles);
+
+        cache.save();
+    }
+
+    // The next session gets all of them from the cache file
+    {
+        decl::DeclCache cache(fs, cacheFile.string());
+        BOOST_TEST(cache.load());
+
+        MockShaderLibrary library;
+        ShaderFileLoader<MockShaderLibrary> loader(fs, library, "materials/");
+        loader.setDeclCache(&cache);
+        loader.parseFiles(FileParseMode::Parallel);
+
+        BOOST_TEST(library.insertions == uncached.insertions, boost::test_tools::per_element());
+        BOOST_TEST(cache.getStatistics().hits == numFiles);
+        BOOST_TEST(cache.getStatistics().misses == 0);
+
+        // Invalidating removes the cache file
+        cache.invalidate();
+        BOOST_TEST(!fs::exists(cacheFile));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(declCacheDetectsChangedFiles)
+{
+    // Set up a VFS on a scratch directory
+    fs::path root = fs::temp_directory_path() / "shadersTest_declCacheDetectsChangedFiles";
+    fs::path cacheFile = root / "declcache.bin";
+    fs::remove_all(root);
+    fs::create_directories(root / "materials");
+
+    std::ofstream(fs::path(root / "materials" / "a.mtr").string()) << "a { }";
+    std::ofstream(fs::path(root / "materials" / "b.mtr").string()) << "b { }";
+
+    vfs::SearchPaths searchPaths;
+    searchPaths.insertIfNotExists(root.string());
+
+    vfs::Doom3FileSystem fileSystem;
+    fileSystem.initialise(searchPaths, { "pk4" });
+
+    {
+        decl::DeclCache cache(fileSystem, cacheFile.string());
+        cache.getFile("materials/a.mtr", decl::DeclFileContents::Blocks);
+        cache.getFile("materials/b.mtr", decl::DeclFileContents::Blocks);
+        cache.save();
+    }
+
+    // Change the size of one of the files
+    std::ofstream(fs::path(root / "materials" / "b.mtr").string()) << "b { diffusemap _white }";
+
+    decl::DeclCache cache(fileSystem, cacheFile.string());
+    BOOST_TEST(cache.load());
+
+    auto a = cache.getFile("materials/a.mtr", decl::DeclFileContents::Blocks);
+    auto b = cache.getFile("materials/b.mtr", decl::DeclFileContents::Blocks);
+
+    BOOST_TEST(cache.getStatistics().hits == 1);
+    BOOST_TEST(cache.getStatistics().misses == 1);
+
+    BOOST_REQUIRE(b->blocks.size() == 1);
+    BOOST_TEST(b->blocks[0].name == "b");
+    BOOST_TEST(b->blocks[0].contents.find("diffusemap") != std::string::npos);
+
+    // Token lists are cached separately from the blocks
+    auto tokens = cache.getFile("materials/a.mtr", decl::DeclFileContents::Tokens);
+    std::vector<std::string> expected = { "a", "{", "}" };
+    BOOST_TEST(tokens->tokens == expected, boost::test_tools::per_element());
+    BOOST_TEST(cache.getStatistics().misses == 2);
+
+    // Missing files are reported as such
+    BOOST_TEST(!cache.getFile("materials/c.mtr", decl::DeclFileContents::Blocks));
+
+    cache.save();
+
+    {
+        // Truncated files are rejected
+        std::ifstream input(cacheFile.string(), std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        input.close();
+
+        std::ofstream(cacheFile.string(), std::ios::binary).write(contents.data(), contents.size() - 3);
+
+        decl::DeclCache truncated(fileSystem, cacheFile.string());
+        BOOST_TEST(!truncated.load());
+    }
+
+    {
+        // So are strings and counts larger than the rest of the file
+        std::ofstream stream(cacheFile.string(), std::ios::binary);
+        stream.write("DRDC", 4);
+        std::uint32_t version = 1;
+        stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        std::uint64_t numEntries = 1;
+        stream.write(reinterpret_cast<const char*>(&numEntries), sizeof(numEntries));
+        std::uint32_t length = 0xfffffff0;
+        stream.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        stream.write(std::string(40, 'a').data(), 40);
+    }
+
+    {
+        decl::DeclCache corrupt(fileSystem, cacheFile.string());
+        BOOST_TEST(!corrupt.load());
+    }
+
+    {
+        std::ofstream stream(cacheFile.string(), std::ios::binary);
+        stream.write("DRDC", 4);
+        std::uint32_t version = 1;
+        stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        std::uint64_t numEntries = 0xffffffffffff;
+        stream.write(reinterpret_cast<const char*>(&numEntries), sizeof(numEntries));
+    }
+
+    {
+        decl::DeclCache corrupt(fileSystem, cacheFile.string());
+        BOOST_TEST(!corrupt.load());
+
+        // The broken file is replaced by a new one
+        corrupt.getFile("materials/a.mtr", decl::DeclFileContents::Blocks);
+        corrupt.save();
+    }
+
+    decl::DeclCache reloaded(fileSystem, cacheFile.string());
+    BOOST_TEST(reloaded.load());
+    BOOST_TEST(reloaded.getFile("materials/a.mtr", decl::DeclFileContents::Blocks));
+    BOOST_TEST(reloaded.getStatistics().hits == 1);
+
+    fileSystem.shutdown();
+    fs::remove_all(root);
+}
+
+BOOST_AUTO_TEST_CASE(internDeclNames)
+{
+    decl::DeclName name("textures/Common/Caulk");
+
+    // All spellings share the same handle
+    BOOST_TEST((decl::DeclName("TEXTURES/common/caulk") == name));
+    BOOST_TEST((decl::DeclName::Find("textures/common/CAULK") == name));
+    BOOST_TEST(name.str() == "textures/common/caulk");
+    BOOST_TEST(name.getHash() == std::hash<decl::DeclName>()(decl::DeclName("textures/common/caulk")));
+
+    BOOST_TEST((decl::DeclName("textures/common/nodraw") != name));
+
+    // Lookups don't intern unknown names
+    std::size_t numNames = decl::DeclNameTable::Instance().size();
+    BOOST_TEST(decl::DeclName::Find("textures/never/interned").empty());
+    BOOST_TEST(decl::DeclNameTable::Instance().size() == numNames);
+
+    // Interning from several threads yields a single entry per name
+    std::vector<std::thread> threads;
+    std::vector<std::vector<decl::DeclName>> results(4);
+
+    for (std::size_t t = 0; t < results.size(); ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (int i = 0; i < 1000; ++i)
+            {
+                results[t].emplace_back(t % 2 == 0 ? "atdm:Name_" + std::to_string(i) : "ATDM:name_" + std::to_string(i));
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (std::size_t t = 1; t < results.size(); ++t)
+    {
+        BOOST_TEST((results[t] == results[0]));
+    }
+
+    BOOST_TEST(decl::DeclNameTable::Instance().size() == numNames + 1000);
+
+    // Interned strings keep their case, and are not added to the names
+    std::shared_ptr<std::string> spawnclass = decl::DeclNameTable::Instance().internString("spawnclass");
+    std::shared_ptr<std::string> spawnClass = decl::DeclNameTable::Instance().internString("spawnClass");
+
+    BOOST_TEST(*spawnClass == "spawnClass");
+    BOOST_TEST(spawnclass != spawnClass);
+    BOOST_TEST(decl::DeclNameTable::Instance().internString("spawnclass") == spawnclass);
+    BOOST_TEST(decl::DeclNameTable::Instance().internString("") == decl::DeclNameTable::Instance().internString(""));
+
+    BOOST_TEST(decl::DeclName::Find("spawnclass").empty());
+    BOOST_TEST(decl::DeclName::Find("").empty());
+    BOOST_TEST(decl::DeclNameTable::Instance().size() == numNames + 1000);
+}
+
+BOOST_AUTO_TEST_CASE(declFileIndexFindsChangedFiles)
+{
+    fs::path root = fs::temp_directory_path() / "shadersTest_declFileIndexFindsChangedFiles";
+    fs::path materials = root / "materials";
+    fs::remove_all(root);
+    fs::create_directories(materials);
+
+    std::ofstream(fs::path(materials / "a.mtr").string()) << "a { }";
+    std::ofstream(fs::path(materials / "b.mtr").string()) << "b { }";
+    std::ofstream(fs::path(materials / "c.mtr").string()) << "c { }";
+
+    vfs::SearchPaths searchPaths;
+    searchPaths.insertIfNotExists(root.string());
+
+    vfs::Doom3FileSystem fileSystem;
+    fileSystem.initialise(searchPaths, { "pk4" });
+
+    decl::DeclFileIndex index;
+    index.reset(fileSystem, "materials/", "mtr");
+
+    BOOST_TEST(index.findChangedFiles(fileSystem).empty());
+
+    // Modify, remove and add a file, touch another one
+    std::ofstream(fs::path(materials / "b.mtr").string()) << "b { diffusemap _white }";
+    fs::remove(materials / "c.mtr");
+    std::ofstream(fs::path(materials / "d.mtr").string()) << "d { }";
+
+    auto touch = [&](const std::string& filename)
+    {
+        fs::path path = materials / filename;
+        fs::last_write_time(path, fs::last_write_time(path) + std::chrono::seconds(10));
+    };
+
+    touch("a.mtr");
+
+    // The contents of a.mtr were unknown so far, it needs to be reported once
+    std::set<std::string> expected = { "materials/a.mtr", "materials/b.mtr",
+                                       "materials/c.mtr", "materials/d.mtr" };
+    BOOST_TEST(index.findChangedFiles(fileSystem) == expected, boost::test_tools::per_element());
+    BOOST_TEST(index.findChangedFiles(fileSystem).empty());
+
+    // Touching files without changing them goes unnoticed now
+    touch("a.mtr");
+    touch("b.mtr");
+    BOOST_TEST(index.findChangedFiles(fileSystem).empty());
+
+    // Files reloaded by other means are not reported again
+    std::ofstream(fs::path(materials / "a.mtr").string()) << "a { diffusemap _black }";
+    index.update(fileSystem, { "materials/a.mtr" });
+    BOOST_TEST(index.findChangedFiles(fileSystem).empty());
+
+    fileSystem.shutdown();
+    fs::remove_all(root);
+}
+
+BOOST_AUTO_TEST_CASE(mapExpressionCacheSharesImages)
+{
+    // Room for four 2x2 RGBA images
+    MapExpressionCache cache(64);
+
+    std::atomic<int> numCreated(0);
+
+    auto create = [&]() -> ImagePtr
+    {
+        ++numCreated;
+        return std::make_shared<RGBAImage>(2, 2);
+    };
+
+    ImagePtr a = cache.get("a", create);
+    BOOST_TEST(cache.get("a", create) == a);
+    BOOST_TEST(numCreated == 1);
+
+    cache.get("b", create);
+    cache.get("c", create);
+    cache.get("d", create);
+    BOOST_TEST(numCreated == 4);
+
+    // "b" is the least recently used image now and has to make room
+    cache.get("a", create);
+    cache.get("e", create);
+    BOOST_TEST(numCreated == 5);
+    BOOST_TEST(cache.getStatistics().evictions == 1);
+
+    cache.get("a", create);
+    BOOST_TEST(numCreated == 5);
+    cache.get("b", create);
+    BOOST_TEST(numCreated == 6);
+
+    // Failures are passed on, but not cached
+    auto fail = []() -> ImagePtr { throw std::runtime_error("failed"); };
+    BOOST_CHECK_THROW(cache.get("f", fail), std::runtime_error);
+    cache.get("f", create);
+    BOOST_TEST(numCreated == 7);
+
+    // Threads requesting the same image at once wait for the first one
+    cache.clear();
+    numCreated = 0;
+
+    auto createSlowly = [&]() -> ImagePtr
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return create();
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<ImagePtr> images(8);
+
+    for (std::size_t i = 0; i < images.size(); ++i)
+    {
+        threads.emplace_back([&, i]() { images[i] = cache.get("x", createSlowly); });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    BOOST_TEST(numCreated == 1);
+    BOOST_TEST(std::count(images.begin(), images.end(), images[0]) == 8);
+
+    MapExpressionCache::Statistics statistics = cache.getStatistics();
+    BOOST_TEST(statistics.numImages == 1);
+    BOOST_TEST(statistics.size == 16);
+}
+
+BOOST_AUTO_TEST_CASE(textureResidencyEvictsLeastRecentlyUsed)
+{
+    shaders::TextureResidency residency(300);
+
+    residency.insert(1, 100);
+    residency.insert(2, 100);
+    residency.insert(3, 100);
+    residency.insert(4, 100);
+
+    // Textures used in the current frame are kept, even above the budget
+    BOOST_TEST(residency.collectEvictions().empty());
+    BOOST_TEST(residency.getStatistics().size == 400);
+
+    // Texture 1 is the least recently used one after this frame
+    residency.markUsed(3);
+    residency.markUsed(2);
+    residency.markUsed(4);
+    std::vector<GLuint> evicted = residency.collectEvictions();
+    BOOST_TEST(evicted == std::vector<GLuint>{ 1 }, boost::test_tools::per_element());
+
+    // Frames without any used texture don't count
+    BOOST_TEST(residency.collectEvictions().empty());
+
+    // 3 was used before 2 and 4, it goes first
+    residency.insert(5, 150);
+    evicted = residency.collectEvictions();
+    BOOST_TEST(evicted == std::vector<GLuint>({ 3, 2 }), boost::test_tools::per_element());
+
+    shaders::TextureResidency::Statistics statistics = residency.getStatistics();
+    BOOST_TEST(statistics.numTextures == 2);
+    BOOST_TEST(statistics.size == 250);
+    BOOST_TEST(statistics.peakSize == 450);
+    BOOST_TEST(statistics.evictions == 3);
+
+    // Evicted textures are reported once when they're used again
+    BOOST_TEST(residency.markUsed(1));
+    BOOST_TEST(!residency.markUsed(1));
+    BOOST_TEST(!residency.markUsed(4));
+    BOOST_TEST(!residency.markUsed(42));
+    BOOST_TEST(residency.getStatistics().reloads == 1);
+
+    // Removed textures are forgotten, evicted or not
+    residency.remove(2);
+    residency.remove(4);
+    BOOST_TEST(!residency.markUsed(2));
+    BOOST_TEST(residency.getStatistics().size == 150);
+
+    // Without a budget nothing is evicted
+    residency.setBudget(0);
+    residency.insert(6, 1000);
+    residency.collectEvictions();
+    residency.markUsed(6);
+    BOOST_TEST(residency.collectEvictions().empty());
+
+    // Mipmaps add a third to uncompressed images
+    BOOST_TEST(shaders::TextureResidency::GetTextureSize(RGBAImage(16, 16)) == 16 * 16 * 4 * 4 / 3);
+}
+
+namespace
+{
+
+// Creates an image of the given size once the gate is opened, recording the
+// bitmaps path and the thread it has been evaluated with
+class TestMapExpression :
+    public MapExpression
+{
+    std::string _name;
+    std::size_t _size;
+    std::shared_future<void> _gate;
+
+public:
+    mutable std::string bitmapsPath;
+    mutable std::thread::id thread;
+
+    TestMapExpression(const std::string& name, std::size_t size, const std::shared_future<void>& gate) :
+        _name(name),
+        _size(size),
+        _gate(gate)
+    {}
+
+    std::string getIdentifier() const override
+    {
+        return _name;
+    }
+
+    void collectImageNames(std::set<std::string>& names) const override
+    {}
+
+protected:
+    ImagePtr createImage(const std::string& path) const override
+    {
+        _gate.wait();
+
+        bitmapsPath = path;
+        thread = std::this_thread::get_id();
+
+        return std::make_shared<RGBAImage>(_size, _size);
+    }
+};
+
+// Returns true once the condition is met, false if it takes longer than 5 seconds
+bool waitUntil(const std::function<bool()>& condition)
+{
+    for (int i = 0; i < 500 && !condition(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return condition();
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(textureDecoderDecodesInBackground)
+{
+    // Two workers claim eight textures at once
+    decl::DeclLoadScheduler scheduler(2);
+
+    TextureDecoder decoder;
+    decoder.setScheduler(scheduler);
+    decoder.setBitmapsPath("bitmaps/");
+
+    std::atomic<int> numDecoded(0);
+    decoder.setImageDecodedCallback([&]() { ++numDecoded; });
+
+    // The first texture keeps the first batch from finishing until released
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+
+    std::promise<void> open;
+    open.set_value();
+    std::shared_future<void> opened = open.get_future().share();
+
+    std::vector<std::shared_ptr<TestMapExpression>> expressions;
+    std::vector<DeferredTexturePtr> textures;
+
+    for (std::size_t i = 0; i < 20; ++i)
+    {
+        expressions.push_back(std::make_shared<TestMapExpression>(
+            "textureDecoderTest/" + std::to_string(i), i + 1, i == 0 ? released : opened));
+
+        // Texture number 0 keeps the texture from making GL calls
+        textures.push_back(std::make_shared<DeferredTexture>(GetTextureManager(), 0,
+            expressions.back()->getIdentifier(), expressions.back()));
+
+        decoder.queue(textures.back());
+    }
+
+    BOOST_TEST(waitUntil([&]() { return numDecoded == 7; }));
+
+    // Textures which haven't been claimed are decoded right away by the waiting thread
+    ImagePtr image = decoder.waitForImage(*textures[19]);
+    BOOST_TEST(image);
+    BOOST_TEST(image->getWidth(0) == 20);
+    BOOST_TEST((expressions[19]->thread == std::this_thread::get_id()));
+
+    // The decoded textures are handed out for uploading, the other ones are
+    // decoded on the workers
+    std::set<std::size_t> uploaded;
+
+    while (DeferredTexturePtr texture = decoder.takeDecodedTexture(image))
+    {
+        std::size_t index = std::find(textures.begin(), textures.end(), texture) - textures.begin();
+
+        BOOST_TEST(uploaded.insert(index).second);
+        BOOST_TEST(image->getWidth(0) == index + 1);
+
+        if (index != 19)
+        {
+            BOOST_TEST((expressions[index]->thread != std::this_thread::get_id()));
+        }
+    }
+
+    BOOST_TEST(uploaded.size() == 8);
+    BOOST_TEST(uploaded.count(0) == 0);
+    BOOST_TEST(!decoder.hasDecodedTextures());
+
+    // Cancelling waits for the running batch and drops the queued textures
+    std::thread releaser([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        release.set_value();
+    });
+
+    decoder.cancel();
+    releaser.join();
+
+    BOOST_TEST(numDecoded == 9);
+    BOOST_TEST(decoder.takeDecodedTexture(image) == textures[0]);
+    BOOST_TEST(!decoder.hasDecodedTextures());
+
+    // The dropped textures are decoded once they're needed, and still uploaded
+    for (std::size_t i = 8; i < 19; ++i)
+    {
+        BOOST_TEST(decoder.waitForImage(*textures[i]));
+    }
+
+    for (std::size_t i = 8; i < 19; ++i)
+    {
+        BOOST_TEST(decoder.takeDecodedTexture(image) == textures[i]);
+    }
+
+    // All of them have been evaluated with the path set on the main thread
+    for (const auto& expression : expressions)
+    {
+        BOOST_TEST(expression->bitmapsPath == "bitmaps/");
+    }
+
+    // Evicted textures are decoded again when queued
+    decoder.setEvicted(*textures[3]);
+    BOOST_TEST(decoder.isEvicted(*textures[3]));
+
+    decoder.queue(textures[3]);
+    BOOST_TEST(!decoder.isEvicted(*textures[3]));
+
+    BOOST_TEST(waitUntil([&]() { return decoder.hasDecodedTextures(); }));
+    BOOST_TEST(decoder.takeDecodedTexture(image) == textures[3]);
+    BOOST_TEST(image->getWidth(0) == 4);
+
+    decoder.setImageDecodedCallback(std::function<void()>());
+}
+
+namespace
+{
+
+std::vector<ShaderTemplatePtr> createShaderTemplates(const std::string& prefix, std::size_t count)
+{
+    std::vector<ShaderTemplatePtr> templates;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::string name = prefix + std::to_string(i);
+
+        templates.push_back(std::make_shared<ShaderTemplate>(name,
+            "description \"" + name + "\" qer_editorimage " + name + "_ed"));
+    }
+
+    return templates;
+}
+
+std::size_t getNumParsed()
+{
+    ShaderTemplate::ParseStatistics statistics = ShaderTemplate::getParseStatistics();
+    return statistics.preParsed + statistics.onDemand;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(materialPreParserParsesInBackground)
+{
+    decl::DeclLoadScheduler scheduler(1);
+    MaterialPreParser preParser(scheduler);
+
+    ShaderTemplate::setMainThread(std::this_thread::get_id());
+
+    ShaderTemplate::ParseStatistics before = ShaderTemplate::getParseStatistics();
+
+    // Keep the only worker busy until the first template has been accessed
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    scheduler.schedule("Blocker", [released]() { released.wait(); }, {}, decl::LoadPriority::Normal);
+
+    std::vector<ShaderTemplatePtr> templates = createShaderTemplates("preParserTest/", 10);
+    preParser.start(templates);
+
+    // Templates which haven't been parsed yet are parsed by the accessing thread
+    BOOST_TEST(templates[3]->getDescription() == "preParserTest/3");
+    BOOST_TEST(ShaderTemplate::getParseStatistics().onDemandMainThread == before.onDemandMainThread + 1);
+
+    release.set_value();
+
+    BOOST_TEST(waitUntil([&]() { return ShaderTemplate::getParseStatistics().preParsed == before.preParsed + 9; }));
+
+    for (std::size_t i = 0; i < templates.size(); ++i)
+    {
+        BOOST_TEST(templates[i]->getDescription() == "preParserTest/" + std::to_string(i));
+        BOOST_TEST(templates[i]->getEditorTexture()->getIdentifier() == "preParserTest/" + std::to_string(i) + "_ed");
+    }
+
+    BOOST_TEST(ShaderTemplate::getParseStatistics().onDemand == before.onDemand + 1);
+
+    // Prioritising templates after the pass is done starts a new one
+    std::vector<ShaderTemplatePtr> added = createShaderTemplates("preParserTest/added", 3);
+    preParser.prioritise(added);
+
+    BOOST_TEST(waitUntil([&]() { return ShaderTemplate::getParseStatistics().preParsed == before.preParsed + 12; }));
+
+    // Templates accessed while the workers are parsing are parsed exactly once
+    std::size_t numParsed = getNumParsed();
+
+    std::vector<ShaderTemplatePtr> concurrent = createShaderTemplates("preParserTest/concurrent", 500);
+    preParser.start(concurrent);
+
+    for (auto i = concurrent.rbegin(); i != concurrent.rend(); ++i)
+    {
+        BOOST_TEST((*i)->getDescription() == (*i)->getName());
+    }
+
+    BOOST_TEST(waitUntil([&]() { return getNumParsed() == numParsed + concurrent.size(); }));
+
+    preParser.cancel();
+    BOOST_TEST(getNumParsed() == numParsed + concurrent.size());
+
+    // Cancelling waits for the scheduled pass, which stops right away
+    std::promise<void> releaseAgain;
+    std::shared_future<void> releasedAgain = releaseAgain.get_future().share();
+    scheduler.schedule("Blocker", [releasedAgain]() { releasedAgain.wait(); }, {}, decl::LoadPriority::Normal);
+
+    std::vector<ShaderTemplatePtr> cancelled = createShaderTemplates("preParserTest/cancelled", 10);
+    preParser.start(cancelled);
+
+    std::thread releaser([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        releaseAgain.set_value();
+    });
+
+    numParsed = getNumParsed();
+
+    preParser.cancel();
+    releaser.join();
+
+    BOOST_TEST(getNumParsed() == numParsed);
+
+    // A cancelled parser ignores prioritised templates until started again
+    preParser.prioritise(cancelled);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_TEST(getNumParsed() == numParsed);
+
+    // The dropped templates are still parsed on demand
+    BOOST_TEST(cancelled[5]->getDescription() == "preParserTest/cancelled5");
+    BOOST_TEST(getNumParsed() == numParsed + 1);
+}
+
+BOOST_AUTO_TEST_CASE(thumbnailCacheStoresThumbnails)
+{
+    fs::path cacheFile = fs::temp_directory_path() / "shadersTest_thumbnails.bin";
+    fs::remove(cacheFile);
+
+    int numCreated = 0;
+
+    auto create = [&](std::size_t width, std::size_t height, byte value)
+    {
+        return [&numCreated, width, height, value]() -> ImagePtr
+        {
+            ++numCreated;
+
+            RGBAImagePtr image = std::make_shared<RGBAImage>(width, height);
+            std::fill_n(image->getMipMapPixels(0), width * height * 4, value);
+            return image;
+        };
+    };
+
+    auto isFilledWith = [](const ImagePtr& image, byte value)
+    {
+        const byte* pixels = image->getMipMapPixels(0);
+        std::size_t size = image->getWidth(0) * image->getHeight(0) * 4;
+
+        return std::all_of(pixels, pixels + size, [&](byte b) { return b == value; });
+    };
+
+    {
+        shaders::ThumbnailCache cache(cacheFile.string(), 8);
+        BOOST_TEST(!cache.load());
+
+        std::size_t width = 0, height = 0;
+        BOOST_TEST(!cache.getSize("a", 1, width, height));
+
+        cache.get("a", 1, create(8, 4, 10));
+        cache.get("b", 1, create(8, 8, 20));
+        BOOST_TEST(numCreated == 2);
+
+        // The second request reads the thumbnail from the file
+        ImagePtr a = cache.get("a", 1, create(8, 4, 99));
+        BOOST_TEST(numCreated == 2);
+        BOOST_TEST(a->getWidth(0) == 8);
+        BOOST_TEST(a->getHeight(0) == 4);
+        BOOST_TEST(isFilledWith(a, 10));
+
+        BOOST_TEST(cache.getSize("a", 1, width, height));
+        BOOST_TEST(width == 8);
+        BOOST_TEST(height == 4);
+
+        // A different signature replaces the thumbnail
+        BOOST_TEST(!cache.getSize("b", 2, width, height));
+        BOOST_TEST(isFilledWith(cache.get("b", 2, create(4, 4, 30)), 30));
+        BOOST_TEST(numCreated == 3);
+
+        // Failures and images exceeding the thumbnail size are not stored
+        cache.get("c", 1, []() { return ImagePtr(); });
+        cache.get("d", 1, create(16, 16, 40));
+        BOOST_TEST(!cache.getSize("c", 1, width, height));
+        BOOST_TEST(!cache.getSize("d", 1, width, height));
+
+        shaders::ThumbnailCache::Statistics statistics = cache.getStatistics();
+        BOOST_TEST(statistics.hits == 1);
+        BOOST_TEST(statistics.misses == 5);
+        BOOST_TEST(statistics.numThumbnails == 2);
+
+        cache.save();
+    }
+
+    std::uintmax_t fileSize = fs::file_size(cacheFile);
+
+    // The next session finds the thumbnails in the file
+    {
+        shaders::ThumbnailCache cache(cacheFile.string(), 8);
+        BOOST_TEST(cache.load());
+
+        numCreated = 0;
+        BOOST_TEST(isFilledWith(cache.get("a", 1, create(8, 4, 99)), 10));
+        BOOST_TEST(isFilledWith(cache.get("b", 2, create(4, 4, 99)), 30));
+        BOOST_TEST(numCreated == 0);
+
+        // Replacing "a" and "b" leaves more replaced than valid thumbnails
+        // in the file, which is compacted on save
+        cache.get("a", 2, create(2, 2, 50));
+        cache.get("b", 3, create(2, 2, 60));
+        BOOST_TEST(fs::file_size(cacheFile) > fileSize);
+
+        cache.save();
+        BOOST_TEST(fs::file_size(cacheFile) < fileSize);
+        BOOST_TEST(isFilledWith(cache.get("a", 2, create(2, 2, 99)), 50));
+        BOOST_TEST(numCreated == 2);
+    }
+
+    {
+        // A different thumbnail size invalidates the file
+        shaders::ThumbnailCache cache(cacheFile.string(), 16);
+        BOOST_TEST(!cache.load());
+    }
+
+    {
+        shaders::ThumbnailCache cache(cacheFile.string(), 8);
+        BOOST_TEST(cache.load());
+        BOOST_TEST(isFilledWith(cache.get("b", 3, create(2, 2, 99)), 60));
+
+        // Invalidating removes the cache file
+        cache.invalidate();
+        BOOST_TEST(!fs::exists(cacheFile));
+        BOOST_TEST(cache.getStatistics().numThumbnails == 0);
+    }
+
+    {
+        // Truncated files are rejected
+        std::ofstream stream(cacheFile, std::ios::binary);
+        stream.write("DRTC", 4);
+        std::uint32_t header[] = { 1, 8, 100 };
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+    }
+
+    {
+        shaders::ThumbnailCache cache(cacheFile.string(), 8);
+        BOOST_TEST(!cache.load());
+    }
+
+    {
+        // So are names longer than the rest of the file
+        std::ofstream stream(cacheFile, std::ios::binary);
+        stream.write("DRTC", 4);
+        std::uint32_t header[] = { 1, 8, 0xfffffff0 };
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        stream.write("name", 4);
+    }
+
+    {
+        shaders::ThumbnailCache cache(cacheFile.string(), 8);
+        BOOST_TEST(!cache.load());
+
+        // The broken file is replaced by a new one
+        cache.get("a", 1, create(2, 2, 70));
+        cache.save();
+    }
+
+    shaders::ThumbnailCache cache(cacheFile.string(), 8);
+    BOOST_TEST(cache.load());
+    BOOST_TEST(cache.getStatistics().numThumbnails == 1);
+
+    fs::remove(cacheFile);
+}
+
+// The texture processing as the TextureManipulator did it before the
+// ImageKernels took over, which the kernels must still match. The unrolled
+// loops are folded into one loop per row, the arithmetic is unchanged.
+namespace previous
+{
+
+void resampleTextureLerpLine(const byte* in, byte* out, std::size_t inwidth, std::size_t outwidth, int bytesperpixel)
+{
+    std::size_t j, xi, oldx = 0, f, lerp;
+
+    std::size_t fstep = static_cast<std::size_t>(inwidth * 65536.0f / outwidth);
+    std::size_t endx = (inwidth - 1);
+
+    for (j = 0, f = 0; j < outwidth; j++, f += fstep)
+    {
+        xi = f >> 16;
+        if (xi != oldx) {
+            in += (xi - oldx) * bytesperpixel;
+            oldx = xi;
+        }
+
+        for (int i = 0; i < bytesperpixel; ++i)
+        {
+            if (xi < endx) {
+                lerp = f & 0xFFFF;
+                *out++ = (byte) ((((in[i + bytesperpixel] - in[i]) * lerp) >> 16) + in[i]);
+            }
+            else // last pixel of the line has no pixel to lerp to
+            {
+                *out++ = in[i];
+            }
+        }
+    }
+}
+
+void resampleTexture(const byte* indata, std::size_t inwidth, std::size_t inheight,
+                     byte* outdata, std::size_t outwidth, std::size_t outheight, int bytesperpixel)
+{
+    std::size_t rowsize = outwidth * bytesperpixel;
+    std::vector<byte> row1(rowsize);
+    std::vector<byte> row2(rowsize);
+
+    std::size_t i, yi, oldy, f, fstep, lerp, endy = (inheight-1), inrowsize = inwidth * bytesperpixel;
+    const byte* inrow;
+    byte* out = outdata;
+    fstep = (int) (inheight * 65536.0f / outheight);
+
+    inrow = indata;
+    oldy = 0;
+    resampleTextureLerpLine(inrow, row1.data(), inwidth, outwidth, bytesperpixel);
+    resampleTextureLerpLine(inrow + inrowsize, row2.data(), inwidth, outwidth, bytesperpixel);
+
+    for (i = 0, f = 0; i < outheight; i++, f += fstep)
+    {
+        yi = f >> 16;
+        if (yi < endy) {
+            lerp = f & 0xFFFF;
+            if (yi != oldy) {
+                inrow = indata + inrowsize * yi;
+                if (yi == oldy+1)
+                    row1 = row2;
+                else
+                    resampleTextureLerpLine(inrow, row1.data(), inwidth, outwidth, bytesperpixel);
+
+                resampleTextureLerpLine(inrow + inrowsize, row2.data(), inwidth, outwidth, bytesperpixel);
+                oldy = yi;
+            }
+            for (std::size_t j = 0; j < rowsize; ++j) {
+                out[j] = (byte) ((((row2[j] - row1[j]) * lerp) >> 16) + row1[j]);
+            }
+        }
+        else {
+            if (yi != oldy) {
+                inrow = indata + inrowsize * yi;
+                if (yi == oldy+1)
+                    row1 = row2;
+                else
+                    resampleTextureLerpLine(inrow, row1.data(), inwidth, outwidth, bytesperpixel);
+
+                oldy = yi;
+            }
+            std::copy(row1.begin(), row1.end(), out);
+        }
+
+        // The only deviation: the previous code didn't advance after the rows
+        // past the last source row, such that they overwrote each other
+        out += rowsize;
+    }
+}
+
+// in can be the same as out
+void mipReduce(byte* in, byte* out,
+               std::size_t width, std::size_t height,
+               std::size_t destwidth, std::size_t destheight)
+{
+    std::size_t x, y, width2, height2, nextrow;
+    if (width > destwidth) {
+        if (height > destheight) {
+            // reduce both
+            width2 = width >> 1;
+            height2 = height >> 1;
+            nextrow = width << 2;
+            for (y = 0;y < height2;y++) {
+                for (x = 0;x < width2;x++) {
+                    out[0] = (byte) ((in[0] + in[4] + in[nextrow  ] + in[nextrow+4]) >> 2);
+                    out[1] = (byte) ((in[1] + in[5] + in[nextrow+1] + in[nextrow+5]) >> 2);
+                    out[2] = (byte) ((in[2] + in[6] + in[nextrow+2] + in[nextrow+6]) >> 2);
+                    out[3] = (byte) ((in[3] + in[7] + in[nextrow+3] + in[nextrow+7]) >> 2);
+                    out += 4;
+                    in += 8;
+                }
+                in += nextrow; // skip a line
+            }
+        }
+        else {
+            // reduce width
+            width2 = width >> 1;
+            for (y = 0;y < height;y++) {
+                for (x = 0;x < width2;x++) {
+                    out[0] = (byte) ((in[0] + in[4]) >> 1);
+                    out[1] = (byte) ((in[1] + in[5]) >> 1);
+                    out[2] = (byte) ((in[2] + in[6]) >> 1);
+                    out[3] = (byte) ((in[3] + in[7]) >> 1);
+                    out += 4;
+                    in += 8;
+                }
+            }
+        }
+    }
+    else if (height > destheight) {
+        // reduce height
+        height2 = height >> 1;
+        nextrow = width << 2;
+        for (y = 0;y < height2;y++) {
+            for (x = 0;x < width;x++) {
+                out[0] = (byte) ((in[0] + in[nextrow  ]) >> 1);
+                out[1] = (byte) ((in[1] + in[nextrow+1]) >> 1);
+                out[2] = (byte) ((in[2] + in[nextrow+2]) >> 1);
+                out[3] = (byte) ((in[3] + in[nextrow+3]) >> 1);
+                out += 4;
+                in += 4;
+            }
+            in += nextrow; // skip a line
+        }
+    }
+}
+
+void processGamma(byte* pixels, std::size_t numPixels, const byte* gammaTable)
+{
+    for (std::size_t i = 0; i < (numPixels*4); i += 4)
+    {
+        pixels[i] = gammaTable[pixels[i]];
+        (pixels + 1)[i] = gammaTable[(pixels + 1)[i]];
+        (pixels + 2)[i] = gammaTable[(pixels + 2)[i]];
+    }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(imageKernelsMatchPreviousOutput)
+{
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    auto createImage = [&](std::size_t numBytes)
+    {
+        std::vector<byte> pixels(numBytes);
+        std::generate(pixels.begin(), pixels.end(), [&]() { return static_cast<byte>(distribution(random)); });
+        return pixels;
+    };
+
+    for (auto instructionSet : { ImageKernels::InstructionSet::Scalar,
+                                 ImageKernels::InstructionSet::SSE2,
+                                 ImageKernels::InstructionSet::AVX2 })
+    {
+        if (!ImageKernels::IsSupported(instructionSet))
+        {
+            continue;
+        }
+
+        ImageKernels kernels(instructionSet);
+        BOOST_TEST_MESSAGE(ImageKernels::GetName(kernels.getInstructionSet()));
+
+        // Odd sizes to cover the remainders of the vectorised loops,
+        // stretching as well as shrinking
+        const std::size_t sizes[][4] = { { 37, 21, 64, 32 }, { 100, 75, 128, 128 }, { 64, 64, 23, 47 } };
+
+        for (const auto& size : sizes)
+        {
+            for (int bytesPerPixel : { 3, 4 })
+            {
+                std::vector<byte> input = createImage(size[0] * size[1] * bytesPerPixel);
+                std::vector<byte> expected(size[2] * size[3] * bytesPerPixel, 0xCD);
+                std::vector<byte> actual(expected.size(), 0xAB);
+
+                previous::resampleTexture(input.data(), size[0], size[1], expected.data(), size[2], size[3], bytesPerPixel);
+                kernels.resample(input.data(), size[0], size[1], actual.data(), size[2], size[3], bytesPerPixel);
+
+                // Every output row has been written
+                BOOST_TEST(expected == actual);
+            }
+        }
+
+        // Reductions in place, as done by the TextureManipulator
+        const std::size_t reductions[][4] = { { 128, 64, 64, 32 }, { 72, 8, 36, 8 }, { 12, 40, 12, 20 } };
+
+        for (const auto& reduction : reductions)
+        {
+            std::vector<byte> expected = createImage(reduction[0] * reduction[1] * 4);
+            std::vector<byte> actual = expected;
+
+            previous::mipReduce(expected.data(), expected.data(), reduction[0], reduction[1], reduction[2], reduction[3]);
+            kernels.mipReduce(actual.data(), actual.data(), reduction[0], reduction[1], reduction[2], reduction[3]);
+
+            BOOST_TEST(expected == actual);
+        }
+
+        std::vector<byte> table = createImage(256);
+        std::vector<byte> expected = createImage(1001 * 4);
+        std::vector<byte> actual = expected;
+
+        previous::processGamma(expected.data(), 1001, table.data());
+        kernels.applyTable(actual.data(), 1001, table.data());
+
+        BOOST_TEST(expected == actual);
+    }
+}
+
+// The normal map calculations as the map expressions did them before the
+// ImageKernels took over, which the kernels must still match
+namespace previous
+{
+
+byte* getPixel(byte* pixels, std::size_t width, std::size_t height, std::size_t x, std::size_t y)
+{
+    return pixels + (((((y + height) % height) * width) + ((x + width) % width)) * 4);
+}
+
+void createNormalmapFromHeightmap(byte* in, byte* out, std::size_t width, std::size_t height, float scale)
+{
+    struct KernelElement
+    {
+        int x, y;
+        float w;
+    };
+
+    const int kernelSize = 6;
+    KernelElement kernel_du[kernelSize] = {
+        {-1, 1,-1.0f },
+        {-1, 0,-1.0f },
+        {-1,-1,-1.0f },
+        { 1, 1, 1.0f },
+        { 1, 0, 1.0f },
+        { 1,-1, 1.0f }
+    };
+    KernelElement kernel_dv[kernelSize] = {
+        {-1, 1, 1.0f },
+        { 0, 1, 1.0f },
+        { 1, 1, 1.0f },
+        {-1,-1,-1.0f },
+        { 0,-1,-1.0f },
+        { 1,-1,-1.0f }
+    };
+
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x, out += 4)
+        {
+            float du = 0;
+            for (KernelElement* i = kernel_du; i != kernel_du + kernelSize; ++i) {
+                du += (getPixel(in, width, height, x + (*i).x, y + (*i).y)[0] / 255.0f) * (*i).w;
+            }
+            float dv = 0;
+            for (KernelElement* i = kernel_dv; i != kernel_dv + kernelSize; ++i) {
+                dv += (getPixel(in, width, height, x + (*i).x, y + (*i).y)[0] / 255.0f) * (*i).w;
+            }
+
+            float nx = -du * scale;
+            float ny = -dv * scale;
+            float nz = 1.0;
+
+            float norm = 1.0f/sqrt(nx*nx + ny*ny + nz*nz);
+            out[0] = static_cast<byte>(float_to_integer(((nx * norm) + 1) * 127.5));
+            out[1] = static_cast<byte>(float_to_integer(((ny * norm) + 1) * 127.5));
+            out[2] = static_cast<byte>(float_to_integer(((nz * norm) + 1) * 127.5));
+            out[3] = 255;
+        }
+    }
+}
+
+void addNormals(byte* pixOne, byte* pixTwo, byte* pixOut, std::size_t numPixels)
+{
+    for (std::size_t i = 0; i < numPixels; ++i, pixOne += 4, pixTwo += 4, pixOut += 4)
+    {
+        Vector3 vectorOne(
+            static_cast<double>(pixOne[0]),
+            static_cast<double>(pixOne[1]),
+            static_cast<double>(pixOne[2])
+        );
+        Vector3 vectorTwo(
+            static_cast<double>(pixTwo[0]),
+            static_cast<double>(pixTwo[1]),
+            static_cast<double>(pixTwo[2])
+        );
+        Vector3 vectorOut = (vectorOne + vectorTwo) * 0.5;
+
+        pixOut[0] = static_cast<byte>(float_to_integer(vectorOut.x()));
+        pixOut[1] = static_cast<byte>(float_to_integer(vectorOut.y()));
+        pixOut[2] = static_cast<byte>(float_to_integer(vectorOut.z()));
+        pixOut[3] = 255;
+    }
+}
+
+void smoothNormals(byte* in, byte* out, std::size_t width, std::size_t height)
+{
+    struct KernelElement {
+        int dx, dy;
+    };
+
+    const int kernelSize = 9;
+    KernelElement kernel[kernelSize] = {
+        {-1, -1 },
+        { 0, -1 },
+        { 1, -1 },
+        { 1,  0 },
+        { 1,  1 },
+        { 0,  1 },
+        {-1,  1 },
+        {-1,  0 },
+        { 0,  0 }
+    };
+    const float perKernelSize = 1.0f/kernelSize;
+
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x, out += 4)
+        {
+            Vector3 smoothVector(0,0,0);
+
+            for (KernelElement* i = kernel; i != kernel + kernelSize; ++i) {
+                byte* pixel = getPixel(in, width, height, x + i->dx, y + i->dy);
+                Vector3 temp(pixel[0], pixel[1], pixel[2]);
+
+                smoothVector += temp;
+            }
+
+            smoothVector *= perKernelSize;
+
+            out[0] = static_cast<byte>(float_to_integer(smoothVector.x()));
+            out[1] = static_cast<byte>(float_to_integer(smoothVector.y()));
+            out[2] = static_cast<byte>(float_to_integer(smoothVector.z()));
+            out[3] = 255;
+        }
+    }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(normalMapKernelsMatchPreviousOutput)
+{
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    auto createImage = [&](std::size_t width, std::size_t height)
+    {
+        std::vector<byte> pixels(width * height * 4);
+        std::generate(pixels.begin(), pixels.end(), [&]() { return static_cast<byte>(distribution(random)); });
+        return pixels;
+    };
+
+    // Returns the largest difference of the components
+    auto compare = [](const std::vector<byte>& a, const std::vector<byte>& b)
+    {
+        int difference = 0;
+
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            difference = std::max(difference, std::abs(a[i] - b[i]));
+        }
+
+        return difference;
+    };
+
+    ImageKernels scalar(ImageKernels::InstructionSet::Scalar);
+
+    decl::DeclLoadScheduler scheduler(2);
+
+    ImageKernels parallel;
+    parallel.setSubTaskRunner(std::bind(&decl::DeclLoadScheduler::runSubTasks,
+                                        &scheduler, std::placeholders::_1));
+
+    ImageKernels sse2(ImageKernels::InstructionSet::SSE2);
+    ImageKernels avx2(ImageKernels::InstructionSet::AVX2);
+
+    // Odd sizes to cover the remainders of the vectorised loops, the last
+    // one is split into several tasks by the parallel kernels
+    const std::size_t sizes[][2] = { { 1, 1 }, { 3, 5 }, { 37, 21 }, { 64, 64 }, { 300, 301 } };
+
+    for (const auto& size : sizes)
+    {
+        std::size_t numPixels = size[0] * size[1];
+        std::vector<byte> first = createImage(size[0], size[1]);
+        std::vector<byte> second = createImage(size[0], size[1]);
+
+        std::vector<byte> expected(numPixels * 4);
+        std::vector<byte> actual(numPixels * 4);
+
+        for (const ImageKernels* kernels : { &scalar, &sse2, &avx2, &parallel })
+        {
+            BOOST_TEST_MESSAGE(ImageKernels::GetName(kernels->getInstructionSet()));
+
+            for (float scale : { 0.5f, 1.0f, 4.0f })
+            {
+                previous::createNormalmapFromHeightmap(first.data(), expected.data(), size[0], size[1], scale);
+                kernels->createNormalMap(first.data(), actual.data(), size[0], size[1], scale);
+
+                // The kernels sum up the heights in a different order and
+                // the vectorised ones calculate with integers, which rounds
+                // slightly differently
+                BOOST_TEST(compare(expected, actual) <= 1);
+            }
+
+            previous::addNormals(first.data(), second.data(), expected.data(), numPixels);
+            kernels->addNormals(first.data(), second.data(), actual.data(), numPixels);
+            BOOST_TEST(expected == actual);
+
+            previous::smoothNormals(first.data(), expected.data(), size[0], size[1]);
+            kernels->smoothNormals(first.data(), actual.data(), size[0], size[1]);
+            BOOST_TEST(expected == actual);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ddsImageDecompressesMipMaps)
+{
+    // Creates an image with a single mipmap of the given blocks
+    auto createImage = [](ddsPF_t pixelFormat, std::size_t width, std::size_t height,
+                          const std::vector<byte>& blocks)
+    {
+        auto image = std::make_shared<DDSImage>(blocks.size());
+        image->setPixelFormat(pixelFormat);
+        image->addMipMap(width, height, blocks.size(), 0);
+        std::copy(blocks.begin(), blocks.end(), image->getMipMapPixels(0));
+        return image;
+    };
+
+    auto getPixel = [](const ImagePtr& image, std::size_t x, std::size_t y)
+    {
+        const byte* pixel = image->getMipMapPixels(0) + (y * image->getWidth(0) + x) * 4;
+        return std::vector<int>(pixel, pixel + 4);
+    };
+
+    // Pure red and blue, the lines use the colours 0, 1, 2, 3 from left to right
+    std::vector<byte> dxt1 = { 0x00, 0xf8, 0x1f, 0x00, 0xe4, 0xe4, 0xe4, 0xe4 };
+    ImagePtr decompressed = createImage(DDS_PF_DXT1, 4, 4, dxt1)->getDecompressedMipMap(0);
+
+    BOOST_REQUIRE(decompressed);
+    BOOST_TEST(!decompressed->isPrecompressed());
+    BOOST_TEST(getPixel(decompressed, 0, 3) == std::vector<int>({ 255, 0, 0, 255 }));
+    BOOST_TEST(getPixel(decompressed, 1, 3) == std::vector<int>({ 0, 0, 255, 255 }));
+    BOOST_TEST(getPixel(decompressed, 2, 3) == std::vector<int>({ 170, 0, 85, 255 }));
+    BOOST_TEST(getPixel(decompressed, 3, 3) == std::vector<int>({ 85, 0, 170, 255 }));
+
+    // The last of the eight interpolated alphas, followed by the colour block
+    std::vector<byte> dxt5 = { 0xff, 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    dxt5.insert(dxt5.end(), dxt1.begin(), dxt1.end());
+    decompressed = createImage(DDS_PF_DXT5, 4, 4, dxt5)->getDecompressedMipMap(0);
+
+    BOOST_TEST(getPixel(decompressed, 2, 1) == std::vector<int>({ 170, 0, 85, 36 }));
+
+    // A flat normal, z is reconstructed from x and y
+    std::vector<byte> ati2 = { 0x80, 0x80, 0, 0, 0, 0, 0, 0, 0x80, 0x80, 0, 0, 0, 0, 0, 0 };
+    decompressed = createImage(DDS_PF_ATI2, 4, 4, ati2)->getDecompressedMipMap(0);
+
+    BOOST_TEST(getPixel(decompressed, 1, 2) == std::vector<int>({ 128, 128, 255, 255 }));
+
+    BOOST_TEST(!createImage(DDS_PF_UNKNOWN, 4, 4, dxt1)->getDecompressedMipMap(0));
+
+    // Random blocks of a size which isn't a multiple of the block size
+    std::mt19937 random(11);
+    std::uniform_int_distribution<int> distribution(0, 255);
+
+    std::vector<byte> blocks(75 * 76 * 16);
+    std::generate(blocks.begin(), blocks.end(), [&]() { return static_cast<byte>(distribution(random)); });
+
+    auto serial = createImage(DDS_PF_DXT5, 297, 301, blocks);
+    auto parallel = createImage(DDS_PF_DXT5, 297, 301, blocks);
+    auto padded = createImage(DDS_PF_DXT5, 300, 304, blocks);
+
+    decl::DeclLoadScheduler scheduler(2);
+    parallel->setSubTaskRunner(std::bind(&decl::DeclLoadScheduler::runSubTasks,
+                                         &scheduler, std::placeholders::_1));
+
+    ImagePtr expected = padded->getDecompressedMipMap(0);
+    ImagePtr serialImage = serial->getDecompressedMipMap(0);
+    ImagePtr parallelImage = parallel->getDecompressedMipMap(0);
+
+    // The partial blocks are clipped
+    bool serialMatches = true;
+    bool parallelMatches = true;
+
+    for (std::size_t y = 0; y < 301; ++y)
+    {
+        const byte* line = expected->getMipMapPixels(0) + y * 300 * 4;
+
+        serialMatches &= std::equal(line, line + 297 * 4, serialImage->getMipMapPixels(0) + y * 297 * 4);
+        parallelMatches &= std::equal(line, line + 297 * 4, parallelImage->getMipMapPixels(0) + y * 297 * 4);
+    }
+
+    BOOST_TEST(serialMatches);
+    BOOST_TEST(parallelMatches);
+}
+
+// Provides the shader parms to the expressions
+struct MockRenderEntity :
+    public IRenderEntity
+{
+    float parms[12] = { 0 };
+
+    float getShaderParm(int parmNum) const override
+    {
+        return parms[parmNum];
+    }
+
+    const Vector3& getDirection() const override
+    {
+        static Vector3 direction(0, 0, 1);
+        return direction;
+    }
+
+    const ShaderPtr& getWireShader() const override
+    {
+        static ShaderPtr shader;
+        return shader;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(expressionProgramMatchesExpressionTrees)
+{
+    using namespace expressions;
+
+    auto constant = [](float value) { return std::make_shared<ConstantExpression>(value); };
+    auto time = []() { return std::make_shared<TimeExpression>(); };
+
+    auto table = std::make_shared<TableDefinition>("sintable", "{ 0, 1, 0, -1 }");
+
+    // sintable[time * 0.3] and sintable[0.3 * time]
+    IShaderExpressionPtr lookup = std::make_shared<TableLookupExpression>(table,
+        std::make_shared<MultiplyExpression>(time(), constant(0.3f)));
+    IShaderExpressionPtr swappedLookup = std::make_shared<TableLookupExpression>(table,
+        std::make_shared<MultiplyExpression>(constant(0.3f), time()));
+
+    std::vector<IShaderExpressionPtr> expressions =
+    {
+        lookup,
+        swappedLookup,
+        // parm4 + sintable[time * 0.3] * 0.5
+        std::make_shared<expressions::AddExpression>(std::make_shared<ShaderParmExpression>(4),
+            std::make_shared<MultiplyExpression>(lookup, constant(0.5f))),
+        // global3 + time > 1.5 && parm0 != 0
+        std::make_shared<LogicalAndExpression>(
+            std::make_shared<GreaterThanExpression>(
+                std::make_shared<expressions::AddExpression>(std::make_shared<GlobalShaderParmExpression>(3), time()),
+                constant(1.5f)),
+            std::make_shared<InequalityExpression>(std::make_shared<ShaderParmExpression>(0), constant(0))),
+        // (time % 2) / 2 - 1
+        std::make_shared<SubtractExpression>(
+            std::make_shared<DivideExpression>(std::make_shared<ModuloExpression>(time(), constant(2)), constant(2)),
+            constant(1)),
+        // sintable[2.5]
+        std::make_shared<TableLookupExpression>(table, constant(2.5f)),
+    };
+
+    Registers registers(NUM_RESERVED_REGISTERS);
+    registers[REG_ZERO] = 0;
+    registers[REG_ONE] = 1;
+
+    ExpressionProgram program(registers);
+
+    std::vector<std::size_t> results;
+
+    for (const IShaderExpressionPtr& expression : expressions)
+    {
+        results.push_back(program.compile(expression));
+    }
+
+    // The lookups share their register, the parms are only needed per entity
+    BOOST_TEST(results[0] == results[1]);
+    BOOST_TEST(program.getNumTimeInstructions() == 10);
+    BOOST_TEST(program.getNumEntityInstructions() == 5);
+
+    // 2 * 3 + 1 is folded into a constant
+    std::size_t folded = program.compile(std::make_shared<expressions::AddExpression>(
+        std::make_shared<MultiplyExpression>(constant(2), constant(3)), constant(1)));
+
+    BOOST_TEST(registers[folded] == 7);
+    BOOST_TEST(program.getNumTimeInstructions() + program.getNumEntityInstructions() == 15);
+
+    MockRenderEntity entity;
+    MockRenderEntity otherEntity;
+    entity.parms[0] = 1;
+    entity.parms[4] = 0.25f;
+    otherEntity.parms[4] = -2;
+
+    for (std::size_t t : { 0, 250, 1000, 1700, 2500, 123456 })
+    {
+        program.evaluate(t);
+
+        for (std::size_t i = 0; i < expressions.size(); ++i)
+        {
+            BOOST_TEST(registers[results[i]] == expressions[i]->getValue(t));
+        }
+
+        // The time only registers stay the same for another entity
+        for (const MockRenderEntity* e : { &entity, &otherEntity })
+        {
+            program.evaluate(t, *e);
+
+            for (std::size_t i = 0; i < expressions.size(); ++i)
+            {
+                BOOST_TEST(registers[results[i]] == expressions[i]->getValue(t, *e));
+            }
+        }
+    }
+}
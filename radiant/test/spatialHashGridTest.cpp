@@ -0,0 +1,108 @@
+#define BOOST_TEST_MODULE spatialHashGridTest
+#include <boost/test/included/unit_test.hpp>
+
+#include "radiant/render/SpatialHashGrid.h"
+
+#include <set>
+
+namespace
+{
+    typedef render::SpatialHashGrid<int> Grid;
+
+    // The elements found by a query, failing on duplicates
+    std::set<int> findIntersecting(Grid& grid, const AABB& bounds)
+    {
+        std::set<int> found;
+
+        grid.forEachIntersecting(bounds, [&](int element)
+        {
+            BOOST_CHECK(found.insert(element).second);
+        });
+
+        return found;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(findOverlappingElements)
+{
+    Grid grid(100);
+
+    grid.link(1, AABB(Vector3(50, 50, 50), Vector3(10, 10, 10)));
+    grid.link(2, AABB(Vector3(250, 50, 50), Vector3(10, 10, 10)));
+    grid.link(3, AABB(Vector3(-150, 50, 50), Vector3(10, 10, 10)));
+
+    BOOST_CHECK_EQUAL(grid.size(), 3);
+    BOOST_CHECK_EQUAL(grid.getNumCells(), 3);
+
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(60, 60, 60), Vector3(5, 5, 5))) == std::set<int>({ 1 }));
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(150, 50, 50), Vector3(100, 5, 5))) == std::set<int>({ 1, 2 }));
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(0, 0, 0), Vector3(5, 5, 5))).empty());
+
+    // Elements in the same cell are filtered by their bounds
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(90, 90, 90), Vector3(5, 5, 5))).empty());
+
+    // Touching bounds overlap
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(70, 50, 50), Vector3(10, 10, 10))) == std::set<int>({ 1 }));
+}
+
+BOOST_AUTO_TEST_CASE(elementsSpanningSeveralCells)
+{
+    Grid grid(100);
+
+    grid.link(1, AABB(Vector3(0, 0, 0), Vector3(150, 150, 150)));
+
+    BOOST_CHECK_EQUAL(grid.getNumCells(), 4 * 4 * 4);
+
+    // Found once, even when the query spans several of its cells
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(0, 0, 0), Vector3(120, 120, 120))) == std::set<int>({ 1 }));
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(140, -140, 140), Vector3(5, 5, 5))) == std::set<int>({ 1 }));
+}
+
+BOOST_AUTO_TEST_CASE(relinkAndUnlink)
+{
+    Grid grid(100);
+
+    grid.link(1, AABB(Vector3(50, 50, 50), Vector3(10, 10, 10)));
+    grid.link(1, AABB(Vector3(550, 50, 50), Vector3(10, 10, 10)));
+
+    BOOST_CHECK_EQUAL(grid.size(), 1);
+    BOOST_CHECK_EQUAL(grid.getNumCells(), 1);
+
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(50, 50, 50), Vector3(10, 10, 10))).empty());
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(550, 50, 50), Vector3(10, 10, 10))) == std::set<int>({ 1 }));
+
+    AABB bounds;
+    BOOST_CHECK(grid.getBounds(1, bounds));
+    BOOST_CHECK_EQUAL(bounds.origin, Vector3(550, 50, 50));
+
+    BOOST_CHECK(grid.unlink(1));
+    BOOST_CHECK(!grid.unlink(1));
+    BOOST_CHECK(!grid.contains(1));
+    BOOST_CHECK(!grid.getBounds(1, bounds));
+
+    BOOST_CHECK_EQUAL(grid.size(), 0);
+    BOOST_CHECK_EQUAL(grid.getNumCells(), 0);
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(550, 50, 50), Vector3(10, 10, 10))).empty());
+}
+
+BOOST_AUTO_TEST_CASE(largeAndInvalidBounds)
+{
+    Grid grid(100);
+
+    grid.link(1, AABB(Vector3(0, 0, 0), Vector3(10000, 10000, 10000)));
+    grid.link(2, AABB());
+    grid.link(3, AABB(Vector3(50, 50, 50), Vector3(10, 10, 10)));
+
+    // Neither of the first two is stored in the cells
+    BOOST_CHECK_EQUAL(grid.getNumCells(), 1);
+
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(-50, -50, -50), Vector3(5, 5, 5))) == std::set<int>({ 1, 2 }));
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(20000, 0, 0), Vector3(5, 5, 5))) == std::set<int>({ 2 }));
+
+    // Invalid query bounds find everything
+    BOOST_CHECK(findIntersecting(grid, AABB()) == std::set<int>({ 1, 2, 3 }));
+
+    BOOST_CHECK(grid.unlink(1));
+    BOOST_CHECK(grid.unlink(2));
+    BOOST_CHECK(findIntersecting(grid, AABB(Vector3(50, 50, 50), Vector3(5, 5, 5))) == std::set<int>({ 3 }));
+}
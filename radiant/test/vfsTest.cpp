@@ -2,6 +2,13 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include "VFSFixture.h"
+#include "stream/ScopedArchiveBuffer.h"
+#include "stream/BinaryToTextInputStream.h"
+#include "os/fs.h"
+#include "string/predicate.h"
+
+#include <algorithm>
+#include <fstream>
 
 BOOST_FIXTURE_TEST_CASE(constructFileSystemModule, VFSFixture)
 {
@@ -88,3 +95,341 @@ BOOST_FIXTURE_TEST_CASE(handleAssetsLst, VFSFixture)
     // returned as an actual file to the calling code.
     BOOST_TEST(fileVis.count("assets.lst") == 0);
 }
+
+namespace
+{
+    // Read the given stream in small chunks, keeping the streams from taking
+    // their whole-file paths
+    template<typename StreamType, typename CharType>
+    std::vector<CharType> readInChunks(StreamType& stream)
+    {
+        std::vector<CharType> result;
+        CharType chunk[7];
+
+        for (std::size_t count = stream.read(chunk, sizeof(chunk)); count > 0;
+             count = stream.read(chunk, sizeof(chunk)))
+        {
+            result.insert(result.end(), chunk, chunk + count);
+        }
+
+        return result;
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(readWholeFileMatchesStreaming, VFSFixture)
+{
+    // Collect the files from both PK4s and the physical directory
+    std::set<std::string> files;
+    for (const char* dir : { "materials/", "models/" })
+    {
+        fs.forEachFile(
+            dir, "*", [&](const vfs::FileInfo& fi) { files.insert(fi.fullPath()); }, 0
+        );
+    }
+    BOOST_TEST(files.count("models/darkmod/test/unit_cube.ase") == 1);
+    BOOST_TEST(files.count("materials/tdm_ai_nobles.mtr") == 1);
+
+    for (const auto& name : files)
+    {
+        // Binary mode: a single read of the entire file must produce the
+        // same bytes as incremental reads
+        auto streamed = fs.openFile(name);
+        auto whole = fs.openFile(name);
+        BOOST_REQUIRE(streamed && whole);
+
+        auto chunks = readInChunks<InputStream, InputStream::byte_type>(streamed->getInputStream());
+        archive::ScopedArchiveBuffer buffer(*whole);
+
+        BOOST_TEST(buffer.length == whole->size());
+        BOOST_TEST(chunks.size() == buffer.length);
+        BOOST_TEST(std::equal(chunks.begin(), chunks.end(), buffer.buffer), name);
+
+        // Text mode: contents equal the binary data without carriage returns
+        auto textFile = fs.openTextFile(name);
+        BOOST_REQUIRE(textFile);
+
+        auto text = readInChunks<TextInputStream, char>(textFile->getInputStream());
+
+        std::string expected(reinterpret_cast<const char*>(buffer.buffer), buffer.length);
+        expected.erase(std::remove(expected.begin(), expected.end(), '\r'), expected.end());
+
+        BOOST_TEST(std::string(text.begin(), text.end()) == expected, name);
+    }
+}
+
+namespace
+{
+    // Returns at most a few bytes per read() call, like a stream falling
+    // back to incremental reads
+    class ShortReadInputStream :
+        public InputStream
+    {
+    private:
+        std::string _data;
+        std::size_t _position = 0;
+
+    public:
+        ShortReadInputStream(const std::string& data) :
+            _data(data)
+        {}
+
+        size_type read(byte_type* buffer, size_type length) override
+        {
+            std::size_t count = std::min<std::size_t>({ length, 7, _data.size() - _position });
+
+            std::copy(_data.begin() + _position, _data.begin() + _position + count, buffer);
+            _position += count;
+
+            return count;
+        }
+    };
+}
+
+BOOST_AUTO_TEST_CASE(readWholeFileUntilExhausted)
+{
+    std::string data;
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        data += "line " + std::to_string(i) + "\r\n";
+    }
+
+    std::string expected = data;
+    expected.erase(std::remove(expected.begin(), expected.end(), '\r'), expected.end());
+
+    // Short reads, and sizes smaller or larger than the actual data
+    for (std::size_t size : { data.size(), data.size() / 3, std::size_t(0), data.size() * 2 })
+    {
+        ShortReadInputStream binary(data);
+        stream::WholeFileBinaryToTextInputStream<InputStream> text(binary, size);
+
+        auto contents = readInChunks<TextInputStream, char>(text);
+
+        BOOST_TEST(std::string(contents.begin(), contents.end()) == expected);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(getFileStamps, VFSFixture)
+{
+    // Files in PK4s are stamped with the PK4 itself
+    vfs::FileStamp first;
+    vfs::FileStamp second;
+    BOOST_REQUIRE(fs.getFileStamp("models/darkmod/test/unit_cube.ase", first));
+    BOOST_REQUIRE(fs.getFileStamp("models/darkmod/test/unit_cube.lwo", second));
+
+    BOOST_TEST(string::ends_with(first.archive, "test_models.pk4"));
+    BOOST_TEST(first.size == fs::file_size(first.archive));
+    BOOST_TEST((first == second));
+
+    // Physical files are stamped individually
+    vfs::FileStamp physical;
+    BOOST_REQUIRE(fs.getFileStamp("materials/example.mtr", physical));
+
+    BOOST_TEST(string::ends_with(physical.archive, "/"));
+    BOOST_TEST(physical.size == fs::file_size(physical.archive + "materials/example.mtr"));
+
+    BOOST_TEST(!fs.getFileStamp("materials/doesnotexist.mtr", physical));
+}
+
+BOOST_FIXTURE_TEST_CASE(openTextFilesAsync, VFSFixture)
+{
+    std::vector<std::string> paths = {
+        "materials/example.mtr",
+        "materials/tdm_ai_nobles.mtr",
+        "materials/nothere.mtr",
+        "models/darkmod/test/unit_cube.ase"
+    };
+
+    auto futures = fs.openTextFilesAsync(paths);
+    BOOST_REQUIRE(futures.size() == paths.size());
+
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        ArchiveTextFilePtr file = futures[i].get();
+        ArchiveTextFilePtr expected = fs.openTextFile(paths[i]);
+
+        // Missing files yield an empty pointer
+        BOOST_TEST(static_cast<bool>(file) == static_cast<bool>(expected));
+
+        if (!file) continue;
+
+        BOOST_TEST(file->getName() == expected->getName());
+
+        // Contents must be the same as the ones read synchronously
+        auto contents = readInChunks<TextInputStream, char>(file->getInputStream());
+        auto expectedContents = readInChunks<TextInputStream, char>(expected->getInputStream());
+
+        BOOST_TEST(!contents.empty());
+        BOOST_TEST(std::string(contents.begin(), contents.end()) ==
+                   std::string(expectedContents.begin(), expectedContents.end()));
+    }
+}
+
+namespace
+{
+
+// Records the change notifications sent by the VFS
+struct FileChangeRecorder :
+    public vfs::VirtualFileSystem::Observer
+{
+    std::set<std::string> changedFiles;
+
+    void onFilesChanged(const std::set<std::string>& files) override
+    {
+        changedFiles.insert(files.begin(), files.end());
+    }
+};
+
+void writeFile(const fs::path& path, const std::string& contents)
+{
+    std::ofstream stream(path.string());
+    stream << contents;
+}
+
+}
+
+#if defined(__linux__)
+BOOST_AUTO_TEST_CASE(reportChangedFiles)
+{
+    // Set up a VFS on a scratch directory
+    fs::path root = fs::temp_directory_path() / "vfsTest_reportChangedFiles";
+    fs::remove_all(root);
+    fs::create_directories(root / "materials");
+    writeFile(root / "materials" / "a.mtr", "a { }");
+
+    vfs::SearchPaths searchPaths;
+    searchPaths.insertIfNotExists(root.string());
+
+    vfs::Doom3FileSystem fileSystem;
+    fileSystem.initialise(searchPaths, { "pk4" });
+    fileSystem.setFileWatchingEnabled(true);
+
+    FileChangeRecorder recorder;
+    fileSystem.addObserver(recorder);
+
+    fileSystem.dispatchFileChanges();
+    BOOST_TEST(recorder.changedFiles.empty());
+
+    // Modify a file, add another one in a new directory
+    writeFile(root / "materials" / "a.mtr", "a { diffusemap _white }");
+    fs::create_directories(root / "def");
+    writeFile(root / "def" / "b.def", "entityDef b { }");
+
+    fileSystem.dispatchFileChanges();
+    BOOST_TEST(recorder.changedFiles.size() == 2);
+    BOOST_TEST(recorder.changedFiles.count("materials/a.mtr") == 1);
+    BOOST_TEST(recorder.changedFiles.count("def/b.def") == 1);
+
+    // Files in the new directory are monitored too
+    recorder.changedFiles.clear();
+    fs::remove(root / "def" / "b.def");
+
+    fileSystem.dispatchFileChanges();
+    BOOST_TEST(recorder.changedFiles.size() == 1);
+    BOOST_TEST(recorder.changedFiles.count("def/b.def") == 1);
+
+    // Nothing is reported after disabling the watch
+    recorder.changedFiles.clear();
+    fileSystem.setFileWatchingEnabled(false);
+    writeFile(root / "materials" / "a.mtr", "a { }");
+
+    fileSystem.dispatchFileChanges();
+    BOOST_TEST(recorder.changedFiles.empty());
+
+    fileSystem.removeObserver(recorder);
+    fileSystem.shutdown();
+    fs::remove_all(root);
+}
+#endif
+
+namespace
+{
+
+// Looks up the statistics of the archive whose path ends with the given name
+const vfs::IOStatistics* findArchiveStatistics(const vfs::IOStatisticsReport& report, const std::string& name)
+{
+    for (const auto& pair : report.archives)
+    {
+        if (pair.first.size() >= name.size() &&
+            pair.first.compare(pair.first.size() - name.size(), name.size(), name) == 0)
+        {
+            return &pair.second;
+        }
+    }
+
+    return nullptr;
+}
+
+}
+
+BOOST_FIXTURE_TEST_CASE(collectIOStatistics, VFSFixture)
+{
+    fs.resetIOStatistics();
+
+    fs::path traceFile = fs::temp_directory_path() / "vfsTest_collectIOStatistics.csv";
+    BOOST_REQUIRE(fs.setIOTraceFile(traceFile.string()));
+
+    {
+        // Keep a text file from the physical directory and a deflated binary file open at once
+        auto textFile = fs.openTextFile("materials/example.mtr");
+        auto binaryFile = fs.openFile("models/darkmod/test/unit_cube.lwo");
+        BOOST_REQUIRE(textFile && binaryFile);
+
+        auto text = readInChunks<TextInputStream, char>(textFile->getInputStream());
+        archive::ScopedArchiveBuffer buffer(*binaryFile);
+
+        // Read statistics are added on closing, the opens are there already
+        auto report = fs.getIOStatistics();
+        BOOST_TEST(report.extensions["mtr"].opens == 1);
+        BOOST_TEST(report.extensions["mtr"].bytesRead == 0);
+        BOOST_TEST(report.peakConcurrentReaders == 2);
+
+        BOOST_TEST(!text.empty());
+        BOOST_TEST(buffer.length == 982);
+    }
+
+    // Files read by the async loader are accounted for as well
+    fs.openTextFilesAsync({ "materials/tdm_ai_nobles.mtr" })[0].get();
+
+    fs.setIOTraceFile("");
+
+    auto report = fs.getIOStatistics();
+
+    BOOST_TEST(report.extensions["mtr"].opens == 2);
+    BOOST_TEST(report.extensions["mtr"].bytesRead > 6000);
+    BOOST_TEST(report.extensions["lwo"].opens == 1);
+    BOOST_TEST(report.extensions["lwo"].bytesRead == 982);
+    BOOST_TEST(report.extensions["lwo"].bytesInflated == 982);
+
+    auto models = findArchiveStatistics(report, "test_models.pk4");
+    auto materials = findArchiveStatistics(report, "tdm_example_mtrs.pk4");
+    auto directory = findArchiveStatistics(report, "vfs_root/");
+    BOOST_REQUIRE(models && materials && directory);
+
+    BOOST_TEST(models->opens == 1);
+    BOOST_TEST(materials->opens == 1);
+    BOOST_TEST(materials->bytesInflated == materials->bytesRead);
+    BOOST_TEST(directory->opens == 1);
+    BOOST_TEST(directory->bytesInflated == 0);
+
+    // The trace contains a header followed by the open and read events
+    std::ifstream trace(traceFile.string());
+    std::string line;
+    std::size_t opens = 0;
+
+    BOOST_REQUIRE(std::getline(trace, line));
+    BOOST_TEST(line == "time_us,thread,event,archive,file,bytes,duration_us");
+
+    while (std::getline(trace, line))
+    {
+        if (line.find(",open,") != std::string::npos) ++opens;
+    }
+
+    BOOST_TEST(opens == 3);
+
+    trace.close();
+    fs::remove(traceFile);
+
+    fs.resetIOStatistics();
+    BOOST_TEST(fs.getIOStatistics().archives.empty());
+}
@@ -13,6 +13,7 @@
 #include <wx/clipbrd.h>
 
 #include <GL/glew.h>
+#include <algorithm>
 #include <functional>
 
 namespace ui
@@ -44,6 +45,9 @@ TexturePreviewCombo::TexturePreviewCombo(wxWindow* parent) :
 		new wxutil::StockIconTextMenuItem(_("Copy shader name"), wxART_COPY),
         std::bind(&TexturePreviewCombo::_onCopyTexName, this)
     );
+
+    GlobalMaterialManager().signal_TexturesUploaded().connect(
+        sigc::mem_fun(this, &TexturePreviewCombo::_onTexturesUploaded));
 }
 
 // Update the selected texture
@@ -98,6 +102,14 @@ void TexturePreviewCombo::_onContextMenu(wxDataViewEvent& ev)
 	_contextMenu->show(_infoTable);
 }
 
+void TexturePreviewCombo::_onTexturesUploaded()
+{
+	if (!_texName.empty())
+	{
+		_glWidget->Refresh();
+	}
+}
+
 // CALLBACKS
 void TexturePreviewCombo::_onRender()
 {
@@ -127,8 +139,10 @@ void TexturePreviewCombo::_onRender()
 		// Get a reference to the selected shader
 		MaterialPtr shader = GlobalMaterialManager().getMaterialForName(_texName);
 
-		// This is an "ordinary" texture, take the editor image
-		TexturePtr tex = shader->getEditorImage();
+		// This is an "ordinary" texture, take the editor image. Small previews
+		// show the thumbnail, which doesn't need the full image to be loaded.
+		TexturePtr tex = std::min(req.GetWidth(), req.GetHeight()) <= static_cast<int>(Material::THUMBNAIL_SIZE) ?
+			shader->getEditorThumbnail() : shader->getEditorImage();
 
 		if (tex != NULL)
 		{
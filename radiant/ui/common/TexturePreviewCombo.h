@@ -3,6 +3,7 @@
 #include <string>
 #include "wxutil/menu/PopupMenu.h"
 #include <wx/panel.h>
+#include <sigc++/trackable.h>
 
 namespace wxutil
 { 
@@ -20,7 +21,8 @@ namespace ui
  * a List View showing information about that texture.
  */
 class TexturePreviewCombo :
-	public wxPanel
+	public wxPanel,
+	public sigc::trackable
 {
 	// The OpenGL preview widget
 	wxutil::GLWidget* _glWidget;
@@ -54,6 +56,9 @@ private:
 	// render callback
 	void _onRender();
 
+	// Redraws the preview once its texture has been loaded in the background
+	void _onTexturesUploaded();
+
 	// Refresh info table utility function
 	void refreshInfoTable();
 
@@ -76,7 +76,7 @@ public:
             return;
         }
 
-        TexturePtr texture = material->getEditorImage();
+        TexturePtr texture = _owner.getTileTexture(material);
         if (!texture) return;
 
         // Is this texture visible?
@@ -257,6 +257,10 @@ TextureBrowser::TextureBrowser(wxWindow* parent) :
     GlobalMaterialManager().signal_activeShadersChanged().connect(
         sigc::mem_fun(this, &TextureBrowser::onActiveShadersChanged));
 
+    // Textures loaded in the background replace their placeholders
+    GlobalMaterialManager().signal_TexturesUploaded().connect(
+        sigc::mem_fun(this, &TextureBrowser::queueDraw));
+
     Connect(wxEVT_IDLE, wxIdleEventHandler(TextureBrowser::onIdle), nullptr, this);
 
     SetSizer(new wxBoxSizer(wxHORIZONTAL));
@@ -453,6 +457,17 @@ int TextureBrowser::getTextureHeight(const Texture& tex) const
     }
 }
 
+TexturePtr TextureBrowser::getTileTexture(const MaterialPtr& material) const
+{
+    // Thumbnails don't need the full image to be loaded
+    if (_uniformTextureSize <= static_cast<int>(Material::THUMBNAIL_SIZE))
+    {
+        return material->getEditorThumbnail();
+    }
+
+    return material->getEditorImage();
+}
+
 const std::string& TextureBrowser::getSelectedShader() const
 {
     return _shader;
@@ -629,7 +644,7 @@ void TextureBrowser::performUpdate()
 
         tile.material = mat;
 
-        Texture& texture = *tile.material->getEditorImage();
+        Texture& texture = *getTileTexture(tile.material);
 
         tile.position = getPositionForTexture(layout, texture);
         tile.size.x() = getTextureWidth(texture);
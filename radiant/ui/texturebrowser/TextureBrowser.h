@@ -224,6 +224,11 @@ private:
      */
     bool materialIsVisible(const MaterialPtr& material);
 
+    /** Returns the texture to draw the tile of the given material with,
+     * which is the cached thumbnail unless the tiles are larger than that.
+     */
+    TexturePtr getTileTexture(const MaterialPtr& material) const;
+
 	// wx callbacks
     void onIdle(wxIdleEvent& ev);
 	void onRender();
@@ -29,7 +29,7 @@ public:
 		_name(name),
 		_istream(archiveName),
 		_substream(_istream, position, stream_size),
-		_zipstream(_substream), 
+		_zipstream(_substream, stream_size, file_size),
 		_size(file_size)
 	{}
 
@@ -18,7 +18,7 @@ private:
 	stream::FileInputStream _istream;
 	stream::SubFileInputStream _substream;	// reads subset of _istream
 	DeflatedInputStream _zipstream;	// inflates data from _substream
-	stream::BinaryToTextInputStream<DeflatedInputStream> _textStream; // converts data from _zipstream
+	stream::WholeFileBinaryToTextInputStream<DeflatedInputStream> _textStream; // converts data from _zipstream
 
     // Mod directory containing this file
     const std::string _modRoot;
@@ -37,12 +37,13 @@ public:
                             const std::string& archiveName, // full path to ZIP file
                             const std::string& modRoot,
                             position_type position,
-                            size_type stream_size) : 
+                            size_type stream_size,
+                            size_type file_size) : 
 		_name(name),
 		_istream(archiveName),
 		_substream(_istream, position, stream_size),
-		_zipstream(_substream),
-		_textStream(_zipstream),
+		_zipstream(_substream, stream_size, file_size),
+		_textStream(_zipstream, file_size),
 		_modRoot(modRoot)
     {}
 
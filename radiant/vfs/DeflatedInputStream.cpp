@@ -1,17 +1,40 @@
 #include "DeflatedInputStream.h"
 
+// We need the HAVE_* symbols created by the configure script
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include <zlib.h>
 
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
 namespace archive
 {
 
+namespace
+{
+	// Size of the compressed input window used in streaming mode
+	const std::size_t STREAMING_BUFFER_SIZE = 16384;
+}
+
 DeflatedInputStream::DeflatedInputStream(InputStream& istream) :
+	DeflatedInputStream(istream, 0, 0)
+{}
+
+DeflatedInputStream::DeflatedInputStream(InputStream& istream, size_type compressedSize, size_type uncompressedSize) :
 	_istream(istream),
-	_zipStream(new z_stream)
+	_zipStream(new z_stream),
+	_compressedSize(compressedSize),
+	_uncompressedSize(uncompressedSize),
+	_exhausted(false)
 {
 	_zipStream->zalloc = 0;
 	_zipStream->zfree = 0;
 	_zipStream->opaque = 0;
+	_zipStream->next_in = nullptr;
 	_zipStream->avail_in = 0;
 
 	inflateInit2(_zipStream.get(), -MAX_WBITS);
@@ -24,6 +47,80 @@ DeflatedInputStream::~DeflatedInputStream()
 
 DeflatedInputStream::size_type DeflatedInputStream::read(byte_type* buffer, size_type length)
 {
+	if (_exhausted)
+	{
+		return 0;
+	}
+
+	if (canReadEntireEntry(length))
+	{
+		return readEntireEntry(buffer, length);
+	}
+
+	return inflateStreaming(buffer, length);
+}
+
+bool DeflatedInputStream::canReadEntireEntry(size_type length) const
+{
+	// Only possible as first read on this stream, and only if the caller wants everything
+	return _compressedSize > 0 && _uncompressedSize > 0 && length >= _uncompressedSize &&
+		_zipStream->total_in == 0 && _zipStream->avail_in == 0;
+}
+
+DeflatedInputStream::size_type DeflatedInputStream::readEntireEntry(byte_type* buffer, size_type length)
+{
+	// Pull the whole compressed entry from the wrapped stream in one go
+	_buffer.resize(_compressedSize);
+	size_type compressedBytes = _istream.read(_buffer.data(), _compressedSize);
+
+#ifdef HAVE_LIBDEFLATE
+	{
+		std::unique_ptr<libdeflate_decompressor, decltype(&libdeflate_free_decompressor)> decompressor(
+			libdeflate_alloc_decompressor(), libdeflate_free_decompressor);
+
+		std::size_t inflatedBytes = 0;
+
+		if (decompressor && libdeflate_deflate_decompress(decompressor.get(), _buffer.data(), compressedBytes,
+			buffer, _uncompressedSize, &inflatedBytes) == LIBDEFLATE_SUCCESS)
+		{
+			_exhausted = true;
+			return inflatedBytes;
+		}
+
+		// Fall through and let zlib deal with the data, it will report any errors the same
+		// way the streaming path does
+	}
+#endif
+
+	// Hand the entire input to zlib, Z_FINISH allows it to skip the sliding window
+	_zipStream->next_in = _buffer.data();
+	_zipStream->avail_in = static_cast<uInt>(compressedBytes);
+	_zipStream->next_out = buffer;
+	_zipStream->avail_out = static_cast<uInt>(length);
+
+	int result = inflate(_zipStream.get(), Z_FINISH);
+
+	size_type inflatedBytes = length - _zipStream->avail_out;
+
+	if (result != Z_STREAM_END && result != Z_BUF_ERROR)
+	{
+		// Corrupt data, nothing more to get out of this stream
+		_exhausted = true;
+	}
+
+	// On Z_BUF_ERROR (the recorded size was wrong) any further read()
+	// continues in streaming mode using the remaining input in _buffer
+	return inflatedBytes;
+}
+
+DeflatedInputStream::size_type DeflatedInputStream::inflateStreaming(byte_type* buffer, size_type length)
+{
+	// Don't touch the buffer while z_stream still refers to it
+	if (_zipStream->avail_in == 0 && _buffer.size() < STREAMING_BUFFER_SIZE)
+	{
+		_buffer.resize(STREAMING_BUFFER_SIZE);
+	}
+
 	// Tell inflate() to load the data directly to the given buffer
 	_zipStream->next_out = buffer;
 	_zipStream->avail_out = static_cast<uInt>(length);
@@ -33,8 +130,8 @@ DeflatedInputStream::size_type DeflatedInputStream::read(byte_type* buffer, size
 		if (_zipStream->avail_in == 0)
 		{
 			// Load some data from the wrapped buffer and point z_stream to it
-			_zipStream->next_in = _buffer;
-			_zipStream->avail_in = static_cast<uInt>(_istream.read(_buffer, sizeof(_buffer)));
+			_zipStream->next_in = _buffer.data();
+			_zipStream->avail_in = static_cast<uInt>(_istream.read(_buffer.data(), _buffer.size()));
 		}
 
 		if (inflate(_zipStream.get(), Z_SYNC_FLUSH) != Z_OK)
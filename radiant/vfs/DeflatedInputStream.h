@@ -2,6 +2,7 @@
 
 #include "idatastream.h"
 #include <memory>
+#include <vector>
 
 // Forward decl.
 struct z_stream_s;
@@ -14,21 +15,47 @@ namespace archive
 ///
 /// - Uses z_stream to decompress the data stream on the fly.
 /// - Uses a buffer to reduce the number of times the wrapped stream must be read.
+/// - If the compressed and uncompressed sizes are known, a first read() requesting
+///   the entire file is served by inflating the whole entry in a single step
+///   (using libdeflate if available at configure time).
 class DeflatedInputStream :
 	public InputStream
 {
 private:
 	InputStream& _istream;
 	std::unique_ptr<z_stream> _zipStream;
-	unsigned char _buffer[1024];
+
+	// Holds the compressed input, either a small window (streaming mode)
+	// or the entire compressed entry (after a whole-entry read)
+	std::vector<byte_type> _buffer;
+
+	// Sizes of the deflated entry, 0 if unknown
+	size_type _compressedSize;
+	size_type _uncompressedSize;
+
+	// Set after the whole entry has been delivered by the fast path
+	bool _exhausted;
 
 public:
 	DeflatedInputStream(InputStream& istream);
 
+	// Construct a stream for an entry of known size, enabling the whole-entry fast path
+	DeflatedInputStream(InputStream& istream, size_type compressedSize, size_type uncompressedSize);
+
 	virtual ~DeflatedInputStream();
 
 	// InputStream implementation
 	size_type read(byte_type* buffer, size_type length) override;
+
+private:
+	// Returns true if the given read request can be served by readEntireEntry()
+	bool canReadEntireEntry(size_type length) const;
+
+	// Single-shot inflation of the whole entry into the given buffer
+	size_type readEntireEntry(byte_type* buffer, size_type length);
+
+	// Incremental inflation, used for partial reads
+	size_type inflateStreaming(byte_type* buffer, size_type length);
 };
 
 }
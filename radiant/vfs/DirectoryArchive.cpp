@@ -98,3 +98,30 @@ void DirectoryArchive::traverse(Visitor& visitor, const std::string& root)
 		}
 	}
 }
+
+void DirectoryArchive::setWatchingEnabled(bool enabled)
+{
+	if (!enabled)
+	{
+		_watcher.reset();
+		return;
+	}
+
+	if (!_watcher)
+	{
+		_watcher.reset(new vfs::DirectoryWatcher(_root));
+
+		if (!_watcher->start())
+		{
+			_watcher.reset();
+		}
+	}
+}
+
+void DirectoryArchive::collectChangedFiles(std::set<std::string>& changedFiles)
+{
+	if (_watcher)
+	{
+		_watcher->collectChanges(changedFiles);
+	}
+}
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Archive.h"
+#include "DirectoryWatcher.h"
+
+#include <memory>
+#include <set>
 
 /**
  * greebo: This wraps around a certain path in the "real"
@@ -19,6 +23,9 @@ class DirectoryArchive :
 	// of the VFS anyway.
 	mutable std::string _modName;
 
+	// Monitors the directory tree if file watching is enabled
+	std::unique_ptr<vfs::DirectoryWatcher> _watcher;
+
 public:
 	// Pass the root path to the constructor
 	DirectoryArchive(const std::string& root);
@@ -30,5 +37,12 @@ public:
 	virtual bool containsFile(const std::string& name) override;
 
 	virtual void traverse(Visitor& visitor, const std::string& root) override;
+
+	// Starts or stops monitoring the directory tree for changes
+	void setWatchingEnabled(bool enabled);
+
+	// Adds the names of all files changed on disk since the last call
+	// to the given set. Does nothing if watching is not enabled.
+	void collectChangedFiles(std::set<std::string>& changedFiles);
 };
 typedef std::shared_ptr<DirectoryArchive> DirectoryArchivePtr;
@@ -0,0 +1,219 @@
+#include "DirectoryWatcher.h"
+
+#include "itextstream.h"
+#include "os/fs.h"
+#include "string/predicate.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace vfs
+{
+
+namespace
+{
+
+#if defined(__linux__)
+	// Files are reported once they've been closed after writing, moved
+	// in or out or deleted. Created directories are picked up to watch them too.
+	const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+		IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+	const std::size_t EVENT_BUFFER_SIZE = 16384;
+#endif
+
+}
+
+DirectoryWatcher::DirectoryWatcher(const std::string& root) :
+	_root(root),
+	_fd(-1)
+{}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+	stop();
+}
+
+bool DirectoryWatcher::start()
+{
+	if (isRunning())
+	{
+		return true;
+	}
+
+#if defined(__linux__)
+	_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (_fd < 0)
+	{
+		rWarning() << "[vfs] Cannot monitor " << _root << ": " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	addWatches("", nullptr);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void DirectoryWatcher::stop()
+{
+#if defined(__linux__)
+	if (_fd >= 0)
+	{
+		// Closing the descriptor releases all watches
+		close(_fd);
+	}
+#endif
+
+	_fd = -1;
+	_watches.clear();
+}
+
+bool DirectoryWatcher::isRunning() const
+{
+	return _fd >= 0;
+}
+
+void DirectoryWatcher::collectChanges(std::set<std::string>& changedFiles)
+{
+#if defined(__linux__)
+	if (_fd < 0)
+	{
+		return;
+	}
+
+	std::vector<char> buffer(EVENT_BUFFER_SIZE);
+
+	while (true)
+	{
+		ssize_t length = read(_fd, buffer.data(), buffer.size());
+
+		if (length <= 0)
+		{
+			break; // EAGAIN: nothing more to read
+		}
+
+		for (ssize_t offset = 0; offset < length; )
+		{
+			inotify_event event;
+			std::memcpy(&event, buffer.data() + offset, sizeof(event));
+
+			const char* name = buffer.data() + offset + sizeof(event);
+			offset += sizeof(event) + event.len;
+
+			if (event.mask & IN_Q_OVERFLOW)
+			{
+				rWarning() << "[vfs] Too many changes in " << _root <<
+					", some of them have been missed." << std::endl;
+				continue;
+			}
+
+			auto watch = _watches.find(event.wd);
+
+			if (watch == _watches.end())
+			{
+				continue;
+			}
+
+			if (event.mask & IN_IGNORED)
+			{
+				// The directory has been deleted
+				_watches.erase(watch);
+				continue;
+			}
+
+			if (event.len == 0)
+			{
+				continue; // event concerning the watched directory itself
+			}
+
+			std::string path = watch->second + name;
+
+			if (event.mask & IN_ISDIR)
+			{
+				if (event.mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					// Any files in a directory moved into the tree are new to us
+					addWatches(path + "/", &changedFiles);
+				}
+				else if (event.mask & IN_MOVED_FROM)
+				{
+					removeWatches(path + "/");
+				}
+			}
+			else if (!(event.mask & IN_CREATE))
+			{
+				// Newly created files will be reported once they're written
+				changedFiles.insert(path);
+			}
+		}
+	}
+#endif
+}
+
+void DirectoryWatcher::addWatches(const std::string& relativeDir, std::set<std::string>* foundFiles)
+{
+#if defined(__linux__)
+	std::string path = _root + relativeDir;
+
+	int wd = inotify_add_watch(_fd, path.c_str(), WATCH_MASK);
+
+	if (wd < 0)
+	{
+		rWarning() << "[vfs] Cannot monitor " << path << ": " << strerror(errno) << std::endl;
+		return;
+	}
+
+	_watches[wd] = relativeDir;
+
+	try
+	{
+		for (fs::directory_iterator it(path); it != fs::directory_iterator(); ++it)
+		{
+			std::string filename = it->path().filename().string();
+
+			if (fs::is_directory(it->path()))
+			{
+				addWatches(relativeDir + filename + "/", foundFiles);
+			}
+			else if (foundFiles != nullptr)
+			{
+				foundFiles->insert(relativeDir + filename);
+			}
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		rWarning() << "[vfs] Cannot traverse " << path << ": " << ex.what() << std::endl;
+	}
+#endif
+}
+
+void DirectoryWatcher::removeWatches(const std::string& relativeDir)
+{
+#if defined(__linux__)
+	for (auto i = _watches.begin(); i != _watches.end(); )
+	{
+		if (string::starts_with(i->second, relativeDir))
+		{
+			inotify_rm_watch(_fd, i->first);
+			_watches.erase(i++);
+		}
+		else
+		{
+			++i;
+		}
+	}
+#endif
+}
+
+}
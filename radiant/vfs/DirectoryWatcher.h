@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace vfs
+{
+
+/**
+ * Monitors a directory tree in the physical filesystem for changes. This is
+ * using inotify on Linux, on other platforms start() will fail and the
+ * watcher won't report anything.
+ *
+ * No threads are involved, the pending change events are picked up
+ * by calling collectChanges().
+ */
+class DirectoryWatcher
+{
+private:
+	// The root path of the monitored tree, including trailing slash
+	std::string _root;
+
+	// The inotify instance, -1 if not running
+	int _fd;
+
+	// Watch descriptors, mapped to the root-relative directory they're
+	// watching (including trailing slash, empty for the root itself)
+	std::map<int, std::string> _watches;
+
+public:
+	DirectoryWatcher(const std::string& root);
+	~DirectoryWatcher();
+
+	DirectoryWatcher(const DirectoryWatcher&) = delete;
+	DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+	// Starts monitoring the directory tree, returns false on failure
+	bool start();
+
+	// Stops monitoring, any pending events are discarded
+	void stop();
+
+	bool isRunning() const;
+
+	// Adds the root-relative paths of all files which have been written,
+	// moved or deleted since the last call to the given set.
+	void collectChanges(std::set<std::string>& changedFiles);
+
+private:
+	// Watches the given directory and all of its subdirectories. If foundFiles
+	// is not null, the names of all existing files are added to it.
+	void addWatches(const std::string& relativeDir, std::set<std::string>* foundFiles);
+
+	// Stops watching the given directory and all of its subdirectories
+	void removeWatches(const std::string& relativeDir);
+};
+
+}
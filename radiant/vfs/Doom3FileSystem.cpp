@@ -37,6 +37,8 @@
 #include "DirectoryArchive.h"
 #include "DirectoryArchiveFile.h"
 #include "DirectoryArchiveTextFile.h"
+#include "MemoryArchiveTextFile.h"
+#include "InstrumentedArchiveFile.h"
 #include "SortedFilenames.h"
 #include "ZipArchive.h"
 #include "modulesystem/StaticModule.h"
@@ -47,6 +49,10 @@ namespace vfs
 namespace
 {
 
+// Reading files is mostly bound by I/O and decompression, don't use
+// more than a few threads for openTextFilesAsync()
+const std::size_t MAX_LOADER_THREADS = 4;
+
 // Representation of an assets.lst file, containing visibility information for
 // assets within a particular folder.
 class AssetsList
@@ -237,6 +243,12 @@ public:
 
 }
 
+Doom3FileSystem::Doom3FileSystem() :
+    _loaderPool(std::min(util::ThreadPool::getDefaultNumThreads(), MAX_LOADER_THREADS)),
+    _watchFiles(false),
+    _ioStatistics(std::make_shared<IOStatisticsCollector>())
+{}
+
 void Doom3FileSystem::initDirectory(const std::string& inputPath)
 {
     // greebo: Normalise path: Replace backslashes and ensure trailing slash
@@ -330,6 +342,8 @@ void Doom3FileSystem::initialise(const SearchPaths& vfsSearchPaths, const Extens
         initDirectory(path);
     }
 
+    updateFileWatching();
+
     for (Observer* observer : _observers)
     {
         observer->onFileSystemInitialise();
@@ -343,6 +357,9 @@ void Doom3FileSystem::shutdown()
         observer->onFileSystemShutdown();
     }
 
+    // Let any pending async loads finish before the archives go away
+    _loaderPool.stop();
+
     _archives.clear();
     _directories.clear();
     _vfsSearchPaths.clear();
@@ -386,13 +403,16 @@ ArchiveFilePtr Doom3FileSystem::openFile(const std::string& filename)
         return ArchiveFilePtr();
     }
 
+    auto start = IOStatisticsCollector::Clock::now();
+
     for (const ArchiveDescriptor& descriptor : _archives)
     {
         ArchiveFilePtr file = descriptor.archive->openFile(filename);
 
         if (file)
         {
-            return file;
+            return std::make_shared<archive::InstrumentedArchiveFile>(file, _ioStatistics,
+                descriptor.name, IOStatisticsCollector::Clock::now() - start);
         }
     }
 
@@ -415,13 +435,16 @@ ArchiveFilePtr Doom3FileSystem::openFileInAbsolutePath(const std::string& filena
 
 ArchiveTextFilePtr Doom3FileSystem::openTextFile(const std::string& filename)
 {
+    auto start = IOStatisticsCollector::Clock::now();
+
     for (const ArchiveDescriptor& descriptor : _archives)
     {
         ArchiveTextFilePtr file = descriptor.archive->openTextFile(filename);
 
         if (file)
         {
-            return file;
+            return std::make_shared<archive::InstrumentedArchiveTextFile>(file, _ioStatistics,
+                descriptor.name, IOStatisticsCollector::Clock::now() - start);
         }
     }
 
@@ -441,6 +464,43 @@ ArchiveTextFilePtr Doom3FileSystem::openTextFileInAbsolutePath(const std::string
     return ArchiveTextFilePtr();
 }
 
+std::vector<std::future<ArchiveTextFilePtr>> Doom3FileSystem::openTextFilesAsync(const std::vector<std::string>& filenames)
+{
+    std::vector<std::future<ArchiveTextFilePtr>> result;
+    result.reserve(filenames.size());
+
+    for (const std::string& filename : filenames)
+    {
+        result.emplace_back(_loaderPool.submit([this, filename]()
+        {
+            auto start = IOStatisticsCollector::Clock::now();
+
+            for (const ArchiveDescriptor& descriptor : _archives)
+            {
+                ArchiveTextFilePtr file = descriptor.archive->openTextFile(filename);
+
+                if (file)
+                {
+                    // Account for the reads performed by the worker
+                    archive::InstrumentedArchiveTextFile instrumented(file, _ioStatistics,
+                        descriptor.name, IOStatisticsCollector::Clock::now() - start);
+
+                    // PK4 contents belong to the mod folder containing the PK4
+                    std::string modRoot = descriptor.is_pakfile ?
+                        os::standardPathWithSlash(fs::path(descriptor.name).remove_filename()) : descriptor.name;
+
+                    // Read the contents right here, the worker thread is taking the hit
+                    return ArchiveTextFilePtr(std::make_shared<archive::MemoryArchiveTextFile>(instrumented, modRoot));
+                }
+            }
+
+            return ArchiveTextFilePtr();
+        }));
+    }
+
+    return result;
+}
+
 void Doom3FileSystem::forEachFile(const std::string& basedir,
                                   const std::string& extension,
                                   const VisitorFunc& visitorFunc,
@@ -547,6 +607,121 @@ const SearchPaths& Doom3FileSystem::getVfsSearchPaths()
     return _vfsSearchPaths;
 }
 
+bool Doom3FileSystem::getFileStamp(const std::string& filename, FileStamp& stamp)
+{
+    std::string fixedFilename(os::standardPath(filename));
+
+    for (const ArchiveDescriptor& descriptor : _archives)
+    {
+        if (!descriptor.archive->containsFile(fixedFilename))
+        {
+            continue;
+        }
+
+        // PK4 contents share the stamp of their PK4
+        fs::path physicalPath = descriptor.is_pakfile ?
+            fs::path(descriptor.name) : fs::path(descriptor.name + fixedFilename);
+
+        try
+        {
+            stamp.archive = descriptor.name;
+            stamp.size = static_cast<std::uint64_t>(fs::file_size(physicalPath));
+            stamp.modificationTime = os::getLastWriteTime(physicalPath);
+        }
+        catch (const fs::filesystem_error& ex)
+        {
+            rWarning() << "[vfs] Cannot stat " << physicalPath.string() << ": " << ex.what() << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void Doom3FileSystem::setFileWatchingEnabled(bool enabled)
+{
+    if (_watchFiles != enabled)
+    {
+        _watchFiles = enabled;
+        updateFileWatching();
+    }
+}
+
+void Doom3FileSystem::updateFileWatching()
+{
+    for (const ArchiveDescriptor& descriptor : _archives)
+    {
+        if (!descriptor.is_pakfile)
+        {
+            std::static_pointer_cast<DirectoryArchive>(descriptor.archive)->setWatchingEnabled(_watchFiles);
+        }
+    }
+}
+
+void Doom3FileSystem::dispatchFileChanges()
+{
+    if (!_watchFiles)
+    {
+        return;
+    }
+
+    std::set<std::string> changedFiles;
+
+    for (auto i = _archives.begin(); i != _archives.end(); ++i)
+    {
+        if (i->is_pakfile)
+        {
+            continue;
+        }
+
+        std::set<std::string> archiveChanges;
+        std::static_pointer_cast<DirectoryArchive>(i->archive)->collectChangedFiles(archiveChanges);
+
+        for (const std::string& filename : archiveChanges)
+        {
+            // A change is not visible if the file is overridden by an archive with higher priority
+            bool overridden = std::any_of(_archives.begin(), i, [&](const ArchiveDescriptor& other)
+            {
+                return other.archive->containsFile(filename);
+            });
+
+            if (!overridden)
+            {
+                changedFiles.insert(filename);
+            }
+        }
+    }
+
+    if (changedFiles.empty())
+    {
+        return;
+    }
+
+    rMessage() << "[vfs] " << changedFiles.size() << " file(s) changed on disk" << std::endl;
+
+    for (Observer* observer : _observers)
+    {
+        observer->onFilesChanged(changedFiles);
+    }
+}
+
+IOStatisticsReport Doom3FileSystem::getIOStatistics()
+{
+    return _ioStatistics->getReport();
+}
+
+void Doom3FileSystem::resetIOStatistics()
+{
+    _ioStatistics->reset();
+}
+
+bool Doom3FileSystem::setIOTraceFile(const std::string& path)
+{
+    return _ioStatistics->setTraceFile(path);
+}
+
 // RegisterableModule implementation
 const std::string& Doom3FileSystem::getName() const
 {
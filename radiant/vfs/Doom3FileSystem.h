@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Archive.h"
+#include "IOStatistics.h"
 #include "ifilesystem.h"
+#include "util/ThreadPool.h"
 
 namespace vfs
 {
@@ -30,7 +32,18 @@ private:
 	typedef std::set<Observer*> ObserverList;
 	ObserverList _observers;
 
+	// Workers serving openTextFilesAsync()
+	util::ThreadPool _loaderPool;
+
+	// Whether the directories should be monitored for changes
+	bool _watchFiles;
+
+	// Shared with the instrumented files, which might outlive the VFS
+	IOStatisticsCollectorPtr _ioStatistics;
+
 public:
+	Doom3FileSystem();
+
 	void initialise(const SearchPaths& vfsSearchPaths, const ExtensionSet& allowedExtensions) override;
 	void shutdown() override;
 
@@ -41,6 +54,8 @@ public:
 	ArchiveFilePtr openFileInAbsolutePath(const std::string& filename) override;
 	ArchiveTextFilePtr openTextFileInAbsolutePath(const std::string& filename) override;
 
+	std::vector<std::future<ArchiveTextFilePtr>> openTextFilesAsync(const std::vector<std::string>& filenames) override;
+
 	// Call the specified callback function for each file matching extension
 	// inside basedir.
 	void forEachFile(const std::string& basedir, const std::string& extension,
@@ -58,6 +73,14 @@ public:
 	void removeObserver(Observer& observer) override;
 
 	const SearchPaths& getVfsSearchPaths() override;
+	bool getFileStamp(const std::string& filename, FileStamp& stamp) override;
+
+	void setFileWatchingEnabled(bool enabled) override;
+	void dispatchFileChanges() override;
+
+	IOStatisticsReport getIOStatistics() override;
+	void resetIOStatistics() override;
+	bool setIOTraceFile(const std::string& path) override;
 
 	// RegisterableModule implementation
 	const std::string& getName() const override;
@@ -68,6 +91,9 @@ public:
 private:
 	void initDirectory(const std::string& path);
 	void initPakFile(const std::string& filename);
+
+	// Applies the current watch setting to all directory archives
+	void updateFileWatching();
 };
 
 }
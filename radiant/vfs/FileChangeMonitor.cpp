@@ -0,0 +1,113 @@
+#include "FileChangeMonitor.h"
+
+#include <sigc++/functors/mem_fun.h>
+
+#include "i18n.h"
+#include "iradiant.h"
+#include "iregistry.h"
+#include "ifilesystem.h"
+#include "imainframe.h"
+#include "ipreferencesystem.h"
+#include "itextstream.h"
+
+#include "registry/registry.h"
+#include "modulesystem/StaticModule.h"
+
+namespace vfs
+{
+
+namespace
+{
+	const int TIMER_INTERVAL_MSECS = 500;
+	const char* const RKEY_WATCH_FILES = "user/ui/vfs/watchFiles";
+}
+
+const std::string& FileChangeMonitor::getName() const
+{
+	static std::string _name("FileChangeMonitor");
+	return _name;
+}
+
+const StringSet& FileChangeMonitor::getDependencies() const
+{
+	static StringSet _dependencies;
+
+	if (_dependencies.empty())
+	{
+		_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
+		_dependencies.insert(MODULE_XMLREGISTRY);
+		_dependencies.insert(MODULE_PREFERENCESYSTEM);
+		_dependencies.insert(MODULE_RADIANT);
+		_dependencies.insert(MODULE_MAINFRAME);
+	}
+
+	return _dependencies;
+}
+
+void FileChangeMonitor::initialiseModule(const ApplicationContext& ctx)
+{
+	rMessage() << getName() << "::initialiseModule called." << std::endl;
+
+	IPreferencePage& page = GlobalPreferenceSystem().getPage(_("Settings/Filesystem"));
+	page.appendCheckBox(_("Reload changed materials, entityDefs, skins and models"), RKEY_WATCH_FILES);
+
+	GlobalRegistry().signalForKey(RKEY_WATCH_FILES).connect(
+		sigc::mem_fun(this, &FileChangeMonitor::keyChanged)
+	);
+
+	// Start monitoring when the application has come up
+	GlobalRadiant().signal_radiantStarted().connect(
+		sigc::mem_fun(*this, &FileChangeMonitor::onRadiantStartup));
+}
+
+void FileChangeMonitor::shutdownModule()
+{
+	_timer.reset();
+
+	GlobalFileSystem().setFileWatchingEnabled(false);
+}
+
+void FileChangeMonitor::onRadiantStartup()
+{
+	Bind(wxEVT_TIMER, sigc::mem_fun(*this, &FileChangeMonitor::onIntervalReached));
+
+	_timer.reset(new wxTimer(this));
+
+	keyChanged();
+}
+
+void FileChangeMonitor::keyChanged()
+{
+	if (!_timer)
+	{
+		return; // not started yet
+	}
+
+	bool enabled = registry::getValue<bool>(RKEY_WATCH_FILES);
+
+	GlobalFileSystem().setFileWatchingEnabled(enabled);
+
+	if (enabled)
+	{
+		_timer->Start(TIMER_INTERVAL_MSECS);
+	}
+	else
+	{
+		_timer->Stop();
+	}
+}
+
+void FileChangeMonitor::onIntervalReached(wxTimerEvent& ev)
+{
+	// Don't interfere with long-running operations, the
+	// changes will be picked up once they are done
+	if (GlobalMainFrame().screenUpdatesEnabled())
+	{
+		GlobalFileSystem().dispatchFileChanges();
+	}
+}
+
+// Static module instance
+module::StaticModule<FileChangeMonitor> fileChangeMonitorModule;
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "imodule.h"
+
+#include <memory>
+#include <wx/event.h>
+#include <wx/timer.h>
+
+namespace vfs
+{
+
+/**
+ * Periodically lets the VFS dispatch the file changes detected in the
+ * mod directories, such that the material, entityDef, skin and model
+ * managers can reload the affected files. Monitoring can be switched
+ * off in the preferences.
+ */
+class FileChangeMonitor :
+	public RegisterableModule,
+	public wxEvtHandler
+{
+private:
+	// Polls the VFS for changes
+	std::unique_ptr<wxTimer> _timer;
+
+public:
+	const std::string& getName() const override;
+	const StringSet& getDependencies() const override;
+	void initialiseModule(const ApplicationContext& ctx) override;
+	void shutdownModule() override;
+
+private:
+	void onRadiantStartup();
+	void onIntervalReached(wxTimerEvent& ev);
+	void keyChanged();
+};
+
+}
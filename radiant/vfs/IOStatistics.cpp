@@ -0,0 +1,141 @@
+#include "IOStatistics.h"
+
+#include "itextstream.h"
+
+#include <thread>
+
+namespace vfs
+{
+
+namespace
+{
+	inline std::size_t toMicroseconds(IOStatisticsCollector::Clock::duration duration)
+	{
+		return static_cast<std::size_t>(
+			std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+	}
+}
+
+IOStatisticsCollector::IOStatisticsCollector() :
+	_openFiles(0),
+	_tracing(false)
+{}
+
+void IOStatisticsCollector::fileOpened(const FileAccess& access)
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		++_report.archives[access.archive].opens;
+		++_report.extensions[access.extension].opens;
+
+		if (++_openFiles > _report.peakConcurrentReaders)
+		{
+			_report.peakConcurrentReaders = _openFiles;
+		}
+	}
+
+	if (_tracing)
+	{
+		writeTraceEvent("open", access, 0, access.latency);
+	}
+}
+
+void IOStatisticsCollector::fileRead(FileAccess& access, std::size_t bytes, Clock::duration duration)
+{
+	access.bytesRead += bytes;
+	access.latency += duration;
+
+	if (_tracing)
+	{
+		writeTraceEvent("read", access, bytes, duration);
+	}
+}
+
+void IOStatisticsCollector::fileClosed(const FileAccess& access)
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	std::size_t inflated = access.inflated ? access.bytesRead : 0;
+	std::size_t latency = toMicroseconds(access.latency);
+
+	for (IOStatistics* stats : { &_report.archives[access.archive], &_report.extensions[access.extension] })
+	{
+		stats->bytesRead += access.bytesRead;
+		stats->bytesInflated += inflated;
+		stats->latencyMicroseconds += latency;
+	}
+
+	--_openFiles;
+}
+
+IOStatisticsReport IOStatisticsCollector::getReport()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _report;
+}
+
+void IOStatisticsCollector::reset()
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	_report = IOStatisticsReport();
+
+	// Files still open at this point are counting towards the new peak
+	_report.peakConcurrentReaders = _openFiles;
+}
+
+bool IOStatisticsCollector::setTraceFile(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(_traceLock);
+
+	_tracing = false;
+
+	if (_trace.is_open())
+	{
+		_trace.close();
+	}
+
+	if (path.empty())
+	{
+		return true;
+	}
+
+	_trace.open(path, std::ios::out | std::ios::trunc);
+
+	if (!_trace)
+	{
+		rError() << "[vfs] Cannot write I/O trace to " << path << std::endl;
+		return false;
+	}
+
+	_trace << "time_us,thread,event,archive,file,bytes,duration_us" << std::endl;
+
+	_traceStart = Clock::now();
+	_tracing = true;
+
+	return true;
+}
+
+void IOStatisticsCollector::writeTraceEvent(const char* eventName, const FileAccess& access,
+	std::size_t bytes, Clock::duration duration)
+{
+	Clock::time_point now = Clock::now();
+
+	std::lock_guard<std::mutex> lock(_traceLock);
+
+	if (!_trace.is_open())
+	{
+		return; // tracing has been stopped in the meantime
+	}
+
+	_trace << toMicroseconds(now - _traceStart) << ','
+		<< std::this_thread::get_id() << ','
+		<< eventName << ','
+		<< '"' << access.archive << "\",\""
+		<< access.filename << "\","
+		<< bytes << ','
+		<< toMicroseconds(duration) << '\n';
+}
+
+}
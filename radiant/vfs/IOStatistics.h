@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ifilesystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace vfs
+{
+
+/**
+ * Thread-safe collector of the I/O statistics of the VFS, which is
+ * optionally writing a trace of all open and read events to a file.
+ *
+ * The counters are fed by the InstrumentedArchiveFile wrappers handed
+ * out by the Doom3FileSystem.
+ */
+class IOStatisticsCollector
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// Book-keeping of a single opened file. The read counters are accumulated
+	// by the reading thread and added to the totals when the file is closed.
+	struct FileAccess
+	{
+		std::string archive;
+		std::string filename;
+		std::string extension;
+
+		// True if the file needs to be decompressed from a PK4
+		bool inflated = false;
+
+		std::size_t bytesRead = 0;
+		Clock::duration latency = Clock::duration::zero();
+	};
+
+private:
+	std::mutex _lock;
+
+	IOStatisticsReport _report;
+
+	// Number of currently open files, protected by _lock
+	std::size_t _openFiles;
+
+	std::mutex _traceLock;
+	std::ofstream _trace;
+	std::atomic<bool> _tracing;
+	Clock::time_point _traceStart;
+
+public:
+	IOStatisticsCollector();
+
+	IOStatisticsCollector(const IOStatisticsCollector&) = delete;
+	IOStatisticsCollector& operator=(const IOStatisticsCollector&) = delete;
+
+	// Registers the given file as opened. The time spent to open the file
+	// is expected in the access latency.
+	void fileOpened(const FileAccess& access);
+
+	// Accounts for a read operation on the given open file
+	void fileRead(FileAccess& access, std::size_t bytes, Clock::duration duration);
+
+	// Adds the read statistics of the file to the totals
+	void fileClosed(const FileAccess& access);
+
+	IOStatisticsReport getReport();
+	void reset();
+
+	// Starts tracing to the given file, an empty path stops tracing
+	bool setTraceFile(const std::string& path);
+
+private:
+	void writeTraceEvent(const char* eventName, const FileAccess& access,
+		std::size_t bytes, Clock::duration duration);
+};
+
+typedef std::shared_ptr<IOStatisticsCollector> IOStatisticsCollectorPtr;
+
+}
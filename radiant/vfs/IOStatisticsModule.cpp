@@ -0,0 +1,116 @@
+#include "imodule.h"
+#include "ifilesystem.h"
+#include "icommandsystem.h"
+#include "itextstream.h"
+
+#include "modulesystem/StaticModule.h"
+
+#include <fmt/format.h>
+
+namespace vfs
+{
+
+namespace
+{
+
+void printStatistics(const std::string& title, const IOStatisticsReport::StatisticsMap& statistics)
+{
+	rMessage() << fmt::format("{0:<48} {1:>8} {2:>12} {3:>12} {4:>10}",
+		title, "Opens", "Read [kB]", "Inflated [kB]", "Time [ms]") << std::endl;
+
+	for (const auto& pair : statistics)
+	{
+		rMessage() << fmt::format("{0:<48} {1:>8} {2:>12} {3:>12} {4:>10}",
+			pair.first.empty() ? "(none)" : pair.first,
+			pair.second.opens,
+			pair.second.bytesRead / 1024,
+			pair.second.bytesInflated / 1024,
+			pair.second.latencyMicroseconds / 1000) << std::endl;
+	}
+}
+
+}
+
+/**
+ * Provides the console commands to inspect the I/O statistics of the VFS.
+ * These are kept out of the filesystem module itself, which is not
+ * depending on any other module.
+ */
+class IOStatisticsModule :
+	public RegisterableModule
+{
+public:
+	const std::string& getName() const override
+	{
+		static std::string _name("IOStatistics");
+		return _name;
+	}
+
+	const StringSet& getDependencies() const override
+	{
+		static StringSet _dependencies;
+
+		if (_dependencies.empty())
+		{
+			_dependencies.insert(MODULE_VIRTUALFILESYSTEM);
+			_dependencies.insert(MODULE_COMMANDSYSTEM);
+		}
+
+		return _dependencies;
+	}
+
+	void initialiseModule(const ApplicationContext& ctx) override
+	{
+		rMessage() << getName() << "::initialiseModule called." << std::endl;
+
+		// "VfsStatistics" prints the tables, "VfsStatistics reset" clears them afterwards
+		GlobalCommandSystem().addCommand("VfsStatistics",
+			std::bind(&IOStatisticsModule::printStatisticsCmd, this, std::placeholders::_1),
+			{ cmd::ARGTYPE_STRING | cmd::ARGTYPE_OPTIONAL });
+
+		// "VfsTrace <file>" starts tracing, "VfsTrace" without argument stops it
+		GlobalCommandSystem().addCommand("VfsTrace",
+			std::bind(&IOStatisticsModule::traceCmd, this, std::placeholders::_1),
+			{ cmd::ARGTYPE_STRING | cmd::ARGTYPE_OPTIONAL });
+	}
+
+private:
+	void printStatisticsCmd(const cmd::ArgumentList& args)
+	{
+		if (!args.empty() && args[0].getString() != "reset")
+		{
+			rWarning() << "Usage: VfsStatistics [reset]" << std::endl;
+			return;
+		}
+
+		IOStatisticsReport report = GlobalFileSystem().getIOStatistics();
+
+		printStatistics("Archive", report.archives);
+		rMessage() << std::endl;
+		printStatistics("Extension", report.extensions);
+
+		rMessage() << "Peak concurrent readers: " << report.peakConcurrentReaders << std::endl;
+
+		if (!args.empty())
+		{
+			GlobalFileSystem().resetIOStatistics();
+			rMessage() << "VFS statistics have been reset." << std::endl;
+		}
+	}
+
+	void traceCmd(const cmd::ArgumentList& args)
+	{
+		std::string path = !args.empty() ? args[0].getString() : "";
+
+		if (GlobalFileSystem().setIOTraceFile(path))
+		{
+			rMessage() << (path.empty() ? std::string("VFS tracing stopped.") :
+				"Writing VFS trace to " + path) << std::endl;
+		}
+	}
+};
+
+// Static module instance
+module::StaticModule<IOStatisticsModule> ioStatisticsModule;
+
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "iarchive.h"
+#include "idatastream.h"
+#include "os/path.h"
+#include "string/case_conv.h"
+
+#include "IOStatistics.h"
+#include "DeflatedArchiveFile.h"
+#include "DeflatedArchiveTextFile.h"
+
+namespace archive
+{
+
+namespace detail
+{
+
+inline vfs::IOStatisticsCollector::FileAccess createFileAccess(const std::string& archiveName,
+	const std::string& filename, bool inflated, vfs::IOStatisticsCollector::Clock::duration openTime)
+{
+	vfs::IOStatisticsCollector::FileAccess access;
+
+	access.archive = archiveName;
+	access.filename = filename;
+	access.extension = string::to_lower_copy(os::getExtension(filename));
+	access.inflated = inflated;
+	access.latency = openTime;
+
+	return access;
+}
+
+}
+
+/// \brief Wraps an ArchiveFile opened by the VFS, passing all reads through
+/// to the wrapped file while reporting them to the I/O statistics.
+class InstrumentedArchiveFile :
+	public ArchiveFile
+{
+private:
+	class Stream :
+		public InputStream
+	{
+	private:
+		InstrumentedArchiveFile& _owner;
+
+	public:
+		Stream(InstrumentedArchiveFile& owner) :
+			_owner(owner)
+		{}
+
+		size_type read(byte_type* buffer, size_type length) override
+		{
+			auto start = vfs::IOStatisticsCollector::Clock::now();
+			size_type bytesRead = _owner._file->getInputStream().read(buffer, length);
+
+			_owner._collector->fileRead(_owner._access, bytesRead,
+				vfs::IOStatisticsCollector::Clock::now() - start);
+
+			return bytesRead;
+		}
+	};
+
+	ArchiveFilePtr _file;
+	vfs::IOStatisticsCollectorPtr _collector;
+	vfs::IOStatisticsCollector::FileAccess _access;
+	Stream _stream;
+
+public:
+	InstrumentedArchiveFile(const ArchiveFilePtr& file, const vfs::IOStatisticsCollectorPtr& collector,
+		const std::string& archiveName, vfs::IOStatisticsCollector::Clock::duration openTime) :
+		_file(file),
+		_collector(collector),
+		_access(detail::createFileAccess(archiveName, file->getName(),
+			dynamic_cast<DeflatedArchiveFile*>(file.get()) != nullptr, openTime)),
+		_stream(*this)
+	{
+		_collector->fileOpened(_access);
+	}
+
+	~InstrumentedArchiveFile()
+	{
+		_collector->fileClosed(_access);
+	}
+
+	std::size_t size() const override
+	{
+		return _file->size();
+	}
+
+	const std::string& getName() const override
+	{
+		return _file->getName();
+	}
+
+	InputStream& getInputStream() override
+	{
+		return _stream;
+	}
+};
+
+/// \brief Text file counterpart of the InstrumentedArchiveFile
+class InstrumentedArchiveTextFile :
+	public ArchiveTextFile
+{
+private:
+	class Stream :
+		public TextInputStream
+	{
+	private:
+		InstrumentedArchiveTextFile& _owner;
+
+	public:
+		Stream(InstrumentedArchiveTextFile& owner) :
+			_owner(owner)
+		{}
+
+		std::size_t read(char* buffer, std::size_t length) override
+		{
+			auto start = vfs::IOStatisticsCollector::Clock::now();
+			std::size_t charsRead = _owner._file->getInputStream().read(buffer, length);
+
+			_owner._collector->fileRead(_owner._access, charsRead,
+				vfs::IOStatisticsCollector::Clock::now() - start);
+
+			return charsRead;
+		}
+	};
+
+	ArchiveTextFilePtr _file;
+	vfs::IOStatisticsCollectorPtr _collector;
+	vfs::IOStatisticsCollector::FileAccess _access;
+	Stream _stream;
+
+public:
+	InstrumentedArchiveTextFile(const ArchiveTextFilePtr& file, const vfs::IOStatisticsCollectorPtr& collector,
+		const std::string& archiveName, vfs::IOStatisticsCollector::Clock::duration openTime) :
+		_file(file),
+		_collector(collector),
+		_access(detail::createFileAccess(archiveName, file->getName(),
+			dynamic_cast<DeflatedArchiveTextFile*>(file.get()) != nullptr, openTime)),
+		_stream(*this)
+	{
+		_collector->fileOpened(_access);
+	}
+
+	~InstrumentedArchiveTextFile()
+	{
+		_collector->fileClosed(_access);
+	}
+
+	const std::string& getName() const override
+	{
+		return _file->getName();
+	}
+
+	TextInputStream& getInputStream() override
+	{
+		return _stream;
+	}
+
+	std::string getModName() const override
+	{
+		return _file->getModName();
+	}
+};
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "iarchive.h"
+#include "gamelib.h"
+#include "stream/BufferInputStream.h"
+
+namespace archive
+{
+
+/// \brief An ArchiveTextFile whose contents have been read into memory.
+/// Constructed from another ArchiveTextFile (located in the given mod
+/// directory), which is read completely and can be released afterwards.
+class MemoryArchiveTextFile :
+	public ArchiveTextFile
+{
+private:
+	std::string _name;
+	std::string _contents;
+
+	// Mod directory containing the source file
+	std::string _modRoot;
+
+	stream::BufferInputStream _inputStream;
+
+public:
+	MemoryArchiveTextFile(ArchiveTextFile& source, const std::string& modRoot) :
+		_name(source.getName()),
+		_contents(readAll(source.getInputStream())),
+		_modRoot(modRoot),
+		_inputStream(_contents.data(), _contents.size())
+	{}
+
+	const std::string& getName() const override
+	{
+		return _name;
+	}
+
+	TextInputStream& getInputStream() override
+	{
+		return _inputStream;
+	}
+
+	std::string getModName() const override
+	{
+		return game::current::getModPath(_modRoot);
+	}
+
+private:
+	static std::string readAll(TextInputStream& stream)
+	{
+		std::string contents;
+		std::size_t length = 0;
+
+		while (true)
+		{
+			contents.resize(length + 65536);
+
+			std::size_t bytesRead = stream.read(&contents[length], contents.size() - length);
+
+			if (bytesRead == 0)
+			{
+				break;
+			}
+
+			length += bytesRead;
+		}
+
+		contents.resize(length);
+
+		return contents;
+	}
+};
+
+}
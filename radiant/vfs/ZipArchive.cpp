@@ -127,7 +127,7 @@ ArchiveTextFilePtr ZipArchive::openTextFile(const std::string& name)
 
 		case ZipRecord::eDeflated:
 			return std::make_shared<DeflatedArchiveTextFile>(
-                name, _fullPath, _containingFolder, _istream.tell(), file->stream_size
+                name, _fullPath, _containingFolder, _istream.tell(), file->stream_size, file->file_size
             );
 		}
 	}